@@ -0,0 +1,413 @@
+/**
+ * @file asset_loader.hpp
+ * @brief Header file for loading meshes and textures in the background.
+ *
+ * This file contains the declaration of the AssetLoader class. Loading an
+ * asset takes three steps, none of which blocks the render loop:
+ * - Reader threads read the file and decode it: mesh files are mapped and
+ *   their pages faulted in, binary PPM images are converted to RGBA8.
+ * - An upload thread, whose OpenGL context shares objects with the main
+ *   context, creates the buffers or the texture, fills them and puts a
+ *   fence sync behind the commands.
+ * - Once a frame, poll checks the fences on the render thread. An asset
+ *   becomes ready only when its fence has signaled, so no draw ever sees
+ *   half uploaded data. Vertex arrays cannot be shared between contexts, so
+ *   poll creates them for finished meshes.
+ *
+ * Without a shared context the uploads run on the render thread instead,
+ * inside poll, limited to FALLBACK_UPLOAD_BUDGET bytes per frame.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "buffer.hpp"
+#include "mesh_file.hpp"
+
+/**
+ * @struct UploadContext
+ * @brief How the upload thread gets an OpenGL context of its own.
+ *
+ * Both functions are called on the upload thread. Leaving makeCurrent
+ * empty makes the loader upload on the render thread.
+ */
+struct UploadContext
+{
+    /**
+     * @var UploadContext::makeCurrent
+     * @brief Makes a context that shares objects with the render context
+     * current, returning false if that failed.
+     */
+    std::function<bool()> makeCurrent;
+
+    /**
+     * @var UploadContext::release
+     * @brief Detaches the context before the upload thread exits.
+     */
+    std::function<void()> release;
+};
+
+/**
+ * @struct AssetLoaderStats
+ * @brief Totals over all assets of a loader.
+ */
+struct AssetLoaderStats
+{
+    std::size_t meshes{ 0 };
+    std::size_t textures{ 0 };
+    std::size_t failed{ 0 };
+    std::size_t bytesUploaded{ 0 };
+};
+
+/**
+ * @class AssetLoader
+ * @brief Reads, decodes and uploads meshes and textures on background
+ * threads and reports when they can be drawn.
+ *
+ * Assets are referred to by the handle returned from loadMesh or
+ * loadTexture. Draw code checks isReady and skips what cannot be drawn yet,
+ * like with the ShaderPipeline.
+ *
+ * @note The AssetLoader class assumes that the OpenGL context has been
+ * properly initialized before it is constructed. Everything but the
+ * background threads runs on the render thread.
+ *
+ * Example:
+ * @code
+ * AssetLoader loader(2, context);
+ * AssetLoader::Handle mesh = loader.loadMesh("scene.htmesh");
+ * // once per frame
+ * loader.poll();
+ * if (loader.isReady(mesh))
+ * {
+ *     loader.getMesh(mesh)->draw();
+ * }
+ * @endcode
+ */
+class AssetLoader
+{
+public:
+    /**
+     * @typedef AssetLoader::Handle
+     * @brief Identifies a requested asset.
+     */
+    using Handle = std::size_t;
+
+    /**
+     * @enum AssetLoader::State
+     * @brief Loading state of a requested asset.
+     */
+    enum class State
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    /**
+     * @var AssetLoader::UPLOAD_CHUNK
+     * @brief Largest block copied with a single call.
+     */
+    static constexpr std::size_t UPLOAD_CHUNK{ std::size_t{ 16 } << 20 };
+
+    /**
+     * @var AssetLoader::FALLBACK_UPLOAD_BUDGET
+     * @brief Bytes uploaded per poll when there is no upload thread.
+     */
+    static constexpr std::size_t FALLBACK_UPLOAD_BUDGET{ std::size_t{ 4 } << 20 };
+
+    /**
+     * @var AssetLoader::MAX_IMAGE_SIZE
+     * @brief Largest width or height of an image, the GL_MAX_TEXTURE_SIZE 
+     * every OpenGL 4.1 implementation supports. Larger headers are rejected 
+     * before any memory is allocated for the pixels.
+     */
+    static constexpr long MAX_IMAGE_SIZE{ 16384 };
+
+    /**
+     * @fn AssetLoader::AssetLoader(std::size_t readers,
+            const UploadContext& context)
+     * @brief Starts the reader threads and, if the context can be made
+     * current, the upload thread.
+     * @param readers Number of threads that read and decode files (at
+     * least one).
+     * @param context Shared context of the upload thread.
+     */
+    AssetLoader(std::size_t readers, const UploadContext& context);
+
+    /**
+     * @fn AssetLoader::~AssetLoader()
+     * @brief Stops the threads and deletes every buffer, texture and fence
+     * of the loader.
+     */
+    ~AssetLoader();
+
+    // Delete copy constructor and copy assignment operator.
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    /**
+     * @fn Handle AssetLoader::loadMesh(const std::string& path)
+     * @brief Requests a mesh file, see MeshFile.
+     * @param path Path of the file.
+     * @return Handle Handle of the mesh.
+     */
+    Handle loadMesh(const std::string& path);
+
+    /**
+     * @fn Handle AssetLoader::loadTexture(const std::string& path)
+     * @brief Requests a binary PPM (P6) image as a mipmapped RGBA8 texture.
+     * @param path Path of the file.
+     * @return Handle Handle of the texture.
+     */
+    Handle loadTexture(const std::string& path);
+
+    /**
+     * @fn void AssetLoader::poll()
+     * @brief Makes the assets whose uploads completed ready. Without an
+     * upload thread it also uploads up to FALLBACK_UPLOAD_BUDGET bytes.
+     * Meant to be called once per frame.
+     */
+    void poll();
+
+    /**
+     * @fn void AssetLoader::finish()
+     * @brief Polls until every requested asset is ready or failed.
+     */
+    void finish();
+
+    /**
+     * @brief Tells whether an asset can be used for drawing.
+     * @param handle Handle from loadMesh or loadTexture.
+     * @return bool true once the upload has completed.
+     */
+    bool isReady(Handle handle) const
+    {
+        return entries_[handle].state == State::Ready;
+    }
+
+    /**
+     * @brief Getter for the loading state of an asset.
+     */
+    State getState(Handle handle) const { return entries_[handle].state; }
+
+    /**
+     * @brief Getter for the buffers of a ready mesh.
+     * @return const BufferSetup* The mesh, nullptr if not ready.
+     */
+    const BufferSetup* getMesh(Handle handle) const
+    {
+        return entries_[handle].mesh.get();
+    }
+
+    /**
+     * @brief Getter for the bounding box of a ready mesh.
+     */
+    const MeshBounds& getBounds(Handle handle) const
+    {
+        return entries_[handle].bounds;
+    }
+
+    /**
+     * @brief Getter for the OpenGL ID of a ready texture, 0 if not ready.
+     */
+    unsigned int getTexture(Handle handle) const
+    {
+        return entries_[handle].texture;
+    }
+
+    /**
+     * @brief Getter for the reason an asset failed.
+     */
+    const std::string& getError(Handle handle) const
+    {
+        return entries_[handle].error;
+    }
+
+    /**
+     * @brief Getter for the milliseconds spent reading and decoding, and
+     * uploading an asset, and from the request until it was ready.
+     */
+    double getReadMs(Handle handle) const { return entries_[handle].readMs; }
+    double getUploadMs(Handle handle) const { return entries_[handle].uploadMs; }
+    double getReadyMs(Handle handle) const { return entries_[handle].readyMs; }
+
+    /**
+     * @brief Getter for the bytes uploaded for an asset.
+     */
+    std::size_t getBytes(Handle handle) const { return entries_[handle].bytes; }
+
+    /**
+     * @brief Getter for the number of requested assets.
+     */
+    std::size_t getAssetCount() const { return entries_.size(); }
+
+    /**
+     * @brief Getter for the number of assets still loading.
+     */
+    std::size_t getPendingCount() const { return pending_; }
+
+    /**
+     * @brief Tells whether uploads run on a shared context.
+     * @return bool true with an upload thread, false if poll uploads.
+     */
+    bool hasUploadThread() const { return uploader_.joinable(); }
+
+    /**
+     * @brief Getter for the totals over all assets.
+     */
+    const AssetLoaderStats& getStats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @enum AssetLoader::Kind
+     * @brief What a request produces.
+     */
+    enum class Kind
+    {
+        Mesh,
+        Texture
+    };
+
+    /**
+     * @struct Task
+     * @brief The work on one asset, handed from thread to thread.
+     */
+    struct Task
+    {
+        Handle handle;
+        Kind kind;
+        std::string path;
+        Clock::time_point requested;
+
+        /**
+         * @brief Output of the reader: the mapped mesh or the decoded
+         * pixels, bottom row first.
+         */
+        std::unique_ptr<MeshFile> mesh;
+        std::vector<std::uint8_t> pixels;
+        int width{ 0 };
+        int height{ 0 };
+
+        /**
+         * @brief Objects created by the upload and its progress: the
+         * section (stream, then indices) or the texture row, and the byte
+         * offset in the section.
+         */
+        std::vector<unsigned int> buffers;
+        unsigned int elementBuffer{ 0 };
+        unsigned int texture{ 0 };
+        std::size_t section{ 0 };
+        std::size_t offset{ 0 };
+        bool started{ false };
+        GLsync fence{ nullptr };
+
+        std::string error;
+        double readMs{ 0.0 };
+        double uploadMs{ 0.0 };
+        std::size_t bytes{ 0 };
+    };
+
+    /**
+     * @struct Entry
+     * @brief State of an asset as the render thread sees it.
+     */
+    struct Entry
+    {
+        Kind kind;
+        State state{ State::Pending };
+        std::unique_ptr<BufferSetup> mesh;
+        MeshBounds bounds{};
+        unsigned int texture{ 0 };
+        std::string error;
+        double readMs{ 0.0 };
+        double uploadMs{ 0.0 };
+        double readyMs{ 0.0 };
+        std::size_t bytes{ 0 };
+    };
+
+    /**
+     * @fn Handle AssetLoader::request(Kind kind, const std::string& path)
+     * @brief Adds an entry and queues its task for the readers.
+     */
+    Handle request(Kind kind, const std::string& path);
+
+    /**
+     * @fn void AssetLoader::readerLoop()
+     * @brief Reads and decodes queued files until the loader stops.
+     */
+    void readerLoop();
+
+    /**
+     * @fn void AssetLoader::uploaderLoop(UploadContext context)
+     * @brief Uploads decoded assets on the shared context until the loader
+     * stops.
+     */
+    void uploaderLoop(UploadContext context);
+
+    /**
+     * @fn void AssetLoader::read(Task& task)
+     * @brief Maps or decodes the file of a task, filling in the error on
+     * failure. Exceptions, such as running out of memory, fail the task 
+     * instead of leaving the reader thread.
+     */
+    static void read(Task& task);
+
+    /**
+     * @fn bool AssetLoader::upload(Task& task, std::size_t& budget)
+     * @brief Continues the upload of a task by at most budget bytes and
+     * fences it when it is complete.
+     * @return bool true once the task is fenced.
+     */
+    static bool upload(Task& task, std::size_t& budget);
+
+    /**
+     * @fn void AssetLoader::complete(Task& task)
+     * @brief Makes the entry of a fenced or failed task ready or failed.
+     */
+    void complete(Task& task);
+
+    /**
+     * @fn void AssetLoader::discard(Task& task)
+     * @brief Deletes the objects and fence of an unfinished task.
+     */
+    static void discard(Task& task);
+
+    /**
+     * @brief Entries by handle; a deque keeps them in place as it grows.
+     */
+    std::deque<Entry> entries_;
+    std::size_t pending_;
+    AssetLoaderStats stats_;
+
+    /**
+     * @brief Tasks waiting for a reader, for an upload and for the render
+     * thread, guarded by mutex_; then tasks waiting for their fence and,
+     * without an upload thread, for their upload, which only the render
+     * thread uses.
+     */
+    std::deque<std::unique_ptr<Task>> readQueue_;
+    std::deque<std::unique_ptr<Task>> uploadQueue_;
+    std::deque<std::unique_ptr<Task>> doneQueue_;
+    std::deque<std::unique_ptr<Task>> fenced_;
+    std::deque<std::unique_ptr<Task>> mainUploads_;
+
+    std::mutex mutex_;
+    std::condition_variable readWake_;
+    std::condition_variable uploadWake_;
+    bool stopping_;
+
+    std::vector<std::thread> readers_;
+    std::thread uploader_;
+};
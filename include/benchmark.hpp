@@ -0,0 +1,187 @@
+/**
+ * @file benchmark.hpp
+ * @brief Header file for the benchmark suite of synthetic scenes.
+ *
+ * This file contains the declarations used by the hello_triangle_bench
+ * program. The suite is a list of SyntheticScene parameters, each varying
+ * one cost of a frame: triangles, draw calls, programs, state changes and
+ * upload sizes. Every case runs headless, first for some warm-up frames
+ * that are not measured and then for the measured frames.
+ *
+ * Results are written as JSON, one flat object of metrics per case. A file
+ * written by an earlier run serves as the baseline of a later one, which
+ * flags every metric that got worse by more than a threshold.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "frame_profiler.hpp"
+#include "scene.hpp"
+
+/**
+ * @struct BenchCase
+ * @brief A named scene of the suite.
+ */
+struct BenchCase
+{
+    std::string name;
+    SyntheticParams params;
+};
+
+/**
+ * @fn std::vector<BenchCase> getBenchSuite()
+ * @brief Getter for the cases of the suite, grouped by the parameter they
+ * vary.
+ */
+std::vector<BenchCase> getBenchSuite();
+
+/**
+ * @struct BenchOptions
+ * @brief Options of a benchmark run.
+ */
+struct BenchOptions
+{
+    std::size_t warmupFrames{ 30 };
+    std::size_t measuredFrames{ 200 };
+    int width{ 640 };
+    int height{ 480 };
+
+    /**
+     * @var BenchOptions::output
+     * @brief JSON file the results are written to.
+     */
+    std::string output{ "bench_results.json" };
+
+    /**
+     * @var BenchOptions::baseline
+     * @brief Results of an earlier run to compare with, empty for none.
+     */
+    std::string baseline;
+
+    /**
+     * @var BenchOptions::threshold
+     * @brief Change in percent beyond which a metric counts as a regression.
+     */
+    double threshold{ 10.0 };
+
+    /**
+     * @var BenchOptions::filter
+     * @brief Only cases whose name contains this text are run.
+     */
+    std::string filter;
+    bool list{ false };
+};
+
+/**
+ * @struct BenchResult
+ * @brief Measurements of one case over its measured frames.
+ */
+struct BenchResult
+{
+    BenchCase benchCase;
+    FrameTimeSummary cpu;
+
+    /**
+     * @var BenchResult::gpu
+     * @brief GPU frame times, without samples if timer queries are missing.
+     */
+    FrameTimeSummary gpu;
+
+    /**
+     * @var BenchResult::seconds
+     * @brief Wall time of the measured frames, including a final glFinish.
+     */
+    double seconds{ 0.0 };
+    std::uint64_t draws{ 0 };
+    std::uint64_t triangles{ 0 };
+    std::uint64_t bytesUploaded{ 0 };
+    std::uint64_t bindsIssued{ 0 };
+};
+
+/**
+ * @typedef BenchMetrics
+ * @brief Named values of a case, in the order they are written.
+ */
+using BenchMetrics = std::vector<std::pair<std::string, double>>;
+
+/**
+ * @struct BenchFile
+ * @brief Contents of a results file.
+ */
+struct BenchFile
+{
+    /**
+     * @var BenchFile::renderer
+     * @brief GL_RENDERER of the run, numbers of different renderers do not
+     * compare.
+     */
+    std::string renderer;
+    std::vector<std::pair<std::string, BenchMetrics>> cases;
+};
+
+/**
+ * @fn BenchResult runBenchCase(const BenchCase& benchCase,
+        const BenchOptions& options)
+ * @brief Builds the scene of a case and renders its warm-up and measured
+ * frames.
+ *
+ * Programs are built before the first frame. The draws are issued in the
+ * order the scene submits them, so the state changes are not sorted away.
+ *
+ * @param benchCase The case to run.
+ * @param options Frame counts of the run.
+ * @throws std::logic_error if the scene fails to build.
+ * @return BenchResult The measurements.
+ * @note A current OpenGL context with a bound framebuffer is required.
+ */
+BenchResult runBenchCase(const BenchCase& benchCase, const BenchOptions& options);
+
+/**
+ * @fn BenchMetrics getBenchMetrics(const BenchResult& result)
+ * @brief Converts a result to the metrics written for it: its parameters,
+ * frame time percentiles and throughput.
+ */
+BenchMetrics getBenchMetrics(const BenchResult& result);
+
+/**
+ * @fn bool writeBenchResults(const std::string& path,
+        const BenchOptions& options, const std::vector<BenchResult>& results)
+ * @brief Writes the results of a run as JSON.
+ * @return bool true if the file was written.
+ */
+bool writeBenchResults(const std::string& path, const BenchOptions& options,
+                       const std::vector<BenchResult>& results);
+
+/**
+ * @fn bool readBenchResults(const std::string& path, BenchFile& file)
+ * @brief Reads a file written by writeBenchResults.
+ *
+ * Only the shape writeBenchResults produces is understood: every "name"
+ * starts a case and every number that follows belongs to it.
+ *
+ * @return bool true if the file holds at least one case.
+ */
+bool readBenchResults(const std::string& path, BenchFile& file);
+
+/**
+ * @fn std::size_t compareBenchResults(const BenchFile& baseline,
+        const std::vector<BenchResult>& results, double threshold)
+ * @brief Prints how the key metrics of every case changed against a
+ * baseline.
+ *
+ * Frame times are worse when they grow, draws and triangles per second
+ * when they shrink. Cases and metrics missing from the baseline are
+ * skipped.
+ *
+ * @param baseline Results of an earlier run.
+ * @param results Results of this run.
+ * @param threshold Change in percent that counts as a regression.
+ * @return std::size_t Number of regressed metrics.
+ */
+std::size_t compareBenchResults(const BenchFile& baseline,
+                                const std::vector<BenchResult>& results,
+                                double threshold);
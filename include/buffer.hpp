@@ -4,7 +4,42 @@
  */
 #pragma once
 #include <glad/glad.h> 
+#include <cstdint>
+#include <stdexcept>
 #include <vector>
+#include "buffer_arena.hpp"
+#include "mesh.hpp"
+#include "mesh_file.hpp"
+#include "streaming_buffer.hpp"
+#include "vertex_layout.hpp"
+
+/**
+ * @struct InstanceAttribute
+ * @brief Describes one vertex attribute that is read from an instance buffer.
+ * 
+ * Attributes of one instance buffer are interleaved in the order they are 
+ * listed, so the stride of the buffer is the sum of their components.
+ */
+struct InstanceAttribute
+{
+    /**
+     * @var InstanceAttribute::location
+     * @brief Attribute location in the vertex shader.
+     */
+    GLuint location;
+
+    /**
+     * @var InstanceAttribute::components
+     * @brief Number of float components (1 to 4).
+     */
+    GLint components;
+
+    /**
+     * @var InstanceAttribute::divisor
+     * @brief Number of instances that share one value (usually 1).
+     */
+    GLuint divisor{ 1 };
+};
 
 /**
  * @class BufferSetup
@@ -34,6 +69,73 @@
  * BufferSetup(vertices, GL_STATIC_DRAW);
  * @endcode
  * 
+ * Per-instance data, such as an offset and a color for each copy of the 
+ * mesh, is added with addInstanceBuffer and drawn with drawInstanced, which 
+ * draws every copy with a single draw call.
+ * 
+ * Example:
+ * @code
+ * BufferSetup mesh(vertices);
+ * // Two instances with a vec2 offset at location 1 and a vec3 color at 2
+ * std::vector<float> instances = {
+ *     -0.5f, 0.0f,   1.0f, 0.0f, 0.0f,
+ *      0.5f, 0.0f,   0.0f, 0.0f, 1.0f
+ * };
+ * mesh.addInstanceBuffer(instances, { {1, 2}, {2, 3} });
+ * mesh.drawInstanced(2);
+ * @endcode
+ * 
+ * Indexed meshes, usually the output of processMesh, keep an element 
+ * buffer in the same VAO. draw and drawInstanced then use glDrawElements.
+ * 
+ * Example:
+ * @code
+ * MeshProcessReport report;
+ * BufferSetup indexedMesh(processMesh(triangleSoup, report));
+ * indexedMesh.draw();
+ * @endcode
+ * 
+ * Vertices with more than a position, or in compact formats, are described 
+ * by a VertexLayout and packed with packVertices. Every stream of the 
+ * layout gets its own vertex buffer.
+ * 
+ * Example:
+ * @code
+ * VertexLayout layout;
+ * layout.add(0, 3, AttributeFormat::Half)
+ *       .add(1, 4, AttributeFormat::Snorm2_10_10_10);
+ * BufferSetup packedMesh(layout, packVertices(layout, { positions, normals }, 
+ *                                             vertexCount), indices);
+ * @endcode
+ * 
+ * Many small meshes should share the buffers of a BufferArena instead of 
+ * each creating buffers and a vertex array of its own. A BufferSetup made 
+ * from an arena is a handle to its range of the arena's buffers: it uses 
+ * the arena's VAO, is drawn from getFirstVertex (and getFirstIndex), and 
+ * returns its range when it is destroyed.
+ * 
+ * Example:
+ * @code
+ * BufferArena arena(positionLayout, 65536, 65536);
+ * std::vector<BufferSetup> meshes;
+ * meshes.emplace_back(arena, triangleVertices);
+ * meshes.emplace_back(arena, quadMesh);
+ * @endcode
+ * 
+ * Geometry that changes every frame is written into a StreamingBuffer 
+ * instead. A BufferSetup constructed from the stream describes its vertices, 
+ * and each frame draws the range that was just written.
+ * 
+ * Example:
+ * @code
+ * StreamingBuffer stream(GL_ARRAY_BUFFER, maxBytes);
+ * BufferSetup dynamicMesh(stream);
+ * // ... per frame: map, write, then
+ * GLintptr offset = stream.commit(bytes);
+ * dynamicMesh.draw(offset / (3 * sizeof(float)), vertexCount);
+ * stream.endFrame();
+ * @endcode
+ * 
  * @section Dependencies
  * This class requires the following dependencies:
  * - OpenGL headers (e.g., GL/glew.h, GL/gl.h)
@@ -60,38 +162,337 @@ public:
      */
     BufferSetup(const std::vector<float>& vertices, 
             const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn BufferSetup::BufferSetup(const Mesh& mesh, 
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+     * @brief Indexed BufferSetup constructor.
+     * 
+     * This constructor uploads the vertices like the default constructor 
+     * and the indices into an element buffer that is bound to the VAO.
+     * 
+     * @param mesh The vertices, three floats each, and triangle indices.
+     * @param DRAW_TYPE openGl Enum The drawing usage type of the data. 
+     * @return void This function does not return a value.
+     */
+    explicit BufferSetup(const Mesh& mesh, 
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn BufferSetup::BufferSetup(const VertexLayout& layout, 
+            const std::vector<std::vector<std::uint8_t>>& streams,
+            const std::vector<GLuint>& indices,
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+     * @brief Vertex layout BufferSetup constructor.
+     * 
+     * This constructor uploads every stream into its own vertex buffer and 
+     * points each attribute of the layout at its type, normalization and 
+     * offset. The indices go into an element buffer unless they are empty.
+     * 
+     * @param layout Attributes and streams of a vertex.
+     * @param streams Packed bytes of every stream, e.g. from packVertices.
+     * @param indices Triangle indices, or empty for a non-indexed mesh.
+     * @param DRAW_TYPE openGl Enum The drawing usage type of the data. 
+     * @throws std::logic_error if the streams do not match the layout.
+     * @return void This function does not return a value.
+     */
+    BufferSetup(const VertexLayout& layout, 
+            const std::vector<std::vector<std::uint8_t>>& streams,
+            const std::vector<GLuint>& indices,
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn BufferSetup::BufferSetup(const MeshFile& file, 
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+     * @brief Mesh file BufferSetup constructor.
+     * 
+     * This constructor creates the buffers of the file's vertex layout and 
+     * fills them straight from the mapped sections of the file, without a 
+     * copy in between. Sections larger than 64 MiB are uploaded in pieces.
+     * 
+     * @param file The mapped mesh file. It only needs to live until the 
+     * constructor returns.
+     * @param DRAW_TYPE openGl Enum The drawing usage type of the data. 
+     * @return void This function does not return a value.
+     */
+    explicit BufferSetup(const MeshFile& file, 
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn BufferSetup::BufferSetup(const VertexLayout& layout, 
+            const std::vector<unsigned int>& buffers, 
+            unsigned int elementBuffer, GLsizei vertexCount, 
+            GLsizei indexCount)
+     * @brief Adopting BufferSetup constructor.
+     * 
+     * This constructor takes over buffers that were created and filled 
+     * elsewhere, e.g. on a shared upload context, and only creates the VAO, 
+     * which cannot be shared between contexts.
+     * 
+     * @param layout Attributes and streams of a vertex.
+     * @param buffers One filled vertex buffer per stream of the layout.
+     * @param elementBuffer Filled element buffer, or 0 if not indexed.
+     * @param vertexCount Number of vertices in the buffers.
+     * @param indexCount Number of indices in the element buffer.
+     * @throws std::logic_error if the buffers do not match the layout.
+     * @return void This function does not return a value.
+     */
+    BufferSetup(const VertexLayout& layout, 
+            const std::vector<unsigned int>& buffers, unsigned int elementBuffer,
+            GLsizei vertexCount, GLsizei indexCount);
+
+    /**
+     * @fn BufferSetup::BufferSetup(BufferArena& arena, 
+            const std::vector<float>& vertices)
+     * @brief Arena BufferSetup constructor for a non-indexed mesh.
+     * 
+     * This constructor copies the vertices into a range of the arena, whose 
+     * layout must have a single stream.
+     * 
+     * @param arena The arena that holds the mesh. It must outlive the 
+     * BufferSetup.
+     * @param vertices The vertex data in the arena's layout.
+     * @throws std::logic_error if the arena has more than one stream.
+     * @return void This function does not return a value.
+     */
+    BufferSetup(BufferArena& arena, const std::vector<float>& vertices);
+
+    /**
+     * @fn BufferSetup::BufferSetup(BufferArena& arena, const Mesh& mesh)
+     * @brief Arena BufferSetup constructor for an indexed mesh.
+     * @param arena The arena that holds the mesh. It must outlive the 
+     * BufferSetup.
+     * @param mesh The vertices, in the arena's single stream, and indices.
+     * @throws std::logic_error if the arena has more than one stream.
+     * @return void This function does not return a value.
+     */
+    BufferSetup(BufferArena& arena, const Mesh& mesh);
+
+    /**
+     * @fn BufferSetup::BufferSetup(BufferArena& arena, 
+            const std::vector<std::vector<std::uint8_t>>& streams,
+            const std::vector<GLuint>& indices)
+     * @brief Arena BufferSetup constructor for packed vertices.
+     * @param arena The arena that holds the mesh. It must outlive the 
+     * BufferSetup.
+     * @param streams Packed bytes of every stream of the arena's layout.
+     * @param indices Triangle indices, or empty for a non-indexed mesh.
+     * @throws std::logic_error if the streams do not match the layout.
+     * @return void This function does not return a value.
+     */
+    BufferSetup(BufferArena& arena, 
+            const std::vector<std::vector<std::uint8_t>>& streams,
+            const std::vector<GLuint>& indices);
+
+    /**
+     * @fn BufferSetup::BufferSetup(const StreamingBuffer& stream);
+     * @brief Streaming BufferSetup constructor.
+     * 
+     * This constructor generates a VAO that reads its vertices from the 
+     * buffer of a StreamingBuffer. No vertices are uploaded; the stream 
+     * provides new ones every frame, which are drawn by range.
+     * 
+     * @param stream The streaming buffer holding three floats per vertex.
+     * @return void This function does not return a value.
+     */
+    explicit BufferSetup(const StreamingBuffer& stream);
     
     /**
-     * @brief Default destructor for the BufferSetup class.
+     * @fn BufferSetup::~BufferSetup()
+     * @brief Destructor for the BufferSetup class.
      * 
-     * This destructor is defined as the default, meaning it will automatically
-     * clean up any resources managed by the BufferSetup class when an instance of the
-     * class is destroyed.
+     * This destructor deletes the buffers and the vertex array created by 
+     * the BufferSetup, or returns its range to the arena it came from. The 
+     * buffer of a StreamingBuffer is left to its owner.
      */
-    ~BufferSetup() = default;
+    ~BufferSetup();
 
     // Delete copy constructor and copy assignment operator.
+    BufferSetup(const BufferSetup&) = delete;
     BufferSetup& operator=(const BufferSetup&) = delete;
 
     /**
+     * @fn BufferSetup::BufferSetup(BufferSetup&& other) noexcept
+     * @brief Takes over the GL objects or arena range of another BufferSetup, 
+     * which is left empty.
+     */
+    BufferSetup(BufferSetup&& other) noexcept;
+
+    /**
+     * @fn BufferSetup& BufferSetup::operator=(BufferSetup&& other) noexcept
+     * @brief Releases the own GL objects or arena range, then takes over 
+     * those of other.
+     */
+    BufferSetup& operator=(BufferSetup&& other) noexcept;
+
+    /**
+     * @fn unsigned int BufferSetup::getVBOId() const
      * @brief Getter for VBO_
      * 
-     * This function returns the unique ID of the Vertex Buffer Object (VBO).
+     * This function returns the unique ID of the Vertex Buffer Object (VBO), 
+     * which is the arena's first vertex buffer for arena meshes.
      * 
      * @return unsigned int The unique ID of the VBO.
      */
-    unsigned int getVBOId() const { return VBO_; }
+    unsigned int getVBOId() const;
 
     /**
+     * @fn unsigned int BufferSetup::getVAOId() const
      * @brief Getter for VAO
      * 
-     * This function returns the unique ID of the Vertex Array Object (VAO).
+     * This function returns the unique ID of the Vertex Array Object (VAO), 
+     * which arena meshes share with the rest of their arena.
      * 
      * @return unsigned int The unique ID of the VAO.
      */
-    unsigned int getVAOId() const { return VAO_; }
+    unsigned int getVAOId() const;
+
+    /**
+     * @fn unsigned int BufferSetup::getEBOId() const
+     * @brief Getter for EBO_
+     * 
+     * This function returns the unique ID of the Element Buffer Object (EBO).
+     * 
+     * @return unsigned int The unique ID of the EBO, or 0 if not indexed.
+     */
+    unsigned int getEBOId() const;
+
+    /**
+     * @fn GLint BufferSetup::getFirstVertex() const
+     * @brief First vertex of the mesh in its vertex buffer, to draw from or 
+     * to use as base vertex. Always 0 outside an arena.
+     */
+    GLint getFirstVertex() const;
+
+    /**
+     * @fn GLuint BufferSetup::getFirstIndex() const
+     * @brief First index of the mesh in its element buffer. Always 0 outside 
+     * an arena.
+     */
+    GLuint getFirstIndex() const;
+
+    /**
+     * @brief Getter for the number of indices in the element buffer.
+     * @return GLsizei Number of indices, or 0 if not indexed.
+     */
+    GLsizei getIndexCount() const { return indexCount_; }
+
+    /**
+     * @brief Tells whether the VAO has an element buffer.
+     * @return bool true for an indexed mesh.
+     */
+    bool isIndexed() const { return indexCount_ > 0; }
+
+    /**
+     * @brief Getter for the number of vertices in the vertex buffer.
+     * @return GLsizei Number of vertices.
+     */
+    GLsizei getVertexCount() const { return vertexCount_; }
+
+    /**
+     * @brief Getter for the number of instances described by the instance 
+     * buffers.
+     * @return GLsizei Number of instances, or 0 without instance buffers.
+     */
+    GLsizei getInstanceCount() const { return instanceCount_; }
+
+    /**
+     * @fn void BufferSetup::addInstanceBuffer(const std::vector<float>& data,
+            const std::vector<InstanceAttribute>& attributes, 
+            const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+     * @brief Uploads per-instance data into a new buffer of the VAO.
+     * 
+     * The buffer holds the listed attributes interleaved, and each attribute 
+     * advances once per divisor instances instead of once per vertex.
+     * 
+     * @param data Interleaved attribute values of all instances.
+     * @param attributes Layout of one instance in the buffer.
+     * @param DRAW_TYPE openGl Enum The drawing usage type of the data.
+     * @throws std::logic_error if the layout is empty or does not divide 
+     * the data evenly, or if the mesh shares the VAO of an arena.
+     * @return void This function does not return a value.
+     */
+    void addInstanceBuffer(const std::vector<float>& data, 
+                           const std::vector<InstanceAttribute>& attributes,
+                           const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn void BufferSetup::setInstanceIndices(GLuint location, 
+            unsigned int buffer, GLintptr offset)
+     * @brief Points an unsigned integer attribute, advancing once per 
+     * instance, at a range of another buffer.
+     * 
+     * Used to draw a list of instance indices, such as the visible ones 
+     * after culling, that is streamed to a new offset every frame.
+     * 
+     * @param location Attribute location, declared as uint in the shader.
+     * @param buffer The buffer holding one GLuint per instance.
+     * @param offset Byte offset of the first index.
+     * @throws std::logic_error if the mesh shares the VAO of an arena.
+     */
+    void setInstanceIndices(GLuint location, unsigned int buffer, 
+                            GLintptr offset);
+
+    /**
+     * @fn void BufferSetup::draw(GLenum mode) const
+     * @brief Draws all vertices once, or all indices of an indexed mesh.
+     * @param mode The primitive type to draw.
+     * @return void This function does not return a value.
+     */
+    void draw(GLenum mode=GL_TRIANGLES) const;
+
+    /**
+     * @fn void BufferSetup::draw(GLint first, GLsizei count, GLenum mode) 
+            const
+     * @brief Draws a range of vertices, e.g. the segment of a stream that 
+     * was written in this frame.
+     * @param first Index of the first vertex to draw.
+     * @param count Number of vertices to draw.
+     * @param mode The primitive type to draw.
+     * @return void This function does not return a value.
+     */
+    void draw(GLint first, GLsizei count, GLenum mode=GL_TRIANGLES) const;
+
+    /**
+     * @fn void BufferSetup::drawInstanced(GLsizei instances, GLenum mode) const
+     * @brief Draws all vertices (or indices) once per instance with one 
+     * draw call.
+     * @param instances Number of instances to draw.
+     * @param mode The primitive type to draw.
+     * @return void This function does not return a value.
+     */
+    void drawInstanced(GLsizei instances, GLenum mode=GL_TRIANGLES) const;
 
 private:
+   /**
+    * @fn void BufferSetup::release()
+    * @brief Deletes the GL objects or frees the arena range.
+    **/
+   void release();
+
+   /**
+    * @fn void BufferSetup::createStreams(const VertexLayout& layout,
+           const std::vector<const void*>& streams, 
+           const std::vector<std::size_t>& sizes, const GLuint* indices,
+           const GLenum& DRAW_TYPE)
+    * @brief Creates the VAO, a vertex buffer per stream of the layout and, 
+    * if indexCount_ is set, the element buffer, and uploads the data.
+    **/
+   void createStreams(const VertexLayout& layout, 
+                      const std::vector<const void*>& streams,
+                      const std::vector<std::size_t>& sizes,
+                      const GLuint* indices, const GLenum& DRAW_TYPE);
+
+   /**
+    * @fn void BufferSetup::allocateFrom(std::size_t vertexCount,
+           const std::vector<const void*>& streams, 
+           const std::vector<GLuint>& indices)
+    * @brief Copies a mesh into arena_ and remembers its handle.
+    **/
+   void allocateFrom(std::size_t vertexCount, 
+                     const std::vector<const void*>& streams,
+                     const std::vector<GLuint>& indices);
+
    /**
     * @brief ID created for Vertex Buffer. 
     **/
@@ -101,4 +502,47 @@ private:
     * @brief ID created for Vertex Array Object. 
     **/
    unsigned int VAO_;
+
+    /**
+    * @brief ID created for Element Buffer, 0 if not indexed. 
+    **/
+   unsigned int EBO_;
+
+    /**
+    * @brief IDs created for the vertex streams after the first, which is 
+    * VBO_.
+    **/
+   std::vector<unsigned int> streamVBOs_;
+
+    /**
+    * @brief IDs created for the per-instance Vertex Buffers.
+    **/
+   std::vector<unsigned int> instanceVBOs_;
+
+    /**
+    * @brief Number of vertices in the vertex buffer.
+    **/
+   GLsizei vertexCount_;
+
+    /**
+    * @brief Number of indices in the element buffer.
+    **/
+   GLsizei indexCount_;
+
+    /**
+    * @brief Number of instances described by the instance buffers.
+    **/
+   GLsizei instanceCount_;
+
+    /**
+    * @brief Whether VBO_ was created here, rather than by a stream.
+    **/
+   bool ownsVertexBuffer_;
+
+    /**
+    * @brief Arena holding the mesh and the mesh's handle in it, or nullptr 
+    * for a mesh with buffers of its own.
+    **/
+   BufferArena* arena_;
+   BufferArena::Handle allocation_;
 };
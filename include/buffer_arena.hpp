@@ -0,0 +1,224 @@
+/**
+ * @file buffer_arena.hpp
+ * @brief Header file for sharing a few large GPU buffers between many 
+ * meshes.
+ * 
+ * This file contains the declaration of the BufferArena class. Instead of 
+ * one vertex buffer, element buffer and vertex array per mesh, every mesh 
+ * of an arena is a range of vertices and a range of indices inside the 
+ * arena's buffers, handed out by an OffsetAllocator. All meshes share the 
+ * arena's vertex array and are drawn with a first vertex or a base vertex, 
+ * so switching meshes needs no bind at all.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "offset_allocator.hpp"
+#include "vertex_layout.hpp"
+
+/**
+ * @struct BufferArenaStats
+ * @brief Sizes and maintenance work of a BufferArena.
+ */
+struct BufferArenaStats
+{
+    std::size_t allocations{ 0 };
+    std::size_t usedVertices{ 0 };
+    std::size_t vertexCapacity{ 0 };
+    std::size_t usedIndices{ 0 };
+    std::size_t indexCapacity{ 0 };
+
+    /**
+     * @var BufferArenaStats::fragmentation
+     * @brief 1 - largest free vertex range / free vertices (0 = one hole).
+     */
+    double fragmentation{ 0.0 };
+
+    std::size_t grows{ 0 };
+    std::size_t defragmentations{ 0 };
+
+    /**
+     * @var BufferArenaStats::bytesMoved
+     * @brief Bytes copied on the GPU by grow and defragment.
+     */
+    std::size_t bytesMoved{ 0 };
+};
+
+/**
+ * @class BufferArena
+ * @brief Vertex buffers in one layout, an element buffer and a vertex array 
+ * shared by all meshes allocated from them.
+ * 
+ * Vertex ranges are counted in vertices, so the offset of a mesh is its 
+ * first (or base) vertex in every stream of the layout, and index ranges 
+ * are counted in indices. Indices stay relative to their mesh and are drawn 
+ * with glDrawElementsBaseVertex, so meshes can move without rewriting them.
+ * 
+ * When an allocation does not fit the arena first defragments, if the free 
+ * space would be enough in one piece, and otherwise doubles its buffers. 
+ * Both copy the live ranges on the GPU with glCopyBufferSubData. Offsets of 
+ * a mesh may therefore change between frames; they are read through its 
+ * handle whenever the mesh is drawn.
+ * 
+ * @note The BufferArena class assumes that the OpenGL context has been 
+ * properly initialized before any of its methods are called.
+ * 
+ * Example:
+ * @code
+ * VertexLayout positions;
+ * positions.add(0, 3, AttributeFormat::Float32);
+ * BufferArena arena(positions, 65536, 0);
+ * BufferSetup triangle(arena, triangleVertices);
+ * glBindVertexArray(arena.getVAOId());
+ * glDrawArrays(GL_TRIANGLES, triangle.getFirstVertex(), 3);
+ * @endcode
+ */
+class BufferArena
+{
+public:
+    /**
+     * @typedef BufferArena::Handle
+     * @brief Identifies one mesh of the arena.
+     */
+    using Handle = std::size_t;
+
+    /**
+     * @fn BufferArena::BufferArena(const VertexLayout& layout, 
+            std::uint32_t vertexCapacity, std::uint32_t indexCapacity)
+     * @brief Creates the buffers and the vertex array.
+     * @param layout Attributes and streams of every vertex.
+     * @param vertexCapacity Initial number of vertices.
+     * @param indexCapacity Initial number of indices.
+     */
+    BufferArena(const VertexLayout& layout, std::uint32_t vertexCapacity, 
+                std::uint32_t indexCapacity);
+
+    /**
+     * @fn BufferArena::~BufferArena()
+     * @brief Deletes the buffers and the vertex array.
+     */
+    ~BufferArena();
+
+    // Delete copy constructor and copy assignment operator.
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+
+    /**
+     * @fn BufferArena::Handle BufferArena::allocate(std::size_t vertexCount,
+            const std::vector<const void*>& streams, const GLuint* indices,
+            std::size_t indexCount)
+     * @brief Copies a mesh into the arena.
+     * @param vertexCount Number of vertices.
+     * @param streams The vertices of every stream of the layout.
+     * @param indices Indices relative to the mesh, or nullptr.
+     * @param indexCount Number of indices.
+     * @throws std::logic_error if the streams do not match the layout, or 
+     * if the mesh does not fit even after growing the buffers.
+     * @return Handle The handle of the mesh.
+     */
+    Handle allocate(std::size_t vertexCount, 
+                    const std::vector<const void*>& streams, 
+                    const GLuint* indices, std::size_t indexCount);
+
+    /**
+     * @fn void BufferArena::free(Handle handle)
+     * @brief Returns the ranges of a mesh to the arena.
+     */
+    void free(Handle handle);
+
+    /**
+     * @fn void BufferArena::defragment()
+     * @brief Moves all meshes to the front of the buffers, leaving the free 
+     * space in one piece.
+     */
+    void defragment();
+
+    /**
+     * @fn GLint BufferArena::getFirstVertex(Handle handle) const
+     * @brief First vertex of a mesh, its base vertex when drawn indexed.
+     */
+    GLint getFirstVertex(Handle handle) const;
+
+    /**
+     * @fn GLuint BufferArena::getFirstIndex(Handle handle) const
+     * @brief First index of a mesh in the element buffer.
+     */
+    GLuint getFirstIndex(Handle handle) const;
+
+    /**
+     * @brief Getter for the shared vertex array.
+     * @return unsigned int The unique ID of the VAO.
+     */
+    unsigned int getVAOId() const { return VAO_; }
+
+    /**
+     * @brief Getter for the vertex buffer of a stream.
+     * @return unsigned int The unique ID of the VBO.
+     */
+    unsigned int getVBOId(std::size_t stream=0) const { return VBOs_[stream]; }
+
+    /**
+     * @brief Getter for the element buffer.
+     * @return unsigned int The unique ID of the EBO.
+     */
+    unsigned int getEBOId() const { return EBO_; }
+
+    /**
+     * @brief Getter for the layout of the vertices.
+     */
+    const VertexLayout& getLayout() const { return layout_; }
+
+    /**
+     * @fn BufferArenaStats BufferArena::getStats() const
+     * @brief Current sizes and the maintenance work done so far.
+     */
+    BufferArenaStats getStats() const;
+
+private:
+    /**
+     * @struct Slot
+     * @brief The vertex and index ranges of one mesh.
+     */
+    struct Slot
+    {
+        std::uint32_t vertexNode;
+        std::uint32_t indexNode;
+        bool live;
+    };
+
+    /**
+     * @fn void BufferArena::reserve(std::uint32_t vertices, 
+            std::uint32_t indices)
+     * @brief Makes room for ranges of the given sizes, by defragmenting or 
+     * growing.
+     */
+    void reserve(std::uint32_t vertices, std::uint32_t indices);
+
+    /**
+     * @fn void BufferArena::rebuild(std::uint32_t vertexCapacity, 
+            std::uint32_t indexCapacity)
+     * @brief Replaces the buffers with new ones and copies the live ranges 
+     * to their front.
+     * @throws std::logic_error if the live ranges do not fit the capacities.
+     */
+    void rebuild(std::uint32_t vertexCapacity, std::uint32_t indexCapacity);
+
+    /**
+     * @fn void BufferArena::bindAttributes()
+     * @brief Points the vertex array at the current buffers.
+     */
+    void bindAttributes();
+
+    VertexLayout layout_;
+    unsigned int VAO_;
+    std::vector<unsigned int> VBOs_;
+    unsigned int EBO_;
+    OffsetAllocator vertices_;
+    OffsetAllocator indices_;
+    std::vector<Slot> slots_;
+    std::vector<Handle> freeSlots_;
+    BufferArenaStats stats_;
+};
@@ -0,0 +1,146 @@
+/**
+ * @file dynamic_resolution.hpp
+ * @brief Header file for holding a GPU frame time budget by changing the
+ * rendering resolution.
+ *
+ * This file contains the declaration of the ResolutionController class.
+ * GPU time of a fill-bound frame grows with the number of pixels, which
+ * grows with the square of the render scale. The controller reads the GPU
+ * frame times as the FrameProfiler gets them back, a few frames late, and
+ * picks the scale at which the frame would have fit the budget with some
+ * headroom. Every frame's scale is remembered, so a late time is always
+ * measured against the scale it was rendered at.
+ *
+ * A frame over budget lowers the scale at once, to ride out a load spike;
+ * frames under budget raise it a step at a time, so the scale does not
+ * bounce between two levels.
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class ResolutionController
+ * @brief Adjusts the render scale from measured GPU frame times.
+ *
+ * Example:
+ * @code
+ * ResolutionController resolution(16.6, 1.0f, 0.5f);
+ * while (running)
+ * {
+ *     resolution.beginFrame(frame);
+ *     target.bind(resolution.getScale());
+ *     // ... draw, upsample, swap ...
+ *     if (profiler.getLatestGpuFrame(timedFrame, gpuMs))
+ *     {
+ *         resolution.addGpuTime(timedFrame, gpuMs);
+ *     }
+ * }
+ * @endcode
+ */
+class ResolutionController
+{
+public:
+    /**
+     * @var ResolutionController::HISTORY
+     * @brief Frames whose scale is remembered, more than the profiler's
+     * query latency.
+     */
+    static constexpr std::size_t HISTORY{ 16 };
+
+    /**
+     * @var ResolutionController::HEADROOM
+     * @brief Share of the budget the scale is chosen to fill.
+     */
+    static constexpr double HEADROOM{ 0.9 };
+
+    /**
+     * @var ResolutionController::RAISE_STEP
+     * @brief Largest increase of the scale per measured frame.
+     */
+    static constexpr float RAISE_STEP{ 0.02f };
+
+    /**
+     * @fn ResolutionController::ResolutionController(double budgetMs,
+            float scale, float minScale)
+     * @brief Creates a controller.
+     * @param budgetMs GPU frame time to hold in milliseconds; 0 keeps the
+     * scale fixed and only counts the frames over it.
+     * @param scale Scale of the first frames, in (0, 1].
+     * @param minScale Lowest scale the controller goes to, in (0, 1].
+     */
+    ResolutionController(double budgetMs, float scale, float minScale);
+
+    /**
+     * @fn void ResolutionController::beginFrame(std::size_t frame)
+     * @brief Records the current scale as that of a new frame.
+     * @param frame Number of the frame, as counted by the FrameProfiler.
+     */
+    void beginFrame(std::size_t frame);
+
+    /**
+     * @fn void ResolutionController::addGpuTime(std::size_t frame,
+            double milliseconds)
+     * @brief Counts a frame's GPU time against the budget and adjusts the
+     * scale. Times of frames already added, or too old to have a
+     * recorded scale, are ignored.
+     * @param frame Number of the frame.
+     * @param milliseconds Its GPU frame time.
+     */
+    void addGpuTime(std::size_t frame, double milliseconds);
+
+    /**
+     * @brief Getter for the scale of the next frame.
+     */
+    float getScale() const { return scale_; }
+
+    double getBudgetMs() const { return budgetMs_; }
+    float getMinScale() const { return minScale_; }
+
+    /**
+     * @brief Getter for the number of frames whose GPU time was added, and
+     * of those over the budget.
+     */
+    std::uint64_t getTimedFrames() const { return timed_; }
+    std::uint64_t getMisses() const { return misses_; }
+
+    /**
+     * @brief Getter for the number of times the scale changed.
+     */
+    std::uint64_t getChanges() const { return changes_; }
+
+    /**
+     * @brief Getter for the lowest, highest and mean scale of the frames
+     * begun so far.
+     */
+    float getLowestScale() const { return lowest_; }
+    float getHighestScale() const { return highest_; }
+    double getMeanScale() const { return frames_ > 0 ? scaleSum_ / frames_ : scale_; }
+
+private:
+    double budgetMs_;
+    float scale_;
+    float minScale_;
+
+    /**
+     * @brief Scale of the recent frames, indexed by frame number modulo
+     * HISTORY, and the number of the newest frame begun.
+     */
+    std::array<float, HISTORY> history_;
+    std::size_t newestFrame_;
+
+    /**
+     * @brief Whether a GPU time was added yet, and the frame of the newest.
+     */
+    bool measured_;
+    std::size_t measuredFrame_;
+
+    std::uint64_t timed_;
+    std::uint64_t misses_;
+    std::uint64_t changes_;
+    std::uint64_t frames_;
+    double scaleSum_;
+    float lowest_;
+    float highest_;
+};
@@ -0,0 +1,311 @@
+/**
+ * @file frame_capture.hpp
+ * @brief Header file for saving rendered frames to disk without stalling
+ * the render loop.
+ *
+ * Reading a frame with glReadPixels into client memory makes the driver
+ * wait until the GPU has finished the frame. The FrameCapture instead reads
+ * every frame into a pixel pack buffer and places a fence behind the copy;
+ * the copy then runs on the GPU while the next frames are built. Frames
+ * whose fences have signalled are handed to encoder threads, which write
+ * them as PNG or as uncompressed binary PPM files. A ring of buffers keeps
+ * several frames in flight. A frame that finds no free buffer waits for the
+ * oldest one, so every frame is written; dropping such frames and counting
+ * them instead can be asked for.
+ *
+ * The PNG encoder needs no library: rows are filtered with the Up filter,
+ * which turns what repeats from one row to the next into zeros, and
+ * compressed with a single fixed Huffman deflate block and greedy LZ77
+ * matching.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @enum CaptureFormat
+ * @brief File format of captured frames.
+ */
+enum class CaptureFormat
+{
+    Png,
+    Raw
+};
+
+/**
+ * @fn bool parseCaptureFormat(const std::string& name, CaptureFormat& format)
+ * @brief Converts "png" or "raw" to a capture format.
+ * @param name Name of the format.
+ * @param format Set to the format if the name is known.
+ * @return bool true if the name is known.
+ */
+bool parseCaptureFormat(const std::string& name, CaptureFormat& format);
+
+/**
+ * @fn std::vector<std::uint8_t> encodePng(const std::uint8_t* pixels,
+        int width, int height)
+ * @brief Encodes RGBA8 pixels as an 8 bit RGB PNG file, dropping alpha.
+ * @param pixels width * height pixels, bottom row first as OpenGL reads them.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @return std::vector<std::uint8_t> The bytes of the file.
+ */
+std::vector<std::uint8_t> encodePng(const std::uint8_t* pixels, int width,
+                                    int height);
+
+/**
+ * @fn std::vector<std::uint8_t> encodePpm(const std::uint8_t* pixels,
+        int width, int height)
+ * @brief Encodes RGBA8 pixels as a binary PPM (P6) file, dropping alpha.
+ * @param pixels width * height pixels, bottom row first as OpenGL reads them.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @return std::vector<std::uint8_t> The bytes of the file.
+ */
+std::vector<std::uint8_t> encodePpm(const std::uint8_t* pixels, int width,
+                                    int height);
+
+/**
+ * @struct FrameCaptureStats
+ * @brief Totals of a FrameCapture.
+ */
+struct FrameCaptureStats
+{
+    /**
+     * @var FrameCaptureStats::captured
+     * @brief Frames whose readback was issued.
+     */
+    std::uint64_t captured{ 0 };
+
+    /**
+     * @var FrameCaptureStats::dropped
+     * @brief Frames skipped because every buffer of the ring was busy, only 
+     * when dropping.
+     */
+    std::uint64_t dropped{ 0 };
+
+    /**
+     * @var FrameCaptureStats::stalls
+     * @brief Frames that waited for a buffer of the ring, and the time 
+     * they waited, which is part of captureMs.
+     */
+    std::uint64_t stalls{ 0 };
+    double stallMs{ 0.0 };
+
+    /**
+     * @var FrameCaptureStats::written
+     * @brief Files written, and those that could not be.
+     */
+    std::uint64_t written{ 0 };
+    std::uint64_t failed{ 0 };
+    std::uint64_t bytesWritten{ 0 };
+
+    /**
+     * @var FrameCaptureStats::captureMs
+     * @brief Time the render thread spent in capture, including the copies
+     * out of the buffers when they cannot stay mapped.
+     */
+    double captureMs{ 0.0 };
+
+    /**
+     * @var FrameCaptureStats::encodeMs
+     * @brief Time the encoder threads spent encoding and writing.
+     */
+    double encodeMs{ 0.0 };
+};
+
+/**
+ * @class FrameCapture
+ * @brief Reads frames back asynchronously and writes them on background
+ * threads.
+ *
+ * The buffers are mapped persistently when buffer storage (OpenGL 4.4 or
+ * ARB_buffer_storage) is available, and the encoders read straight from
+ * them. Otherwise a finished buffer is mapped, copied into memory of its
+ * slot and unmapped by the render thread.
+ *
+ * @note The FrameCapture class assumes that the OpenGL context has been
+ * properly initialized before any of its methods are called, and all of
+ * them have to be called on the thread of that context.
+ *
+ * Example:
+ * @code
+ * FrameCapture capture("frames", CaptureFormat::Png, 2, false);
+ * while (running)
+ * {
+ *     // ... draw ...
+ *     capture.capture(0, width, height, frame);
+ *     // ... swap ...
+ * }
+ * capture.finish();
+ * @endcode
+ */
+class FrameCapture
+{
+public:
+    /**
+     * @var FrameCapture::SLOTS
+     * @brief Frames that can be read back or encoded at the same time.
+     */
+    static constexpr std::size_t SLOTS{ 6 };
+
+    /**
+     * @fn FrameCapture::FrameCapture(const std::string& directory,
+            CaptureFormat format, std::size_t encoders, bool dropFrames)
+     * @brief Creates the directory if needed and starts the encoder threads.
+     * The buffers are created by the first capture.
+     * @param directory Directory the files are written to.
+     * @param format File format.
+     * @param encoders Number of encoder threads (at least one).
+     * @param dropFrames Whether a frame that finds every buffer busy is 
+     * dropped instead of waiting for the oldest.
+     * @throws std::logic_error if the directory cannot be created.
+     */
+    FrameCapture(const std::string& directory, CaptureFormat format,
+                 std::size_t encoders, bool dropFrames);
+
+    /**
+     * @fn FrameCapture::~FrameCapture()
+     * @brief Writes the frames still in flight, stops the threads and
+     * deletes the buffers and fences.
+     */
+    ~FrameCapture();
+
+    // Delete copy constructor and copy assignment operator.
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    /**
+     * @fn void FrameCapture::capture(GLuint framebuffer, int width,
+            int height, std::size_t frame)
+     * @brief Starts reading a frame back, after handing the readbacks that
+     * have finished to the encoders. Only waits when every buffer is busy 
+     * and frames are not dropped, or when the size changed and the buffers 
+     * are recreated. The read framebuffer binding is left as it was.
+     * @param framebuffer Framebuffer Object to read, 0 for the window's
+     * back buffer.
+     * @param width Width of the frame in pixels.
+     * @param height Height of the frame in pixels.
+     * @param frame Number of the frame, which names the file.
+     * @throws std::logic_error if the buffers cannot be mapped.
+     */
+    void capture(GLuint framebuffer, int width, int height, std::size_t frame);
+
+    /**
+     * @fn void FrameCapture::finish()
+     * @brief Waits until every frame captured so far has been written.
+     */
+    void finish();
+
+    /**
+     * @fn FrameCaptureStats FrameCapture::getStats() const
+     * @brief Copies the totals.
+     */
+    FrameCaptureStats getStats() const;
+
+    /**
+     * @brief Tells whether the buffers are mapped persistently.
+     */
+    bool isPersistent() const { return persistent_; }
+
+    const std::string& getDirectory() const { return directory_; }
+    CaptureFormat getFormat() const { return format_; }
+
+private:
+    /**
+     * @enum FrameCapture::SlotState
+     * @brief Where the frame of a slot is: nowhere, being copied by the GPU
+     * or with the encoders.
+     */
+    enum class SlotState
+    {
+        Free,
+        Reading,
+        Encoding
+    };
+
+    /**
+     * @struct Slot
+     * @brief A pixel pack buffer and the frame read into it.
+     */
+    struct Slot
+    {
+        GLuint buffer{ 0 };
+        void* mapped{ nullptr };
+        GLsync fence{ nullptr };
+        SlotState state{ SlotState::Free };
+        std::size_t frame{ 0 };
+
+        /**
+         * @brief Copy of the buffer when it cannot stay mapped.
+         */
+        std::vector<std::uint8_t> pixels;
+    };
+
+    /**
+     * @fn void FrameCapture::allocate(int width, int height)
+     * @brief Creates a buffer of width * height RGBA8 pixels per slot.
+     */
+    void allocate(int width, int height);
+
+    /**
+     * @fn void FrameCapture::release()
+     * @brief Deletes the buffers and fences of all slots.
+     */
+    void release();
+
+    /**
+     * @fn void FrameCapture::retire(bool wait)
+     * @brief Queues the slots whose readback finished for encoding.
+     * @param wait Whether to wait for readbacks still running.
+     */
+    void retire(bool wait);
+
+    /**
+     * @fn bool FrameCapture::retireSlot(Slot& slot, bool wait)
+     * @brief Queues a slot for encoding if its readback finished.
+     * @param slot A slot, which may not be Reading.
+     * @param wait Whether to wait for the readback if it still runs.
+     * @return bool true if the slot was queued.
+     */
+    bool retireSlot(Slot& slot, bool wait);
+
+    /**
+     * @fn void FrameCapture::encoderLoop()
+     * @brief Body of the encoder threads.
+     */
+    void encoderLoop();
+
+    std::string directory_;
+    CaptureFormat format_;
+    bool dropFrames_;
+    bool persistent_;
+    int width_;
+    int height_;
+
+    /**
+     * @brief The ring, and the slot the next frame is read into.
+     */
+    std::array<Slot, SLOTS> slots_;
+    std::size_t next_;
+
+    /**
+     * @brief Guards the slot states, the queue and the totals.
+     */
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable freed_;
+    std::deque<std::size_t> queue_;
+    FrameCaptureStats stats_;
+    bool stopping_;
+    std::vector<std::thread> encoders_;
+};
@@ -0,0 +1,297 @@
+/**
+ * @file frame_pacing.hpp
+ * @brief Header file for frame pacing and for timestamped input events.
+ *
+ * This file contains the declarations of the FramePacer and InputQueue
+ * classes. The FramePacer decides how frames are spaced: by the display's
+ * vertical sync, not at all, or by a limiter that sleeps for most of the
+ * time left until the next frame is due and spins for the rest, since
+ * sleeps overshoot by up to a scheduler tick.
+ *
+ * The InputQueue receives input events from GLFW callbacks, each stamped
+ * with the time it arrived. The display loop takes the events as late as
+ * possible, right before it builds a frame, and once that frame has been
+ * handed to the swap it records how long every event took to get there:
+ * the input-to-present latency.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_profiler.hpp"
+
+/**
+ * @enum PacingMode
+ * @brief How the display loop spaces its frames.
+ */
+enum class PacingMode
+{
+    Vsync,
+    Uncapped,
+    Limited
+};
+
+/**
+ * @fn bool parsePacingMode(const std::string& name, PacingMode& mode)
+ * @brief Converts "vsync", "off" or "limit" to a pacing mode.
+ * @param name Name of the mode.
+ * @param mode Set to the mode if the name is known.
+ * @return bool true if the name is known.
+ */
+bool parsePacingMode(const std::string& name, PacingMode& mode);
+
+/**
+ * @class FramePacer
+ * @brief Spaces frames by vertical sync, not at all or at a fixed rate.
+ *
+ * With vertical sync and uncapped frames the pacer only picks the swap
+ * interval; the limiter also waits in wait. Its deadlines advance by one
+ * period per frame, so a frame that starts late is followed by a shorter
+ * wait, until a frame is a whole period behind and the deadlines restart
+ * from the present.
+ *
+ * Example:
+ * @code
+ * FramePacer pacer(PacingMode::Limited, 60.0);
+ * glfwSwapInterval(pacer.getSwapInterval());
+ * while (running)
+ * {
+ *     pacer.wait();
+ *     // ... sample input, draw, swap ...
+ * }
+ * @endcode
+ */
+class FramePacer
+{
+public:
+    /**
+     * @var FramePacer::SPIN_MARGIN
+     * @brief Time before a deadline at which the limiter stops sleeping and
+     * starts spinning.
+     */
+    static constexpr std::chrono::microseconds SPIN_MARGIN{ 1500 };
+
+    /**
+     * @fn FramePacer::FramePacer(PacingMode mode, double rate)
+     * @brief Creates a pacer.
+     * @param mode How frames are spaced.
+     * @param rate Frames per second of the limiter.
+     */
+    FramePacer(PacingMode mode, double rate);
+
+    /**
+     * @fn void FramePacer::wait()
+     * @brief Waits until the next frame is due. Returns at once unless the
+     * mode is Limited.
+     */
+    void wait();
+
+    /**
+     * @brief Getter for the swap interval of the mode: 1 for vertical sync,
+     * otherwise 0.
+     */
+    int getSwapInterval() const { return mode_ == PacingMode::Vsync ? 1 : 0; }
+
+    /**
+     * @brief Getter for the pacing mode.
+     */
+    PacingMode getMode() const { return mode_; }
+
+    /**
+     * @fn const char* FramePacer::getModeName() const
+     * @brief Getter for a readable name of the mode.
+     */
+    const char* getModeName() const;
+
+    /**
+     * @brief Getter for the time spent sleeping and spinning, in
+     * milliseconds.
+     */
+    double getSleepMs() const { return sleepMs_; }
+    double getSpinMs() const { return spinMs_; }
+
+    /**
+     * @brief Getter for the number of frames that started a whole period
+     * late, which restarted the deadlines.
+     */
+    std::uint64_t getMissedFrames() const { return missed_; }
+
+    /**
+     * @brief Getter for the latest a wait returned after its deadline, in
+     * milliseconds.
+     */
+    double getMaxOvershootMs() const { return maxOvershootMs_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    PacingMode mode_;
+    Clock::duration period_;
+    Clock::time_point deadline_;
+    bool started_;
+    double sleepMs_;
+    double spinMs_;
+    std::uint64_t missed_;
+    double maxOvershootMs_;
+};
+
+/**
+ * @struct InputEvent
+ * @brief A key event with the time it reached the program.
+ */
+struct InputEvent
+{
+    int key{ 0 };
+    int action{ 0 };
+    std::chrono::steady_clock::time_point time{};
+};
+
+/**
+ * @class InputQueue
+ * @brief Collects timestamped input events and measures how long they take
+ * to be presented.
+ *
+ * push may be called from any thread, the other methods only from the
+ * display loop. Besides the GLFW callbacks, a thread of the queue can push
+ * synthetic events at a fixed rate, which gives headless runs and
+ * benchmarks a latency to measure. Like the window system's events, which
+ * GLFW only hands over in glfwPollEvents, synthetic events wait until the
+ * loop calls deliver.
+ *
+ * Example:
+ * @code
+ * InputQueue input;
+ * // key callback: input.push({ key, action, std::chrono::steady_clock::now() });
+ * for (const InputEvent& event : input.take())
+ * {
+ *     // ... react to the event ...
+ * }
+ * // ... draw, swap ...
+ * input.present(profiler);
+ * @endcode
+ */
+class InputQueue
+{
+public:
+    /**
+     * @var InputQueue::SYNTHETIC_KEY
+     * @brief Key code of synthetic events, outside the range of GLFW keys.
+     */
+    static constexpr int SYNTHETIC_KEY{ -2 };
+
+    /**
+     * @var InputQueue::MAX_LATENCY_SAMPLES
+     * @brief Latencies kept for the summary; later ones are only counted.
+     */
+    static constexpr std::size_t MAX_LATENCY_SAMPLES{ std::size_t{ 1 } << 20 };
+
+    /**
+     * @fn InputQueue::InputQueue()
+     * @brief Creates an empty queue.
+     */
+    InputQueue();
+
+    /**
+     * @fn InputQueue::~InputQueue()
+     * @brief Stops the synthetic input thread.
+     */
+    ~InputQueue();
+
+    // Delete copy constructor and copy assignment operator.
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    /**
+     * @fn void InputQueue::push(const InputEvent& event)
+     * @brief Adds an event.
+     */
+    void push(const InputEvent& event);
+
+    /**
+     * @fn void InputQueue::startSynthetic(double rate,
+            std::function<void()> wake)
+     * @brief Starts a thread that pushes a synthetic event rate times per
+     * second, like a device polled at that rate.
+     * @param rate Events per second.
+     * @param wake Called from the thread after every event, e.g. to wake a
+     * loop blocked in glfwWaitEvents.
+     */
+    void startSynthetic(double rate, std::function<void()> wake = {});
+
+    /**
+     * @fn bool InputQueue::waitForEvents(double seconds)
+     * @brief Blocks until an event is queued or a synthetic event arrives,
+     * or until the time is up.
+     * @param seconds Longest time to wait.
+     * @return bool true if events are waiting to be delivered or taken.
+     */
+    bool waitForEvents(double seconds);
+
+    /**
+     * @fn bool InputQueue::hasEvents()
+     * @brief Tells whether delivered events are waiting to be taken.
+     */
+    bool hasEvents();
+
+    /**
+     * @fn void InputQueue::deliver()
+     * @brief Makes the synthetic events that arrived so far available to
+     * take. Call wherever the loop polls window events.
+     */
+    void deliver();
+
+    /**
+     * @fn const std::vector<InputEvent>& InputQueue::take()
+     * @brief Takes every queued event for the frame being built.
+     * @return const std::vector<InputEvent>& The events, oldest first,
+     * valid until the next call.
+     */
+    const std::vector<InputEvent>& take();
+
+    /**
+     * @fn void InputQueue::present(FrameProfiler& profiler)
+     * @brief Records the latency of the events taken for the frame that was
+     * just handed to the swap.
+     * @param profiler Gets the number of events and their summed latency
+     * as counters of the frame.
+     */
+    void present(FrameProfiler& profiler);
+
+    /**
+     * @brief Getter for the number of presented events.
+     */
+    std::uint64_t getPresentedCount() const { return presented_; }
+
+    /**
+     * @fn FrameTimeSummary InputQueue::getLatencySummary() const
+     * @brief Distribution of the input-to-present latency in milliseconds.
+     */
+    FrameTimeSummary getLatencySummary() const;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::vector<InputEvent> queued_;
+
+    /**
+     * @brief Synthetic events not delivered yet.
+     */
+    std::vector<InputEvent> pending_;
+
+    /**
+     * @brief Events of the frame being built.
+     */
+    std::vector<InputEvent> taken_;
+    std::vector<double> latencies_;
+    std::uint64_t presented_;
+
+    std::thread synthetic_;
+    std::atomic<bool> stopping_;
+};
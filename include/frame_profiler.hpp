@@ -0,0 +1,430 @@
+/**
+ * @file frame_profiler.hpp
+ * @brief Header file for per-frame CPU and GPU timing.
+ * 
+ * This file contains the declaration of the FrameProfiler class, which 
+ * measures how long each phase of a frame takes on the CPU and on the GPU. 
+ * CPU times come from a steady clock, GPU times from GL_TIME_ELAPSED queries. 
+ * The queries are read back several frames after they were issued, when their 
+ * results are already available, so timing never waits for the GPU.
+ * 
+ * Besides times, each frame carries counters, such as the number of bytes 
+ * uploaded, that the rendering code adds to while the frame is drawn.
+ * 
+ * Samples are kept in a fixed-size ring buffer, from which percentiles of the 
+ * frame time can be computed at any moment and which can be written to a 
+ * JSON or CSV file.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @enum FramePhase
+ * @brief The phases of one iteration of the display loop.
+ */
+enum class FramePhase : std::size_t
+{
+    Pace,
+    Input,
+    Clear,
+    Draw,
+    Capture,
+    Swap,
+    Poll,
+    Count
+};
+
+/**
+ * @var FRAME_PHASE_COUNT
+ * @brief Number of timed phases per frame.
+ */
+constexpr std::size_t FRAME_PHASE_COUNT{ 
+                                static_cast<std::size_t>( FramePhase::Count ) };
+
+/**
+ * @fn const char* getPhaseName(FramePhase phase)
+ * @brief Gets a lower case name of a phase, as used in the output files.
+ * @param phase The phase.
+ * @return const char* Name of the phase.
+ */
+const char* getPhaseName(FramePhase phase);
+
+/**
+ * @enum FrameCounter
+ * @brief Quantities counted per frame.
+ */
+enum class FrameCounter : std::size_t
+{
+    BytesStreamed,
+    DrawCalls,
+    BindsIssued,
+    BindsElided,
+    VisibleInstances,
+    Triangles,
+    TextureBinds,
+    InputEvents,
+    InputLatencyUs,
+    UniformBytes,
+    OccludedInstances,
+    RenderScalePercent,
+    Count
+};
+
+/**
+ * @var FRAME_COUNTER_COUNT
+ * @brief Number of counters per frame.
+ */
+constexpr std::size_t FRAME_COUNTER_COUNT{ 
+                            static_cast<std::size_t>( FrameCounter::Count ) };
+
+/**
+ * @fn const char* getCounterName(FrameCounter counter)
+ * @brief Gets a lower case name of a counter, as used in the output files.
+ * @param counter The counter.
+ * @return const char* Name of the counter.
+ */
+const char* getCounterName(FrameCounter counter);
+
+/**
+ * @struct FrameSample
+ * @brief Timings of a single frame in milliseconds.
+ */
+struct FrameSample
+{
+    /**
+     * @var FrameSample::frame
+     * @brief Number of the frame, counted from zero.
+     */
+    std::size_t frame{ 0 };
+
+    /**
+     * @var FrameSample::cpuPhases
+     * @brief CPU time spent in each phase.
+     */
+    std::array<double, FRAME_PHASE_COUNT> cpuPhases{};
+
+    /**
+     * @var FrameSample::gpuPhases
+     * @brief GPU time spent on the commands of each phase.
+     */
+    std::array<double, FRAME_PHASE_COUNT> gpuPhases{};
+
+    /**
+     * @var FrameSample::cpuFrame
+     * @brief CPU time from the start to the end of the frame.
+     */
+    double cpuFrame{ 0.0 };
+
+    /**
+     * @var FrameSample::gpuFrame
+     * @brief Sum of the GPU phase times.
+     */
+    double gpuFrame{ 0.0 };
+
+    /**
+     * @var FrameSample::counters
+     * @brief Values of the counters at the end of the frame.
+     */
+    std::array<std::uint64_t, FRAME_COUNTER_COUNT> counters{};
+
+    /**
+     * @var FrameSample::gpuValid
+     * @brief Whether the GPU times have been read back.
+     */
+    bool gpuValid{ false };
+};
+
+/**
+ * @struct FrameTimeSummary
+ * @brief Distribution of the frame time over the stored samples, in 
+ * milliseconds.
+ */
+struct FrameTimeSummary
+{
+    std::size_t samples{ 0 };
+    double p50{ 0.0 };
+    double p95{ 0.0 };
+    double p99{ 0.0 };
+    double max{ 0.0 };
+};
+
+/**
+ * @fn FrameTimeSummary summarizeTimes(std::vector<double> times)
+ * @brief Computes nearest-rank percentiles of a list of times.
+ * @param times Times in milliseconds, in any order.
+ * @return FrameTimeSummary The distribution, all zero for an empty list.
+ */
+FrameTimeSummary summarizeTimes(std::vector<double> times);
+
+/**
+ * @class FrameProfiler
+ * @brief Collects CPU and GPU timings of the display loop.
+ * 
+ * Each frame is bracketed by beginFrame and endFrame, and each phase inside it
+ * by beginPhase and endPhase (or a ProfileScope). The GPU queries of a frame 
+ * are read QUERY_LATENCY frames later; a result that is still not available 
+ * then is dropped rather than waited for.
+ * 
+ * @note The FrameProfiler class assumes that the OpenGL context has been 
+ * properly initialized before it is constructed.
+ * 
+ * Example:
+ * @code
+ * FrameProfiler profiler;
+ * profiler.beginFrame();
+ * {
+ *     ProfileScope scope(profiler, FramePhase::Draw);
+ *     glDrawArrays(GL_TRIANGLES, 0, 3);
+ * }
+ * profiler.endFrame();
+ * FrameTimeSummary cpu = profiler.getCpuSummary();
+ * @endcode
+ */
+class FrameProfiler
+{
+public:
+
+    /**
+     * @var FrameProfiler::QUERY_LATENCY
+     * @brief Number of frames between issuing and reading a GPU query.
+     */
+    static constexpr std::size_t QUERY_LATENCY{ 4 };
+
+    /**
+     * @fn FrameProfiler::FrameProfiler(std::size_t capacity, bool gpuTiming)
+     * @brief Creates the GPU queries and the sample ring buffer.
+     * @param capacity Number of frames kept in the ring buffer.
+     * @param gpuTiming Whether to time the GPU; without it the profiler 
+     * makes no OpenGL calls and works without a context.
+     */
+    explicit FrameProfiler(std::size_t capacity = 1024, bool gpuTiming = true);
+
+    /**
+     * @fn FrameProfiler::~FrameProfiler()
+     * @brief Deletes the GPU queries.
+     */
+    ~FrameProfiler();
+
+    // Delete copy constructor and copy assignment operator.
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    /**
+     * @brief Tells whether GPU times are measured.
+     */
+    bool hasGpuTiming() const { return gpuTiming_; }
+
+    /**
+     * @fn void FrameProfiler::beginFrame()
+     * @brief Starts a new frame and reads back the GPU queries that were 
+     * issued QUERY_LATENCY frames ago.
+     */
+    void beginFrame();
+
+    /**
+     * @fn void FrameProfiler::endFrame()
+     * @brief Finishes the current frame and stores its CPU times.
+     */
+    void endFrame();
+
+    /**
+     * @fn void FrameProfiler::beginPhase(FramePhase phase)
+     * @brief Starts timing a phase on the CPU and the GPU.
+     * @param phase The phase that starts.
+     * @note Phases must not overlap.
+     */
+    void beginPhase(FramePhase phase);
+
+    /**
+     * @fn void FrameProfiler::endPhase(FramePhase phase)
+     * @brief Stops timing a phase on the CPU and the GPU.
+     * @param phase The phase that ends.
+     */
+    void endPhase(FramePhase phase);
+
+    /**
+     * @fn void FrameProfiler::addCounter(FrameCounter counter, 
+            std::uint64_t value)
+     * @brief Adds to a counter of the current frame.
+     * @param counter The counter to increase.
+     * @param value The amount to add.
+     */
+    void addCounter(FrameCounter counter, std::uint64_t value);
+
+    /**
+     * @fn std::uint64_t FrameProfiler::getCounterTotal(FrameCounter counter) 
+            const
+     * @brief Sums a counter over every frame since construction, including 
+     * frames no longer in the ring buffer.
+     * @param counter The counter.
+     * @return std::uint64_t The total.
+     */
+    std::uint64_t getCounterTotal(FrameCounter counter) const
+    {
+        return counterTotals_[static_cast<std::size_t>( counter )];
+    }
+
+    /**
+     * @fn bool FrameProfiler::getLatestGpuFrame(std::size_t& frame, 
+            double& milliseconds) const
+     * @brief Gets the newest frame whose GPU times have been read back, 
+     * which is at least QUERY_LATENCY frames old.
+     * @param frame Set to the number of the frame.
+     * @param milliseconds Set to its GPU frame time.
+     * @return bool false if no valid GPU time has been read yet.
+     */
+    bool getLatestGpuFrame(std::size_t& frame, double& milliseconds) const;
+
+    /**
+     * @fn void FrameProfiler::collect()
+     * @brief Reads back every GPU query that is still outstanding, waiting 
+     * for the results if needed. Meant to be called once after the loop.
+     */
+    void collect();
+
+    /**
+     * @fn FrameTimeSummary FrameProfiler::getCpuSummary() const
+     * @brief Computes percentiles of the CPU frame time.
+     * @return FrameTimeSummary Summary of the stored samples.
+     */
+    FrameTimeSummary getCpuSummary() const;
+
+    /**
+     * @fn FrameTimeSummary FrameProfiler::getGpuSummary() const
+     * @brief Computes percentiles of the GPU frame time.
+     * @return FrameTimeSummary Summary of the samples with GPU times.
+     */
+    FrameTimeSummary getGpuSummary() const;
+
+    /**
+     * @fn std::vector<FrameSample> FrameProfiler::getSamples() const
+     * @brief Copies the stored samples, oldest first.
+     * @return std::vector<FrameSample> The samples.
+     */
+    std::vector<FrameSample> getSamples() const;
+
+    /**
+     * @fn bool FrameProfiler::writeFile(const std::string& path) const
+     * @brief Writes the summary and all stored samples to a file.
+     * 
+     * The format is CSV if the path ends in ".csv" and JSON otherwise.
+     * 
+     * @param path Path of the output file.
+     * @return bool true if the file was written, false otherwise.
+     */
+    bool writeFile(const std::string& path) const;
+
+    /**
+     * @brief Getter for the number of frames that have ended.
+     * @return std::size_t Number of frames.
+     */
+    std::size_t getFrameCount() const { return frame_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Reads the GPU results of a query slot into its sample.
+     * @param slot Index of the query slot.
+     * @param wait Whether to wait for results that are not available yet.
+     */
+    void readQueries(std::size_t slot, bool wait);
+
+    /**
+     * @brief Computes a summary of one kind of frame time.
+     * @param gpu Summarize GPU times if true, CPU times otherwise.
+     */
+    FrameTimeSummary summarize(bool gpu) const;
+
+    bool writeJson(const std::string& path) const;
+    bool writeCsv(const std::string& path) const;
+
+    /**
+     * @brief Ring buffer of samples, indexed by frame number modulo size.
+     */
+    std::vector<FrameSample> samples_;
+
+    /**
+     * @brief Whether GL_TIME_ELAPSED queries are issued.
+     */
+    bool gpuTiming_;
+
+    /**
+     * @brief GL_TIME_ELAPSED query IDs, one set of phases per slot.
+     */
+    std::array<std::array<GLuint, FRAME_PHASE_COUNT>, QUERY_LATENCY> queries_;
+
+    /**
+     * @brief Frame number whose results each query slot holds.
+     */
+    std::array<std::size_t, QUERY_LATENCY> queryFrames_;
+
+    /**
+     * @brief CPU time at which the queries of each slot were begun.
+     */
+    std::array<Clock::time_point, QUERY_LATENCY> queryStart_;
+
+    /**
+     * @brief Which phases of each query slot were issued.
+     */
+    std::array<std::array<bool, FRAME_PHASE_COUNT>, QUERY_LATENCY> queryIssued_;
+
+    /**
+     * @brief Whether each query slot has results that were not yet read.
+     */
+    std::array<bool, QUERY_LATENCY> queryPending_;
+
+    /**
+     * @brief Start time of the frame and of each phase.
+     */
+    Clock::time_point frameStart_;
+    std::array<Clock::time_point, FRAME_PHASE_COUNT> phaseStart_;
+
+    /**
+     * @brief Counter totals over all frames.
+     */
+    std::array<std::uint64_t, FRAME_COUNTER_COUNT> counterTotals_;
+
+    /**
+     * @brief Newest frame with valid GPU times, and its GPU frame time.
+     */
+    bool latestGpuValid_;
+    std::size_t latestGpuFrame_;
+    double latestGpuMs_;
+
+    /**
+     * @brief Number of the current frame.
+     */
+    std::size_t frame_;
+};
+
+/**
+ * @class ProfileScope
+ * @brief Times one phase for as long as the object lives.
+ */
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler& profiler, FramePhase phase)
+        : profiler_(profiler), phase_(phase)
+    {
+        profiler_.beginPhase(phase_);
+    }
+
+    ~ProfileScope() { profiler_.endPhase(phase_); }
+
+    // Delete copy constructor and copy assignment operator.
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    FrameProfiler& profiler_;
+    FramePhase phase_;
+};
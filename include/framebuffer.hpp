@@ -0,0 +1,258 @@
+/**
+ * @file framebuffer.hpp
+ * @brief Header file for offscreen framebuffer objects.
+ * 
+ * Besides the Framebuffer render target, this file declares the 
+ * ScaledFramebuffer, which renders at a fraction of the window's resolution
+ * and upsamples to it, and the UploadFramebuffer, which shows pixels drawn
+ * on the CPU in a window.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @class Framebuffer
+ * @brief A class encapsulating an OpenGL Framebuffer Object with a color 
+ * and a depth attachment.
+ * 
+ * The Framebuffer class creates a Framebuffer Object together with 
+ * renderbuffers that store its color and depth values. It is used as a render target 
+ * when there is no window to draw into, or when a frame has to be kept 
+ * around after it has been drawn.
+ * 
+ * @note The Framebuffer class assumes that the OpenGL context has been 
+ * properly initialized before any of its methods are called.
+ * 
+ * Example:
+ * @code
+ * Framebuffer target(640, 480);
+ * target.bind();
+ * glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+ * @endcode
+ */
+class Framebuffer
+{
+public:
+
+    /**
+     * @fn Framebuffer::Framebuffer(int width, int height)
+     * @brief Creates a framebuffer with an RGBA8 color attachment and a 
+     * 24 bit depth attachment.
+     * @param width Width of the attachments in pixels.
+     * @param height Height of the attachments in pixels.
+     * @throws std::logic_error if the framebuffer is not complete.
+     */
+    Framebuffer(int width, int height);
+
+    /**
+     * @fn Framebuffer::~Framebuffer()
+     * @brief Deletes the framebuffer and its attachments.
+     */
+    ~Framebuffer();
+
+    // Delete copy constructor and copy assignment operator.
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    /**
+     * @fn void Framebuffer::bind() const
+     * @brief Binds the framebuffer as the draw and read target and sets the 
+     * viewport to cover it.
+     */
+    void bind() const;
+
+    /**
+     * @brief Getter for FBO_
+     * @return unsigned int The unique ID of the Framebuffer Object.
+     */
+    unsigned int getFBOId() const { return FBO_; }
+
+    /**
+     * @brief Getter for the width of the attachments.
+     * @return int Width in pixels.
+     */
+    int getWidth() const { return width_; }
+
+    /**
+     * @brief Getter for the height of the attachments.
+     * @return int Height in pixels.
+     */
+    int getHeight() const { return height_; }
+
+private:
+    /**
+     * @brief ID created for the Framebuffer Object.
+     */
+    unsigned int FBO_;
+
+    /**
+     * @brief ID created for the color renderbuffer.
+     */
+    unsigned int colorRBO_;
+
+    /**
+     * @brief ID created for the depth renderbuffer.
+     */
+    unsigned int depthRBO_;
+
+    /**
+     * @brief Width of the attachments.
+     */
+    int width_;
+
+    /**
+     * @brief Height of the attachments.
+     */
+    int height_;
+};
+
+/**
+ * @class ScaledFramebuffer
+ * @brief A render target at the size of the window whose frames are drawn
+ * into a scaled corner and stretched to the window.
+ * 
+ * Changing the scale only changes the viewport: the attachments keep the 
+ * full size, so a new scale every frame costs no reallocation. They are 
+ * only recreated when the window itself changes size. Upsampling is a 
+ * single linear filtered blit of the color attachment.
+ * 
+ * Example:
+ * @code
+ * ScaledFramebuffer target(windowWidth, windowHeight);
+ * target.bind(0.75f);
+ * glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+ * // ... draw the scene ...
+ * target.blitTo(0, windowWidth, windowHeight);
+ * @endcode
+ */
+class ScaledFramebuffer
+{
+public:
+
+    /**
+     * @fn ScaledFramebuffer::ScaledFramebuffer(int width, int height)
+     * @brief Creates the target at full scale.
+     * @param width Width of the window in pixels.
+     * @param height Height of the window in pixels.
+     * @throws std::logic_error if the framebuffer is not complete.
+     */
+    ScaledFramebuffer(int width, int height);
+
+    /**
+     * @fn void ScaledFramebuffer::resize(int width, int height)
+     * @brief Recreates the attachments if the window size changed.
+     * @param width Width of the window in pixels.
+     * @param height Height of the window in pixels.
+     * @throws std::logic_error if the framebuffer is not complete.
+     */
+    void resize(int width, int height);
+
+    /**
+     * @fn void ScaledFramebuffer::bind(float scale)
+     * @brief Binds the target and sets the viewport to the scaled corner.
+     * @param scale Fraction of the window's width and height drawn, in 
+     * (0, 1].
+     */
+    void bind(float scale);
+
+    /**
+     * @fn void ScaledFramebuffer::blitTo(GLuint target, int width, 
+            int height) const
+     * @brief Stretches the scaled corner over a framebuffer, binds that 
+     * framebuffer and sets the viewport to cover it.
+     * @param target Framebuffer Object to present to, 0 for the window.
+     * @param width Width of the target in pixels.
+     * @param height Height of the target in pixels.
+     */
+    void blitTo(GLuint target, int width, int height) const;
+
+    int getWidth() const { return target_->getWidth(); }
+    int getHeight() const { return target_->getHeight(); }
+
+    /**
+     * @brief Getter for the size of the scaled corner set by the last bind.
+     */
+    int getScaledWidth() const { return scaledWidth_; }
+    int getScaledHeight() const { return scaledHeight_; }
+
+private:
+    std::unique_ptr<Framebuffer> target_;
+    int scaledWidth_;
+    int scaledHeight_;
+};
+
+/**
+ * @class UploadFramebuffer
+ * @brief A Framebuffer Object with a texture attachment that CPU pixels are
+ * uploaded to and copied to the window from.
+ * 
+ * The software backend draws its frames in system memory; this class puts 
+ * them on screen with one texture upload and one blit, without any shader.
+ * 
+ * Example:
+ * @code
+ * UploadFramebuffer present(rasterizer.getWidth(), rasterizer.getHeight());
+ * present.upload(rasterizer.getColor());
+ * present.blitToWindow(windowWidth, windowHeight);
+ * @endcode
+ */
+class UploadFramebuffer
+{
+public:
+
+    /**
+     * @fn UploadFramebuffer::UploadFramebuffer(int width, int height)
+     * @brief Creates a framebuffer with an RGBA8 texture attachment.
+     * @param width Width of the texture in pixels.
+     * @param height Height of the texture in pixels.
+     * @throws std::logic_error if the framebuffer is not complete.
+     */
+    UploadFramebuffer(int width, int height);
+
+    /**
+     * @fn UploadFramebuffer::~UploadFramebuffer()
+     * @brief Deletes the framebuffer and its texture.
+     */
+    ~UploadFramebuffer();
+
+    // Delete copy constructor and copy assignment operator.
+    UploadFramebuffer(const UploadFramebuffer&) = delete;
+    UploadFramebuffer& operator=(const UploadFramebuffer&) = delete;
+
+    /**
+     * @fn void UploadFramebuffer::upload(const std::uint32_t* pixels)
+     * @brief Replaces the texture with RGBA8 pixels, bottom row first.
+     * @param pixels width * height packed pixels.
+     */
+    void upload(const std::uint32_t* pixels);
+
+    /**
+     * @fn void UploadFramebuffer::blitToWindow(int width, int height) const
+     * @brief Copies the texture to the default framebuffer, scaled to its 
+     * size.
+     * @param width Width of the window framebuffer in pixels.
+     * @param height Height of the window framebuffer in pixels.
+     */
+    void blitToWindow(int width, int height) const;
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+
+private:
+    /**
+     * @brief ID created for the Framebuffer Object.
+     */
+    unsigned int FBO_;
+
+    /**
+     * @brief ID created for the color texture.
+     */
+    unsigned int texture_;
+
+    int width_;
+    int height_;
+};
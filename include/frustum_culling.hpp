@@ -0,0 +1,93 @@
+/**
+ * @file frustum_culling.hpp
+ * @brief Header file for culling the bounding spheres of an InstanceStore 
+ * against a view frustum.
+ * 
+ * The culling kernel exists in a scalar, an SSE2 and an AVX2 version. The 
+ * fastest one the processor supports is picked at runtime, so one binary 
+ * runs everywhere and still uses AVX2 where it is available. All versions 
+ * write the same compact, ascending list of visible indices.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "instance_store.hpp"
+
+/**
+ * @struct Frustum
+ * @brief The six planes of a view frustum.
+ * 
+ * A point p is inside a plane if a * p.x + b * p.y + c * p.z + d >= 0. The 
+ * planes are normalized, so the same expression is the signed distance.
+ */
+struct Frustum
+{
+    float planes[6][4];
+};
+
+/**
+ * @fn Frustum makeFrustum(const float* viewProjection)
+ * @brief Extracts the frustum planes from a view-projection matrix 
+ * (Gribb and Hartmann).
+ * @param viewProjection 16 floats in column-major order, as given to 
+ * glUniformMatrix4fv.
+ * @return Frustum The normalized planes.
+ */
+Frustum makeFrustum(const float* viewProjection);
+
+/**
+ * @enum CullPath
+ * @brief Implementations of the culling kernel.
+ */
+enum class CullPath
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+/**
+ * @fn CullPath detectCullPath()
+ * @brief Gets the fastest culling kernel the processor supports.
+ */
+CullPath detectCullPath();
+
+/**
+ * @fn bool isCullPathSupported(CullPath path)
+ * @brief Tells whether the processor can run a culling kernel.
+ */
+bool isCullPathSupported(CullPath path);
+
+/**
+ * @fn const char* getCullPathName(CullPath path)
+ * @brief Gets a lower case name of a culling kernel.
+ */
+const char* getCullPathName(CullPath path);
+
+/**
+ * @fn std::size_t cullSpheres(const Frustum& frustum, 
+        const InstanceStore& store, std::size_t begin, std::size_t end, 
+        CullPath path, std::uint32_t* visible)
+ * @brief Tests the bounding spheres of a range of instances against a 
+ * frustum and writes the indices of those that are at least partly inside.
+ * @param frustum The frustum.
+ * @param store The instances.
+ * @param begin First instance to test, a multiple of INSTANCE_PADDING.
+ * @param end One past the last instance to test; padding entries are 
+ * never visible, so this may be rounded up to INSTANCE_PADDING.
+ * @param path The kernel to use, which must be supported.
+ * @param visible Receives the visible indices in ascending order; room for 
+ * end - begin indices, rounded up to INSTANCE_PADDING, is needed.
+ * @return std::size_t Number of visible instances.
+ * 
+ * Example:
+ * @code
+ * std::vector<std::uint32_t> visible(store.getPaddedSize());
+ * const std::size_t count = cullSpheres(makeFrustum(viewProjection), store,
+ *                                       0, store.size(), detectCullPath(), 
+ *                                       visible.data());
+ * @endcode
+ */
+std::size_t cullSpheres(const Frustum& frustum, const InstanceStore& store,
+                        std::size_t begin, std::size_t end, CullPath path, 
+                        std::uint32_t* visible);
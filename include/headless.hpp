@@ -0,0 +1,137 @@
+/**
+ * @file headless.hpp
+ * @brief Header file for creating an OpenGL context without a window.
+ * 
+ * This file contains the declaration of the HeadlessContext class, which 
+ * creates an OpenGL 3.3 core context through EGL without any window system. 
+ * On machines without a display or a GPU the Mesa surfaceless platform 
+ * provides a software (llvmpipe) context, so the same rendering code can run 
+ * on build and batch machines. Because such a context has no default 
+ * framebuffer, rendering goes into an offscreen Framebuffer instead.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <cstdio>
+#include <memory>
+#include "framebuffer.hpp"
+
+/**
+ * @class HeadlessContext
+ * @brief Manages an EGL display, a surfaceless OpenGL context and the 
+ * offscreen framebuffer that is rendered into.
+ * 
+ * @note The main context is made current on the thread that created it. 
+ * An optional shared context can be made current on one other thread.
+ */
+class HeadlessContext
+{
+public:
+
+    /**
+     * @fn HeadlessContext::HeadlessContext()
+     * @brief Default constructor. No EGL calls are made until createContext.
+     */
+    HeadlessContext();
+
+    /**
+     * @fn HeadlessContext::~HeadlessContext()
+     * @brief Deletes the framebuffer, destroys the context and terminates 
+     * the EGL display.
+     */
+    ~HeadlessContext();
+
+    // Delete copy constructor and copy assignment operator.
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    /**
+     * @brief Creates an OpenGL 3.3 core context without a surface and makes
+     * it current.
+     * 
+     * @return bool true if the context is current, false otherwise.
+     * 
+     * @remark This function performs the following steps:
+     * @remark Opens the surfaceless EGL platform, or the default display.
+     * @remark Checks for surfaceless context support.
+     * @remark Creates a core profile desktop OpenGL context.
+     * @remark Makes the context current without a draw or read surface.
+    */
+    bool createContext();
+
+    /**
+     * @brief Creates a second context that shares objects with the main 
+     * one, for uploading resources on another thread.
+     * @return bool true if the context was created, false otherwise.
+     * @note The shared context is not made current here.
+    */
+    bool createSharedContext();
+
+    /**
+     * @brief Makes the shared context current on the calling thread.
+     * @return bool true on success, false otherwise.
+    */
+    bool makeSharedContextCurrent() const;
+
+    /**
+     * @brief Detaches whatever context is current on the calling thread.
+    */
+    void releaseCurrentContext() const;
+
+    /**
+     * @brief Creates the offscreen framebuffer and binds it.
+     * 
+     * @param width Width of the framebuffer in pixels.
+     * @param height Height of the framebuffer in pixels.
+     * @return bool true if the framebuffer is complete, false otherwise.
+     * @note Requires that OpenGL functions have been loaded.
+     */
+    bool createFramebuffer(int width, int height);
+
+    /**
+     * @brief Finishes a frame.
+     * 
+     * There is nothing to present, so the queued commands are only flushed 
+     * to the driver, in the same place a window would swap its buffers.
+     */
+    void swapBuffers() const;
+
+    /**
+     * @brief Getter for the offscreen framebuffer.
+     * @return Framebuffer* The framebuffer, or nullptr before creation.
+     */
+    Framebuffer* getFramebuffer() const { return framebuffer_.get(); }
+
+    /**
+     * @brief Looks up an OpenGL function for the glad loader.
+     * @param name Name of the OpenGL function.
+     * @return void* Address of the function, or nullptr if it is unknown.
+     */
+    static void* getProcAddress(const char* name);
+
+private:
+    /**
+     * @brief Handle of the EGL display (an EGLDisplay).
+     */
+    void* display_;
+
+    /**
+     * @brief Handle of the EGL context (an EGLContext).
+     */
+    void* context_;
+
+    /**
+     * @brief Handle of the EGL config of both contexts (an EGLConfig).
+     */
+    void* config_;
+
+    /**
+     * @brief Handle of the shared upload context (an EGLContext).
+     */
+    void* sharedContext_;
+
+    /**
+     * @brief The framebuffer that takes the place of a window.
+     */
+    std::unique_ptr<Framebuffer> framebuffer_;
+};
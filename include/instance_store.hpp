@@ -0,0 +1,130 @@
+/**
+ * @file instance_store.hpp
+ * @brief Header file for storing the bounds of many instances as a 
+ * structure of arrays.
+ * 
+ * This file contains the declaration of the InstanceStore class. Each 
+ * component of the bounding spheres lives in an array of its own, aligned 
+ * to INSTANCE_ALIGNMENT bytes and padded to a multiple of INSTANCE_PADDING 
+ * entries, so SIMD kernels can load eight instances with one aligned load 
+ * and never need a scalar tail.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/**
+ * @var INSTANCE_ALIGNMENT
+ * @brief Alignment of the arrays in bytes, one cache line.
+ */
+constexpr std::size_t INSTANCE_ALIGNMENT{ 64 };
+
+/**
+ * @var INSTANCE_PADDING
+ * @brief The arrays hold a multiple of this many entries, one AVX register.
+ */
+constexpr std::size_t INSTANCE_PADDING{ 8 };
+
+/**
+ * @class AlignedAllocator
+ * @brief Allocator that aligns the storage of a std::vector to 
+ * INSTANCE_ALIGNMENT bytes.
+ */
+template <typename T>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), 
+                                   std::align_val_t{ INSTANCE_ALIGNMENT }));
+    }
+
+    void deallocate(T* pointer, std::size_t)
+    {
+        ::operator delete(pointer, std::align_val_t{ INSTANCE_ALIGNMENT });
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+/**
+ * @typedef AlignedFloats
+ * @brief A float array aligned to INSTANCE_ALIGNMENT bytes.
+ */
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+/**
+ * @class InstanceStore
+ * @brief Bounding spheres of instances, one array per component.
+ * 
+ * Padding entries have a radius of -infinity, so no culling test ever 
+ * finds them visible.
+ * 
+ * Example:
+ * @code
+ * InstanceStore store;
+ * store.add(0.0f, 0.0f, -5.0f, 1.0f);
+ * const float* x = store.getCenterX(); // aligned to 64 bytes
+ * @endcode
+ */
+class InstanceStore
+{
+public:
+    /**
+     * @fn void InstanceStore::reserve(std::size_t count)
+     * @brief Reserves room for count instances.
+     */
+    void reserve(std::size_t count);
+
+    /**
+     * @fn std::uint32_t InstanceStore::add(float x, float y, float z, 
+            float radius)
+     * @brief Appends the bounding sphere of an instance.
+     * @return std::uint32_t Index of the instance.
+     */
+    std::uint32_t add(float x, float y, float z, float radius);
+
+    /**
+     * @fn void InstanceStore::setCenter(std::size_t index, float x, float y,
+            float z)
+     * @brief Moves an instance.
+     */
+    void setCenter(std::size_t index, float x, float y, float z);
+
+    /**
+     * @brief Getter for the number of instances, without padding.
+     */
+    std::size_t size() const { return count_; }
+
+    /**
+     * @brief Getter for the length of the arrays, a multiple of 
+     * INSTANCE_PADDING.
+     */
+    std::size_t getPaddedSize() const { return radius_.size(); }
+
+    const float* getCenterX() const { return centerX_.data(); }
+    const float* getCenterY() const { return centerY_.data(); }
+    const float* getCenterZ() const { return centerZ_.data(); }
+    const float* getRadius() const { return radius_.data(); }
+
+private:
+    AlignedFloats centerX_;
+    AlignedFloats centerY_;
+    AlignedFloats centerZ_;
+    AlignedFloats radius_;
+    std::size_t count_{ 0 };
+};
@@ -0,0 +1,279 @@
+/**
+ * @file job_system.hpp
+ * @brief Header file for running small pieces of frame work on all cores.
+ * 
+ * This file contains the declaration of the JobSystem class. Every thread 
+ * of the system, including the one that owns the OpenGL context, has a 
+ * deque of jobs. A thread pushes and pops jobs at the back of its own deque 
+ * and, once that is empty, steals from the front of the others, so work 
+ * spreads to idle threads without a central queue.
+ * 
+ * The OpenGL thread never blocks on jobs: while it waits for a counter it 
+ * runs jobs itself. Jobs must not call OpenGL, since only the OpenGL thread 
+ * has a current context; they fill memory that the OpenGL thread then 
+ * submits, such as draw item lists or mapped buffers.
+ */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class JobCounter
+ * @brief Counts the unfinished jobs of a group, so the group can be waited 
+ * for.
+ */
+class JobCounter
+{
+public:
+    /**
+     * @brief Tells whether all jobs of the group have finished.
+     */
+    bool isDone() const { return pending_.load( std::memory_order_acquire ) == 0; }
+
+private:
+    friend class JobSystem;
+
+    /**
+     * @var JobCounter::pending
+     * @brief Jobs of the group that are queued or running.
+     */
+    std::atomic<std::size_t> pending_{ 0 };
+};
+
+/**
+ * @class JobSystem
+ * @brief A pool of worker threads with per-thread work-stealing deques.
+ * 
+ * @note Jobs must not throw.
+ * 
+ * Example:
+ * @code
+ * JobSystem jobs(0);  // one thread per core
+ * std::vector<float> values(100000);
+ * jobs.parallelFor(values.size(), 4096, [&](std::size_t begin, std::size_t end) {
+ *     for (std::size_t i = begin; i < end; ++i)
+ *         values[i] = std::sqrt(static_cast<float>(i));
+ * });
+ * @endcode
+ */
+class JobSystem
+{
+public:
+    /**
+     * @typedef JobSystem::Job
+     * @brief A piece of work.
+     */
+    using Job = std::function<void()>;
+
+    /**
+     * @fn JobSystem::JobSystem(std::size_t threads)
+     * @brief Starts the worker threads.
+     * @param threads Number of threads that run jobs, counting the calling 
+     * thread; 0 uses one thread per hardware thread.
+     */
+    explicit JobSystem(std::size_t threads);
+
+    /**
+     * @fn JobSystem::~JobSystem()
+     * @brief Stops and joins the worker threads.
+     */
+    ~JobSystem();
+
+    // Delete copy constructor and copy assignment operator.
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * @fn void JobSystem::setThreadCount(std::size_t threads)
+     * @brief Restarts the pool with another number of threads.
+     * @param threads As for the constructor.
+     * @note No jobs may be pending.
+     */
+    void setThreadCount(std::size_t threads);
+
+    /**
+     * @brief Getter for the number of threads, counting the calling thread.
+     */
+    std::size_t getThreadCount() const { return workers_.size(); }
+
+    /**
+     * @fn void JobSystem::run(Job job, JobCounter& counter)
+     * @brief Queues a job on the calling thread's deque.
+     * @param job The work.
+     * @param counter Counter of the job's group, which must outlive the job.
+     */
+    void run(Job job, JobCounter& counter);
+
+    /**
+     * @fn void JobSystem::wait(JobCounter& counter)
+     * @brief Runs jobs until every job of the group has finished.
+     */
+    void wait(JobCounter& counter);
+
+    /**
+     * @fn void JobSystem::parallelFor(std::size_t count, std::size_t grain,
+            Function body)
+     * @brief Calls body(begin, end) on ranges of [0, count) in parallel and 
+     * waits for all of them.
+     * @param count Number of items.
+     * @param grain Items per job; ranges are never smaller unless count is.
+     * @param body Callable taking the first and one past the last item.
+     */
+    template <typename Function>
+    void parallelFor(std::size_t count, std::size_t grain, Function body)
+    {
+        if ( count == 0 )
+        {
+            return;
+        }
+        grain = std::max<std::size_t>( grain, 1 );
+        if ( workers_.size() == 1 || count <= grain )
+        {
+            body( std::size_t{ 0 }, count );
+            return;
+        }
+        JobCounter counter;
+        for ( std::size_t begin = 0; begin < count; begin += grain )
+        {
+            const std::size_t end = std::min( begin + grain, count );
+            push( { [&body, begin, end]() { body( begin, end ); }, &counter } );
+        }
+        wakeWorkers();
+        wait( counter );
+    }
+
+    /**
+     * @brief Getter for the number of jobs run since the system started.
+     */
+    std::uint64_t getJobsRun() const { return jobsRun_.load(); }
+
+    /**
+     * @brief Getter for the number of jobs that ran on another thread than 
+     * the one that queued them.
+     */
+    std::uint64_t getJobsStolen() const { return jobsStolen_.load(); }
+
+private:
+    /**
+     * @struct Entry
+     * @brief A queued job and the counter of its group.
+     */
+    struct Entry
+    {
+        Job job;
+
+        /**
+         * @var Entry::counter
+         * @brief Counter of the job's group, decremented once the job ran.
+         */
+        JobCounter* counter;
+    };
+
+    /**
+     * @struct Worker
+     * @brief The deque of one thread.
+     */
+    struct Worker
+    {
+        /**
+         * @var Worker::mutex
+         * @brief Guards the deque against the thieves.
+         */
+        std::mutex mutex;
+        std::deque<Entry> jobs;
+    };
+
+    /**
+     * @fn void JobSystem::start(std::size_t threads)
+     * @brief Creates the deques and starts a thread for all but the first.
+     */
+    void start(std::size_t threads);
+
+    /**
+     * @fn void JobSystem::stop()
+     * @brief Wakes and joins the worker threads.
+     */
+    void stop();
+
+    /**
+     * @fn void JobSystem::push(Entry entry)
+     * @brief Adds a job to the back of the calling thread's deque without 
+     * waking anyone.
+     */
+    void push(Entry entry);
+
+    /**
+     * @fn void JobSystem::wakeWorkers()
+     * @brief Wakes every sleeping worker after a batch of pushes.
+     */
+    void wakeWorkers();
+
+    /**
+     * @fn bool JobSystem::tryRunOne(std::size_t self)
+     * @brief Runs the newest job of the own deque or steals the oldest job 
+     * of another.
+     * @return bool true if a job was run.
+     */
+    bool tryRunOne(std::size_t self);
+
+    /**
+     * @fn void JobSystem::workerLoop(std::size_t index)
+     * @brief Body of the worker threads: runs jobs, sleeping while there 
+     * are none.
+     * @param index The deque of the thread.
+     */
+    void workerLoop(std::size_t index);
+
+    /**
+     * @brief Index of the calling thread's deque; 0 for the thread that 
+     * created the system and for any other outside thread.
+     */
+    std::size_t currentIndex() const;
+
+    /**
+     * @var JobSystem::workers
+     * @brief One deque per thread, the first for the calling thread.
+     */
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    /**
+     * @var JobSystem::threads
+     * @brief The worker threads, one fewer than the deques.
+     */
+    std::vector<std::thread> threads_;
+
+    /**
+     * @var JobSystem::running
+     * @brief Cleared by stop to end the worker loops.
+     */
+    std::atomic<bool> running_;
+
+    /**
+     * @var JobSystem::sleepMutex
+     * @brief Idle workers sleep on wake until jobs are queued.
+     */
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+
+    /**
+     * @var JobSystem::queued
+     * @brief Jobs in all deques, which idle workers check before sleeping.
+     */
+    std::atomic<std::size_t> queued_;
+
+    /**
+     * @var JobSystem::jobsRun
+     * @brief Jobs run, and those of them taken from another thread's deque.
+     */
+    std::atomic<std::uint64_t> jobsRun_;
+    std::atomic<std::uint64_t> jobsStolen_;
+};
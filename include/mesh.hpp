@@ -0,0 +1,115 @@
+/**
+ * @file mesh.hpp
+ * @brief Header file for indexed meshes and the processing that prepares 
+ * them for drawing.
+ * 
+ * Geometry usually arrives as a triangle soup, three vertices per triangle, 
+ * in which every shared corner is stored again. The functions in this file 
+ * turn a soup into an indexed Mesh and reorder it for the GPU:
+ * 
+ * - makeIndexedMesh merges identical vertices with a hash table.
+ * - optimizeVertexCache reorders triangles with the Tipsify algorithm 
+ *   (Sander, Nehab and Barczak 2007), so that vertices are reused while 
+ *   they are still in the post-transform cache and the vertex shader runs 
+ *   fewer times.
+ * - optimizeVertexFetch renumbers vertices in the order the triangles first 
+ *   use them, so vertex fetches walk through memory linearly.
+ * 
+ * The effect is measured as the ACMR (average cache miss ratio): vertex 
+ * shader invocations per triangle on a simulated FIFO cache. A soup has an 
+ * ACMR of 3; a well ordered regular grid gets close to 0.5.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct Mesh
+ * @brief Indexed triangles with three floats per vertex.
+ */
+struct Mesh
+{
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+};
+
+/**
+ * @struct MeshProcessReport
+ * @brief What processing did to a mesh and how long it took.
+ */
+struct MeshProcessReport
+{
+    std::size_t inputVertices{ 0 };
+    std::size_t uniqueVertices{ 0 };
+    std::size_t triangles{ 0 };
+
+    /**
+     * @var MeshProcessReport::acmrIndexed
+     * @brief ACMR of the deduplicated mesh in its original triangle order.
+     */
+    double acmrIndexed{ 0.0 };
+
+    /**
+     * @var MeshProcessReport::acmrOptimized
+     * @brief ACMR after triangle reordering.
+     */
+    double acmrOptimized{ 0.0 };
+
+    double milliseconds{ 0.0 };
+};
+
+/**
+ * @var DEFAULT_VERTEX_CACHE_SIZE
+ * @brief Post-transform cache entries assumed when reordering and measuring.
+ */
+constexpr std::size_t DEFAULT_VERTEX_CACHE_SIZE{ 16 };
+
+/**
+ * @fn Mesh makeIndexedMesh(const std::vector<float>& vertices)
+ * @brief Merges bitwise identical vertices of a triangle soup.
+ * @param vertices Three floats per vertex, three vertices per triangle.
+ * @return Mesh The unique vertices, in order of first appearance, and one 
+ * index per input vertex.
+ */
+Mesh makeIndexedMesh(const std::vector<float>& vertices);
+
+/**
+ * @fn void optimizeVertexCache(Mesh& mesh, std::size_t cacheSize)
+ * @brief Reorders the triangles for post-transform vertex cache reuse.
+ * @param mesh The mesh whose indices are reordered.
+ * @param cacheSize Number of cache entries to optimize for.
+ */
+void optimizeVertexCache(Mesh& mesh, 
+                         std::size_t cacheSize=DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * @fn void optimizeVertexFetch(Mesh& mesh)
+ * @brief Renumbers the vertices in order of first use and drops vertices 
+ * that no triangle uses.
+ * @param mesh The mesh whose vertices are reordered.
+ */
+void optimizeVertexFetch(Mesh& mesh);
+
+/**
+ * @fn double computeACMR(const std::vector<GLuint>& indices, 
+        std::size_t vertexCount, std::size_t cacheSize)
+ * @brief Simulates a FIFO post-transform cache over the indices.
+ * @param indices Three indices per triangle.
+ * @param vertexCount Number of vertices the indices refer to.
+ * @param cacheSize Number of cache entries.
+ * @return double Cache misses per triangle (0 without triangles).
+ */
+double computeACMR(const std::vector<GLuint>& indices, std::size_t vertexCount,
+                   std::size_t cacheSize=DEFAULT_VERTEX_CACHE_SIZE);
+
+/**
+ * @fn Mesh processMesh(const std::vector<float>& soup, 
+        MeshProcessReport& report)
+ * @brief Runs deduplication, cache and fetch optimization on a soup.
+ * @param soup Three floats per vertex, three vertices per triangle.
+ * @param report Receives the counts, the ACMR before and after, and the 
+ * processing time.
+ * @return Mesh The optimized indexed mesh.
+ */
+Mesh processMesh(const std::vector<float>& soup, MeshProcessReport& report);
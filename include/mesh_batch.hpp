@@ -0,0 +1,165 @@
+/**
+ * @file mesh_batch.hpp
+ * @brief Header file for packing many meshes into shared buffers and 
+ * drawing them with a single multi-draw call.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @struct DrawElementsIndirectCommand
+ * @brief One indexed draw, laid out as glMultiDrawElementsIndirect reads it
+ * from GL_DRAW_INDIRECT_BUFFER.
+ */
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/**
+ * @class MeshBatch
+ * @brief Packs many small indexed meshes into one vertex buffer, one 
+ * element buffer and one vertex array, and draws all of them at once.
+ * 
+ * Every mesh keeps its own indices, which start at zero; the batch records 
+ * where the mesh's indices and vertices start in the shared buffers as a 
+ * DrawElementsIndirectCommand. With OpenGL 4.3 or ARB_multi_draw_indirect 
+ * the commands are uploaded to an indirect buffer and the whole batch is 
+ * one glMultiDrawElementsIndirect call. On OpenGL 3.3 the same commands 
+ * feed one glMultiDrawElementsBaseVertex call, the core equivalent of a 
+ * loop of glDrawElementsBaseVertex.
+ * 
+ * @note The MeshBatch class assumes that the OpenGL context has been 
+ * properly initialized before build and draw are called.
+ * 
+ * Example:
+ * @code
+ * MeshBatch batch;
+ * batch.addMesh(triangleVertices, {0, 1, 2});
+ * batch.addMesh(quadVertices, {0, 1, 2, 0, 2, 3});
+ * batch.build();
+ * batch.draw();
+ * @endcode
+ */
+class MeshBatch
+{
+public:
+    /**
+     * @fn MeshBatch::MeshBatch()
+     * @brief Creates an empty batch. No GL objects exist until build.
+     */
+    MeshBatch();
+
+    /**
+     * @fn MeshBatch::~MeshBatch()
+     * @brief Deletes the buffers and the vertex array of the batch.
+     */
+    ~MeshBatch();
+
+    // Delete copy constructor and copy assignment operator.
+    MeshBatch(const MeshBatch&) = delete;
+    MeshBatch& operator=(const MeshBatch&) = delete;
+
+    /**
+     * @fn std::size_t MeshBatch::addMesh(const std::vector<float>& vertices,
+            const std::vector<GLuint>& indices)
+     * @brief Appends a mesh to the batch.
+     * @param vertices Three floats per vertex.
+     * @param indices Triangle indices into vertices, starting at zero.
+     * @throws std::logic_error if the batch was already built.
+     * @return std::size_t Index of the mesh in the batch.
+     */
+    std::size_t addMesh(const std::vector<float>& vertices, 
+                        const std::vector<GLuint>& indices);
+
+    /**
+     * @fn void MeshBatch::build(const GLenum& DRAW_TYPE=GL_STATIC_DRAW)
+     * @brief Uploads all meshes and their draw commands.
+     * @param DRAW_TYPE openGl Enum The drawing usage type of the data.
+     */
+    void build(const GLenum& DRAW_TYPE=GL_STATIC_DRAW);
+
+    /**
+     * @fn void MeshBatch::draw() const
+     * @brief Draws every mesh with one multi-draw call.
+     * @note Expects the VAO of the batch to be bound, so the call can go 
+     * through a state cache; see getVAOId.
+     */
+    void draw() const;
+
+    /**
+     * @brief Getter for the vertex array of the batch.
+     * @return unsigned int The unique ID of the VAO.
+     */
+    unsigned int getVAOId() const { return VAO_; }
+
+    /**
+     * @brief Getter for the number of meshes.
+     * @return std::size_t Meshes in the batch.
+     */
+    std::size_t getMeshCount() const { return commands_.size(); }
+
+    /**
+     * @brief Getter for the draw command of a mesh.
+     * @param mesh Index from addMesh.
+     * @return const DrawElementsIndirectCommand& The command.
+     */
+    const DrawElementsIndirectCommand& getCommand(std::size_t mesh) const 
+    { 
+        return commands_[mesh]; 
+    }
+
+    /**
+     * @brief Tells whether draw uses glMultiDrawElementsIndirect.
+     * @return bool true with multi-draw indirect support.
+     */
+    bool isIndirect() const { return indirectBuffer_ != 0; }
+
+    /**
+     * @brief Getter for the number of vertices in the batch.
+     * @return std::size_t Vertices of all meshes.
+     */
+    std::size_t getVertexCount() const { return vertexCount_; }
+
+    /**
+     * @brief Getter for the number of indices in the batch.
+     * @return std::size_t Indices of all meshes.
+     */
+    std::size_t getIndexCount() const { return indexCount_; }
+
+private:
+    unsigned int VAO_;
+    unsigned int VBO_;
+    unsigned int EBO_;
+
+    /**
+     * @brief Buffer of DrawElementsIndirectCommands, 0 without support.
+     */
+    unsigned int indirectBuffer_;
+
+    std::vector<DrawElementsIndirectCommand> commands_;
+
+    /**
+     * @brief Vertex and index data until build uploads them.
+     */
+    std::vector<float> vertices_;
+    std::vector<GLuint> indices_;
+
+    /**
+     * @brief Arguments of glMultiDrawElementsBaseVertex, built from the 
+     * commands for the OpenGL 3.3 path.
+     */
+    std::vector<GLsizei> counts_;
+    std::vector<const void*> offsets_;
+    std::vector<GLint> baseVertices_;
+
+    std::size_t vertexCount_;
+    std::size_t indexCount_;
+};
@@ -0,0 +1,284 @@
+/**
+ * @file mesh_file.hpp
+ * @brief Header file for the binary mesh container and memory mapped files.
+ *
+ * Meshes are stored on disk in exactly the layout the GPU reads them in, so
+ * loading one is a matter of mapping the file and handing the mapped pages
+ * to glBufferData. Nothing is parsed or copied into an intermediate vector;
+ * the time to load a large mesh is the time the disk needs to deliver it.
+ *
+ * A mesh file is little endian and consists of:
+ * - A MeshFileHeader of 64 bytes with the counts and the bounding box.
+ * - One MeshFileAttribute per attribute of the VertexLayout, in layout order.
+ * - One MeshFileSection per vertex stream, followed by one for the indices.
+ * - The sections themselves, each starting at a multiple of
+ *   MESH_FILE_ALIGNMENT bytes: the packed vertices of every stream and
+ *   three 32-bit indices per triangle.
+ *
+ * Files are written by writeMeshFile, e.g. from the mesh_convert tool, which
+ * turns Wavefront OBJ files into mesh files.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "vertex_layout.hpp"
+
+/**
+ * @var MESH_FILE_VERSION
+ * @brief Version written into and expected from the header.
+ */
+constexpr std::uint32_t MESH_FILE_VERSION{ 1 };
+
+/**
+ * @var MESH_FILE_ALIGNMENT
+ * @brief Alignment in bytes of every section within the file.
+ */
+constexpr std::size_t MESH_FILE_ALIGNMENT{ 16 };
+
+/**
+ * @var MESH_FILE_MAX_ATTRIBUTES
+ * @brief Most attributes a mesh file may describe.
+ */
+constexpr std::uint32_t MESH_FILE_MAX_ATTRIBUTES{ 16 };
+
+/**
+ * @struct MeshFileHeader
+ * @brief First 64 bytes of a mesh file.
+ */
+struct MeshFileHeader
+{
+    /**
+     * @var MeshFileHeader::magic
+     * @brief "HTMESH" followed by "\r\n", which catches files mangled by
+     * line ending conversion.
+     */
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t attributeCount;
+    std::uint32_t streamCount;
+
+    /**
+     * @var MeshFileHeader::indexSize
+     * @brief Bytes per index, always 4.
+     */
+    std::uint32_t indexSize;
+    std::uint64_t vertexCount;
+    std::uint64_t indexCount;
+
+    /**
+     * @var MeshFileHeader::boundsMin
+     * @brief Corners of the axis aligned bounding box of the positions.
+     */
+    float boundsMin[3];
+    float boundsMax[3];
+};
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader must be 64 bytes");
+
+/**
+ * @struct MeshFileAttribute
+ * @brief One attribute of the vertex layout. Offsets are not stored; they
+ * follow from adding the attributes to a VertexLayout in order.
+ */
+struct MeshFileAttribute
+{
+    std::uint32_t location;
+    std::uint32_t components;
+
+    /**
+     * @var MeshFileAttribute::format
+     * @brief Value of the AttributeFormat enumerator.
+     */
+    std::uint32_t format;
+    std::uint32_t stream;
+};
+static_assert(sizeof(MeshFileAttribute) == 16, "MeshFileAttribute must be 16 bytes");
+
+/**
+ * @struct MeshFileSection
+ * @brief Position and size in bytes of a block of data in the file.
+ */
+struct MeshFileSection
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+static_assert(sizeof(MeshFileSection) == 16, "MeshFileSection must be 16 bytes");
+
+/**
+ * @struct MeshBounds
+ * @brief Axis aligned bounding box of a mesh.
+ */
+struct MeshBounds
+{
+    float min[3];
+    float max[3];
+};
+
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * Pages are read from disk when they are first touched. The mapping is
+ * advised for sequential access, so the kernel reads ahead while earlier
+ * pages are being consumed.
+ *
+ * Example:
+ * @code
+ * MappedFile file("scene.htmesh");
+ * const std::uint8_t* bytes = file.getData();
+ * @endcode
+ */
+class MappedFile
+{
+public:
+    /**
+     * @fn MappedFile::MappedFile(const std::string& path)
+     * @brief Opens and maps a file.
+     * @param path Path of the file.
+     * @throws std::logic_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& path);
+
+    /**
+     * @fn MappedFile::~MappedFile()
+     * @brief Unmaps and closes the file.
+     */
+    ~MappedFile();
+
+    // Delete copy constructor and copy assignment operator.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Getter for the first byte of the mapping.
+     * @return const std::uint8_t* The file contents, nullptr if it is empty.
+     */
+    const std::uint8_t* getData() const { return data_; }
+
+    /**
+     * @brief Getter for the size of the file.
+     * @return std::size_t Size in bytes.
+     */
+    std::size_t getSize() const { return size_; }
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+
+    /**
+     * @brief File descriptor, or on Windows the file and mapping handles.
+     */
+#ifdef _WIN32
+    void* file_;
+    void* mapping_;
+#else
+    int file_;
+#endif
+};
+
+/**
+ * @class MeshFile
+ * @brief A mapped and validated mesh file.
+ *
+ * Opening a mesh file only reads the header and the tables: sections are
+ * checked to lie inside the file and to match the counts and the layout,
+ * but the vertex and index data is not touched until it is uploaded.
+ *
+ * @note The indices are not checked against the vertex count. Files come
+ * from writeMeshFile, which only writes valid indices.
+ *
+ * Example:
+ * @code
+ * MeshFile file("scene.htmesh");
+ * BufferSetup mesh(file);  // glBufferData straight from the mapping
+ * @endcode
+ */
+class MeshFile
+{
+public:
+    /**
+     * @fn MeshFile::MeshFile(const std::string& path)
+     * @brief Maps a mesh file and validates its header and tables.
+     * @param path Path of the file.
+     * @throws std::logic_error if the file cannot be mapped or is not a
+     * valid mesh file.
+     */
+    explicit MeshFile(const std::string& path);
+
+    /**
+     * @brief Getter for the vertex layout described by the file.
+     */
+    const VertexLayout& getLayout() const { return layout_; }
+
+    std::size_t getVertexCount() const { return vertexCount_; }
+    std::size_t getIndexCount() const { return indexCount_; }
+
+    /**
+     * @brief Getter for the bounding box of the positions.
+     */
+    const MeshBounds& getBounds() const { return bounds_; }
+
+    /**
+     * @fn const std::uint8_t* MeshFile::getStream(std::size_t stream) const
+     * @brief Mapped bytes of a vertex stream, getLayout().getStride(stream)
+     * bytes per vertex.
+     */
+    const std::uint8_t* getStream(std::size_t stream) const;
+
+    /**
+     * @fn std::size_t MeshFile::getStreamSize(std::size_t stream) const
+     * @brief Size in bytes of a vertex stream.
+     */
+    std::size_t getStreamSize(std::size_t stream) const;
+
+    /**
+     * @fn const GLuint* MeshFile::getIndices() const
+     * @brief Mapped indices, three per triangle, or nullptr without any.
+     */
+    const GLuint* getIndices() const;
+
+    /**
+     * @brief Getter for the size of the whole file.
+     */
+    std::size_t getFileSize() const { return file_.getSize(); }
+
+private:
+    MappedFile file_;
+    VertexLayout layout_;
+    std::size_t vertexCount_;
+    std::size_t indexCount_;
+    MeshBounds bounds_;
+
+    /**
+     * @brief Sections of the vertex streams, then of the indices.
+     */
+    std::vector<MeshFileSection> sections_;
+};
+
+/**
+ * @fn MeshBounds computeBounds(const std::vector<float>& positions)
+ * @brief Bounding box of three floats per vertex, all zero without any.
+ */
+MeshBounds computeBounds(const std::vector<float>& positions);
+
+/**
+ * @fn void writeMeshFile(const std::string& path,
+        const VertexLayout& layout,
+        const std::vector<std::vector<std::uint8_t>>& streams,
+        const std::vector<GLuint>& indices, const MeshBounds& bounds)
+ * @brief Writes packed vertices and indices as a mesh file.
+ * @param path Path of the file, which is replaced.
+ * @param layout Attributes and streams of a vertex.
+ * @param streams Packed bytes of every stream, e.g. from packVertices.
+ * @param indices Three indices per triangle.
+ * @param bounds Bounding box of the positions.
+ * @throws std::logic_error if the streams do not match the layout or the
+ * file cannot be written.
+ */
+void writeMeshFile(const std::string& path, const VertexLayout& layout,
+                   const std::vector<std::vector<std::uint8_t>>& streams,
+                   const std::vector<GLuint>& indices, const MeshBounds& bounds);
@@ -0,0 +1,97 @@
+/**
+ * @file mesh_lod.hpp
+ * @brief Header file for simplifying meshes into chains of levels of
+ * detail.
+ *
+ * A distant object covers few pixels, but drawn from its full mesh it
+ * still costs every triangle. buildLodChain simplifies a Mesh step by step
+ * with quadric error metric edge collapses (Garland and Heckbert 1997):
+ * every vertex carries the sum of the planes of its triangles, and the edge
+ * whose collapse moves the surface least is collapsed first. Snapshots of
+ * the shrinking triangle list become the levels, which share the vertices
+ * of the original mesh and sit back to back in one index list, so one
+ * vertex array and element buffer draw every level.
+ *
+ * Every level records its error, an estimate of how far its surface is
+ * from the original in object units. Projected to the screen,
+ * error * scale / distance is the deviation in pixels, and the coarsest
+ * level below a pixel threshold looks the same as the full mesh.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+#include "mesh.hpp"
+
+/**
+ * @var MAX_LOD_LEVELS
+ * @brief Most levels of a chain, the full mesh included.
+ */
+constexpr std::size_t MAX_LOD_LEVELS{ 8 };
+
+/**
+ * @struct MeshLod
+ * @brief A level of detail: a range of the chain's indices and its error.
+ */
+struct MeshLod
+{
+    std::size_t firstIndex{ 0 };
+    std::size_t indexCount{ 0 };
+
+    /**
+     * @var MeshLod::error
+     * @brief Largest error of the collapses up to this level, 0 for the
+     * full mesh. The error of a collapse is the root mean square distance,
+     * weighted by area, from the kept vertex to the original planes it
+     * carries.
+     */
+    float error{ 0.0f };
+};
+
+/**
+ * @struct LodChain
+ * @brief A mesh whose indices hold every level, finest first.
+ */
+struct LodChain
+{
+    Mesh mesh;
+    std::vector<MeshLod> lods;
+    double milliseconds{ 0.0 };
+};
+
+/**
+ * @fn LodChain buildLodChain(const Mesh& mesh, std::size_t maxLevels,
+        float ratio, std::size_t minTriangles)
+ * @brief Simplifies a mesh into levels of detail.
+ *
+ * Level 0 is the mesh itself. Each following level keeps about ratio of
+ * the triangles of the one before, until a level would drop below
+ * minTriangles or simplification stops making progress. Collapses that
+ * would flip a triangle are skipped, and edges on a border keep their
+ * shape through constraint planes. Every level is reordered with
+ * optimizeVertexCache.
+ *
+ * @param mesh Indexed triangles, e.g. from makeIndexedMesh.
+ * @param maxLevels Most levels, at most MAX_LOD_LEVELS.
+ * @param ratio Triangles kept from one level to the next, in (0, 1).
+ * @param minTriangles Fewest triangles of a level.
+ * @return LodChain The original vertices and the indices of every level.
+ */
+LodChain buildLodChain(const Mesh& mesh, std::size_t maxLevels = MAX_LOD_LEVELS,
+                       float ratio = 0.5f, std::size_t minTriangles = 16);
+
+/**
+ * @fn std::size_t selectLod(const std::vector<MeshLod>& lods, float radius,
+        float distance, float pixelScale, float maxPixels)
+ * @brief Picks the coarsest level whose error covers at most maxPixels on
+ * the screen.
+ * @param lods Levels of a chain.
+ * @param radius Scale of the object, which multiplies the errors.
+ * @param distance Distance from the camera.
+ * @param pixelScale Pixels per unit at distance 1: the viewport height
+ * over 2 * tan(fovY / 2).
+ * @param maxPixels Largest deviation allowed, in pixels.
+ * @return std::size_t Index of the level.
+ */
+std::size_t selectLod(const std::vector<MeshLod>& lods, float radius,
+                      float distance, float pixelScale, float maxPixels);
@@ -0,0 +1,122 @@
+/**
+ * @file occlusion_culling.hpp
+ * @brief Header file for culling instances hidden behind other instances.
+ *
+ * Frustum culling keeps everything in view, including what is covered by
+ * nearer objects. Two ways of finding those are offered:
+ *
+ * - HiZ: the biggest occluders are rasterized on the CPU into a small depth
+ *   buffer, and a DepthPyramid of its mip levels, each texel holding the
+ *   farthest depth of the four below it, answers for a whole bounding box
+ *   with at most four reads. A box whose nearest depth lies behind all of
+ *   them is hidden.
+ * - Queries: the GPU draws a proxy box around a group of instances inside
+ *   an occlusion query, and conditional rendering skips the group's draw if
+ *   no sample of the box passed the depth test.
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @enum OcclusionMode
+ * @brief How hidden instances are culled.
+ */
+enum class OcclusionMode
+{
+    Off,
+    HiZ,
+    Queries
+};
+
+/**
+ * @fn bool parseOcclusionMode(const std::string& name, OcclusionMode& mode)
+ * @brief Converts "off", "hiz" or "queries" to an occlusion mode.
+ * @param name Name of the mode.
+ * @param mode Set to the mode if the name is known.
+ * @return bool true if the name is known.
+ */
+bool parseOcclusionMode(const std::string& name, OcclusionMode& mode);
+
+/**
+ * @fn const char* getOcclusionModeName(OcclusionMode mode)
+ * @brief Gets a lower case name of an occlusion mode.
+ */
+const char* getOcclusionModeName(OcclusionMode mode);
+
+/**
+ * @class DepthPyramid
+ * @brief Mip chain of a depth buffer whose texels keep the farthest depth
+ * they cover, for conservative occlusion tests.
+ *
+ * Depths are in [0, 1] with 1 at the far plane, as the SoftwareRasterizer
+ * and OpenGL write them. Level 0 has the size of the depth buffer, every
+ * further level half the size of the one before, down to one texel.
+ *
+ * Example:
+ * @code
+ * DepthPyramid pyramid(256, 128);
+ * pyramid.build(rasterizer.getDepth(), rasterizer.getDepthPitch());
+ * if (pyramid.isOccluded(viewProjection, x, y, z, radius))
+ * {
+ *     // ... skip the instance ...
+ * }
+ * @endcode
+ */
+class DepthPyramid
+{
+public:
+    /**
+     * @fn DepthPyramid::DepthPyramid(int width, int height)
+     * @brief Allocates the levels.
+     * @param width Width of level 0, a power of two.
+     * @param height Height of level 0, a power of two.
+     * @throws std::logic_error if a size is not a power of two.
+     */
+    DepthPyramid(int width, int height);
+
+    /**
+     * @fn void DepthPyramid::build(const float* depth, std::size_t pitch)
+     * @brief Copies a depth buffer into level 0 and reduces it into the
+     * other levels, four texels at a time with SSE2 where available.
+     * @param depth Depth buffer of the pyramid's size, bottom row first.
+     * @param pitch Floats from one row of the buffer to the next.
+     */
+    void build(const float* depth, std::size_t pitch);
+
+    /**
+     * @fn bool DepthPyramid::isOccluded(const float* viewProjection,
+            float x, float y, float z, float radius) const
+     * @brief Tests whether a sphere lies behind the depths of the pyramid.
+     *
+     * The sphere's bounding box is projected to a screen rectangle and its
+     * nearest depth. The test reads the level at which the rectangle covers
+     * at most two texels in each direction. Boxes reaching behind the near
+     * plane count as visible.
+     *
+     * @param viewProjection The matrix the depths were rendered with, 16
+     * floats in column-major order.
+     * @param x Center of the sphere.
+     * @param y Center of the sphere.
+     * @param z Center of the sphere.
+     * @param radius Radius of the sphere.
+     * @return bool true if the sphere is hidden.
+     */
+    bool isOccluded(const float* viewProjection, float x, float y, float z,
+                    float radius) const;
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    std::size_t getLevelCount() const { return levels_.size(); }
+
+private:
+    int width_;
+    int height_;
+
+    /**
+     * @brief The levels, row by row, each width_ >> level texels wide with
+     * at least one texel.
+     */
+    std::vector<std::vector<float>> levels_;
+};
@@ -0,0 +1,170 @@
+/**
+ * @file offset_allocator.hpp
+ * @brief Header file for a two-level segregated fit (TLSF) allocator of 
+ * ranges inside a larger block, such as a GPU buffer.
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class OffsetAllocator
+ * @brief Hands out ranges of [0, capacity) in constant time.
+ * 
+ * The allocator never touches the memory it manages; it only keeps track of 
+ * offsets, so the same allocator works for a buffer object, a range of 
+ * vertices or a range of indices. Units are whatever the caller counts in.
+ * 
+ * Free ranges are kept in bins. The first level bins by the highest set bit 
+ * of the size, the second level splits each power of two into 
+ * SECOND_LEVEL_BINS linear steps. Two bitmaps of non-empty bins find a free 
+ * range that is large enough with a few bit scans, and freed ranges are 
+ * merged with free neighbours straight away.
+ * 
+ * Example:
+ * @code
+ * OffsetAllocator allocator(1024);
+ * OffsetAllocator::Allocation a = allocator.allocate(100);
+ * // ... use [a.offset, a.offset + 100) ...
+ * allocator.free(a.node);
+ * @endcode
+ */
+class OffsetAllocator
+{
+public:
+    /**
+     * @var OffsetAllocator::SECOND_LEVEL_BINS
+     * @brief Linear subdivisions of every power of two.
+     */
+    static constexpr std::uint32_t SECOND_LEVEL_BINS{ 8 };
+
+    /**
+     * @var OffsetAllocator::NO_SPACE
+     * @brief Node of an allocation that did not fit.
+     */
+    static constexpr std::uint32_t NO_SPACE{ 0xFFFFFFFFu };
+
+    /**
+     * @struct Allocation
+     * @brief A range handed out by allocate.
+     */
+    struct Allocation
+    {
+        std::uint32_t offset;
+
+        /**
+         * @var Allocation::node
+         * @brief Identifies the allocation for free, NO_SPACE on failure.
+         */
+        std::uint32_t node;
+    };
+
+    /**
+     * @fn OffsetAllocator::OffsetAllocator(std::uint32_t capacity)
+     * @brief Creates an allocator with one free range of capacity units.
+     */
+    explicit OffsetAllocator(std::uint32_t capacity);
+
+    /**
+     * @fn OffsetAllocator::Allocation OffsetAllocator::allocate(
+            std::uint32_t size)
+     * @brief Finds a free range of at least size units.
+     * @param size Units to allocate, at least 1.
+     * @return Allocation The range, with node NO_SPACE if nothing fits.
+     */
+    Allocation allocate(std::uint32_t size);
+
+    /**
+     * @fn void OffsetAllocator::free(std::uint32_t node)
+     * @brief Returns an allocation and merges it with free neighbours.
+     * @param node The node of the allocation.
+     */
+    void free(std::uint32_t node);
+
+    /**
+     * @fn void OffsetAllocator::reset(std::uint32_t capacity)
+     * @brief Forgets every allocation and starts over with one free range.
+     */
+    void reset(std::uint32_t capacity);
+
+    /**
+     * @fn void OffsetAllocator::grow(std::uint32_t capacity)
+     * @brief Extends the managed range to capacity units, keeping every 
+     * allocation where it is.
+     */
+    void grow(std::uint32_t capacity);
+
+    /**
+     * @brief Getter for the offset of an allocation.
+     */
+    std::uint32_t getOffset(std::uint32_t node) const { return nodes_[node].offset; }
+
+    /**
+     * @brief Getter for the size of an allocation.
+     */
+    std::uint32_t getSize(std::uint32_t node) const { return nodes_[node].size; }
+
+    /**
+     * @brief Getter for the number of managed units.
+     */
+    std::uint32_t getCapacity() const { return capacity_; }
+
+    /**
+     * @brief Getter for the number of free units, in all free ranges.
+     */
+    std::uint32_t getFreeSize() const { return freeSize_; }
+
+    /**
+     * @fn std::uint32_t OffsetAllocator::getLargestFree() const
+     * @brief Size of the largest free range.
+     */
+    std::uint32_t getLargestFree() const;
+
+private:
+    static constexpr std::uint32_t FIRST_LEVEL_BINS{ 32 };
+    static constexpr std::uint32_t NONE{ 0xFFFFFFFFu };
+
+    /**
+     * @struct Node
+     * @brief A free or used range, linked to its neighbours in address order 
+     * and, while free, to the other ranges of its bin.
+     */
+    struct Node
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+        std::uint32_t binPrevious;
+        std::uint32_t binNext;
+        std::uint32_t neighbourPrevious;
+        std::uint32_t neighbourNext;
+        bool used;
+    };
+
+    std::uint32_t createNode(std::uint32_t offset, std::uint32_t size);
+    void insertFree(std::uint32_t node);
+    void removeFree(std::uint32_t node);
+
+    std::vector<Node> nodes_;
+
+    /**
+     * @brief Nodes that can be reused by createNode.
+     */
+    std::vector<std::uint32_t> unusedNodes_;
+
+    /**
+     * @brief First free node of every bin, and bitmaps of non-empty bins.
+     */
+    std::array<std::uint32_t, FIRST_LEVEL_BINS * SECOND_LEVEL_BINS> bins_;
+    std::uint32_t firstLevelMap_;
+    std::array<std::uint8_t, FIRST_LEVEL_BINS> secondLevelMaps_;
+
+    /**
+     * @brief Node at the highest offset, which grow extends.
+     */
+    std::uint32_t last_;
+
+    std::uint32_t capacity_;
+    std::uint32_t freeSize_;
+};
@@ -0,0 +1,143 @@
+/**
+ * @file program_cache.hpp
+ * @brief Header file for the on-disk cache of linked shader programs.
+ * 
+ * This file contains the declaration of the ProgramCache class, which stores 
+ * the driver's binary form of linked programs (glGetProgramBinary) in a 
+ * directory and loads them back with glProgramBinary on later runs, so the 
+ * GLSL sources do not have to be compiled and linked again.
+ * 
+ * Entries are keyed on a hash of the shader sources together with the 
+ * vendor, renderer and version strings of the driver, because a binary is 
+ * only valid for the exact driver that produced it. A driver may still 
+ * reject a binary, e.g. after an update that kept the version string; the 
+ * program is then built from source and the entry is replaced.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @struct ProgramCacheStats
+ * @brief Counts of cache lookups and the build time they saved.
+ */
+struct ProgramCacheStats
+{
+    /**
+     * @var ProgramCacheStats::hits
+     * @brief Programs loaded from a cached binary.
+     */
+    std::size_t hits{ 0 };
+
+    /**
+     * @var ProgramCacheStats::misses
+     * @brief Programs that had no cached binary.
+     */
+    std::size_t misses{ 0 };
+
+    /**
+     * @var ProgramCacheStats::rejected
+     * @brief Cached binaries the driver refused to load.
+     */
+    std::size_t rejected{ 0 };
+
+    /**
+     * @var ProgramCacheStats::savedMs
+     * @brief Compile and link time of the hits minus their load time.
+     */
+    double savedMs{ 0.0 };
+};
+
+/**
+ * @class ProgramCache
+ * @brief Stores and loads program binaries in a directory.
+ * 
+ * @note The ProgramCache class assumes that the OpenGL context has been 
+ * properly initialized before it is constructed.
+ * 
+ * Example:
+ * @code
+ * ProgramCache cache(".shader_cache");
+ * Program program(vertexSource, fragmentSource, &cache);
+ * @endcode
+ */
+class ProgramCache
+{
+public:
+    /**
+     * @fn ProgramCache::ProgramCache(const std::string& directory)
+     * @brief Checks driver support and creates the cache directory.
+     * @param directory Directory the binaries are stored in.
+     */
+    explicit ProgramCache(const std::string& directory);
+
+    // Delete copy constructor and copy assignment operator.
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    /**
+     * @fn std::uint64_t ProgramCache::makeKey(const char* vertexSource, 
+            const char* fragmentSource) const
+     * @brief Hashes the shader sources and the driver identification.
+     * @param vertexSource GLSL source of the vertex shader.
+     * @param fragmentSource GLSL source of the fragment shader.
+     * @return std::uint64_t Key of the program.
+     */
+    std::uint64_t makeKey(const char* vertexSource, 
+                          const char* fragmentSource) const;
+
+    /**
+     * @fn bool ProgramCache::load(std::uint64_t key, GLuint program)
+     * @brief Loads the cached binary of a key into a program object.
+     * 
+     * A hit leaves the program linked. A miss or a rejected binary leaves 
+     * it unlinked, and the caller builds it from source.
+     * 
+     * @param key Key from makeKey.
+     * @param program A newly created program object.
+     * @return bool true if the program was loaded and linked.
+     */
+    bool load(std::uint64_t key, GLuint program);
+
+    /**
+     * @fn void ProgramCache::store(std::uint64_t key, GLuint program, 
+            double buildMs)
+     * @brief Saves the binary of a linked program.
+     * @param key Key from makeKey.
+     * @param program A linked program object, linked with 
+     * GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     * @param buildMs Time spent compiling and linking it from source.
+     */
+    void store(std::uint64_t key, GLuint program, double buildMs);
+
+    /**
+     * @brief Tells whether the driver can save program binaries.
+     * @return bool true if the cache is used at all.
+     */
+    bool isSupported() const { return supported_; }
+
+    /**
+     * @brief Getter for the lookup counts.
+     * @return const ProgramCacheStats& The statistics.
+     */
+    const ProgramCacheStats& getStats() const { return stats_; }
+
+private:
+    /**
+     * @brief Builds the path of the file of a key.
+     */
+    std::string pathOf(std::uint64_t key) const;
+
+    std::string directory_;
+
+    /**
+     * @brief Vendor, renderer and version strings of the driver.
+     */
+    std::string driver_;
+
+    bool supported_;
+    ProgramCacheStats stats_;
+};
@@ -0,0 +1,337 @@
+/**
+ * @file render_queue.hpp
+ * @brief Header file for sorted draw submission with redundant state 
+ * filtering.
+ * 
+ * This file contains the declarations of the GLStateCache and RenderQueue 
+ * classes. Scenes no longer call OpenGL to draw; they describe every draw as 
+ * a DrawItem with a packed 64-bit sort key and push it into the RenderQueue. 
+ * Once per frame the queue radix-sorts the items by key, so draws that share 
+ * a program, a vertex array and textures end up next to each other, and 
+ * submits them through the GLStateCache, which skips every bind that would 
+ * not change the current state.
+ * 
+ * Per-draw uniform data travels as a range of a UniformRing, which the 
+ * queue binds to OBJECT_UNIFORM_BINDING before the draw.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mesh_batch.hpp"
+#include "uniform_buffer.hpp"
+
+/**
+ * @class GLStateCache
+ * @brief Remembers the currently bound OpenGL objects and skips binds that 
+ * would not change them.
+ * 
+ * @note All binds of the tracked state during a frame must go through the 
+ * cache. Code outside of it may change bindings between frames, so 
+ * invalidate is called at the start of every frame.
+ */
+class GLStateCache
+{
+public:
+    /**
+     * @var GLStateCache::TEXTURE_UNITS
+     * @brief Number of texture units whose bindings are tracked.
+     */
+    static constexpr std::size_t TEXTURE_UNITS{ 16 };
+
+    /**
+     * @var GLStateCache::UNIFORM_BINDINGS
+     * @brief Number of uniform buffer binding points whose ranges are 
+     * tracked.
+     */
+    static constexpr std::size_t UNIFORM_BINDINGS{ 4 };
+
+    /**
+     * @fn GLStateCache::GLStateCache()
+     * @brief Creates a cache that knows nothing about the current state.
+     */
+    GLStateCache();
+
+    /**
+     * @fn void GLStateCache::invalidate()
+     * @brief Forgets the tracked state, so the next bind of everything is 
+     * issued.
+     */
+    void invalidate();
+
+    /**
+     * @fn void GLStateCache::useProgram(GLuint program)
+     * @brief Calls glUseProgram unless the program is already in use.
+     */
+    void useProgram(GLuint program);
+
+    /**
+     * @fn void GLStateCache::bindVertexArray(GLuint vao)
+     * @brief Calls glBindVertexArray unless the VAO is already bound.
+     */
+    void bindVertexArray(GLuint vao);
+
+    /**
+     * @fn void GLStateCache::bindTexture(GLuint unit, GLenum target, 
+            GLuint texture)
+     * @brief Binds a texture to a unit unless it is already bound there.
+     * @param unit Texture unit index, below TEXTURE_UNITS.
+     * @param target Texture target, e.g. GL_TEXTURE_2D_ARRAY.
+     * @param texture Texture ID.
+     */
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    /**
+     * @fn void GLStateCache::bindUniformRange(GLuint binding, GLuint buffer,
+            GLintptr offset, GLsizeiptr size)
+     * @brief Binds a range of a uniform buffer to a binding point unless 
+     * that exact range is already bound there.
+     * @param binding Binding point, below UNIFORM_BINDINGS.
+     * @param buffer Buffer ID.
+     * @param offset Byte offset of the range, suitably aligned.
+     * @param size Bytes of the range.
+     */
+    void bindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, 
+                          GLsizeiptr size);
+
+    /**
+     * @fn void GLStateCache::resetCounters()
+     * @brief Sets the bind counters back to zero.
+     */
+    void resetCounters();
+
+    /**
+     * @brief Getter for the number of binds passed on to OpenGL.
+     * @return std::uint64_t Binds issued since the last counter reset.
+     */
+    std::uint64_t getBindsIssued() const { return bindsIssued_; }
+
+    /**
+     * @brief Getter for the number of binds that were skipped.
+     * @return std::uint64_t Binds elided since the last counter reset.
+     */
+    std::uint64_t getBindsElided() const { return bindsElided_; }
+
+    /**
+     * @brief Getter for the number of issued binds that were texture binds.
+     * @return std::uint64_t Texture binds issued since the last counter 
+     * reset.
+     */
+    std::uint64_t getTextureBindsIssued() const { return textureBindsIssued_; }
+
+private:
+    /**
+     * @brief Marks every tracked binding as unknown after invalidate.
+     */
+    void ensureValid();
+
+    /**
+     * @brief Counts a bind and tells whether it has to be issued.
+     * @param current The tracked binding, updated to value.
+     * @param value The requested binding.
+     * @return bool true if the binding changes.
+     */
+    bool change(GLuint& current, GLuint value);
+
+    GLuint program_;
+    GLuint vao_;
+    GLuint activeUnit_;
+    std::array<GLuint, TEXTURE_UNITS> textures_;
+    std::array<GLenum, TEXTURE_UNITS> textureTargets_;
+
+    /**
+     * @struct UniformRange
+     * @brief A tracked uniform buffer binding.
+     */
+    struct UniformRange
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+    std::array<UniformRange, UNIFORM_BINDINGS> uniformRanges_;
+    bool valid_;
+    std::uint64_t bindsIssued_;
+    std::uint64_t bindsElided_;
+    std::uint64_t textureBindsIssued_;
+};
+
+/**
+ * @struct DrawItem
+ * @brief Everything needed to issue one draw call.
+ */
+struct DrawItem
+{
+    /**
+     * @var DrawItem::key
+     * @brief Sort key, usually from makeSortKey.
+     */
+    std::uint64_t key{ 0 };
+
+    GLuint program{ 0 };
+    GLuint vao{ 0 };
+
+    /**
+     * @var DrawItem::texture
+     * @brief Texture bound to unit 0, or 0 for none.
+     */
+    GLuint texture{ 0 };
+    GLenum textureTarget{ GL_TEXTURE_2D };
+
+    GLenum mode{ GL_TRIANGLES };
+    GLint first{ 0 };
+    GLsizei count{ 0 };
+
+    /**
+     * @var DrawItem::instances
+     * @brief Number of instances, 0 for a non-instanced draw.
+     */
+    GLsizei instances{ 0 };
+
+    /**
+     * @var DrawItem::baseInstance
+     * @brief Added to the instance index before instanced attributes are 
+     * read. Anything but 0 needs OpenGL 4.2 or ARB_base_instance.
+     */
+    GLuint baseInstance{ 0 };
+
+    /**
+     * @var DrawItem::indexType
+     * @brief Type of the indices in the bound element buffer, or GL_NONE 
+     * for a non-indexed draw. Indexed draws read count indices starting 
+     * at indexOffset bytes and add baseVertex to each.
+     */
+    GLenum indexType{ GL_NONE };
+    GLintptr indexOffset{ 0 };
+    GLint baseVertex{ 0 };
+
+    /**
+     * @var DrawItem::batch
+     * @brief Batch drawn with one multi-draw call instead of the fields 
+     * above, or nullptr. vao must be the batch's vertex array.
+     */
+    const MeshBatch* batch{ nullptr };
+
+    /**
+     * @var DrawItem::uniformBuffer
+     * @brief Buffer of the draw's uniform block, bound to 
+     * OBJECT_UNIFORM_BINDING from uniformOffset for uniformSize bytes, or 0 
+     * for none.
+     */
+    GLuint uniformBuffer{ 0 };
+    GLintptr uniformOffset{ 0 };
+    GLsizeiptr uniformSize{ 0 };
+
+    /**
+     * @var DrawItem::occlusionQuery
+     * @brief Query object the draw runs inside as a GL_ANY_SAMPLES_PASSED 
+     * query, or 0 for none. Such a draw is a proxy: it writes neither color
+     * nor depth.
+     */
+    GLuint occlusionQuery{ 0 };
+
+    /**
+     * @var DrawItem::conditionQuery
+     * @brief Query object whose result decides, through conditional 
+     * rendering, whether the draw runs at all, or 0 for none. The GPU 
+     * waits for the result; the CPU does not.
+     */
+    GLuint conditionQuery{ 0 };
+};
+
+/**
+ * @fn std::uint64_t makeSortKey(std::uint32_t program, std::uint32_t vao,
+        std::uint32_t texture, float depth)
+ * @brief Packs draw state into a key whose order groups expensive state 
+ * changes together.
+ * 
+ * From the most to the least significant bits the key holds 16 bits of 
+ * program, 16 bits of vertex array, 12 bits of texture and 20 bits of depth, 
+ * so sorting switches programs least often. The identifiers are small 
+ * indices (or OpenGL names) and are truncated to their field width.
+ * 
+ * @param program Index of the program.
+ * @param vao Index of the vertex array.
+ * @param texture Index of the texture.
+ * @param depth Depth in [0, 1], drawn front to back.
+ * @return std::uint64_t The sort key.
+ */
+std::uint64_t makeSortKey(std::uint32_t program, std::uint32_t vao, 
+                          std::uint32_t texture, float depth);
+
+/**
+ * @class RenderQueue
+ * @brief Collects the draws of a frame, sorts them and submits them.
+ * 
+ * Example:
+ * @code
+ * DrawItem item;
+ * item.key = makeSortKey(program, vao, 0, 0.5f);
+ * item.program = program;
+ * item.vao = vao;
+ * item.count = 3;
+ * queue.submit(item);
+ * queue.sort();
+ * queue.flush(stateCache);
+ * @endcode
+ */
+class RenderQueue
+{
+public:
+    /**
+     * @fn void RenderQueue::submit(const DrawItem& item)
+     * @brief Adds a draw to the current frame.
+     */
+    void submit(const DrawItem& item);
+
+    /**
+     * @fn void RenderQueue::submit(const std::vector<DrawItem>& items)
+     * @brief Adds a list of draws that was prepared off the OpenGL thread.
+     */
+    void submit(const std::vector<DrawItem>& items);
+
+    /**
+     * @fn void RenderQueue::sort()
+     * @brief Orders the draws by key with a stable LSD radix sort.
+     * 
+     * Byte passes in which every key has the same digit are skipped, so 
+     * keys that only use a few fields sort in a few passes.
+     */
+    void sort();
+
+    /**
+     * @fn std::size_t RenderQueue::flush(GLStateCache& state)
+     * @brief Issues the draws in sorted order and empties the queue.
+     * @param state Cache through which all binds are made.
+     * @return std::size_t Number of draw calls issued.
+     */
+    std::size_t flush(GLStateCache& state);
+
+    /**
+     * @brief Getter for the number of queued draws.
+     * @return std::size_t Draws submitted since the last flush.
+     */
+    std::size_t size() const { return items_.size(); }
+
+private:
+    /**
+     * @struct SortEntry
+     * @brief Key and item index, the unit that the radix sort moves around.
+     */
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    std::vector<DrawItem> items_;
+
+    /**
+     * @brief Sorted order of the items, and the scratch buffer of the sort.
+     */
+    std::vector<SortEntry> order_;
+    std::vector<SortEntry> scratch_;
+};
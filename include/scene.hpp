@@ -0,0 +1,1008 @@
+/**
+ * @file scene.hpp
+ * @brief Header file for the scenes that the display loop can render.
+ * 
+ * This file contains the declaration of the abstract `Scene` class, which 
+ * owns the shaders and buffers of one thing to draw, and the scenes derived 
+ * from it. The display loop only sees the `Scene` interface, so the scene 
+ * is picked on the command line without changing the loop.
+ * 
+ * The `TriangleScene` draws the single triangle of the original program. 
+ * The `InstancedScene` draws many copies of the triangle with one instanced 
+ * draw call and can sweep the instance count to show how frame time scales.
+ * The `StreamingScene` regenerates all of its geometry on the CPU every frame 
+ * and uploads it through a `StreamingBuffer`. The `ObjectsScene` draws many 
+ * small objects with separate draw calls that switch between several 
+ * programs and vertex arrays. The `BatchScene` packs many distinct small 
+ * meshes into a `MeshBatch` and draws them with one multi-draw call. The 
+ * `MeshScene` turns a large triangle soup into an optimized indexed mesh. 
+ * The `CullingScene` culls a million bounding spheres against the view 
+ * frustum every frame and draws only the visible ones. The `ModelScene` 
+ * draws a mesh loaded from a memory mapped mesh file. The `SyntheticScene` 
+ * has one knob per cost a frame can have and is what the benchmark runs.
+ * 
+ * Scenes tell which part of the view the next frame changes, so on-demand 
+ * rendering can skip frames that change nothing and scissor the rest to 
+ * the damaged area.
+ * 
+ * Scenes do not draw directly. They submit DrawItems to a RenderQueue, which 
+ * sorts and issues them after every scene has been asked. Scenes with much 
+ * per-frame CPU work spread it over a JobSystem and only hand the prepared 
+ * results to OpenGL on the calling thread.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "asset_loader.hpp"
+#include "buffer.hpp"
+#include "buffer_arena.hpp"
+#include "frame_profiler.hpp"
+#include "frustum_culling.hpp"
+#include "instance_store.hpp"
+#include "job_system.hpp"
+#include "mesh_batch.hpp"
+#include "mesh_file.hpp"
+#include "mesh_lod.hpp"
+#include "occlusion_culling.hpp"
+#include "render_queue.hpp"
+#include "settings.hpp"
+#include "shader_pipeline.hpp"
+#include "software_rasterizer.hpp"
+#include "streaming_buffer.hpp"
+#include "texture.hpp"
+#include "uniform_buffer.hpp"
+#include "vertex_layout.hpp"
+
+/**
+ * @struct DamageRect
+ * @brief A rectangle of the view that has to be redrawn, in normalized 
+ * device coordinates. Defaults to the whole view.
+ */
+struct DamageRect
+{
+    float left{ -1.0f };
+    float bottom{ -1.0f };
+    float right{ 1.0f };
+    float top{ 1.0f };
+
+    /**
+     * @brief Grows the rectangle to cover another one as well.
+     * @param other The rectangle to add.
+     */
+    void add(const DamageRect& other)
+    {
+        left = std::min( left, other.left );
+        bottom = std::min( bottom, other.bottom );
+        right = std::max( right, other.right );
+        top = std::max( top, other.top );
+    }
+
+    /**
+     * @brief Tells whether the rectangle covers the whole view.
+     */
+    bool isFull() const
+    {
+        return left <= -1.0f && bottom <= -1.0f && right >= 1.0f && top >= 1.0f;
+    }
+};
+
+/**
+ * @class Scene
+ * @brief Base class of everything the display loop can draw.
+ * 
+ * @note Scenes create GL objects in their constructors, so the OpenGL 
+ * context must be current when they are created.
+ * 
+ * Scenes submit their shader programs to a ShaderPipeline and skip drawing 
+ * whatever uses a program that is not ready yet, so the first frames are 
+ * rendered while shaders are still being built.
+ */
+class Scene
+{
+public:
+    /**
+     * @fn Scene::virtual ~Scene()
+     * @brief Default virtual destructor.
+     */
+    virtual ~Scene() = default;
+
+    /**
+     * @fn void Scene::update(std::size_t frame)
+     * @brief Advances the scene state before a frame is drawn.
+     * @param frame Number of the frame about to be drawn.
+     */
+    virtual void update(std::size_t frame) { (void)frame; }
+
+    /**
+     * @fn bool Scene::getDamage(std::size_t frame, DamageRect& damage) const
+     * @brief Tells which part of the view changes when the scene is updated
+     * to a frame. Scenes that animate all over change the whole view every 
+     * frame, which is the default.
+     * @param frame Number of the frame about to be drawn.
+     * @param damage Set to the area that changes.
+     * @return bool false if the frame would look the same as the last one.
+     */
+    virtual bool getDamage(std::size_t frame, DamageRect& damage) const
+    {
+        (void)frame;
+        damage = DamageRect{};
+        return true;
+    }
+
+    /**
+     * @fn void Scene::draw(RenderQueue& queue, FrameProfiler& profiler)
+     * @brief Submits the draws of the scene.
+     * @param queue The queue that sorts and issues the draws.
+     * @param profiler Timings of the current frame, to which the scene adds
+     * its counters.
+     */
+    virtual void draw(RenderQueue& queue, FrameProfiler& profiler) = 0;
+
+    /**
+     * @fn void Scene::endFrame()
+     * @brief Called after the queued draws of the frame were issued.
+     */
+    virtual void endFrame() {}
+
+    /**
+     * @fn std::size_t Scene::getFrameLimit() const
+     * @brief Number of frames the scene needs to finish (0 = no limit).
+     */
+    virtual std::size_t getFrameLimit() const { return 0; }
+
+    /**
+     * @fn void Scene::report(const FrameProfiler& profiler) const
+     * @brief Prints scene specific results after the display loop.
+     * @param profiler Timings of the frames that were rendered.
+     */
+    virtual void report(const FrameProfiler& profiler) const { (void)profiler; }
+};
+
+/**
+ * @class TriangleScene
+ * @brief Draws one triangle with a constant color.
+ */
+class TriangleScene : public Scene
+{
+public:
+    /**
+     * @fn TriangleScene::TriangleScene(ShaderPipeline& pipeline)
+     * @brief Submits the shader program and uploads the triangle.
+     * @param pipeline The pipeline that builds the shader program.
+     */
+    explicit TriangleScene(ShaderPipeline& pipeline);
+
+    /**
+     * @brief The triangle never moves, so no frame changes the view.
+     */
+    bool getDamage(std::size_t frame, DamageRect& damage) const override
+    {
+        (void)frame;
+        (void)damage;
+        return false;
+    }
+
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+
+private:
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<BufferSetup> buffer_;
+};
+
+/**
+ * @class InstancedScene
+ * @brief Draws a grid of triangles, each with its own offset, scale and 
+ * color, using a single instanced draw call.
+ * 
+ * In sweep mode the number of drawn instances doubles from 1 up to the 
+ * configured count, staying at each count for SWEEP_FRAMES frames, and the 
+ * frame time of every step is reported at the end.
+ */
+class InstancedScene : public Scene
+{
+public:
+    /**
+     * @var InstancedScene::SWEEP_FRAMES
+     * @brief Frames rendered at each instance count of a sweep.
+     */
+    static constexpr std::size_t SWEEP_FRAMES{ 120 };
+
+    /**
+     * @fn InstancedScene::InstancedScene(std::size_t instances, bool sweep,
+            ShaderPipeline& pipeline)
+     * @brief Submits the shader program and uploads the mesh and instance 
+     * data.
+     * @param instances Number of instances (the largest count of a sweep).
+     * @param sweep Whether to step through increasing instance counts.
+     * @param pipeline The pipeline that builds the shader program.
+     */
+    InstancedScene(std::size_t instances, bool sweep, ShaderPipeline& pipeline);
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    std::size_t getFrameLimit() const override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<BufferSetup> buffer_;
+
+    /**
+     * @brief Instance counts of the sweep, or only the full count.
+     */
+    std::vector<GLsizei> steps_;
+
+    /**
+     * @brief Instances drawn in the current frame.
+     */
+    GLsizei drawnInstances_;
+};
+
+/**
+ * @class StreamingScene
+ * @brief Draws a grid of spinning triangles whose vertices are computed on 
+ * the CPU and uploaded every frame through a fenced streaming buffer.
+ * 
+ * The vertices are written straight into the mapped buffer by jobs of 
+ * GRAIN triangles each; mapping, committing and drawing stay on the OpenGL 
+ * thread.
+ */
+class StreamingScene : public Scene
+{
+public:
+    /**
+     * @var StreamingScene::GRAIN
+     * @brief Triangles computed by one job.
+     */
+    static constexpr std::size_t GRAIN{ 4096 };
+
+    /**
+     * @fn StreamingScene::StreamingScene(std::size_t triangles, 
+            JobSystem& jobs, ShaderPipeline& pipeline)
+     * @brief Submits the shader program and creates the streaming buffer.
+     * @param triangles Number of triangles regenerated every frame.
+     * @param jobs The job system that computes the vertices.
+     * @param pipeline The pipeline that builds the shader program.
+     */
+    StreamingScene(std::size_t triangles, JobSystem& jobs, 
+                   ShaderPipeline& pipeline);
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void endFrame() override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    JobSystem& jobs_;
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<StreamingBuffer> stream_;
+    std::unique_ptr<BufferSetup> buffer_;
+
+    /**
+     * @brief Number of triangles, and the grid they are placed on.
+     */
+    std::size_t triangles_;
+    std::size_t side_;
+
+    /**
+     * @brief Frame whose geometry is generated in draw.
+     */
+    std::size_t frame_;
+};
+
+/**
+ * @class ObjectsScene
+ * @brief Draws every object of a grid, a mesh of one to three triangles, 
+ * with its own draw call.
+ * 
+ * The objects use PROGRAMS programs and are submitted in an order that 
+ * switches programs on almost every draw, which is what the sorted render 
+ * queue and state cache are there to fix.
+ * 
+ * Every frame 1 / CHURN_DIVISOR of the objects are replaced by new meshes 
+ * of a different size. With an arena all meshes are ranges of one shared 
+ * BufferArena, which the churn fragments and the arena defragments; 
+ * without it every mesh has a vertex buffer and a vertex array of its own.
+ * 
+ * The objects drift in depth every frame. Jobs of GRAIN objects each move 
+ * them, skip those whose program is not ready and fill a draw item list 
+ * with their sort keys; the OpenGL thread only submits the lists.
+ * 
+ * Every object has a uniform block of its own with its sway and its color, 
+ * which depends on its depth. The jobs write the blocks of all objects 
+ * into one range of the UniformRing, at the member offsets reflected from 
+ * each program, and every draw item carries the range of its object.
+ */
+class ObjectsScene : public Scene
+{
+public:
+    /**
+     * @var ObjectsScene::PROGRAMS
+     * @brief Number of distinct shader programs.
+     */
+    static constexpr std::size_t PROGRAMS{ 4 };
+
+    /**
+     * @var ObjectsScene::CHURN_DIVISOR
+     * @brief Fraction of the objects replaced every frame, as a divisor.
+     */
+    static constexpr std::size_t CHURN_DIVISOR{ 64 };
+
+    /**
+     * @var ObjectsScene::GRAIN
+     * @brief Objects prepared by one job.
+     */
+    static constexpr std::size_t GRAIN{ 1024 };
+
+    /**
+     * @var ObjectsScene::OBJECT_BLOCK_SIZE
+     * @brief Size of the std140 Object block, two vec4 members.
+     */
+    static constexpr GLsizeiptr OBJECT_BLOCK_SIZE{ 32 };
+
+    /**
+     * @fn ObjectsScene::ObjectsScene(std::size_t objects, bool useArena,
+            JobSystem& jobs, UniformRing& uniforms, ShaderPipeline& pipeline)
+     * @brief Submits the programs and uploads the meshes.
+     * @param objects Number of objects, each drawn separately.
+     * @param useArena Whether the meshes share the buffers of an arena.
+     * @param jobs The job system that prepares the draw items.
+     * @param uniforms The ring the per-object blocks are written to, which 
+     * is grown to hold the blocks of all objects.
+     * @param pipeline The pipeline that builds the shader programs.
+     */
+    ObjectsScene(std::size_t objects, bool useArena, JobSystem& jobs, 
+                 UniformRing& uniforms, ShaderPipeline& pipeline);
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    /**
+     * @struct Object
+     * @brief State of one object.
+     */
+    struct Object
+    {
+        std::size_t program;
+        float baseDepth;
+        float depth;
+    };
+
+    /**
+     * @fn BufferSetup ObjectsScene::createMesh(std::size_t object, 
+            std::size_t generation)
+     * @brief Builds the mesh of an object, whose triangle count depends on 
+     * how often the object was replaced.
+     */
+    BufferSetup createMesh(std::size_t object, std::size_t generation);
+
+    /**
+     * @struct ObjectBlock
+     * @brief Reflected layout of the Object block of one program.
+     */
+    struct ObjectBlock
+    {
+        bool reflected{ false };
+        GLint swayOffset{ -1 };
+        GLint colorOffset{ -1 };
+    };
+
+    JobSystem& jobs_;
+    UniformRing& uniforms_;
+    ShaderPipeline& pipeline_;
+    std::vector<ShaderPipeline::Handle> programs_;
+    std::vector<ObjectBlock> blocks_;
+
+    /**
+     * @brief Arena of the meshes, declared first so that it outlives them.
+     */
+    std::unique_ptr<BufferArena> arena_;
+
+    std::vector<Object> objects_;
+    std::vector<std::unique_ptr<BufferSetup>> meshes_;
+
+    /**
+     * @brief Draw items of every job, kept between frames to reuse their 
+     * memory.
+     */
+    std::vector<std::vector<DrawItem>> lists_;
+
+    /**
+     * @brief Grid the objects are placed on.
+     */
+    std::size_t side_;
+
+    /**
+     * @brief Frame whose depths are computed in draw.
+     */
+    std::size_t frame_;
+};
+
+/**
+ * @class BatchScene
+ * @brief Draws a grid of distinct small polygons that share one vertex and 
+ * one index buffer.
+ * 
+ * Every polygon is its own mesh with 3 to 8 corners. Batched, all of them 
+ * are one draw item that the MeshBatch issues with a single multi-draw 
+ * call; unbatched, every mesh is a separate indexed draw item.
+ */
+class BatchScene : public Scene
+{
+public:
+    /**
+     * @fn BatchScene::BatchScene(std::size_t meshes, bool batched, 
+            ShaderPipeline& pipeline)
+     * @brief Submits the shader program and builds the batch.
+     * @param meshes Number of distinct meshes.
+     * @param batched Whether to draw all meshes with one multi-draw call.
+     * @param pipeline The pipeline that builds the shader program.
+     */
+    BatchScene(std::size_t meshes, bool batched, ShaderPipeline& pipeline);
+
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<MeshBatch> batch_;
+    bool batched_;
+};
+
+/**
+ * @class MeshScene
+ * @brief Draws one large indexed grid that was built as a shuffled 
+ * triangle soup and run through processMesh.
+ * 
+ * The grid is a lit height field whose vertices have a position, a normal 
+ * and a texture coordinate, stored as floats or in packed formats.
+ */
+class MeshScene : public Scene
+{
+public:
+    /**
+     * @fn MeshScene::MeshScene(std::size_t triangles, bool optimize,
+            const std::string& vertexFormat, ShaderPipeline& pipeline)
+     * @brief Submits the shader program, builds and processes the mesh.
+     * @param triangles Approximate number of triangles of the grid.
+     * @param optimize Whether to reorder the mesh after deduplication.
+     * @param vertexFormat "float", "packed" or "split".
+     * @param pipeline The pipeline that builds the shader program.
+     * @throws std::logic_error if the vertex format is unknown.
+     */
+    MeshScene(std::size_t triangles, bool optimize, 
+              const std::string& vertexFormat, ShaderPipeline& pipeline);
+
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<BufferSetup> buffer_;
+    MeshProcessReport processReport_;
+    bool optimize_;
+    std::string vertexFormat_;
+    std::size_t vertexSize_;
+};
+
+/**
+ * @class CullingScene
+ * @brief Draws the instances of an InstanceStore scattered around a turning 
+ * camera, culled against the view frustum every frame.
+ * 
+ * Jobs of GRAIN instances cull their range with the SIMD kernel and the 
+ * surviving indices are packed into a streaming buffer, from which every 
+ * instance of an instanced draw reads its index. The shader looks the 
+ * sphere of that index up in a buffer texture.
+ * 
+ * The sphere is an icosphere with a chain of levels of detail built at 
+ * load time. The jobs also pick a level for every visible instance, the 
+ * coarsest whose error projects to at most LOD_PIXEL_ERROR pixels, and 
+ * sort their survivors by level. The stream holds the instances grouped by 
+ * level, and each level is one instanced draw whose base instance points 
+ * at its group.
+ * 
+ * Instances hidden behind nearer ones are culled as well, in one of two 
+ * ways. With HiZ occlusion the biggest instances in view are rasterized on
+ * the CPU into a small depth buffer, whose DepthPyramid the jobs test every
+ * instance against after the frustum. With queries the instances are 
+ * stored grouped by the cells of a grid; every cell with visible instances
+ * draws its box inside an occlusion query, front to back, and then its 
+ * instances as one draw at one level of detail under conditional 
+ * rendering.
+ */
+class CullingScene : public Scene
+{
+public:
+    /**
+     * @var CullingScene::GRAIN
+     * @brief Instances culled by one job, a multiple of INSTANCE_PADDING.
+     */
+    static constexpr std::size_t GRAIN{ 65536 };
+
+    /**
+     * @var CullingScene::SPHERE_SUBDIVISIONS
+     * @brief Subdivisions of the icosahedron, 20 * 4^n triangles at full 
+     * detail.
+     */
+    static constexpr int SPHERE_SUBDIVISIONS{ 3 };
+
+    /**
+     * @var CullingScene::LOD_PIXEL_ERROR
+     * @brief Largest error of a level, projected to the screen in pixels, 
+     * at which the level is used.
+     */
+    static constexpr float LOD_PIXEL_ERROR{ 1.0f };
+
+    /**
+     * @var CullingScene::OCCLUSION_WIDTH
+     * @brief Size of the CPU depth buffer of HiZ occlusion, powers of two.
+     */
+    static constexpr int OCCLUSION_WIDTH{ 256 };
+    static constexpr int OCCLUSION_HEIGHT{ 128 };
+
+    /**
+     * @var CullingScene::OCCLUDERS
+     * @brief Most instances rasterized as occluders per frame, picked from
+     * the OCCLUDER_CANDIDATES that look biggest from the camera.
+     */
+    static constexpr std::size_t OCCLUDERS{ 64 };
+    static constexpr std::size_t OCCLUDER_CANDIDATES{ 4096 };
+
+    /**
+     * @var CullingScene::OCCLUDER_TRIANGLES
+     * @brief Fewest triangles of the level occluders are rasterized with. 
+     * Its corners lie on the sphere, so it never covers more than the 
+     * sphere does.
+     */
+    static constexpr std::size_t OCCLUDER_TRIANGLES{ 80 };
+
+    /**
+     * @var CullingScene::GRID_CELLS
+     * @brief Cells along each axis of the grid occlusion queries test.
+     */
+    static constexpr std::size_t GRID_CELLS{ 8 };
+
+    /**
+     * @fn CullingScene::CullingScene(std::size_t instances, bool cull, 
+            bool lod, const std::string& cullPath, 
+            const std::string& occlusion, JobSystem& jobs, 
+            ShaderPipeline& pipeline)
+     * @brief Submits the shader programs, scatters the instances, uploads
+     * their bounds and builds the levels of detail of the sphere.
+     * @param instances Number of instances.
+     * @param cull Whether to cull, or to draw every instance.
+     * @param lod Whether to pick a level of detail per instance, or to draw
+     * every instance at full detail. Needs OpenGL 4.2 or 
+     * ARB_base_instance, without them it is off.
+     * @param cullPath Culling kernel: "auto", "scalar", "sse2" or "avx2".
+     * @param occlusion Occlusion culling: "off", "hiz" or "queries". 
+     * Queries need base instances like lod, without them they are off.
+     * @param jobs The job system that runs the culling.
+     * @param pipeline The pipeline that builds the shader programs.
+     * @throws std::logic_error if the kernel or the occlusion mode is 
+     * unknown, or the kernel is not supported.
+     */
+    CullingScene(std::size_t instances, bool cull, bool lod, 
+                 const std::string& cullPath, const std::string& occlusion,
+                 JobSystem& jobs, ShaderPipeline& pipeline);
+
+    /**
+     * @fn CullingScene::~CullingScene()
+     * @brief Deletes the buffer texture of the bounds and the queries.
+     */
+    ~CullingScene() override;
+
+    // Delete copy constructor and copy assignment operator.
+    CullingScene(const CullingScene&) = delete;
+    CullingScene& operator=(const CullingScene&) = delete;
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void endFrame() override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    /**
+     * @fn void CullingScene::renderOccluders(const Frustum& frustum, 
+            const float* viewProjection)
+     * @brief Rasterizes the biggest candidates inside the frustum into the
+     * CPU depth buffer and builds its pyramid.
+     */
+    void renderOccluders(const Frustum& frustum, const float* viewProjection);
+
+    /**
+     * @fn std::size_t CullingScene::collectQueries()
+     * @brief Counts the instances of the cells whose queries of the last 
+     * frame found them hidden, for the report.
+     * @return std::size_t Instances hidden in the last frame.
+     */
+    std::size_t collectQueries();
+
+    /**
+     * @fn std::uint64_t CullingScene::submitCells(RenderQueue& queue, 
+            GLuint program, float pixelScale)
+     * @brief Submits the proxy box and the conditional draw of every cell 
+     * with visible instances, front to back.
+     * @return std::uint64_t Triangles of the instance draws.
+     */
+    std::uint64_t submitCells(RenderQueue& queue, GLuint program, float pixelScale);
+
+    JobSystem& jobs_;
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    InstanceStore store_;
+    unsigned int boundsBuffer_;
+    unsigned int boundsTexture_;
+    GLint viewProjectionLocation_;
+    std::unique_ptr<StreamingBuffer> stream_;
+    std::unique_ptr<BufferSetup> buffer_;
+
+    /**
+     * @brief Visible indices, each chunk of GRAIN written at its own offset,
+     * and the number found in every chunk.
+     */
+    std::vector<std::uint32_t> visible_;
+    std::vector<std::size_t> chunkCounts_;
+
+    /**
+     * @brief Visible indices sorted by level within their chunk's range, the
+     * level of every visible index, and per chunk the number found at each
+     * level and where they go in the stream.
+     */
+    std::vector<std::uint32_t> sorted_;
+    std::vector<std::uint8_t> levels_;
+    std::vector<std::size_t> lodCounts_;
+    std::vector<std::size_t> packOffsets_;
+
+    /**
+     * @brief Levels of the sphere, ranges of the buffer's element buffer.
+     */
+    std::vector<MeshLod> lods_;
+
+    /**
+     * @brief HiZ occlusion: the CPU depth buffer and its pyramid, the 
+     * depth-only program and the level occluders are drawn with, the 
+     * candidates nearest first by radius over distance, and the vertices 
+     * and indices of the occluders of a frame.
+     */
+    std::unique_ptr<SoftwareRasterizer> occlusionBuffer_;
+    std::unique_ptr<DepthPyramid> pyramid_;
+    SoftwareProgram occluderProgram_;
+    Mesh occluderMesh_;
+    std::vector<std::uint32_t> occluderCandidates_;
+    std::vector<float> occluderVertices_;
+    std::vector<std::uint32_t> occluderIndices_;
+    float occlusionMatrix_[16];
+    std::vector<std::size_t> chunkOccluded_;
+
+    /**
+     * @brief Query occlusion: the first instance of every cell, the proxy 
+     * boxes and their program, a query per cell, and the cells queried in
+     * the last frame with their number of instances.
+     */
+    std::vector<std::uint32_t> cellFirst_;
+    std::unique_ptr<BufferSetup> proxies_;
+    ShaderPipeline::Handle proxyProgram_;
+    GLint proxyViewProjectionLocation_;
+    std::vector<GLuint> queries_;
+    std::vector<std::pair<float, std::uint32_t>> cellOrder_;
+    std::vector<std::uint32_t> queriedCells_;
+    std::vector<std::size_t> queriedCounts_;
+
+    CullPath path_;
+    OcclusionMode occlusion_;
+    bool cull_;
+    bool lod_;
+    bool baseInstance_;
+    bool occlusionFallback_;
+    std::size_t frame_;
+
+    /**
+     * @brief Half the edge of the cube the instances fill.
+     */
+    float extent_;
+    double lodBuildMs_;
+
+    /**
+     * @brief Culling time of every frame and the sums of visible instances,
+     * of visible instances per level and of triangles drawn.
+     */
+    std::vector<double> cullMs_;
+    std::uint64_t lodVisible_[MAX_LOD_LEVELS];
+    std::size_t visibleTotal_;
+    std::uint64_t trianglesTotal_;
+
+    /**
+     * @brief Time of the occluder pass or of the cell submission of every 
+     * frame, and the sums of occluders, of instances tested for occlusion and of those found 
+     * hidden.
+     */
+    std::vector<double> occlusionMs_;
+    std::uint64_t occluderTotal_;
+    std::uint64_t testedTotal_;
+    std::uint64_t occludedTotal_;
+};
+
+/**
+ * @class ModelScene
+ * @brief Draws a turning mesh loaded from a mesh file, optionally textured.
+ * 
+ * The mesh and the texture come from the AssetLoader. By default the scene
+ * starts drawing as soon as both are ready and renders empty frames until
+ * then; with asyncLoad off it waits for them on construction. The shader 
+ * reads a position at location 0 and, if the file has them, a normal at 1 
+ * and a texture coordinate at 2, and scales the mesh by its bounding box 
+ * to fill the view.
+ */
+class ModelScene : public Scene
+{
+public:
+    /**
+     * @fn ModelScene::ModelScene(const std::string& path, 
+            const std::string& texturePath, bool asyncLoad, 
+            AssetLoader& loader, ShaderPipeline& pipeline)
+     * @brief Submits the shader program and requests the mesh file and the
+     * texture.
+     * @param path Path of the mesh file.
+     * @param texturePath Path of a binary PPM image, empty for none.
+     * @param asyncLoad Draw while the assets load instead of waiting.
+     * @param loader The loader that reads and uploads the assets.
+     * @param pipeline The pipeline that builds the shader program.
+     * @throws std::logic_error if asyncLoad is off and an asset failed.
+     */
+    ModelScene(const std::string& path, const std::string& texturePath,
+               bool asyncLoad, AssetLoader& loader, ShaderPipeline& pipeline);
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    /**
+     * @fn bool ModelScene::isLoaded() const
+     * @brief Tells whether the mesh and the texture, if any, are ready.
+     */
+    bool isLoaded() const;
+
+    AssetLoader& loader_;
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    AssetLoader::Handle mesh_;
+    AssetLoader::Handle texture_;
+    bool textured_;
+    GLint fitLocation_;
+    GLint angleLocation_;
+    GLint texturedLocation_;
+
+    /**
+     * @brief Center of the bounding box and the scale that fits it into 
+     * the view, computed when the mesh becomes ready.
+     */
+    float fit_[4];
+    bool fitted_;
+    float angle_;
+
+    std::string path_;
+    std::string texturePath_;
+
+    /**
+     * @brief First frame drawn with every asset ready, SIZE_MAX until then.
+     */
+    std::size_t frame_;
+    std::size_t loadedFrame_;
+};
+
+/**
+ * @class TexturedScene
+ * @brief Draws a grid of quads, each showing one of many materials, and 
+ * uploads a few material textures again every frame.
+ * 
+ * The quads are sorted by material and drawn with one indexed draw per 
+ * material. With a texture array every material is a layer of the same 
+ * texture and the quads carry their layer as a vertex attribute, so all 
+ * draws share one bind; otherwise every draw binds the 2D texture of its 
+ * material. The changing layers go through a TextureStreamer.
+ */
+class TexturedScene : public Scene
+{
+public:
+    /**
+     * @var TexturedScene::MATERIAL_SIZE
+     * @brief Width and height of a material texture.
+     */
+    static constexpr GLsizei MATERIAL_SIZE{ 256 };
+
+    /**
+     * @fn TexturedScene::TexturedScene(std::size_t quads, 
+            std::size_t materials, bool textureArray, bool pixelBuffers, 
+            std::size_t uploadsPerFrame, ShaderPipeline& pipeline)
+     * @brief Submits the shader program, builds the quads and creates and 
+     * fills the textures.
+     * @param quads Number of quads.
+     * @param materials Number of materials.
+     * @param textureArray Whether the materials are layers of one texture.
+     * @param pixelBuffers Whether uploads go through pixel buffer objects.
+     * @param uploadsPerFrame Material layers uploaded every frame.
+     * @param pipeline The pipeline that builds the shader program.
+     * @throws std::logic_error if the pixel buffers cannot be mapped.
+     */
+    TexturedScene(std::size_t quads, std::size_t materials, bool textureArray,
+                  bool pixelBuffers, std::size_t uploadsPerFrame, 
+                  ShaderPipeline& pipeline);
+
+    void update(std::size_t frame) override;
+
+    /**
+     * @fn bool TexturedScene::getDamage(std::size_t frame, 
+            DamageRect& damage) const
+     * @brief Only the quads of the materials uploaded for a frame change, 
+     * which covers the rows of the grid they lie in.
+     */
+    bool getDamage(std::size_t frame, DamageRect& damage) const override;
+
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void endFrame() override;
+    void report(const FrameProfiler& profiler) const override;
+
+private:
+    /**
+     * @brief Index of a material uploaded for a frame.
+     * @param frame Number of the frame.
+     * @param upload Index of the upload within the frame.
+     */
+    std::size_t getUploadedMaterial(std::size_t frame, std::size_t upload) const;
+
+    ShaderPipeline& pipeline_;
+    ShaderPipeline::Handle program_;
+    std::unique_ptr<BufferSetup> buffer_;
+
+    /**
+     * @brief Quads per row and column of the grid.
+     */
+    std::size_t side_;
+
+    /**
+     * @brief One array texture, or one 2D texture per material.
+     */
+    std::vector<std::unique_ptr<Texture>> textures_;
+    std::unique_ptr<TextureStreamer> streamer_;
+    bool textureArray_;
+
+    /**
+     * @brief First quad of every material, plus the total at the end.
+     */
+    std::vector<std::size_t> firstQuads_;
+
+    /**
+     * @brief Pixels of the layers uploaded this frame, kept until flush.
+     */
+    std::vector<std::vector<std::uint8_t>> staging_;
+    std::size_t frame_;
+};
+
+/**
+ * @struct SyntheticParams
+ * @brief The work a SyntheticScene does every frame.
+ */
+struct SyntheticParams
+{
+    /**
+     * @var SyntheticParams::triangles
+     * @brief Triangles drawn, at least one per draw.
+     */
+    std::size_t triangles{ 1 };
+    std::size_t draws{ 1 };
+
+    /**
+     * @var SyntheticParams::programs
+     * @brief Distinct programs, each used by one run of consecutive draws.
+     */
+    std::size_t programs{ 1 };
+
+    /**
+     * @var SyntheticParams::stateChanges
+     * @brief Texture switches between consecutive draws, at most one less 
+     * than the draws.
+     */
+    std::size_t stateChanges{ 0 };
+
+    /**
+     * @var SyntheticParams::uploadBytes
+     * @brief Bytes uploaded to a GPU buffer every frame.
+     */
+    std::size_t uploadBytes{ 0 };
+};
+
+/**
+ * @class SyntheticScene
+ * @brief Draws a grid of triangles with a configurable amount of draws, 
+ * programs, state changes and uploads.
+ * 
+ * The triangles are split into equal ranges of one vertex buffer, one draw 
+ * each. Draws are submitted in an order that the caller should not sort: 
+ * the programs are used by consecutive runs of draws, and the draws 
+ * alternate between two textures stateChanges times, so every parameter 
+ * costs exactly the binds it asks for. The uploads are written into a 
+ * StreamingBuffer and copied from there into a buffer the GPU owns, the way 
+ * dynamic data reaches device memory.
+ */
+class SyntheticScene : public Scene
+{
+public:
+    /**
+     * @fn SyntheticScene::SyntheticScene(const SyntheticParams& params,
+            ShaderPipeline& pipeline)
+     * @brief Submits the programs and creates the buffers and textures.
+     * @param params The work of a frame.
+     * @param pipeline The pipeline that builds the shader programs.
+     * @throws std::logic_error if the upload buffer cannot be mapped.
+     */
+    SyntheticScene(const SyntheticParams& params, ShaderPipeline& pipeline);
+
+    /**
+     * @fn SyntheticScene::~SyntheticScene()
+     * @brief Deletes the target buffer of the uploads.
+     */
+    ~SyntheticScene() override;
+
+    // Delete copy constructor and copy assignment operator.
+    SyntheticScene(const SyntheticScene&) = delete;
+    SyntheticScene& operator=(const SyntheticScene&) = delete;
+
+    void update(std::size_t frame) override;
+    void draw(RenderQueue& queue, FrameProfiler& profiler) override;
+    void endFrame() override;
+
+    /**
+     * @brief Getter for the parameters, with the draws, programs and state 
+     * changes limited to what the triangles allow.
+     */
+    const SyntheticParams& getParams() const { return params_; }
+
+private:
+    SyntheticParams params_;
+    ShaderPipeline& pipeline_;
+    std::vector<ShaderPipeline::Handle> programs_;
+    std::unique_ptr<BufferSetup> buffer_;
+    std::unique_ptr<Texture> textures_[2];
+
+    /**
+     * @brief Staging ring and target of the uploads, or nullptr and 0 
+     * without uploads.
+     */
+    std::unique_ptr<StreamingBuffer> staging_;
+    GLuint target_;
+    std::size_t frame_;
+};
+
+/**
+ * @fn std::unique_ptr<Scene> createScene(const RenderSettings& settings,
+        ShaderPipeline& pipeline, JobSystem& jobs, AssetLoader& loader,
+        UniformRing& uniforms)
+ * @brief Creates the scene selected in the settings.
+ * @param settings The settings naming the scene and its parameters.
+ * @param pipeline The pipeline that builds the scene's shader programs.
+ * @param jobs The job system the scene spreads its CPU work over.
+ * @param loader The loader of the scene's mesh files and textures.
+ * @param uniforms The ring of the frame's uniform blocks.
+ * @throws std::logic_error if the scene is unknown or fails to build.
+ * @return std::unique_ptr<Scene> The new scene.
+ */
+std::unique_ptr<Scene> createScene(const RenderSettings& settings, 
+                                   ShaderPipeline& pipeline, JobSystem& jobs,
+                                   AssetLoader& loader, UniformRing& uniforms);
@@ -0,0 +1,347 @@
+/**
+ * @file settings.hpp
+ * @brief Header file for the runtime settings of the application.
+ * 
+ * This file contains the declaration of the RenderSettings structure, which 
+ * collects every option that can be given on the command line, and the 
+ * parseArguments function that fills it in. The settings are handed to the 
+ * window manager, which decides from them how the OpenGL context is created 
+ * and when the display loop ends.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @var DEFAULT_HEADLESS_FRAMES
+ * @brief Frame limit of a headless run that was given no limit at all.
+ */
+constexpr std::size_t DEFAULT_HEADLESS_FRAMES{ 1000 };
+
+/**
+ * @var THREAD_SWEEP_FRAMES
+ * @brief Frames rendered with each thread count of a thread sweep.
+ */
+constexpr std::size_t THREAD_SWEEP_FRAMES{ 120 };
+
+/**
+ * @var IDLE_WAIT_SECONDS
+ * @brief Longest time an on-demand run blocks waiting for events, so run 
+ * limits and background work are still checked while nothing changes.
+ */
+constexpr double IDLE_WAIT_SECONDS{ 0.25 };
+
+/**
+ * @struct RenderSettings
+ * @brief Options that control context creation and the display loop.
+ * 
+ * The default values reproduce the original behaviour: a visible window 
+ * that renders until the user closes it.
+ */
+struct RenderSettings
+{
+    /**
+     * @var RenderSettings::headless
+     * @brief Render without a window into an offscreen framebuffer.
+     */
+    bool headless{ false };
+
+    /**
+     * @var RenderSettings::frameLimit
+     * @brief Number of frames to render before exiting (0 = no limit). 
+     * A headless run without any limit stops after DEFAULT_HEADLESS_FRAMES.
+     */
+    std::size_t frameLimit{ 0 };
+
+    /**
+     * @var RenderSettings::timeBudget
+     * @brief Seconds to render before exiting (0 = no limit).
+     */
+    double timeBudget{ 0.0 };
+
+    /**
+     * @var RenderSettings::width
+     * @brief Width of the window or offscreen framebuffer.
+     */
+    int width{ 640 };
+
+    /**
+     * @var RenderSettings::height
+     * @brief Height of the window or offscreen framebuffer.
+     */
+    int height{ 480 };
+
+    /**
+     * @var RenderSettings::statsOutput
+     * @brief File the frame timings are written to on exit (empty = none).
+     * A ".csv" extension selects CSV, anything else JSON.
+     */
+    std::string statsOutput;
+
+    /**
+     * @var RenderSettings::backend
+     * @brief Renderer of the frames: "opengl", or "software" for the 
+     * SoftwareRasterizer, which needs no OpenGL context in headless mode.
+     */
+    std::string backend{ "opengl" };
+
+    /**
+     * @var RenderSettings::scene
+     * @brief Name of the scene to render ("triangle", "instanced", 
+     * "streaming", "objects", "batch", "mesh", "culling", "model" or 
+     * "textured"; "triangle" or "terrain" with the software backend).
+     */
+    std::string scene{ "triangle" };
+
+    /**
+     * @var RenderSettings::meshFile
+     * @brief Mesh file drawn by the model scene, as written by mesh_convert.
+     */
+    std::string meshFile;
+
+    /**
+     * @var RenderSettings::textureFile
+     * @brief Binary PPM image the model scene puts on its mesh (empty = 
+     * none).
+     */
+    std::string textureFile;
+
+    /**
+     * @var RenderSettings::asyncLoad
+     * @brief Let the model scene draw while its assets load in the 
+     * background instead of waiting for them on setup.
+     */
+    bool asyncLoad{ true };
+
+    /**
+     * @var RenderSettings::loaderThreads
+     * @brief Threads that read and decode asset files.
+     */
+    std::size_t loaderThreads{ 2 };
+
+    /**
+     * @var RenderSettings::uploadContext
+     * @brief Upload assets on a second context that shares objects with the
+     * render context, instead of a few megabytes per frame on the render 
+     * thread.
+     */
+    bool uploadContext{ true };
+
+    /**
+     * @var RenderSettings::instances
+     * @brief Number of triangles drawn by the instanced, streaming and 
+     * objects scenes, and the approximate triangle count of the software 
+     * terrain.
+     */
+    std::size_t instances{ 10000 };
+
+    /**
+     * @var RenderSettings::sweep
+     * @brief Step the instance count up to instances and report frame time 
+     * per count.
+     */
+    bool sweep{ false };
+
+    /**
+     * @var RenderSettings::threads
+     * @brief Threads that prepare frames, counting the OpenGL thread 
+     * (0 = one per hardware thread).
+     */
+    std::size_t threads{ 0 };
+
+    /**
+     * @var RenderSettings::threadSweep
+     * @brief Double the thread count from 1 up to threads and report frame 
+     * time per count.
+     */
+    bool threadSweep{ false };
+
+    /**
+     * @var RenderSettings::shaderCache
+     * @brief Directory of the program binary cache (empty = no cache).
+     */
+    std::string shaderCache{ ".shader_cache" };
+
+    /**
+     * @var RenderSettings::sortQueue
+     * @brief Sort queued draws by state before issuing them.
+     */
+    bool sortQueue{ true };
+
+    /**
+     * @var RenderSettings::batch
+     * @brief Draw the meshes of the batch scene with one multi-draw call 
+     * instead of one draw call each.
+     */
+    bool batch{ true };
+
+    /**
+     * @var RenderSettings::useArena
+     * @brief Allocate the meshes of the objects scene from a shared arena.
+     */
+    bool useArena{ true };
+
+    /**
+     * @var RenderSettings::optimizeMeshes
+     * @brief Reorder indexed meshes for vertex cache and fetch locality.
+     */
+    bool optimizeMeshes{ true };
+
+    /**
+     * @var RenderSettings::vertexFormat
+     * @brief Vertex format of the mesh scene: "float", "packed" (one 
+     * interleaved stream of compact formats) or "split" (packed, with the 
+     * positions in a stream of their own).
+     */
+    std::string vertexFormat{ "packed" };
+
+    /**
+     * @var RenderSettings::cull
+     * @brief Cull the instances of the culling scene against the frustum.
+     */
+    bool cull{ true };
+
+    /**
+     * @var RenderSettings::cullPath
+     * @brief Culling kernel: "auto" (fastest supported), "scalar", "sse2" 
+     * or "avx2".
+     */
+    std::string cullPath{ "auto" };
+
+    /**
+     * @var RenderSettings::lod
+     * @brief Pick a level of detail per instance of the culling scene from
+     * its projected error, instead of drawing every instance at full detail.
+     */
+    bool lod{ true };
+
+    /**
+     * @var RenderSettings::occlusion
+     * @brief Occlusion culling of the culling scene: "off", "hiz" (CPU 
+     * rasterized occluders and a depth pyramid) or "queries" (GPU occlusion
+     * queries with conditional rendering).
+     */
+    std::string occlusion{ "hiz" };
+
+    /**
+     * @var RenderSettings::materials
+     * @brief Number of materials, each with its own texture layer, of the 
+     * textured scene.
+     */
+    std::size_t materials{ 64 };
+
+    /**
+     * @var RenderSettings::textureArray
+     * @brief Keep the materials of the textured scene in one 2D array 
+     * texture instead of a 2D texture each.
+     */
+    bool textureArray{ true };
+
+    /**
+     * @var RenderSettings::pixelBuffers
+     * @brief Stream texture uploads through a ring of pixel buffer objects 
+     * instead of from client memory.
+     */
+    bool pixelBuffers{ true };
+
+    /**
+     * @var RenderSettings::textureUploads
+     * @brief Material layers the textured scene uploads again every frame.
+     */
+    std::size_t textureUploads{ 4 };
+
+    /**
+     * @var RenderSettings::pacing
+     * @brief How frames are spaced: "vsync" (swap interval 1), "off" 
+     * (swap interval 0, as fast as possible) or "limit" (swap interval 0 
+     * and a limiter at fpsLimit).
+     */
+    std::string pacing{ "vsync" };
+
+    /**
+     * @var RenderSettings::fpsLimit
+     * @brief Frames per second of the "limit" pacing mode.
+     */
+    double fpsLimit{ 60.0 };
+
+    /**
+     * @var RenderSettings::lateInput
+     * @brief Poll events right before a frame is built instead of after 
+     * the previous swap, so the frame sees the newest input.
+     */
+    bool lateInput{ true };
+
+    /**
+     * @var RenderSettings::syntheticInput
+     * @brief Rate of synthetic input events per second, which give runs 
+     * without a keyboard an input-to-present latency (0 = none).
+     */
+    double syntheticInput{ 0.0 };
+
+    /**
+     * @var RenderSettings::onDemand
+     * @brief Only draw a frame when something changed, redraw only the 
+     * damaged part of the view and block waiting for events in between.
+     */
+    bool onDemand{ false };
+
+    /**
+     * @var RenderSettings::gpuBudget
+     * @brief GPU frame time in milliseconds that dynamic resolution holds 
+     * by rendering at a lower scale (0 = fixed scale).
+     */
+    double gpuBudget{ 0.0 };
+
+    /**
+     * @var RenderSettings::renderScale
+     * @brief Fraction of the window's width and height the scene is 
+     * rendered at and upsampled from; the first scale under a budget.
+     */
+    float renderScale{ 1.0f };
+
+    /**
+     * @var RenderSettings::minScale
+     * @brief Lowest render scale dynamic resolution goes to.
+     */
+    float minScale{ 0.5f };
+
+    /**
+     * @var RenderSettings::capture
+     * @brief Directory every frame is written to (empty = no capture).
+     */
+    std::string capture{};
+
+    /**
+     * @var RenderSettings::captureFormat
+     * @brief File format of captured frames: "png" or "raw" (binary PPM).
+     */
+    std::string captureFormat{ "png" };
+
+    /**
+     * @var RenderSettings::captureThreads
+     * @brief Threads encoding and writing captured frames.
+     */
+    std::size_t captureThreads{ 2 };
+
+    /**
+     * @var RenderSettings::captureDrop
+     * @brief Drop frames when every capture buffer is busy instead of 
+     * waiting for one.
+     */
+    bool captureDrop{ false };
+};
+
+/**
+ * @fn bool parseArguments(int argc, char** argv, RenderSettings& settings)
+ * @brief Parses command line arguments into the settings structure.
+ * 
+ * Unknown options and malformed values are reported on standard output.
+ * 
+ * @param argc Number of arguments, as given to main.
+ * @param argv Argument vector, as given to main.
+ * @param settings The settings to fill in.
+ * @return bool true if the program should continue, false if the arguments
+ * were invalid or only the usage text was requested.
+ */
+bool parseArguments(int argc, char** argv, RenderSettings& settings);
@@ -0,0 +1,210 @@
+/**
+ * @file shader_pipeline.hpp
+ * @brief Header file for building shader programs without blocking.
+ * 
+ * This file contains the declaration of the ShaderPipeline class. Where the 
+ * `Program` constructor compiles, links and checks a program before it 
+ * returns, the pipeline only submits the compile and link commands and 
+ * checks the results later, once per frame. Querying GL_COMPILE_STATUS or 
+ * GL_LINK_STATUS right after submitting forces the driver to finish that 
+ * work on the spot, which serializes every build.
+ * 
+ * With GL_KHR_parallel_shader_compile (or the ARB version of it) the driver 
+ * builds the programs on its own threads, and GL_COMPLETION_STATUS_KHR tells 
+ * without blocking when a program is done. Without the extension each poll 
+ * finishes at most one program, so the build cost is spread over the first 
+ * frames instead of being paid before the first one.
+ */
+
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "program_cache.hpp"
+
+/**
+ * @class ShaderPipeline
+ * @brief Submits program builds up front and reports when they are ready.
+ * 
+ * Programs are referred to by the handle returned from submit. Draw code 
+ * checks isReady and skips what cannot be drawn yet.
+ * 
+ * @note The ShaderPipeline class assumes that the OpenGL context has been 
+ * properly initialized before it is constructed.
+ * 
+ * Example:
+ * @code
+ * ShaderPipeline pipeline(&cache);
+ * ShaderPipeline::Handle handle = pipeline.submit(vertexSource, fragSource);
+ * // once per frame
+ * pipeline.poll();
+ * if (pipeline.isReady(handle))
+ * {
+ *     glUseProgram(pipeline.getProgramID(handle));
+ * }
+ * @endcode
+ */
+class ShaderPipeline
+{
+public:
+    /**
+     * @typedef ShaderPipeline::Handle
+     * @brief Identifies a submitted program.
+     */
+    using Handle = std::size_t;
+
+    /**
+     * @enum ShaderPipeline::State
+     * @brief Build state of a submitted program.
+     */
+    enum class State
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    /**
+     * @fn ShaderPipeline::ShaderPipeline(ProgramCache* cache)
+     * @brief Enables parallel compilation if the driver supports it.
+     * @param cache Binary cache consulted on submit, may be nullptr.
+     */
+    explicit ShaderPipeline(ProgramCache* cache);
+
+    /**
+     * @fn ShaderPipeline::~ShaderPipeline()
+     * @brief Deletes every program and shader of the pipeline.
+     */
+    ~ShaderPipeline();
+
+    // Delete copy constructor and copy assignment operator.
+    ShaderPipeline(const ShaderPipeline&) = delete;
+    ShaderPipeline& operator=(const ShaderPipeline&) = delete;
+
+    /**
+     * @fn Handle ShaderPipeline::submit(const char* vertexSource, 
+            const char* fragmentSource)
+     * @brief Starts building a program.
+     * 
+     * A program found in the binary cache is ready at once. Otherwise both 
+     * shaders are compiled and the program is linked without waiting for 
+     * any result.
+     * 
+     * @param vertexSource GLSL source of the vertex shader.
+     * @param fragmentSource GLSL source of the fragment shader.
+     * @return Handle Handle of the program.
+     */
+    Handle submit(const char* vertexSource, const char* fragmentSource);
+
+    /**
+     * @fn void ShaderPipeline::poll()
+     * @brief Checks pending programs and finishes those that are complete.
+     * Meant to be called once per frame.
+     */
+    void poll();
+
+    /**
+     * @fn void ShaderPipeline::finish()
+     * @brief Waits until every submitted program is ready or failed.
+     */
+    void finish();
+
+    /**
+     * @brief Tells whether a program can be used for drawing.
+     * @param handle Handle from submit.
+     * @return bool true if the program linked successfully.
+     */
+    bool isReady(Handle handle) const 
+    { 
+        return entries_[handle].state == State::Ready; 
+    }
+
+    /**
+     * @brief Getter for the build state of a program.
+     * @param handle Handle from submit.
+     * @return State The state.
+     */
+    State getState(Handle handle) const { return entries_[handle].state; }
+
+    /**
+     * @brief Getter for the OpenGL ID of a program.
+     * @param handle Handle from submit.
+     * @return unsigned int The program ID, only usable when ready.
+     */
+    unsigned int getProgramID(Handle handle) const 
+    { 
+        return entries_[handle].program; 
+    }
+
+    /**
+     * @brief Getter for the compile or link log of a failed program.
+     * @param handle Handle from submit.
+     * @return const std::string& The error message.
+     */
+    const std::string& getError(Handle handle) const 
+    { 
+        return entries_[handle].error; 
+    }
+
+    /**
+     * @brief Getter for the number of programs still being built.
+     * @return std::size_t Pending programs.
+     */
+    std::size_t getPendingCount() const { return pending_; }
+
+    /**
+     * @brief Getter for the number of submitted programs.
+     * @return std::size_t All programs.
+     */
+    std::size_t getProgramCount() const { return entries_.size(); }
+
+    /**
+     * @brief Tells whether the driver compiles in parallel.
+     * @return bool true with KHR/ARB_parallel_shader_compile.
+     */
+    bool isParallel() const { return parallel_; }
+
+    /**
+     * @brief Getter for the longest time from submit to ready.
+     * @return double Milliseconds until the slowest program was ready.
+     */
+    double getSlowestReadyMs() const { return slowestReadyMs_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Entry
+     * @brief Bookkeeping of one submitted program.
+     */
+    struct Entry
+    {
+        unsigned int program{ 0 };
+        unsigned int vertexShader{ 0 };
+        unsigned int fragmentShader{ 0 };
+        std::uint64_t key{ 0 };
+        State state{ State::Pending };
+        std::string error;
+        Clock::time_point submitted;
+
+        /**
+         * @brief Time the calling thread spent in submit and finalize, 
+         * which is what a cache hit saves it.
+         */
+        double buildMs{ 0.0 };
+    };
+
+    /**
+     * @brief Checks the results of a completed build and updates its state.
+     * @param entry The program to finish.
+     */
+    void finalize(Entry& entry);
+
+    std::vector<Entry> entries_;
+    ProgramCache* cache_;
+    bool parallel_;
+    std::size_t pending_;
+    double slowestReadyMs_;
+};
@@ -16,6 +16,11 @@
  * provide specific implementations for vertex and fragment shader generation, 
  * respectively.
  * 
+ * The `Program` class links a vertex and a fragment shader into a shader 
+ * program. When it is given a `ProgramCache`, it first tries to load the 
+ * linked program from a binary stored by an earlier run, and only compiles 
+ * the GLSL sources when there is no usable binary.
+ * 
  * This header file is essential for setting up and managing shaders in an OpenGL 
  * application, ensuring that shaders are correctly compiled and linked into 
  * executable programs.
@@ -25,7 +30,9 @@
 #include <glad/glad.h>
 #include <cstddef>
 #include <stdexcept>
+#include <string>
 #include <vector>
+#include "program_cache.hpp"
 
 
  
@@ -169,10 +176,40 @@ public:
 
 };
 
+/**
+ * @class Program
+ * @brief A class representing a linked shader program.
+ */
 class Program
 {
 public:
+    /**
+     * @fn Program::Program(const unsigned int vertexShaderID, 
+            const unsigned int fragShaderID)
+     * @brief Links two compiled shaders into a program and deletes them.
+     * @param vertexShaderID ID of a compiled vertex shader.
+     * @param fragShaderID ID of a compiled fragment shader.
+     * @throws std::logic_error if linking failed.
+     */
     Program(const unsigned int vertexShaderID, const unsigned int fragShaderID);
+
+    /**
+     * @fn Program::Program(const char* vertexSource, 
+            const char* fragmentSource, ProgramCache* cache)
+     * @brief Builds a program from GLSL sources, using a cached binary of 
+     * the same sources when one is available.
+     * 
+     * Without a cache hit the shaders are compiled and linked, and the 
+     * linked binary is stored in the cache for the next run.
+     * 
+     * @param vertexSource GLSL source of the vertex shader.
+     * @param fragmentSource GLSL source of the fragment shader.
+     * @param cache The binary cache, or nullptr to always compile.
+     * @throws std::logic_error if compiling or linking failed.
+     */
+    Program(const char* vertexSource, const char* fragmentSource, 
+            ProgramCache* cache);
+
     ~Program() = default;
 
     /**
@@ -183,5 +220,13 @@ public:
     unsigned int getProgramID() const { return shaderProgram_; }
 
 private:
+    /**
+     * @fn void Program::link(const unsigned int vertexShaderID, 
+            const unsigned int fragShaderID)
+     * @brief Attaches and links the shaders, then deletes them.
+     * @throws std::logic_error if linking failed.
+     */
+    void link(const unsigned int vertexShaderID, const unsigned int fragShaderID);
+
     unsigned int shaderProgram_;
-};;
\ No newline at end of file
+};
\ No newline at end of file
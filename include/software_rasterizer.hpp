@@ -0,0 +1,382 @@
+/**
+ * @file software_rasterizer.hpp
+ * @brief Header file for rendering triangles on the CPU, without OpenGL.
+ *
+ * This file contains the declaration of the SoftwareRasterizer class and the
+ * SoftwareProgram it draws with. A program is a pair of C++ functors that
+ * take the place of the GLSL vertex and fragment shaders; the vertex data is
+ * the same float arrays and Meshes that BufferSetup uploads to the GPU.
+ *
+ * Drawing is split into passes over the JobSystem:
+ * - The vertex pass runs the vertex functor on every vertex.
+ * - The setup pass clips the triangles, snaps them to a fixed point grid with
+ *   SUBPIXEL_BITS bits of precision and sorts them into bins, one per tile of
+ *   TILE_SIZE x TILE_SIZE pixels.
+ * - The raster pass gives every tile to one job, which walks its bin in
+ *   submission order, evaluates the edge functions and depth test for four
+ *   pixels at once with SSE2 and runs the fragment functor on the pixels
+ *   that pass.
+ *
+ * Since every tile belongs to a single job, the passes need no locks and the
+ * image does not depend on the number of threads.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "job_system.hpp"
+#include "mesh.hpp"
+
+/**
+ * @var SOFTWARE_MAX_VARYINGS
+ * @brief Number of floats a vertex functor can pass to the fragment functor.
+ */
+constexpr std::size_t SOFTWARE_MAX_VARYINGS{ 4 };
+
+/**
+ * @struct SoftwareVertex
+ * @brief Output of the vertex functor: a clip space position, like
+ * gl_Position, and the values to interpolate across the triangle.
+ */
+struct SoftwareVertex
+{
+    float position[4];
+    float varyings[SOFTWARE_MAX_VARYINGS];
+};
+
+/**
+ * @struct SoftwareProgram
+ * @brief The functors and fixed function state a draw uses.
+ *
+ * Functors run on several threads at once and must not change shared
+ * state.
+ */
+struct SoftwareProgram
+{
+    /**
+     * @var SoftwareProgram::vertex
+     * @brief Receives the attributes of one vertex and writes its position
+     * and varyings.
+     */
+    std::function<void(const float* attributes, SoftwareVertex& out)> vertex;
+
+    /**
+     * @var SoftwareProgram::fragment
+     * @brief Receives the perspective correct varyings of one pixel and
+     * returns its color, packed as by packColor. Left empty, the draw only
+     * writes depth.
+     */
+    std::function<std::uint32_t(const float* varyings)> fragment;
+
+    /**
+     * @var SoftwareProgram::varyings
+     * @brief Number of varyings written, at most SOFTWARE_MAX_VARYINGS.
+     */
+    std::size_t varyings{ 0 };
+
+    /**
+     * @var SoftwareProgram::depthTest
+     * @brief Draw only pixels closer than the depth buffer and update it.
+     */
+    bool depthTest{ true };
+
+    /**
+     * @var SoftwareProgram::cullBackFaces
+     * @brief Skip triangles whose corners appear clockwise on screen.
+     */
+    bool cullBackFaces{ false };
+};
+
+/**
+ * @fn std::uint32_t packColor(float red, float green, float blue,
+        float alpha)
+ * @brief Packs a color in [0, 1] into the RGBA8 layout of the color buffer.
+ */
+std::uint32_t packColor(float red, float green, float blue, float alpha = 1.0f);
+
+/**
+ * @struct SoftwareRasterizerStats
+ * @brief Work done by the last render.
+ */
+struct SoftwareRasterizerStats
+{
+    std::size_t draws{ 0 };
+    std::size_t vertices{ 0 };
+    std::size_t triangles{ 0 };
+    std::size_t trianglesSetUp{ 0 };
+    std::size_t binEntries{ 0 };
+    std::size_t tiles{ 0 };
+};
+
+/**
+ * @class SoftwareRasterizer
+ * @brief A tile based, multithreaded triangle rasterizer with a color and a
+ * depth buffer.
+ *
+ * The color buffer holds RGBA8 pixels and, like an OpenGL framebuffer,
+ * starts with the bottom row.
+ *
+ * @note draw only records the draw; the vertex data and the program must
+ * stay alive until render returns.
+ *
+ * Example:
+ * @code
+ * JobSystem jobs(0);
+ * SoftwareRasterizer rasterizer(640, 480, jobs);
+ * SoftwareProgram program;
+ * program.vertex = [](const float* in, SoftwareVertex& out) {
+ *     out.position[0] = in[0]; out.position[1] = in[1];
+ *     out.position[2] = in[2]; out.position[3] = 1.0f;
+ * };
+ * program.fragment = [](const float*) { return packColor(0.5f, 1.0f, 0.2f); };
+ * rasterizer.clear(packColor(0.2f, 0.3f, 0.3f));
+ * rasterizer.draw(program, vertices);
+ * rasterizer.render();
+ * @endcode
+ */
+class SoftwareRasterizer
+{
+public:
+    /**
+     * @var SoftwareRasterizer::TILE_SIZE
+     * @brief Edge of a tile in pixels.
+     */
+    static constexpr int TILE_SIZE{ 64 };
+
+    /**
+     * @var SoftwareRasterizer::SUBPIXEL_BITS
+     * @brief Fractional bits of the snapped screen coordinates.
+     */
+    static constexpr int SUBPIXEL_BITS{ 4 };
+
+    /**
+     * @var SoftwareRasterizer::MAX_SIZE
+     * @brief Largest width or height, which keeps the edge functions inside
+     * 32 bits within a tile.
+     */
+    static constexpr int MAX_SIZE{ 4096 };
+
+    /**
+     * @var SoftwareRasterizer::SETUP_GRAIN
+     * @brief Triangles set up by one job.
+     */
+    static constexpr std::size_t SETUP_GRAIN{ 2048 };
+
+    /**
+     * @fn SoftwareRasterizer::SoftwareRasterizer(int width, int height,
+            JobSystem& jobs)
+     * @brief Creates the color and depth buffers.
+     * @param width Width in pixels.
+     * @param height Height in pixels.
+     * @param jobs The job system the passes run on.
+     * @throws std::logic_error if a size is not in [1, MAX_SIZE].
+     */
+    SoftwareRasterizer(int width, int height, JobSystem& jobs);
+
+    /**
+     * @fn void SoftwareRasterizer::resize(int width, int height)
+     * @brief Changes the size of the buffers, whose contents are lost.
+     * @throws std::logic_error if a size is not in [1, MAX_SIZE].
+     */
+    void resize(int width, int height);
+
+    /**
+     * @fn void SoftwareRasterizer::clear(std::uint32_t color, float depth)
+     * @brief Fills the color and the depth buffer.
+     * @param color Packed color, see packColor.
+     * @param depth Depth in [0, 1]; 1 is the far plane.
+     */
+    void clear(std::uint32_t color, float depth = 1.0f);
+
+    /**
+     * @fn void SoftwareRasterizer::draw(const SoftwareProgram& program,
+            const float* vertices, std::size_t stride,
+            std::size_t vertexCount, const std::uint32_t* indices,
+            std::size_t indexCount)
+     * @brief Records a draw of triangles.
+     * @param program The functors and state to draw with.
+     * @param vertices Attributes of all vertices, stride floats per vertex.
+     * @param stride Floats per vertex, passed to the vertex functor.
+     * @param vertexCount Number of vertices.
+     * @param indices Three indices per triangle, or nullptr to draw the
+     * vertices in order.
+     * @param indexCount Number of indices.
+     */
+    void draw(const SoftwareProgram& program, const float* vertices,
+              std::size_t stride, std::size_t vertexCount,
+              const std::uint32_t* indices = nullptr, std::size_t indexCount = 0);
+
+    /**
+     * @fn void SoftwareRasterizer::draw(const SoftwareProgram& program,
+            const std::vector<float>& vertices, std::size_t stride)
+     * @brief Records a draw of a vertex array as given to BufferSetup.
+     */
+    void draw(const SoftwareProgram& program, const std::vector<float>& vertices,
+              std::size_t stride = 3);
+
+    /**
+     * @fn void SoftwareRasterizer::draw(const SoftwareProgram& program,
+            const Mesh& mesh)
+     * @brief Records a draw of an indexed Mesh.
+     */
+    void draw(const SoftwareProgram& program, const Mesh& mesh);
+
+    /**
+     * @fn void SoftwareRasterizer::render()
+     * @brief Runs the recorded draws in order and forgets them.
+     */
+    void render();
+
+    /**
+     * @brief Getter for the pixels of the color buffer, bottom row first.
+     */
+    const std::uint32_t* getColor() const { return color_.data(); }
+
+    /**
+     * @brief Getter for the depth buffer, bottom row first.
+     */
+    const float* getDepth() const { return depth_.data(); }
+
+    /**
+     * @brief Getter for the floats from one row of the depth buffer to the
+     * next, the width rounded up to a multiple of four.
+     */
+    std::size_t getDepthPitch() const 
+    { 
+        return static_cast<std::size_t>((width_ + 3) & ~3); 
+    }
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+
+    /**
+     * @brief Getter for the work done by the last render.
+     */
+    const SoftwareRasterizerStats& getStats() const { return stats_; }
+
+    /**
+     * @struct SetupTriangle
+     * @brief A triangle ready for rasterization.
+     */
+    struct SetupTriangle
+    {
+        /**
+         * @brief Pixel bounds, the maximum excluded.
+         */
+        int minX, minY, maxX, maxY;
+
+        /**
+         * @brief Edge functions A * x + B * y + C in subpixel units, the
+         * fill rule already folded into C.
+         */
+        std::int32_t edgeA[3];
+        std::int32_t edgeB[3];
+        std::int64_t edgeC[3];
+
+        /**
+         * @brief Reciprocal of twice the area, turning edge values into
+         * barycentric coordinates.
+         */
+        float inverseArea;
+
+        /**
+         * @brief Depth at the first corner and its change towards the
+         * second and third.
+         */
+        float depth[3];
+
+        /**
+         * @brief 1 / w and varyings / w of the corners.
+         */
+        float inverseW[3];
+        float varyings[3][SOFTWARE_MAX_VARYINGS];
+
+        const SoftwareProgram* program;
+    };
+
+private:
+    /**
+     * @struct Draw
+     * @brief A recorded draw.
+     */
+    struct Draw
+    {
+        const SoftwareProgram* program;
+        const float* vertices;
+        std::size_t stride;
+        std::size_t vertexCount;
+        const std::uint32_t* indices;
+        std::size_t triangleCount;
+    };
+
+    /**
+     * @struct SetupChunk
+     * @brief Output of one setup job: its triangles, the tiles they touch
+     * and how many of them each tile got.
+     */
+    struct SetupChunk
+    {
+        std::size_t draw;
+        std::size_t firstTriangle;
+        std::size_t triangleCount;
+        std::vector<SetupTriangle> triangles;
+        std::vector<std::uint32_t> tileRefs;
+        std::vector<std::uint32_t> triangleRefs;
+        std::vector<std::uint32_t> tileCounts;
+    };
+
+    /**
+     * @fn void SoftwareRasterizer::setupChunk(SetupChunk& chunk)
+     * @brief Clips, snaps and bins the triangles of a chunk.
+     */
+    void setupChunk(SetupChunk& chunk);
+
+    /**
+     * @fn void SoftwareRasterizer::setupTriangle(SetupChunk& chunk,
+            const SoftwareProgram& program, const SoftwareVertex* corners[3])
+     * @brief Snaps a triangle that lies inside the clip volume and bins it.
+     */
+    void setupTriangle(SetupChunk& chunk, const SoftwareProgram& program,
+                       const SoftwareVertex* const* corners);
+
+    /**
+     * @fn void SoftwareRasterizer::rasterTile(std::size_t tile)
+     * @brief Draws the bin of one tile.
+     */
+    void rasterTile(std::size_t tile);
+
+    /**
+     * @fn void SoftwareRasterizer::rasterTriangle(const SetupTriangle&
+            triangle, int x0, int y0, int x1, int y1)
+     * @brief Draws the part of a triangle inside a pixel rectangle.
+     */
+    void rasterTriangle(const SetupTriangle& triangle, int x0, int y0, int x1,
+                        int y1);
+
+    JobSystem& jobs_;
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    std::vector<std::uint32_t> color_;
+    std::vector<float> depth_;
+
+    std::vector<Draw> draws_;
+
+    /**
+     * @brief Vertex functor output of every draw.
+     */
+    std::vector<std::vector<SoftwareVertex>> shaded_;
+
+    std::vector<SetupChunk> chunks_;
+
+    /**
+     * @brief Triangles of every tile, stored bin after bin; binStart_ has
+     * one entry per tile and one past the end.
+     */
+    std::vector<const SetupTriangle*> bins_;
+    std::vector<std::size_t> binStart_;
+
+    SoftwareRasterizerStats stats_;
+};
@@ -0,0 +1,124 @@
+/**
+ * @file software_scene.hpp
+ * @brief Header file for the scenes that the software backend can render.
+ * 
+ * This file contains the declaration of the abstract `SoftwareScene` class, 
+ * the counterpart of `Scene` for the SoftwareRasterizer. Software scenes 
+ * keep their vertex data on the CPU and describe their shaders as C++ 
+ * functors, so they run without any OpenGL context.
+ * 
+ * The `SoftwareTriangleScene` draws the triangle of the `TriangleScene`. 
+ * The `SoftwareTerrainScene` draws a large indexed height field in 
+ * perspective with depth testing and lighting, as a heavier load.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "frame_profiler.hpp"
+#include "job_system.hpp"
+#include "mesh.hpp"
+#include "settings.hpp"
+#include "software_rasterizer.hpp"
+
+/**
+ * @class SoftwareScene
+ * @brief Base class of everything the software backend can draw.
+ */
+class SoftwareScene
+{
+public:
+    /**
+     * @fn SoftwareScene::virtual ~SoftwareScene()
+     * @brief Default virtual destructor.
+     */
+    virtual ~SoftwareScene() = default;
+
+    /**
+     * @fn void SoftwareScene::update(std::size_t frame)
+     * @brief Advances the scene state before a frame is drawn.
+     * @param frame Number of the frame about to be drawn.
+     */
+    virtual void update(std::size_t frame) { (void)frame; }
+
+    /**
+     * @fn void SoftwareScene::draw(SoftwareRasterizer& rasterizer, 
+            FrameProfiler& profiler)
+     * @brief Records the draws of the scene.
+     * @param rasterizer The rasterizer that runs the draws.
+     * @param profiler Timings of the current frame, to which the scene adds
+     * its counters.
+     */
+    virtual void draw(SoftwareRasterizer& rasterizer, FrameProfiler& profiler) = 0;
+};
+
+/**
+ * @class SoftwareTriangleScene
+ * @brief Draws one triangle with a constant color.
+ */
+class SoftwareTriangleScene : public SoftwareScene
+{
+public:
+    /**
+     * @fn SoftwareTriangleScene::SoftwareTriangleScene()
+     * @brief Sets up the program and the triangle.
+     */
+    SoftwareTriangleScene();
+
+    void draw(SoftwareRasterizer& rasterizer, FrameProfiler& profiler) override;
+
+private:
+    SoftwareProgram program_;
+    std::vector<float> vertices_;
+};
+
+/**
+ * @class SoftwareTerrainScene
+ * @brief Draws a turning, lit height field of about the requested number 
+ * of triangles.
+ */
+class SoftwareTerrainScene : public SoftwareScene
+{
+public:
+    /**
+     * @fn SoftwareTerrainScene::SoftwareTerrainScene(std::size_t triangles)
+     * @brief Sets up the program and builds the indexed grid.
+     * @param triangles Approximate number of triangles.
+     */
+    explicit SoftwareTerrainScene(std::size_t triangles);
+
+    void update(std::size_t frame) override;
+    void draw(SoftwareRasterizer& rasterizer, FrameProfiler& profiler) override;
+
+private:
+    SoftwareProgram program_;
+
+    /**
+     * @brief Position (3 floats) and normal (3 floats) of every vertex.
+     */
+    std::vector<float> vertices_;
+    std::vector<std::uint32_t> indices_;
+
+    /**
+     * @brief View-projection matrix of the current frame, read by the 
+     * vertex functor.
+     */
+    float viewProjection_[16];
+
+    /**
+     * @brief Angle of the camera around the height field, in radians.
+     */
+    float angle_;
+};
+
+/**
+ * @fn std::unique_ptr<SoftwareScene> createSoftwareScene(
+        const RenderSettings& settings)
+ * @brief Creates the software version of the scene selected in the 
+ * settings.
+ * @param settings The settings naming the scene and its parameters.
+ * @throws std::logic_error if the scene has no software version.
+ * @return std::unique_ptr<SoftwareScene> The new scene.
+ */
+std::unique_ptr<SoftwareScene> createSoftwareScene(const RenderSettings& settings);
@@ -0,0 +1,167 @@
+/**
+ * @file streaming_buffer.hpp
+ * @brief Header file for buffers that receive new data every frame.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @class StreamingBuffer
+ * @brief A ring of equally sized segments inside one buffer object, used to 
+ * upload data every frame without stalling the driver.
+ * 
+ * Each frame writes into the next segment while the GPU may still read the 
+ * segments of the previous frames. A fence placed at the end of every frame 
+ * guards its segment, so a segment is only written again once the GPU is 
+ * done with it. With three segments the CPU can run two frames ahead before 
+ * it ever waits.
+ * 
+ * The buffer is mapped persistently when buffer storage (OpenGL 4.4 or 
+ * ARB_buffer_storage) is available. Otherwise every segment is mapped with 
+ * GL_MAP_UNSYNCHRONIZED_BIT, which skips the driver's implicit 
+ * synchronization because the fences already provide it.
+ * 
+ * @note The StreamingBuffer class assumes that the OpenGL context has been 
+ * properly initialized before any of its methods are called.
+ * 
+ * Example:
+ * @code
+ * StreamingBuffer stream(GL_ARRAY_BUFFER, 64 * 1024);
+ * float* vertices = static_cast<float*>(stream.map(bytes));
+ * // ... write the vertices of this frame ...
+ * GLintptr offset = stream.commit(bytes);
+ * // ... draw from offset ...
+ * stream.endFrame();
+ * @endcode
+ */
+class StreamingBuffer
+{
+public:
+
+    /**
+     * @var StreamingBuffer::SEGMENTS
+     * @brief Number of frames that can be in flight.
+     */
+    static constexpr std::size_t SEGMENTS{ 3 };
+
+    /**
+     * @fn StreamingBuffer::StreamingBuffer(GLenum target, 
+            GLsizeiptr segmentSize)
+     * @brief Creates the buffer object with room for SEGMENTS segments.
+     * @param target The buffer binding target, e.g. GL_ARRAY_BUFFER.
+     * @param segmentSize Largest number of bytes written in one frame.
+     * @throws std::logic_error if the buffer cannot be mapped.
+     */
+    StreamingBuffer(GLenum target, GLsizeiptr segmentSize);
+
+    /**
+     * @fn StreamingBuffer::~StreamingBuffer()
+     * @brief Unmaps and deletes the buffer and its fences.
+     */
+    ~StreamingBuffer();
+
+    // Delete copy constructor and copy assignment operator.
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    /**
+     * @fn void* StreamingBuffer::map(GLsizeiptr bytes)
+     * @brief Gets writable memory in the segment of the current frame.
+     * 
+     * Waits for the fence of the segment if the GPU may still read it.
+     * 
+     * @param bytes Number of bytes that will be written.
+     * @throws std::logic_error if bytes exceeds the segment size.
+     * @return void* Pointer to the start of the segment.
+     */
+    void* map(GLsizeiptr bytes);
+
+    /**
+     * @fn GLintptr StreamingBuffer::commit(GLsizeiptr bytes)
+     * @brief Finishes writing the current segment.
+     * @param bytes Number of bytes that were written.
+     * @return GLintptr Byte offset of the segment in the buffer object.
+     */
+    GLintptr commit(GLsizeiptr bytes);
+
+    /**
+     * @fn void StreamingBuffer::endFrame()
+     * @brief Fences the segment of the current frame and moves on to the 
+     * next one. Call after the last draw that reads the segment.
+     */
+    void endFrame();
+
+    /**
+     * @brief Getter for the buffer object ID.
+     * @return unsigned int The unique ID of the buffer.
+     */
+    unsigned int getBufferId() const { return buffer_; }
+
+    /**
+     * @brief Getter for the byte offset of the current frame's segment.
+     * @return GLintptr Offset of the segment in the buffer object.
+     */
+    GLintptr getSegmentOffset() const 
+    { 
+        return segmentSize_ * static_cast<GLintptr>(segment_); 
+    }
+
+    /**
+     * @brief Getter for the size of one segment in bytes.
+     * @return GLsizeiptr Segment size.
+     */
+    GLsizeiptr getSegmentSize() const { return segmentSize_; }
+
+    /**
+     * @brief Tells whether the buffer is mapped persistently.
+     * @return bool true with buffer storage, false with per-frame mapping.
+     */
+    bool isPersistent() const { return persistent_; }
+
+    /**
+     * @brief Getter for the bytes committed since construction.
+     * @return std::uint64_t Total bytes streamed.
+     */
+    std::uint64_t getBytesStreamed() const { return bytesStreamed_; }
+
+    /**
+     * @brief Getter for the number of times map had to wait for the GPU.
+     * @return std::uint64_t Number of fence waits that blocked.
+     */
+    std::uint64_t getStallCount() const { return stalls_; }
+
+private:
+    /**
+     * @brief Blocks until the GPU has finished reading a segment.
+     * @param segment Index of the segment.
+     */
+    void waitForSegment(std::size_t segment);
+
+    GLenum target_;
+    unsigned int buffer_;
+    GLsizeiptr segmentSize_;
+    bool persistent_;
+
+    /**
+     * @brief Start of the persistent mapping, or the current segment mapping.
+     */
+    void* mapped_;
+
+    /**
+     * @brief Fences guarding the segments, nullptr when a segment is free.
+     */
+    std::array<GLsync, SEGMENTS> fences_;
+
+    /**
+     * @brief Index of the segment written in the current frame.
+     */
+    std::size_t segment_;
+
+    std::uint64_t bytesStreamed_;
+    std::uint64_t stalls_;
+};
@@ -0,0 +1,303 @@
+/**
+ * @file texture.hpp
+ * @brief Header file for textures with immutable storage and for streaming
+ * texture uploads through pixel buffer objects.
+ *
+ * This file contains the declarations of the Texture and TextureStreamer
+ * classes. A Texture is either a 2D texture or a 2D array texture, whose
+ * layers let many materials of the same size share one bind: a shader picks
+ * the layer per vertex or instance instead of the draw rebinding textures.
+ *
+ * The TextureStreamer copies pixels, with a mipmap chain it builds on the
+ * CPU, into a ring of pixel buffer segments and lets the texture copies
+ * read from there. The calls return as soon as
+ * the copy is queued, and the fences of the ring keep a segment from being
+ * overwritten while the GPU still reads it.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "streaming_buffer.hpp"
+
+/**
+ * @fn GLsizei computeMipLevels(GLsizei width, GLsizei height)
+ * @brief Counts the levels of a full mipmap chain down to 1x1.
+ * @param width Width of the base level.
+ * @param height Height of the base level.
+ * @return GLsizei Number of levels, including the base level.
+ */
+GLsizei computeMipLevels(GLsizei width, GLsizei height);
+
+/**
+ * @fn void downsampleRGBA8(const std::uint8_t* source, GLsizei width,
+        GLsizei height, std::uint8_t* target)
+ * @brief Averages 2x2 blocks of an RGBA8 image into the next mipmap level.
+ * @param source Pixels of the level.
+ * @param width Width of the level.
+ * @param height Height of the level.
+ * @param target Room for max(width / 2, 1) * max(height / 2, 1) pixels.
+ */
+void downsampleRGBA8(const std::uint8_t* source, GLsizei width, GLsizei height,
+                     std::uint8_t* target);
+
+/**
+ * @fn bool allocateTextureStorage(GLenum target, GLsizei levels,
+        GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers)
+ * @brief Allocates every level of the bound texture.
+ *
+ * Uses immutable storage (OpenGL 4.2 or ARB_texture_storage) when it is
+ * available, which lets the driver allocate the whole chain once and skip
+ * completeness checks on every bind. Otherwise each level is specified
+ * with glTexImage2D or glTexImage3D.
+ *
+ * @param target GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY, bound by the caller.
+ * @param levels Number of mipmap levels.
+ * @param internalFormat Sized internal format, e.g. GL_RGBA8.
+ * @param width Width of the base level.
+ * @param height Height of the base level.
+ * @param layers Number of layers, 1 for GL_TEXTURE_2D.
+ * @return bool true if the storage is immutable.
+ */
+bool allocateTextureStorage(GLenum target, GLsizei levels, GLenum internalFormat,
+                            GLsizei width, GLsizei height, GLsizei layers);
+
+/**
+ * @class Texture
+ * @brief An RGBA8 2D texture or 2D array texture with a full mipmap chain.
+ *
+ * @note The Texture class assumes that the OpenGL context has been properly
+ * initialized before it is constructed.
+ *
+ * Example:
+ * @code
+ * Texture materials(GL_TEXTURE_2D_ARRAY, 256, 256, 64);
+ * materials.upload(3, pixels);
+ * materials.generateMipmaps();
+ * @endcode
+ */
+class Texture
+{
+public:
+    /**
+     * @fn Texture::Texture(GLenum target, GLsizei width, GLsizei height,
+            GLsizei layers)
+     * @brief Creates the texture and allocates all of its levels.
+     * @param target GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY.
+     * @param width Width of a layer in pixels.
+     * @param height Height of a layer in pixels.
+     * @param layers Number of layers, 1 for GL_TEXTURE_2D.
+     * @throws std::logic_error if the target or the size is invalid.
+     */
+    Texture(GLenum target, GLsizei width, GLsizei height, GLsizei layers = 1);
+
+    /**
+     * @fn Texture::~Texture()
+     * @brief Deletes the texture.
+     */
+    ~Texture();
+
+    // Delete copy constructor and copy assignment operator.
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    /**
+     * @fn void Texture::upload(GLint layer, const void* pixels, GLint level)
+     * @brief Replaces one level of a layer, reading from client memory or,
+     * with a pixel unpack buffer bound, from an offset into it.
+     * 
+     * Replacing the base level marks the smaller levels stale for 
+     * generateMipmaps, unless the caller uploads them itself.
+     * 
+     * @param layer Index of the layer, 0 for GL_TEXTURE_2D.
+     * @param pixels RGBA8 pixels, bottom row first, or a buffer offset.
+     * @param level Mipmap level.
+     */
+    void upload(GLint layer, const void* pixels, GLint level = 0);
+
+    /**
+     * @fn void Texture::generateMipmaps()
+     * @brief Rebuilds the smaller levels of every layer if a base level 
+     * changed since.
+     */
+    void generateMipmaps();
+
+    /**
+     * @brief Getter for the texture ID.
+     */
+    GLuint getId() const { return texture_; }
+
+    /**
+     * @brief Getter for the texture target.
+     */
+    GLenum getTarget() const { return target_; }
+
+    GLsizei getWidth() const { return width_; }
+    GLsizei getHeight() const { return height_; }
+    GLsizei getLayerCount() const { return layers_; }
+    GLsizei getLevelCount() const { return levels_; }
+
+    /**
+     * @brief Getter for the bytes of one layer of the base level.
+     */
+    std::size_t getLayerSize() const
+    {
+        return static_cast<std::size_t>(width_) * height_ * 4;
+    }
+
+    /**
+     * @fn std::size_t Texture::getMipChainSize() const
+     * @brief Getter for the bytes of one layer over all levels.
+     */
+    std::size_t getMipChainSize() const;
+
+    /**
+     * @brief Tells whether the storage was allocated with glTexStorage.
+     */
+    bool isImmutable() const { return immutable_; }
+
+private:
+    GLenum target_;
+    GLuint texture_;
+    GLsizei width_;
+    GLsizei height_;
+    GLsizei layers_;
+    GLsizei levels_;
+    bool immutable_;
+    bool mipsDirty_;
+};
+
+/**
+ * @struct TextureStreamerStats
+ * @brief Totals of a TextureStreamer since construction.
+ */
+struct TextureStreamerStats
+{
+    std::uint64_t layers{ 0 };
+    std::uint64_t bytes{ 0 };
+
+    /**
+     * @var TextureStreamerStats::submitMs
+     * @brief CPU time spent copying pixels and issuing the uploads.
+     */
+    double submitMs{ 0.0 };
+
+    /**
+     * @var TextureStreamerStats::stalls
+     * @brief Times a segment of the ring was still read by the GPU.
+     */
+    std::uint64_t stalls{ 0 };
+};
+
+/**
+ * @class TextureStreamer
+ * @brief Uploads texture layers every frame through a ring of pixel buffer
+ * segments.
+ *
+ * Layers are queued during the frame and flush copies as many as fit into
+ * the frame's segment of a StreamingBuffer bound as GL_PIXEL_UNPACK_BUFFER,
+ * then issues the texture copies from it. Each layer comes with its whole
+ * mipmap chain, so a changed layer never makes the GPU rebuild the mipmaps
+ * of every other layer of an array. The rest stays queued for the
+ * next frame, so a frame never uploads more than one segment. Without
+ * pixel buffers the layers are uploaded straight from client memory, which
+ * makes the driver copy them before the call returns.
+ *
+ * @note The TextureStreamer class assumes that the OpenGL context has been
+ * properly initialized before it is constructed.
+ *
+ * Example:
+ * @code
+ * TextureStreamer streamer(4 * materials.getMipChainSize(), true);
+ * streamer.queue(materials, 3, pixels);
+ * streamer.flush();
+ * // ... draw ...
+ * streamer.endFrame();
+ * @endcode
+ */
+class TextureStreamer
+{
+public:
+    /**
+     * @fn TextureStreamer::TextureStreamer(GLsizeiptr bytesPerFrame,
+            bool pixelBuffers)
+     * @brief Creates the pixel buffer ring.
+     * @param bytesPerFrame Size of one segment of the ring.
+     * @param pixelBuffers Upload through the ring instead of client memory.
+     * @throws std::logic_error if the ring cannot be mapped.
+     */
+    TextureStreamer(GLsizeiptr bytesPerFrame, bool pixelBuffers);
+
+    /**
+     * @fn void TextureStreamer::queue(Texture& texture, GLint layer,
+            const std::uint8_t* pixels)
+     * @brief Queues the upload of a layer.
+     * @param texture The texture to write.
+     * @param layer Index of the layer.
+     * @param pixels RGBA8 pixels of the base level, which must stay valid 
+     * until the layer is flushed.
+     * @throws std::logic_error if the layer is larger than a segment.
+     */
+    void queue(Texture& texture, GLint layer, const std::uint8_t* pixels);
+
+    /**
+     * @fn std::size_t TextureStreamer::flush()
+     * @brief Builds the mipmaps of the queued layers that fit into this 
+     * frame and uploads them.
+     * @return std::size_t Number of layers uploaded.
+     */
+    std::size_t flush();
+
+    /**
+     * @fn void TextureStreamer::endFrame()
+     * @brief Fences the segment of this frame. Call after the last command
+     * that reads the uploaded layers has been issued.
+     */
+    void endFrame();
+
+    /**
+     * @brief Getter for the number of layers waiting to be flushed.
+     */
+    std::size_t getQueuedCount() const { return queue_.size(); }
+
+    /**
+     * @brief Tells whether uploads go through pixel buffers.
+     */
+    bool usesPixelBuffers() const { return ring_ != nullptr; }
+
+    /**
+     * @brief Tells whether the pixel buffers are mapped persistently.
+     */
+    bool isPersistent() const { return ring_ && ring_->isPersistent(); }
+
+    /**
+     * @fn TextureStreamerStats TextureStreamer::getStats() const
+     * @brief Getter for the totals since construction.
+     */
+    TextureStreamerStats getStats() const;
+
+private:
+    /**
+     * @struct Upload
+     * @brief A queued layer.
+     */
+    struct Upload
+    {
+        Texture* texture;
+        GLint layer;
+        const std::uint8_t* pixels;
+    };
+
+    std::unique_ptr<StreamingBuffer> ring_;
+    GLsizeiptr bytesPerFrame_;
+    std::vector<Upload> queue_;
+
+    /**
+     * @brief Mipmap chain of the layer being flushed.
+     */
+    std::vector<std::uint8_t> chain_;
+    TextureStreamerStats stats_;
+};
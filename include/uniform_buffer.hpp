@@ -0,0 +1,301 @@
+/**
+ * @file uniform_buffer.hpp
+ * @brief Header file for uniform block reflection and for a ring buffer of 
+ * per-frame and per-draw uniform data.
+ * 
+ * This file contains the declarations of the UniformBlockLayout and 
+ * UniformRing classes. Setting uniforms one glUniform call at a time costs 
+ * a driver call per value and per draw. Uniform blocks instead read their 
+ * values from a buffer: the data of a whole frame is written linearly into 
+ * one large buffer and every draw only binds its range with 
+ * glBindBufferRange.
+ * 
+ * A UniformBlockLayout asks a linked program where every member of a block 
+ * lives, so writers use the offsets and strides the driver chose instead of 
+ * mirroring the layout in a C++ struct. The UniformRing hands out aligned 
+ * ranges of the current frame's segment of a StreamingBuffer, which is 
+ * persistently mapped where buffer storage is available and fenced either 
+ * way.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "streaming_buffer.hpp"
+
+/**
+ * @var FRAME_UNIFORM_BINDING
+ * @brief Binding point of the per-frame block, FrameUniforms.
+ */
+constexpr GLuint FRAME_UNIFORM_BINDING{ 0 };
+
+/**
+ * @var OBJECT_UNIFORM_BINDING
+ * @brief Binding point of the per-draw block, the range of a DrawItem.
+ */
+constexpr GLuint OBJECT_UNIFORM_BINDING{ 1 };
+
+/**
+ * @struct FrameUniforms
+ * @brief Data of the per-frame block, bound to FRAME_UNIFORM_BINDING for 
+ * every draw of a frame.
+ * 
+ * Matches this std140 block, whose layout is fixed by the standard:
+ * @code
+ * layout (std140) uniform Frame
+ * {
+ *     vec4 viewport;  // width, height, 1 / width, 1 / height
+ *     vec4 time;      // seconds, frame number, 0, 0
+ * };
+ * @endcode
+ */
+struct FrameUniforms
+{
+    float viewport[4];
+    float time[4];
+};
+
+/**
+ * @struct UniformMember
+ * @brief Where a member of a uniform block lives in the block's buffer.
+ */
+struct UniformMember
+{
+    /**
+     * @var UniformMember::name
+     * @brief Name as reported by the driver, e.g. "color" or "bones[0]".
+     */
+    std::string name;
+    GLenum type{ GL_NONE };
+
+    /**
+     * @var UniformMember::size
+     * @brief Number of array elements, 1 for a single value.
+     */
+    GLint size{ 0 };
+    GLint offset{ 0 };
+    GLint arrayStride{ 0 };
+    GLint matrixStride{ 0 };
+};
+
+/**
+ * @class UniformBlockLayout
+ * @brief Layout of one uniform block of a linked program.
+ * 
+ * Example:
+ * @code
+ * UniformBlockLayout object(program, "Object");
+ * object.bind(program, OBJECT_UNIFORM_BINDING);
+ * const GLint color = object.getOffset("color");
+ * @endcode
+ */
+class UniformBlockLayout
+{
+public:
+    /**
+     * @fn UniformBlockLayout::UniformBlockLayout(GLuint program, 
+            const std::string& name)
+     * @brief Reflects the block of a program by name.
+     * @param program A successfully linked program.
+     * @param name Name of the block, not of its instance.
+     * @throws std::logic_error if the program has no such block.
+     */
+    UniformBlockLayout(GLuint program, const std::string& name);
+
+    /**
+     * @fn void UniformBlockLayout::bind(GLuint program, GLuint binding) const
+     * @brief Connects the block of a program to a binding point. Programs 
+     * with the same block may have it at different indices.
+     * @param program The program the block belongs to.
+     * @param binding Binding point, e.g. OBJECT_UNIFORM_BINDING.
+     */
+    void bind(GLuint program, GLuint binding) const;
+
+    /**
+     * @fn GLint UniformBlockLayout::getOffset(const std::string& member) const
+     * @brief Byte offset of a member; arrays are found by their name with 
+     * or without "[0]".
+     * @param member Name of the member.
+     * @return GLint The offset, or -1 if the block has no such member.
+     */
+    GLint getOffset(const std::string& member) const;
+
+    /**
+     * @fn const UniformMember* UniformBlockLayout::findMember(
+            const std::string& member) const
+     * @brief Looks a member up by name, like getOffset.
+     * @return const UniformMember* The member, or nullptr.
+     */
+    const UniformMember* findMember(const std::string& member) const;
+
+    const std::string& getName() const { return name_; }
+    GLuint getIndex() const { return index_; }
+
+    /**
+     * @brief Getter for the bytes a buffer range of the block must hold.
+     */
+    GLsizeiptr getDataSize() const { return dataSize_; }
+
+    const std::vector<UniformMember>& getMembers() const { return members_; }
+
+private:
+    std::string name_;
+    GLuint index_;
+    GLsizeiptr dataSize_;
+    std::vector<UniformMember> members_;
+};
+
+/**
+ * @fn std::vector<std::string> listUniformBlocks(GLuint program)
+ * @brief Gets the names of the active uniform blocks of a linked program.
+ * @param program The program.
+ * @return std::vector<std::string> Block names, in index order.
+ */
+std::vector<std::string> listUniformBlocks(GLuint program);
+
+/**
+ * @struct UniformAllocation
+ * @brief A range of the current frame's segment of a UniformRing.
+ */
+struct UniformAllocation
+{
+    /**
+     * @var UniformAllocation::data
+     * @brief Where to write the range, valid until the ring is committed.
+     */
+    std::uint8_t* data{ nullptr };
+
+    /**
+     * @var UniformAllocation::offset
+     * @brief Byte offset of the range in the buffer object, a multiple of 
+     * the offset alignment.
+     */
+    GLintptr offset{ 0 };
+    GLsizeiptr size{ 0 };
+};
+
+/**
+ * @class UniformRing
+ * @brief Hands out aligned ranges for uniform data of the current frame.
+ * 
+ * Ranges are carved linearly out of the frame's segment of a 
+ * StreamingBuffer, each starting at a multiple of the offset alignment the 
+ * driver requires for glBindBufferRange. The segment is mapped on the first 
+ * allocation of a frame. commit finishes writing; without persistent 
+ * mapping it unmaps the segment, so it must come before the first draw 
+ * that reads from the ring. endFrame fences the segment.
+ * 
+ * The ring works for GL_UNIFORM_BUFFER and, with OpenGL 4.3, for 
+ * GL_SHADER_STORAGE_BUFFER.
+ * 
+ * @note The UniformRing class assumes that the OpenGL context has been 
+ * properly initialized before it is constructed.
+ * 
+ * Example:
+ * @code
+ * UniformRing ring(GL_UNIFORM_BUFFER, 1 << 20);
+ * UniformAllocation object = ring.allocate(layout.getDataSize());
+ * // ... write the block at object.data ...
+ * ring.commit();
+ * glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORM_BINDING, 
+ *                   ring.getBufferId(), object.offset, object.size);
+ * // ... draw ...
+ * ring.endFrame();
+ * @endcode
+ */
+class UniformRing
+{
+public:
+    /**
+     * @fn UniformRing::UniformRing(GLenum target, GLsizeiptr bytesPerFrame)
+     * @brief Creates the ring buffer.
+     * @param target GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+     * @param bytesPerFrame Size of the segment of one frame.
+     * @throws std::logic_error if the target is not supported or the 
+     * buffer cannot be mapped.
+     */
+    UniformRing(GLenum target, GLsizeiptr bytesPerFrame);
+
+    /**
+     * @fn void UniformRing::reserve(GLsizeiptr bytesPerFrame)
+     * @brief Replaces the buffer with a larger one if a frame needs more 
+     * room. Only call between frames; the bound ranges of the old buffer 
+     * become invalid.
+     * @param bytesPerFrame Bytes the largest frame will allocate, 
+     * including the padding of the alignment.
+     */
+    void reserve(GLsizeiptr bytesPerFrame);
+
+    /**
+     * @fn UniformAllocation UniformRing::allocate(GLsizeiptr size)
+     * @brief Takes the next aligned range of the current frame.
+     * @param size Bytes of the range.
+     * @throws std::logic_error if the segment of the frame is full or the 
+     * ring was already committed this frame.
+     * @return UniformAllocation The range.
+     */
+    UniformAllocation allocate(GLsizeiptr size);
+
+    /**
+     * @fn void UniformRing::commit()
+     * @brief Finishes writing the current frame. Call before the first 
+     * draw that reads from the ring.
+     */
+    void commit();
+
+    /**
+     * @fn void UniformRing::endFrame()
+     * @brief Commits if needed and fences the segment of the frame. Call 
+     * after the last draw that reads from the ring.
+     */
+    void endFrame();
+
+    /**
+     * @brief Rounds a size up to the offset alignment, the stride of 
+     * consecutive ranges of that size.
+     */
+    GLsizeiptr alignSize(GLsizeiptr size) const
+    {
+        return (size + alignment_ - 1) / alignment_ * alignment_;
+    }
+
+    GLenum getTarget() const { return target_; }
+    GLuint getBufferId() const { return ring_->getBufferId(); }
+    GLsizeiptr getAlignment() const { return alignment_; }
+    GLsizeiptr getSegmentSize() const { return ring_->getSegmentSize(); }
+    bool isPersistent() const { return ring_->isPersistent(); }
+    std::uint64_t getStallCount() const { return ring_->getStallCount(); }
+
+    /**
+     * @brief Getter for the bytes allocated in the current frame, padding 
+     * included.
+     */
+    GLsizeiptr getFrameBytes() const { return head_; }
+
+    /**
+     * @brief Getter for the ranges allocated since construction.
+     */
+    std::uint64_t getAllocationCount() const { return allocations_; }
+
+private:
+    GLenum target_;
+    GLsizeiptr alignment_;
+    std::unique_ptr<StreamingBuffer> ring_;
+
+    /**
+     * @brief Mapped segment of the current frame, nullptr before the first 
+     * allocation.
+     */
+    std::uint8_t* mapped_;
+
+    /**
+     * @brief Bytes used of the current segment.
+     */
+    GLsizeiptr head_;
+    bool committed_;
+    std::uint64_t allocations_;
+};
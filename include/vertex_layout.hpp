@@ -0,0 +1,179 @@
+/**
+ * @file vertex_layout.hpp
+ * @brief Header file for describing and packing vertex attributes.
+ * 
+ * This file contains the VertexLayout class, which lists the attributes of 
+ * a vertex together with their storage format and the buffer (stream) they 
+ * live in, and packVertices, which converts float input into that layout.
+ * 
+ * Most attributes do not need 32-bit floats. Positions of small meshes fit 
+ * in half floats, normals in GL_INT_2_10_10_10_REV and texture coordinates 
+ * and colors in normalized 8 or 16-bit integers. A position, normal and 
+ * texture coordinate take 32 bytes as floats and 16 bytes packed, which 
+ * halves vertex fetch bandwidth and GPU memory.
+ */
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @enum AttributeFormat
+ * @brief Storage format of one attribute component.
+ * 
+ * Normalized formats are read by the shader as floats in [0, 1] (Unorm) or 
+ * [-1, 1] (Snorm). Snorm2_10_10_10 packs four components into 32 bits and 
+ * always has four components.
+ */
+enum class AttributeFormat
+{
+    Float32,
+    Half,
+    Snorm2_10_10_10,
+    Unorm8,
+    Snorm8,
+    Unorm16,
+    Snorm16
+};
+
+/**
+ * @struct VertexAttribute
+ * @brief One attribute of a VertexLayout.
+ */
+struct VertexAttribute
+{
+    /**
+     * @var VertexAttribute::location
+     * @brief Attribute location in the vertex shader.
+     */
+    GLuint location;
+
+    /**
+     * @var VertexAttribute::components
+     * @brief Number of components (1 to 4).
+     */
+    GLint components;
+
+    AttributeFormat format;
+
+    /**
+     * @var VertexAttribute::stream
+     * @brief Index of the vertex buffer holding the attribute.
+     */
+    std::size_t stream;
+
+    /**
+     * @var VertexAttribute::offset
+     * @brief Byte offset of the attribute inside a vertex of its stream.
+     */
+    std::size_t offset;
+};
+
+/**
+ * @class VertexLayout
+ * @brief Attributes of a vertex, interleaved within each stream.
+ * 
+ * Attributes of the same stream are interleaved in the order they are 
+ * added, each starting at a multiple of four bytes. Attributes in separate 
+ * streams live in separate buffers, e.g. positions alone for a depth pass.
+ * 
+ * Example:
+ * @code
+ * VertexLayout layout;
+ * layout.add(0, 3, AttributeFormat::Half)             // position,  8 bytes
+ *       .add(1, 4, AttributeFormat::Snorm2_10_10_10)  // normal,    4 bytes
+ *       .add(2, 2, AttributeFormat::Unorm16);         // uv,        4 bytes
+ * std::vector<std::vector<std::uint8_t>> streams = 
+ *     packVertices(layout, { positions, normals, uvs }, vertexCount);
+ * BufferSetup mesh(layout, streams, indices);
+ * @endcode
+ */
+class VertexLayout
+{
+public:
+    /**
+     * @fn VertexLayout& VertexLayout::add(GLuint location, GLint components,
+            AttributeFormat format, std::size_t stream)
+     * @brief Appends an attribute.
+     * @param location Attribute location in the vertex shader.
+     * @param components Number of components (1 to 4).
+     * @param format Storage format of the components.
+     * @param stream Index of the vertex buffer, at most one more than the 
+     * largest stream so far.
+     * @throws std::logic_error if the attribute cannot be stored that way.
+     * @return VertexLayout& The layout, for chaining.
+     */
+    VertexLayout& add(GLuint location, GLint components, AttributeFormat format,
+                      std::size_t stream=0);
+
+    /**
+     * @brief Getter for the attributes in the order they were added.
+     * @return const std::vector<VertexAttribute>& The attributes.
+     */
+    const std::vector<VertexAttribute>& getAttributes() const 
+    { 
+        return attributes_; 
+    }
+
+    /**
+     * @brief Getter for the number of vertex buffers.
+     * @return std::size_t Number of streams.
+     */
+    std::size_t getStreamCount() const { return strides_.size(); }
+
+    /**
+     * @brief Getter for the size of one vertex in a stream.
+     * @param stream Index of the stream.
+     * @return std::size_t Bytes per vertex in the stream.
+     */
+    std::size_t getStride(std::size_t stream) const { return strides_[stream]; }
+
+    /**
+     * @fn std::size_t VertexLayout::getVertexSize() const
+     * @brief Size of one vertex over all streams.
+     * @return std::size_t Bytes per vertex.
+     */
+    std::size_t getVertexSize() const;
+
+private:
+    std::vector<VertexAttribute> attributes_;
+    std::vector<std::size_t> strides_;
+};
+
+/**
+ * @fn GLenum getAttributeType(AttributeFormat format)
+ * @brief OpenGL type that glVertexAttribPointer takes for a format.
+ */
+GLenum getAttributeType(AttributeFormat format);
+
+/**
+ * @fn bool isNormalized(AttributeFormat format)
+ * @brief Whether the integer format is read as a normalized float.
+ */
+bool isNormalized(AttributeFormat format);
+
+/**
+ * @fn std::size_t getAttributeSize(AttributeFormat format, 
+        GLint components)
+ * @brief Bytes an attribute takes before alignment.
+ */
+std::size_t getAttributeSize(AttributeFormat format, GLint components);
+
+/**
+ * @fn std::vector<std::vector<std::uint8_t>> packVertices(
+        const VertexLayout& layout, 
+        const std::vector<std::vector<float>>& sources,
+        std::size_t vertexCount)
+ * @brief Converts float attributes into the formats of a layout.
+ * @param layout The layout to pack into.
+ * @param sources One array per attribute, in layout order, with 
+ * components floats per vertex.
+ * @param vertexCount Number of vertices.
+ * @throws std::logic_error if a source does not match its attribute.
+ * @return std::vector<std::vector<std::uint8_t>> The bytes of every stream.
+ */
+std::vector<std::vector<std::uint8_t>> packVertices(
+    const VertexLayout& layout, const std::vector<std::vector<float>>& sources,
+    std::size_t vertexCount);
@@ -0,0 +1,64 @@
+/**
+ * @file vertex_packing.hpp
+ * @brief Header file for converting float arrays into compact vertex 
+ * formats.
+ * 
+ * Every routine converts count values (or count vectors, for the packed 
+ * 2_10_10_10 format) from a flat float array. With SSE2 four values are 
+ * converted per step; other targets use the scalar versions, which give 
+ * identical results. Values outside the range of a normalized format are 
+ * clamped, and floats are rounded to the nearest representable value.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @fn void packHalf(const float* input, std::uint16_t* output, 
+        std::size_t count)
+ * @brief Converts floats to IEEE half floats, rounding to nearest even.
+ * 
+ * Values too large for a half become infinity, NaNs stay NaNs and small 
+ * values become half float denormals.
+ */
+void packHalf(const float* input, std::uint16_t* output, std::size_t count);
+
+/**
+ * @fn void packUnorm8(const float* input, std::uint8_t* output, 
+        std::size_t count)
+ * @brief Converts floats in [0, 1] to 8-bit unsigned normalized integers.
+ */
+void packUnorm8(const float* input, std::uint8_t* output, std::size_t count);
+
+/**
+ * @fn void packSnorm8(const float* input, std::int8_t* output, 
+        std::size_t count)
+ * @brief Converts floats in [-1, 1] to 8-bit signed normalized integers.
+ */
+void packSnorm8(const float* input, std::int8_t* output, std::size_t count);
+
+/**
+ * @fn void packUnorm16(const float* input, std::uint16_t* output, 
+        std::size_t count)
+ * @brief Converts floats in [0, 1] to 16-bit unsigned normalized integers.
+ */
+void packUnorm16(const float* input, std::uint16_t* output, std::size_t count);
+
+/**
+ * @fn void packSnorm16(const float* input, std::int16_t* output, 
+        std::size_t count)
+ * @brief Converts floats in [-1, 1] to 16-bit signed normalized integers.
+ */
+void packSnorm16(const float* input, std::int16_t* output, std::size_t count);
+
+/**
+ * @fn void packSnorm2_10_10_10(const float* input, std::uint32_t* output, 
+        std::size_t count)
+ * @brief Packs vectors of four floats in [-1, 1] into the layout of 
+ * GL_INT_2_10_10_10_REV: x in the lowest ten bits, w in the highest two.
+ * @param input Four floats per vector.
+ * @param output One word per vector.
+ * @param count Number of vectors.
+ */
+void packSnorm2_10_10_10(const float* input, std::uint32_t* output, 
+                         std::size_t count);
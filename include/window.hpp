@@ -17,6 +17,37 @@
  * - Handling window resizing and updating the OpenGL viewport.
  * - Processing user input and managing display logic.
  * 
+ * When headless rendering is requested, no window is created. The OpenGL 
+ * context then comes from a HeadlessContext and frames are drawn into an 
+ * offscreen framebuffer until a frame or time limit is reached.
+ * 
+ * With the software backend the frames are drawn by a SoftwareRasterizer 
+ * instead. A headless software run creates no OpenGL context at all; a 
+ * window shows the frames by uploading them to a texture.
+ * 
+ * Per-frame CPU work of the scenes runs on a JobSystem owned by the window 
+ * manager. A thread sweep restarts it with 1, 2, 4 ... threads and reports 
+ * how the frame time scales.
+ * 
+ * Frames are spaced by a FramePacer: vertical sync, uncapped or a fixed 
+ * rate limiter. Key events arrive through a GLFW callback in an InputQueue 
+ * with the time they came in, are taken right before a frame is built and 
+ * measured against the moment the frame is handed to the swap.
+ * 
+ * In on-demand mode a frame is only drawn when a resize, an input event, 
+ * background work or the scene changed something. Only the damaged part of 
+ * the view is redrawn, under a scissor rectangle, and the loop blocks in 
+ * glfwWaitEventsTimeout while nothing changes.
+ * 
+ * With a render scale below 1 or a GPU frame time budget the scene is drawn
+ * into a ScaledFramebuffer and upsampled to the window. Under a budget a 
+ * ResolutionController picks the scale of every frame from the measured 
+ * GPU frame times.
+ * 
+ * A FrameCapture can write every presented frame to disk; the readback 
+ * goes through pixel pack buffers and the encoding runs on threads of its 
+ * own, so the loop never waits for either.
+ * 
  * This file should be included in any application that requires a GLFW window 
  * with an OpenGL context for rendering graphics.
  */
@@ -24,12 +55,52 @@
 #pragma once
 #include <glad/glad.h> 
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <vector>
 #include <iostream>
+#include "asset_loader.hpp"
 #include "buffer.hpp"
+#include "dynamic_resolution.hpp"
+#include "frame_capture.hpp"
+#include "frame_pacing.hpp"
+#include "frame_profiler.hpp"
+#include "headless.hpp"
+#include "job_system.hpp"
+#include "program_cache.hpp"
+#include "render_queue.hpp"
+#include "scene.hpp"
+#include "settings.hpp"
+#include "shader_pipeline.hpp"
 #include "shaders.hpp"
+#include "software_scene.hpp"
+
+/**
+ * @struct OnDemandStats
+ * @brief Totals of an on-demand run.
+ */
+struct OnDemandStats
+{
+    /**
+     * @var OnDemandStats::idleWaits
+     * @brief Times the loop blocked because no frame was needed.
+     */
+    std::size_t idleWaits{ 0 };
+
+    /**
+     * @var OnDemandStats::scissoredFrames
+     * @brief Frames that redrew only part of the view.
+     */
+    std::size_t scissoredFrames{ 0 };
+
+    /**
+     * @var OnDemandStats::redrawnArea
+     * @brief Sum over all drawn frames of the fraction of the view redrawn.
+     */
+    double redrawnArea{ 0.0 };
+};
 
 /**
  * @class My_GLFW_Window_Manager
@@ -46,13 +117,16 @@ class My_GLFW_Window_Manager
 public:
 
     /**
-     * @fn My_GLFW_Window_Manager().
+     * @fn My_GLFW_Window_Manager(const RenderSettings& settings).
      * @brief Default constructor. 
      * Initializes the GLFW library, creates a window, and sets up the 
-     * OpenGL context.
+     * OpenGL context. In headless mode a windowless context is created 
+     * instead.
      * 
+     * @param settings Options for context creation and the display loop.
     */
-    My_GLFW_Window_Manager();
+    explicit My_GLFW_Window_Manager(const RenderSettings& settings = 
+                                    RenderSettings{});
 
     /**
      * @fn ~My_GLFW_Window_Manager().
@@ -64,7 +138,8 @@ public:
      * @fn display()
      * @brief Function to handle the display logic for the application.
      * @remark Manages display buffers and processes input, 
-     * @remark loops until a closing signal is given.
+     * @remark loops until a closing signal is given or the frame or time 
+     * limit of the settings is reached.
     */
     void display();
 
@@ -72,6 +147,8 @@ public:
      * @fn void processInput().
      * @brief This function handles user input, such as keyboard or mouse events,
      * and updates the application state accordingly.
+     * @remark Takes the events queued by the key callback since the last 
+     * frame; they count as presented once the frame is swapped.
     */
     void processInput();
 
@@ -135,6 +212,27 @@ public:
         initialization_success_ = success;
     }
 
+    /**
+     * @fn inline bool isHeadless() const.
+     * @brief Tells whether rendering happens without a window.
+     * @return True if frames are drawn offscreen or, with the software 
+     * backend, only in memory.
+    */
+    inline bool isHeadless() const
+    {
+        return settings_.headless;
+    }
+
+    /**
+     * @fn inline const FrameProfiler* getProfiler() const.
+     * @brief Gets the frame timings of the display loop.
+     * @return Pointer to the profiler, or nullptr before display() runs.
+    */
+    inline const FrameProfiler* getProfiler() const
+    {
+        return profiler_.get();
+    }
+
 private:
     /**
      * @brief Initializes the GLFW library, creates a window, and sets up the 
@@ -175,6 +273,193 @@ private:
     */
     bool openGLFW();
 
+    /**
+     * @brief Creates a windowless OpenGL context and its offscreen 
+     * framebuffer.
+     * 
+     * @return bool true if the context and framebuffer are ready, false 
+     * otherwise.
+     * 
+     * @remark This function performs the following steps:
+     * @remark Creates a surfaceless EGL context and makes it current.
+     * @remark Loads OpenGL 3.3 functions through EGL.
+     * @remark Creates the offscreen framebuffer and binds it.
+    */
+    bool createHeadlessContext();
+
+    /**
+     * @brief Display loop of the software backend, the counterpart of 
+     * display() that draws every frame with a SoftwareRasterizer.
+     * 
+     * @remark Frames of a windowed run are uploaded to an UploadFramebuffer 
+     * and blitted to the window; a headless run makes no OpenGL calls.
+    */
+    void displaySoftware();
+
+    /**
+     * @brief Creates the job system and, for a thread sweep, lists the 
+     * thread counts to step through.
+     * 
+     * @return std::vector<std::size_t> Thread counts of the sweep, empty 
+     * without a sweep.
+    */
+    std::vector<std::size_t> startJobs();
+
+    /**
+     * @brief Creates the asset loader, with an upload context that shares 
+     * objects with the render context unless that is disabled or fails.
+     * 
+     * @remark A windowed run shares with a hidden GLFW window, a headless 
+     * run with a second EGL context.
+    */
+    void startAssetLoader();
+
+    /**
+     * @brief Creates the frame pacer and the input queue, sets the swap 
+     * interval of the window and starts synthetic input if requested.
+    */
+    void startPacing();
+
+    /**
+     * @brief Creates the scaled render target and the resolution controller
+     * if the settings ask for a render scale or a GPU budget. Windowed 
+     * on-demand runs get a full scale target without a controller.
+     * 
+     * @throws std::logic_error if the render target is not complete.
+    */
+    void startResolution();
+
+    /**
+     * @brief Binds the scaled render target at the scale of the next frame, 
+     * following the size of the window. Disables the scissor test when 
+     * the target is recreated.
+    */
+    void bindSceneTarget();
+
+    /**
+     * @brief Upsamples the frame to the window, or to the offscreen 
+     * framebuffer of a headless run.
+    */
+    void presentSceneTarget();
+
+    /**
+     * @brief Starts the readback of the presented frame if frames are 
+     * captured.
+     * 
+     * @param frames Number of frames drawn so far, which names the file.
+    */
+    void captureFrame(std::size_t frames);
+
+    /**
+     * @brief Writes the frames still in flight and prints the totals of 
+     * the capture.
+    */
+    void reportCapture() const;
+
+    /**
+     * @brief Decides whether an on-demand run needs to draw the next frame 
+     * and which part of the view it has to redraw.
+     * 
+     * @param scene The scene to ask for its damage.
+     * @param frames Number of frames drawn so far.
+     * @param damage Set to the area to redraw. The target drawn into keeps 
+     * the last frame, so nothing older has to be redrawn.
+     * @return bool true if a frame has to be drawn.
+    */
+    bool findDamage(const Scene& scene, std::size_t frames, DamageRect& damage);
+
+    /**
+     * @brief Limits drawing to the damaged area with a scissor rectangle.
+     * 
+     * @param damage The area to redraw.
+     * @return bool true if the scissor test was enabled, false if the whole 
+     * view is redrawn.
+    */
+    bool setScissor(const DamageRect& damage);
+
+    /**
+     * @brief Getter for the size of the framebuffer in pixels, the window's 
+     * or that of a headless run.
+    */
+    void getFramebufferSize(int& width, int& height) const;
+
+    /**
+     * @brief Writes the Frame block of this frame into the uniform ring.
+     * 
+     * @param frames Number of frames drawn so far.
+     * @param seconds Time since the loop started.
+     * @return UniformAllocation The range of the block, bound to 
+     * FRAME_UNIFORM_BINDING once the state cache has been reset.
+    */
+    UniformAllocation writeFrameUniforms(std::size_t frames, double seconds);
+
+    /**
+     * @brief Blocks until an event arrives or IDLE_WAIT_SECONDS have passed.
+    */
+    void waitForEvents();
+
+    /**
+     * @brief Switches the job system to the thread count of a sweep step 
+     * when a new step begins.
+     * 
+     * @param steps Thread counts of the sweep.
+     * @param frames Number of frames rendered so far.
+    */
+    void stepThreadSweep(const std::vector<std::size_t>& steps, 
+                         std::size_t frames);
+
+    /**
+     * @brief Fills in the frame limit of a run that was given none and 
+     * creates the profiler.
+     * 
+     * @param sceneLimit Frames the scene asks for (0 = no limit).
+     * @param steps Thread counts of a sweep, which sets its own limit.
+     * @param gpuTiming Time the phases with OpenGL queries too.
+    */
+    void startProfiler(std::size_t sceneLimit, 
+                       const std::vector<std::size_t>& steps, bool gpuTiming);
+
+    /**
+     * @brief Checks whether the display loop should end.
+     * 
+     * @param frames Number of frames rendered so far.
+     * @param seconds Seconds elapsed since the first frame.
+     * @return bool true if the window was closed or a run limit is reached.
+    */
+    bool shouldClose(std::size_t frames, double seconds) const;
+
+    /**
+     * @brief Presents the finished frame, either by swapping the window 
+     * buffers or by flushing the offscreen frame.
+    */
+    void swapBuffers();
+
+    /**
+     * @brief Processes pending window events, and delivers synthetic input 
+     * events. Polls no window in headless mode.
+    */
+    void pollEvents();
+
+    /**
+     * @brief Prints the frame rate and frame time percentiles of a run and 
+     * writes the timings to the file given in the settings.
+     * 
+     * @param frames Number of frames rendered.
+     * @param seconds Seconds the display loop ran.
+     * @param setupMs Milliseconds spent creating the scene.
+    */
+    void reportRun(std::size_t frames, double seconds, double setupMs) const;
+
+    /**
+     * @brief Prints the median draw phase and frame time of every step of a 
+     * thread sweep and its speedup over one thread. Runs that count their 
+     * triangles also get the triangle rate of the draw phase.
+     * 
+     * @param steps Thread counts of the sweep, THREAD_SWEEP_FRAMES frames 
+     * each.
+    */
+    void reportThreadSweep(const std::vector<std::size_t>& steps) const;
+
     /**
      * @brief Resizes the OpenGL drawing context (viewport) 
      * 
@@ -188,9 +473,23 @@ private:
                                      int new_height) 
     {
         glViewport(0, 0, new_width, new_height);
-        
+        viewDamaged_ = true;
     } 
 
+    /**
+     * @brief Queues a key event with the time it arrived.
+     * 
+     * @param window Pointer to the GLFW window.
+     * @param key GLFW key code.
+     * @param scancode Platform scancode of the key.
+     * @param action GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT.
+     * @param mods Modifier bits.
+     * 
+     * @note This function is called by glfwPollEvents.
+    */
+    static void key_callback(GLFWwindow* window, int key, int scancode, 
+                             int action, int mods);
+
     /**
      * @var My_GLFW_Window_Manager::initialization_success
      * @brief Flag indicating whether GLFW and window initialization was 
@@ -198,6 +497,121 @@ private:
     */
     static bool initialization_success_;
 
+    /**
+     * @var My_GLFW_Window_Manager::settings
+     * @brief Options given on construction.
+    */
+    static RenderSettings settings_;
+
+    /**
+     * @var My_GLFW_Window_Manager::headless
+     * @brief Windowless context, only created in headless mode.
+    */
+    static std::unique_ptr<HeadlessContext> headless_;
+
+    /**
+     * @var My_GLFW_Window_Manager::profiler
+     * @brief CPU and GPU timings of the display loop.
+    */
+    static std::unique_ptr<FrameProfiler> profiler_;
+
+    /**
+     * @var My_GLFW_Window_Manager::jobs
+     * @brief Worker threads that prepare the frames of the scene.
+    */
+    static std::unique_ptr<JobSystem> jobs_;
+
+    /**
+     * @var My_GLFW_Window_Manager::programCache
+     * @brief On-disk cache of linked shader programs.
+    */
+    static std::unique_ptr<ProgramCache> programCache_;
+
+    /**
+     * @var My_GLFW_Window_Manager::shaderPipeline
+     * @brief Builds shader programs while the first frames are drawn.
+    */
+    static std::unique_ptr<ShaderPipeline> shaderPipeline_;
+
+    /**
+     * @var My_GLFW_Window_Manager::assetLoader
+     * @brief Reads and uploads meshes and textures in the background.
+    */
+    static std::unique_ptr<AssetLoader> assetLoader_;
+
+    /**
+     * @var My_GLFW_Window_Manager::uploadWindow
+     * @brief Hidden window whose context the asset uploads run on, only 
+     * created in windowed mode.
+    */
+    static std::shared_ptr<GLFWwindow> uploadWindow_;
+
+    /**
+     * @var My_GLFW_Window_Manager::framePacer
+     * @brief Spaces the frames of the display loop.
+    */
+    static std::unique_ptr<FramePacer> framePacer_;
+
+    /**
+     * @var My_GLFW_Window_Manager::inputQueue
+     * @brief Timestamped input events and their input-to-present latency.
+    */
+    static std::unique_ptr<InputQueue> inputQueue_;
+
+    /**
+     * @var My_GLFW_Window_Manager::uniformRing
+     * @brief Ring of uniform blocks written every frame, the Frame block 
+     * and the blocks of the scene's draws.
+    */
+    static std::unique_ptr<UniformRing> uniformRing_;
+
+    /**
+     * @var My_GLFW_Window_Manager::sceneTarget
+     * @brief Target the scene is drawn into at the render scale, only 
+     * created with dynamic resolution, or to keep the last frame of a 
+     * windowed on-demand run.
+    */
+    static std::unique_ptr<ScaledFramebuffer> sceneTarget_;
+
+    /**
+     * @var My_GLFW_Window_Manager::resolution
+     * @brief Picks the render scale of every frame, only created with 
+     * dynamic resolution.
+    */
+    static std::unique_ptr<ResolutionController> resolution_;
+
+    /**
+     * @var My_GLFW_Window_Manager::frameCapture
+     * @brief Writes the presented frames to disk, only created when a 
+     * capture directory is given.
+    */
+    static std::unique_ptr<FrameCapture> frameCapture_;
+
+    /**
+     * @var My_GLFW_Window_Manager::viewDamaged
+     * @brief Set by the resize and key callbacks; the next on-demand frame 
+     * redraws the whole view.
+    */
+    static bool viewDamaged_;
+
+    /**
+     * @var My_GLFW_Window_Manager::onDemandStats
+     * @brief Totals of an on-demand run.
+    */
+    static OnDemandStats onDemandStats_;
+
+    /**
+     * @var My_GLFW_Window_Manager::renderQueue
+     * @brief Collects, sorts and issues the draws of a frame.
+    */
+    static RenderQueue renderQueue_;
+
+    /**
+     * @var My_GLFW_Window_Manager::stateCache
+     * @brief Skips redundant binds while the queue is issued.
+    */
+    static GLStateCache stateCache_;
+
     /**
      * @var My_GLFW_Window_Manager::window
      * @brief Pointer to the GLFW window.
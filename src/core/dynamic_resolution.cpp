@@ -0,0 +1,77 @@
+#include "dynamic_resolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+/**
+* @section Constructor
+*/
+
+ResolutionController::ResolutionController(double budgetMs, float scale,
+                                           float minScale)
+    : budgetMs_{ std::max( budgetMs, 0.0 ) },
+      scale_{ std::min( std::max( scale, minScale ), 1.0f ) },
+      minScale_{ std::min( minScale, 1.0f ) }, history_{}, newestFrame_{ 0 },
+      measured_{ false }, measuredFrame_{ 0 }, timed_{ 0 }, misses_{ 0 },
+      changes_{ 0 }, frames_{ 0 }, scaleSum_{ 0.0 }, lowest_{ scale_ },
+      highest_{ scale_ }
+{
+    history_.fill( scale_ );
+}
+
+/**
+* @section Member functions
+*/
+
+void ResolutionController::beginFrame(std::size_t frame)
+{
+    history_[frame % HISTORY] = scale_;
+    newestFrame_ = frame;
+    ++frames_;
+    scaleSum_ += scale_;
+    lowest_ = std::min( lowest_, scale_ );
+    highest_ = std::max( highest_, scale_ );
+}
+
+void ResolutionController::addGpuTime(std::size_t frame, double milliseconds)
+{
+    // The profiler reports its newest frame until a newer one is read
+    if ( ( measured_ && frame <= measuredFrame_ ) || frame > newestFrame_ ||
+         newestFrame_ - frame >= HISTORY )
+    {
+        return;
+    }
+    measured_ = true;
+    measuredFrame_ = frame;
+    ++timed_;
+    if ( budgetMs_ <= 0.0 )
+    {
+        return;
+    }
+    misses_ += milliseconds > budgetMs_ ? 1 : 0;
+    if ( milliseconds <= 0.0 )
+    {
+        return;
+    }
+
+    // Time per pixel of that frame, scaled to the pixels that fill the
+    // budget with headroom
+    const float frameScale = history_[frame % HISTORY];
+    const float fitting = static_cast<float>(
+                frameScale * std::sqrt( HEADROOM * budgetMs_ / milliseconds ) );
+    float scale = scale_;
+    if ( milliseconds > budgetMs_ )
+    {
+        // Frames in flight at the old scale all ask for the same drop
+        scale = std::min( scale_, fitting );
+    }
+    else if ( fitting > scale_ )
+    {
+        scale = std::min( scale_ + RAISE_STEP, fitting );
+    }
+    scale = std::min( std::max( scale, minScale_ ), 1.0f );
+    if ( scale != scale_ )
+    {
+        scale_ = scale;
+        ++changes_;
+    }
+}
@@ -0,0 +1,209 @@
+#include "frame_pacing.hpp"
+#include <algorithm>
+
+/**
+* @section Helper functions
+*/
+
+bool parsePacingMode(const std::string& name, PacingMode& mode)
+{
+    if ( name == "vsync" )
+    {
+        mode = PacingMode::Vsync;
+    }
+    else if ( name == "off" )
+    {
+        mode = PacingMode::Uncapped;
+    }
+    else if ( name == "limit" )
+    {
+        mode = PacingMode::Limited;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+* @section FramePacer
+*/
+
+FramePacer::FramePacer(PacingMode mode, double rate)
+    : mode_{ mode }, period_{ std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>( 1.0 / std::max( rate, 1e-3 ) ) ) },
+      deadline_{}, started_{ false }, sleepMs_{ 0.0 }, spinMs_{ 0.0 }, missed_{ 0 },
+      maxOvershootMs_{ 0.0 }
+{
+}
+
+void FramePacer::wait()
+{
+    if ( mode_ != PacingMode::Limited )
+    {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    // The first frame starts at once and sets the cadence
+    if ( !started_ )
+    {
+        started_ = true;
+        deadline_ = now + period_;
+        return;
+    }
+    // Catching up on a whole missed period would only bunch up frames
+    if ( now >= deadline_ + period_ )
+    {
+        ++missed_;
+        deadline_ = now + period_;
+        return;
+    }
+    // Sleeps wake up late by up to a scheduler tick, so stop short of the
+    // deadline and spin for the rest
+    const Clock::time_point wake = deadline_ - SPIN_MARGIN;
+    if ( now < wake )
+    {
+        std::this_thread::sleep_for( wake - now );
+        const Clock::time_point slept = Clock::now();
+        sleepMs_ += std::chrono::duration<double, std::milli>( slept - now ).count();
+        now = slept;
+    }
+    const Clock::time_point spinStart = now;
+    while ( now < deadline_ )
+    {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    spinMs_ += std::chrono::duration<double, std::milli>( now - spinStart ).count();
+    maxOvershootMs_ = std::max( maxOvershootMs_,
+                std::chrono::duration<double, std::milli>( now - deadline_ ).count() );
+    deadline_ += period_;
+}
+
+const char* FramePacer::getModeName() const
+{
+    switch ( mode_ )
+    {
+        case PacingMode::Vsync:    return "vsync";
+        case PacingMode::Uncapped: return "uncapped";
+        case PacingMode::Limited:  return "limited";
+        default:                   return "unknown";
+    }
+}
+
+/**
+* @section InputQueue
+*/
+
+InputQueue::InputQueue()
+    : presented_{ 0 }, stopping_{ false }
+{
+}
+
+InputQueue::~InputQueue()
+{
+    stopping_ = true;
+    if ( synthetic_.joinable() )
+    {
+        synthetic_.join();
+    }
+}
+
+void InputQueue::push(const InputEvent& event)
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        queued_.push_back( event );
+    }
+    arrived_.notify_all();
+}
+
+void InputQueue::startSynthetic(double rate, std::function<void()> wake)
+{
+    if ( rate <= 0.0 || synthetic_.joinable() )
+    {
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>( 1.0 / rate ) );
+    synthetic_ = std::thread( [this, period, wake]()
+    {
+        // Ticks keep their spacing even if a push has to wait for the lock
+        Clock::time_point next = Clock::now() + period;
+        while ( !stopping_ )
+        {
+            std::this_thread::sleep_until( next );
+            next += period;
+            const InputEvent event{ SYNTHETIC_KEY, 1, Clock::now() };
+            {
+                std::lock_guard<std::mutex> lock( mutex_ );
+                pending_.push_back( event );
+            }
+            arrived_.notify_all();
+            if ( wake )
+            {
+                wake();
+            }
+        }
+    } );
+}
+
+bool InputQueue::waitForEvents(double seconds)
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return arrived_.wait_for( lock, std::chrono::duration<double>( seconds ), [this]()
+    {
+        return !queued_.empty() || !pending_.empty();
+    } );
+}
+
+bool InputQueue::hasEvents()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return !queued_.empty();
+}
+
+void InputQueue::deliver()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    queued_.insert( queued_.end(), pending_.begin(), pending_.end() );
+    pending_.clear();
+}
+
+const std::vector<InputEvent>& InputQueue::take()
+{
+    taken_.clear();
+    std::lock_guard<std::mutex> lock( mutex_ );
+    taken_.swap( queued_ );
+    return taken_;
+}
+
+void InputQueue::present(FrameProfiler& profiler)
+{
+    if ( taken_.empty() )
+    {
+        return;
+    }
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::uint64_t totalUs{ 0 };
+    for ( const InputEvent& event : taken_ )
+    {
+        const std::chrono::duration<double, std::milli> latency = now - event.time;
+        if ( latencies_.size() < MAX_LATENCY_SAMPLES )
+        {
+            latencies_.push_back( latency.count() );
+        }
+        totalUs += static_cast<std::uint64_t>( latency.count() * 1000.0 );
+    }
+    presented_ += taken_.size();
+    profiler.addCounter( FrameCounter::InputEvents, taken_.size() );
+    profiler.addCounter( FrameCounter::InputLatencyUs, totalUs );
+    taken_.clear();
+}
+
+FrameTimeSummary InputQueue::getLatencySummary() const
+{
+    return summarizeTimes( latencies_ );
+}
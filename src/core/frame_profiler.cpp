@@ -0,0 +1,424 @@
+#include "frame_profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <utility>
+
+/**
+* @section Helper functions
+*/
+
+const char* getPhaseName(FramePhase phase)
+{
+    switch ( phase )
+    {
+        case FramePhase::Pace:  return "pace";
+        case FramePhase::Input: return "input";
+        case FramePhase::Clear: return "clear";
+        case FramePhase::Draw:  return "draw";
+        case FramePhase::Capture: return "capture";
+        case FramePhase::Swap:  return "swap";
+        case FramePhase::Poll:  return "poll";
+        default:                return "unknown";
+    }
+}
+
+const char* getCounterName(FrameCounter counter)
+{
+    switch ( counter )
+    {
+        case FrameCounter::BytesStreamed:    return "bytes_streamed";
+        case FrameCounter::DrawCalls:        return "draw_calls";
+        case FrameCounter::BindsIssued:      return "binds_issued";
+        case FrameCounter::BindsElided:      return "binds_elided";
+        case FrameCounter::VisibleInstances: return "visible_instances";
+        case FrameCounter::Triangles:        return "triangles";
+        case FrameCounter::TextureBinds:     return "texture_binds";
+        case FrameCounter::InputEvents:      return "input_events";
+        case FrameCounter::InputLatencyUs:   return "input_latency_us";
+        case FrameCounter::UniformBytes:     return "uniform_bytes";
+        case FrameCounter::OccludedInstances: return "occluded_instances";
+        case FrameCounter::RenderScalePercent: return "render_scale_percent";
+        default:                             return "unknown";
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    // Nearest-rank percentile of an ascending list
+    std::size_t rank = static_cast<std::size_t>( 
+                            std::ceil( fraction * sorted.size() ) );
+    rank = std::min( std::max<std::size_t>( rank, 1 ), sorted.size() );
+    return sorted[rank - 1];
+}
+
+FrameTimeSummary summarizeTimes(std::vector<double> times)
+{
+    FrameTimeSummary summary;
+    if ( times.empty() )
+    {
+        return summary;
+    }
+    std::sort( times.begin(), times.end() );
+    summary.samples = times.size();
+    summary.p50 = percentile( times, 0.50 );
+    summary.p95 = percentile( times, 0.95 );
+    summary.p99 = percentile( times, 0.99 );
+    summary.max = times.back();
+    return summary;
+}
+
+/**
+* @section Constructor & Destructor
+*/
+
+FrameProfiler::FrameProfiler(std::size_t capacity, bool gpuTiming)
+    : samples_( std::max<std::size_t>( capacity, 1 ) ), gpuTiming_{ gpuTiming },
+      queries_{}, queryFrames_{}, queryStart_{}, queryIssued_{}, 
+      queryPending_{}, counterTotals_{}, latestGpuValid_{ false }, 
+      latestGpuFrame_{ 0 }, latestGpuMs_{ 0.0 }, frame_{ 0 }
+{
+    if ( !gpuTiming_ )
+    {
+        return;
+    }
+    for ( auto& slot : queries_ )
+    {
+        glGenQueries( static_cast<GLsizei>( slot.size() ), slot.data() );
+    }
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    if ( !gpuTiming_ )
+    {
+        return;
+    }
+    for ( auto& slot : queries_ )
+    {
+        glDeleteQueries( static_cast<GLsizei>( slot.size() ), slot.data() );
+    }
+}
+
+/**
+* @section Timing Member functions
+*/
+
+void FrameProfiler::beginFrame()
+{
+    // The slot of this frame last held the queries from QUERY_LATENCY frames
+    // ago, whose results should be available by now
+    const std::size_t slot = frame_ % QUERY_LATENCY;
+    if ( queryPending_[slot] )
+    {
+        readQueries( slot, false );
+    }
+    queryFrames_[slot] = frame_;
+    queryIssued_[slot].fill( false );
+
+    // Start a fresh sample, overwriting the oldest one
+    FrameSample& sample = samples_[frame_ % samples_.size()];
+    sample = FrameSample{};
+    sample.frame = frame_;
+    frameStart_ = Clock::now();
+    queryStart_[slot] = frameStart_;
+}
+
+void FrameProfiler::endFrame()
+{
+    FrameSample& sample = samples_[frame_ % samples_.size()];
+    sample.cpuFrame = std::chrono::duration<double, std::milli>( 
+                                    Clock::now() - frameStart_ ).count();
+    queryPending_[frame_ % QUERY_LATENCY] = true;
+    ++frame_;
+}
+
+void FrameProfiler::beginPhase(FramePhase phase)
+{
+    const std::size_t index = static_cast<std::size_t>( phase );
+    if ( gpuTiming_ )
+    {
+        const std::size_t slot = frame_ % QUERY_LATENCY;
+        glBeginQuery( GL_TIME_ELAPSED, queries_[slot][index] );
+        queryIssued_[slot][index] = true;
+    }
+    phaseStart_[index] = Clock::now();
+}
+
+void FrameProfiler::endPhase(FramePhase phase)
+{
+    const std::size_t index = static_cast<std::size_t>( phase );
+    FrameSample& sample = samples_[frame_ % samples_.size()];
+    sample.cpuPhases[index] += std::chrono::duration<double, std::milli>( 
+                                    Clock::now() - phaseStart_[index] ).count();
+    if ( gpuTiming_ )
+    {
+        glEndQuery( GL_TIME_ELAPSED );
+    }
+}
+
+void FrameProfiler::addCounter(FrameCounter counter, std::uint64_t value)
+{
+    const std::size_t index = static_cast<std::size_t>( counter );
+    samples_[frame_ % samples_.size()].counters[index] += value;
+    counterTotals_[index] += value;
+}
+
+void FrameProfiler::collect()
+{
+    for ( std::size_t slot = 0; slot < QUERY_LATENCY; ++slot )
+    {
+        if ( queryPending_[slot] )
+        {
+            readQueries( slot, true );
+        }
+    }
+}
+
+void FrameProfiler::readQueries(std::size_t slot, bool wait)
+{
+    queryPending_[slot] = false;
+    const std::size_t frame = queryFrames_[slot];
+    FrameSample& sample = samples_[frame % samples_.size()];
+    // The sample may already have been replaced by a newer frame
+    if ( sample.frame != frame )
+    {
+        return;
+    }
+
+    // Queries complete in order, so the last issued one decides for all
+    GLuint last{ 0 };
+    for ( std::size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase )
+    {
+        if ( queryIssued_[slot][phase] )
+        {
+            last = queries_[slot][phase];
+        }
+    }
+    if ( last == 0 )
+    {
+        return;
+    }
+    if ( !wait )
+    {
+        GLint available{ 0 };
+        glGetQueryObjectiv( last, GL_QUERY_RESULT_AVAILABLE, &available );
+        // Never stall the pipeline: a late result is dropped instead
+        if ( !available )
+        {
+            return;
+        }
+    }
+
+    sample.gpuFrame = 0.0;
+    for ( std::size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase )
+    {
+        if ( !queryIssued_[slot][phase] )
+        {
+            continue;
+        }
+        GLuint64 nanoseconds{ 0 };
+        glGetQueryObjectui64v( queries_[slot][phase], GL_QUERY_RESULT, 
+                               &nanoseconds );
+        sample.gpuPhases[phase] = nanoseconds * 1e-6;
+        sample.gpuFrame += sample.gpuPhases[phase];
+    }
+    // GPU work cannot take longer than the wall time since it was issued;
+    // some drivers report garbage for the very first queries of a context
+    const double elapsed = std::chrono::duration<double, std::milli>( 
+                                    Clock::now() - queryStart_[slot] ).count();
+    sample.gpuValid = sample.gpuFrame <= elapsed;
+    if ( sample.gpuValid && ( !latestGpuValid_ || frame > latestGpuFrame_ ) )
+    {
+        latestGpuValid_ = true;
+        latestGpuFrame_ = frame;
+        latestGpuMs_ = sample.gpuFrame;
+    }
+}
+
+bool FrameProfiler::getLatestGpuFrame(std::size_t& frame, double& milliseconds) const
+{
+    frame = latestGpuFrame_;
+    milliseconds = latestGpuMs_;
+    return latestGpuValid_;
+}
+
+/**
+* @section Statistics Member functions
+*/
+
+std::vector<FrameSample> FrameProfiler::getSamples() const
+{
+    std::vector<FrameSample> samples;
+    const std::size_t count = std::min( frame_, samples_.size() );
+    samples.reserve( count );
+    for ( std::size_t frame = frame_ - count; frame < frame_; ++frame )
+    {
+        samples.push_back( samples_[frame % samples_.size()] );
+    }
+    return samples;
+}
+
+FrameTimeSummary FrameProfiler::getCpuSummary() const
+{
+    return summarize( false );
+}
+
+FrameTimeSummary FrameProfiler::getGpuSummary() const
+{
+    return summarize( true );
+}
+
+FrameTimeSummary FrameProfiler::summarize(bool gpu) const
+{
+    std::vector<double> times;
+    for ( const FrameSample& sample : getSamples() )
+    {
+        if ( !gpu )
+        {
+            times.push_back( sample.cpuFrame );
+        }
+        else if ( sample.gpuValid )
+        {
+            times.push_back( sample.gpuFrame );
+        }
+    }
+    return summarizeTimes( std::move( times ) );
+}
+
+/**
+* @section Output Member functions
+*/
+
+bool FrameProfiler::writeFile(const std::string& path) const
+{
+    const std::string extension{ ".csv" };
+    const bool csv = path.size() >= extension.size() && 
+        path.compare( path.size() - extension.size(), extension.size(), 
+                      extension ) == 0;
+    return csv ? writeCsv( path ) : writeJson( path );
+}
+
+bool FrameProfiler::writeCsv(const std::string& path) const
+{
+    std::ofstream file( path );
+    if ( !file )
+    {
+        return false;
+    }
+    // Header row: one CPU and one GPU column per phase
+    file << "frame,cpu_frame_ms,gpu_frame_ms";
+    for ( std::size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase )
+    {
+        file << ",cpu_" << getPhaseName( static_cast<FramePhase>( phase ) ) 
+             << "_ms";
+    }
+    for ( std::size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase )
+    {
+        file << ",gpu_" << getPhaseName( static_cast<FramePhase>( phase ) ) 
+             << "_ms";
+    }
+    for ( std::size_t counter = 0; counter < FRAME_COUNTER_COUNT; ++counter )
+    {
+        file << ',' << getCounterName( static_cast<FrameCounter>( counter ) );
+    }
+    file << '\n';
+
+    // One row per frame, GPU columns stay empty when no result was read
+    for ( const FrameSample& sample : getSamples() )
+    {
+        file << sample.frame << ',' << sample.cpuFrame << ',';
+        if ( sample.gpuValid )
+        {
+            file << sample.gpuFrame;
+        }
+        for ( double time : sample.cpuPhases )
+        {
+            file << ',' << time;
+        }
+        for ( double time : sample.gpuPhases )
+        {
+            file << ',';
+            if ( sample.gpuValid )
+            {
+                file << time;
+            }
+        }
+        for ( std::uint64_t value : sample.counters )
+        {
+            file << ',' << value;
+        }
+        file << '\n';
+    }
+    return static_cast<bool>( file );
+}
+
+static void writeJsonSummary(std::ofstream& file, const char* name, 
+                             const FrameTimeSummary& summary)
+{
+    file << "    \"" << name << "\": { \"samples\": " << summary.samples 
+         << ", \"p50_ms\": " << summary.p50 << ", \"p95_ms\": " << summary.p95 
+         << ", \"p99_ms\": " << summary.p99 << ", \"max_ms\": " << summary.max 
+         << " }";
+}
+
+static void writeJsonPhases(std::ofstream& file, 
+                            const std::array<double, FRAME_PHASE_COUNT>& times)
+{
+    file << '{';
+    for ( std::size_t phase = 0; phase < FRAME_PHASE_COUNT; ++phase )
+    {
+        file << ( phase ? ", \"" : "\"" ) 
+             << getPhaseName( static_cast<FramePhase>( phase ) ) << "\": " 
+             << times[phase];
+    }
+    file << '}';
+}
+
+static void writeJsonCounters(std::ofstream& file, 
+                    const std::array<std::uint64_t, FRAME_COUNTER_COUNT>& values)
+{
+    file << '{';
+    for ( std::size_t counter = 0; counter < FRAME_COUNTER_COUNT; ++counter )
+    {
+        file << ( counter ? ", \"" : "\"" ) 
+             << getCounterName( static_cast<FrameCounter>( counter ) ) << "\": " 
+             << values[counter];
+    }
+    file << '}';
+}
+
+bool FrameProfiler::writeJson(const std::string& path) const
+{
+    std::ofstream file( path );
+    if ( !file )
+    {
+        return false;
+    }
+    file << "{\n  \"frames\": " << frame_ << ",\n  \"summary\": {\n";
+    writeJsonSummary( file, "cpu", getCpuSummary() );
+    file << ",\n";
+    writeJsonSummary( file, "gpu", getGpuSummary() );
+    file << "\n  },\n  \"counter_totals\": ";
+    writeJsonCounters( file, counterTotals_ );
+    file << ",\n  \"samples\": [";
+
+    const std::vector<FrameSample> samples = getSamples();
+    for ( std::size_t i = 0; i < samples.size(); ++i )
+    {
+        const FrameSample& sample = samples[i];
+        file << ( i ? ",\n" : "\n" ) << "    { \"frame\": " << sample.frame 
+             << ", \"cpu_ms\": " << sample.cpuFrame << ", \"cpu_phases\": ";
+        writeJsonPhases( file, sample.cpuPhases );
+        if ( sample.gpuValid )
+        {
+            file << ", \"gpu_ms\": " << sample.gpuFrame << ", \"gpu_phases\": ";
+            writeJsonPhases( file, sample.gpuPhases );
+        }
+        file << ", \"counters\": ";
+        writeJsonCounters( file, sample.counters );
+        file << " }";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>( file );
+}
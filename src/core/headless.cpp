@@ -0,0 +1,264 @@
+#include "headless.hpp"
+#include <cstring>
+
+// Without EGL the build has no headless mode, and every context fails
+#ifdef HELLO_TRIANGLE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/**
+* @section Helper functions
+*/
+
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if ( !extensions )
+    {
+        return false;
+    }
+    // Extension strings are space separated, so match whole words only
+    const std::size_t length = std::strlen( name );
+    for ( const char* start = std::strstr( extensions, name ); start; 
+          start = std::strstr( start + length, name ) )
+    {
+        const bool wordStart = start == extensions || start[-1] == ' ';
+        const bool wordEnd = start[length] == ' ' || start[length] == '\0';
+        if ( wordStart && wordEnd )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printEGLError(const char* step)
+{
+    std::printf( "EGL %s failed with error code 0x%x\n", step, eglGetError() );
+}
+
+/**
+* @section Constructor & Destructor
+*/
+
+HeadlessContext::HeadlessContext()
+    : display_{ EGL_NO_DISPLAY }, context_{ EGL_NO_CONTEXT }, config_{ nullptr },
+      sharedContext_{ EGL_NO_CONTEXT }
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    // The framebuffer must be deleted while its context is still current
+    framebuffer_.reset();
+    if ( display_ != EGL_NO_DISPLAY )
+    {
+        eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, 
+                        EGL_NO_CONTEXT );
+        if ( sharedContext_ != EGL_NO_CONTEXT )
+        {
+            eglDestroyContext( display_, sharedContext_ );
+        }
+        if ( context_ != EGL_NO_CONTEXT )
+        {
+            eglDestroyContext( display_, context_ );
+        }
+        eglTerminate( display_ );
+    }
+}
+
+/**
+* @section Setup Member functions
+*/
+
+bool HeadlessContext::createContext()
+{
+    // Prefer the surfaceless platform, which needs neither a display server 
+    // nor a GPU device
+    const char* clientExtensions = eglQueryString( EGL_NO_DISPLAY, 
+                                                   EGL_EXTENSIONS );
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                        eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+    if ( getPlatformDisplay && 
+         hasExtension( clientExtensions, "EGL_MESA_platform_surfaceless" ) )
+    {
+        display_ = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, 
+                                       EGL_DEFAULT_DISPLAY, nullptr );
+    }
+    if ( display_ == EGL_NO_DISPLAY )
+    {
+        display_ = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+    }
+    if ( display_ == EGL_NO_DISPLAY )
+    {
+        std::printf( "EGL found no display to create a context on\n" );
+        return false;
+    }
+
+    EGLint major{ 0 };
+    EGLint minor{ 0 };
+    if ( !eglInitialize( display_, &major, &minor ) )
+    {
+        printEGLError( "initialization" );
+        display_ = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    // Rendering without any surface requires the surfaceless extension
+    const char* extensions = eglQueryString( display_, EGL_EXTENSIONS );
+    if ( !hasExtension( extensions, "EGL_KHR_surfaceless_context" ) )
+    {
+        std::printf( "EGL %d.%d does not support surfaceless contexts\n", 
+                     major, minor );
+        return false;
+    }
+
+    if ( !eglBindAPI( EGL_OPENGL_API ) )
+    {
+        printEGLError( "desktop OpenGL binding" );
+        return false;
+    }
+
+    // Pick any desktop OpenGL config, unless configs are not needed at all
+    EGLConfig config = nullptr;
+    if ( !hasExtension( extensions, "EGL_KHR_no_config_context" ) )
+    {
+        const EGLint configAttributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLint configCount{ 0 };
+        if ( !eglChooseConfig( display_, configAttributes, &config, 1, 
+                               &configCount ) || configCount == 0 )
+        {
+            printEGLError( "config selection" );
+            return false;
+        }
+    }
+
+    // Request the same OpenGL 3.3 core context as the windowed path
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context_ = eglCreateContext( display_, config, EGL_NO_CONTEXT, 
+                                 contextAttributes );
+    config_ = config;
+    if ( context_ == EGL_NO_CONTEXT )
+    {
+        printEGLError( "context creation" );
+        return false;
+    }
+
+    if ( !eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, 
+                          context_ ) )
+    {
+        printEGLError( "context activation" );
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::createSharedContext()
+{
+    // Same version and profile as the main context, sharing its objects
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    sharedContext_ = eglCreateContext( display_, config_, context_, 
+                                       contextAttributes );
+    if ( sharedContext_ == EGL_NO_CONTEXT )
+    {
+        printEGLError( "shared context creation" );
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessContext::makeSharedContextCurrent() const
+{
+    return eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, 
+                           sharedContext_ ) == EGL_TRUE;
+}
+
+void HeadlessContext::releaseCurrentContext() const
+{
+    eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+}
+
+#else
+
+/**
+* @section Constructor & Destructor
+*/
+
+HeadlessContext::HeadlessContext()
+    : display_{ nullptr }, context_{ nullptr }, config_{ nullptr },
+      sharedContext_{ nullptr }
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+}
+
+/**
+* @section Setup Member functions
+*/
+
+bool HeadlessContext::createContext()
+{
+    std::printf( "Headless mode needs EGL, which this build was configured without\n" );
+    return false;
+}
+
+bool HeadlessContext::createSharedContext()
+{
+    return false;
+}
+
+bool HeadlessContext::makeSharedContextCurrent() const
+{
+    return false;
+}
+
+void HeadlessContext::releaseCurrentContext() const
+{
+}
+
+#endif // HELLO_TRIANGLE_EGL
+
+bool HeadlessContext::createFramebuffer(int width, int height)
+{
+    try
+    {
+        framebuffer_ = std::make_unique<Framebuffer>( width, height );
+    }
+    catch( const std::logic_error& except )
+    {
+        std::printf( "%s\n", except.what() );
+        return false;
+    }
+    // All drawing goes into the offscreen framebuffer from now on
+    framebuffer_->bind();
+    return true;
+}
+
+void HeadlessContext::swapBuffers() const
+{
+    glFlush();
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+#ifdef HELLO_TRIANGLE_EGL
+    return reinterpret_cast<void*>( eglGetProcAddress( name ) );
+#else
+    ( void ) name;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,184 @@
+#include "job_system.hpp"
+
+/**
+ * @var workerIndex
+ * @brief Deque of the current thread, set once by each worker thread.
+ */
+static thread_local std::size_t workerIndex{ 0 };
+
+/**
+ * @var workerOwner
+ * @brief The JobSystem the current worker thread belongs to.
+ */
+static thread_local const void* workerOwner{ nullptr };
+
+/**
+* @section Constructor and Destructor
+*/
+
+JobSystem::JobSystem(std::size_t threads)
+    : running_{ false }, queued_{ 0 }, jobsRun_{ 0 }, jobsStolen_{ 0 }
+{
+    start( threads );
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::setThreadCount(std::size_t threads)
+{
+    stop();
+    start( threads );
+}
+
+void JobSystem::start(std::size_t threads)
+{
+    if ( threads == 0 )
+    {
+        threads = std::max<std::size_t>( std::thread::hardware_concurrency(), 1 );
+    }
+    workers_.clear();
+    for ( std::size_t i = 0; i < threads; ++i )
+    {
+        workers_.push_back( std::make_unique<Worker>() );
+    }
+    // Deque 0 belongs to the calling thread, the others get a thread each
+    running_ = true;
+    for ( std::size_t i = 1; i < threads; ++i )
+    {
+        threads_.emplace_back( &JobSystem::workerLoop, this, i );
+    }
+}
+
+void JobSystem::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock( sleepMutex_ );
+        running_ = false;
+    }
+    wake_.notify_all();
+    for ( std::thread& thread : threads_ )
+    {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+/**
+* @section Queueing
+*/
+
+std::size_t JobSystem::currentIndex() const
+{
+    return workerOwner == this ? workerIndex : 0;
+}
+
+void JobSystem::push(Entry entry)
+{
+    entry.counter->pending_.fetch_add( 1, std::memory_order_relaxed );
+    Worker& worker = *workers_[currentIndex()];
+    {
+        std::lock_guard<std::mutex> lock( worker.mutex );
+        worker.jobs.push_back( std::move( entry ) );
+    }
+    queued_.fetch_add( 1, std::memory_order_release );
+}
+
+void JobSystem::wakeWorkers()
+{
+    // Taking the lock orders the queued count before any sleeping check
+    {
+        std::lock_guard<std::mutex> lock( sleepMutex_ );
+    }
+    wake_.notify_all();
+}
+
+void JobSystem::run(Job job, JobCounter& counter)
+{
+    push( { std::move( job ), &counter } );
+    {
+        std::lock_guard<std::mutex> lock( sleepMutex_ );
+    }
+    wake_.notify_one();
+}
+
+/**
+* @section Running
+*/
+
+bool JobSystem::tryRunOne(std::size_t self)
+{
+    Entry entry;
+    bool found = false;
+    bool stolen = false;
+    {
+        // Newest job of the own deque, which is likely still in the cache
+        Worker& own = *workers_[self];
+        std::lock_guard<std::mutex> lock( own.mutex );
+        if ( !own.jobs.empty() )
+        {
+            entry = std::move( own.jobs.back() );
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    for ( std::size_t i = 1; !found && i < workers_.size(); ++i )
+    {
+        // Oldest job of another deque, which is likely the largest
+        Worker& victim = *workers_[( self + i ) % workers_.size()];
+        std::lock_guard<std::mutex> lock( victim.mutex );
+        if ( !victim.jobs.empty() )
+        {
+            entry = std::move( victim.jobs.front() );
+            victim.jobs.pop_front();
+            found = true;
+            stolen = true;
+        }
+    }
+    if ( !found )
+    {
+        return false;
+    }
+    queued_.fetch_sub( 1, std::memory_order_relaxed );
+    entry.job();
+    jobsRun_.fetch_add( 1, std::memory_order_relaxed );
+    if ( stolen )
+    {
+        jobsStolen_.fetch_add( 1, std::memory_order_relaxed );
+    }
+    entry.counter->pending_.fetch_sub( 1, std::memory_order_release );
+    return true;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    const std::size_t self = currentIndex();
+    while ( !counter.isDone() )
+    {
+        if ( !tryRunOne( self ) )
+        {
+            // The last jobs are running elsewhere
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(std::size_t index)
+{
+    workerIndex = index;
+    workerOwner = this;
+    while ( running_ )
+    {
+        if ( tryRunOne( index ) )
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock( sleepMutex_ );
+        wake_.wait( lock, [this]()
+        {
+            return !running_ || queued_.load( std::memory_order_acquire ) > 0;
+        } );
+    }
+}
@@ -4,10 +4,16 @@
 /**
  * @section main
  */
-int main()
+int main(int argc, char** argv)
 {
+    // Read the options from the command line
+    RenderSettings settings;
+    if ( !parseArguments( argc, argv, settings ) )
+    {
+        exit(EXIT_FAILURE);
+    }
     // Create an instance of My_GLFW_Window_Manager
-    My_GLFW_Window_Manager windowManager;
+    My_GLFW_Window_Manager windowManager( settings );
 
     // Check if initialization was successful
     if( !windowManager.getInitialization() )
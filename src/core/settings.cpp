@@ -0,0 +1,418 @@
+#include "settings.hpp"
+#include "frame_capture.hpp"
+#include "frame_pacing.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+* @section Helper functions
+*/
+
+static void printUsage(const char* program)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --headless          render offscreen without a window\n"
+        "  --frames <n>        exit after n frames\n"
+        "  --seconds <s>       exit after s seconds\n"
+        "  --width <pixels>    width of the window or framebuffer\n"
+        "  --height <pixels>   height of the window or framebuffer\n"
+        "  --stats-out <file>  write frame timings to a .json or .csv file\n"
+        "  --backend <b>       renderer: opengl, or software for the CPU\n"
+        "                      rasterizer without any OpenGL\n"
+        "  --scene <name>      scene to render: triangle, instanced, streaming,\n"
+        "                      objects, batch, mesh, culling, model, textured;\n"
+        "                      the software backend draws triangle and\n"
+        "                      terrain\n"
+        "  --mesh-file <path>  mesh file of the model scene\n"
+        "  --texture <path>    binary PPM texture of the model scene\n"
+        "  --sync-load         load the assets of the model scene on setup\n"
+        "  --loader-threads <n> threads reading and decoding asset files\n"
+        "  --no-upload-context upload assets on the render thread\n"
+        "  --instances <n>     number of triangles or meshes of the instanced,\n"
+        "                      streaming, objects, batch and mesh scenes\n"
+        "  --no-sort           issue draws in submission order\n"
+        "  --no-batch          draw each mesh of the batch scene separately\n"
+        "  --no-arena          give every mesh of the objects scene its own\n"
+        "                      buffers instead of a shared arena\n"
+        "  --no-mesh-opt       only deduplicate vertices of the mesh scene\n"
+        "  --vertex-format <f> vertices of the mesh scene: float, packed, split\n"
+        "  --no-cull           draw every instance of the culling scene\n"
+        "  --cull-path <p>     culling kernel: auto, scalar, sse2, avx2\n"
+        "  --no-lod            draw every instance of the culling scene at\n"
+        "                      full detail\n"
+        "  --occlusion <m>     occlusion culling of the culling scene: off, hiz,\n"
+        "                      queries\n"
+        "  --materials <n>     textured materials of the textured scene\n"
+        "  --no-texture-array  give every material its own 2D texture\n"
+        "  --no-pbo            upload textures from client memory\n"
+        "  --texture-uploads <n> material layers uploaded every frame\n"
+        "  --pacing <mode>     frame pacing: vsync, off (uncapped) or limit\n"
+        "  --fps-limit <hz>    frame rate of the limit pacing mode\n"
+        "  --early-input       poll events after the swap instead of right\n"
+        "                      before the next frame is built\n"
+        "  --synthetic-input <hz> push synthetic input events to measure the\n"
+        "                      input-to-present latency without a keyboard\n"
+        "  --on-demand         only draw frames that change something and\n"
+        "                      wait for events in between\n"
+        "  --gpu-budget <ms>   lower the render scale to hold a GPU frame time\n"
+        "  --render-scale <f>  render at a fraction of the window size (1)\n"
+        "  --min-scale <f>     lowest scale under a GPU budget (0.5)\n"
+        "  --capture <dir>     write every frame to a directory\n"
+        "  --capture-format <f> format of captured frames: png, raw (PPM)\n"
+        "  --capture-threads <n> threads encoding captured frames (2)\n"
+        "  --capture-drop      drop frames instead of waiting when every\n"
+        "                      capture buffer is busy\n"
+        "  --shader-cache <dir> directory of the program binary cache\n"
+        "  --no-shader-cache   always compile shaders from source\n"
+        "  --sweep             double the instance count from 1 to n and\n"
+        "                      report the frame time of every count\n"
+        "  --threads <n>       threads preparing frames (0 = all cores)\n"
+        "  --thread-sweep      double the thread count from 1 to n and\n"
+        "                      report the frame time of every count\n"
+        "  --help              print this text\n", program );
+}
+
+static bool readValue(int argc, char** argv, int& index, std::string& value)
+{
+    // Every valued option needs one more argument after it
+    if ( index + 1 >= argc )
+    {
+        std::printf( "Missing value for option %s\n", argv[index] );
+        return false;
+    }
+    value = argv[++index];
+    return true;
+}
+
+static bool readCount(const std::string& option, const std::string& value,
+                      std::size_t& count)
+{
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull( value.c_str(), &end, 10 );
+    if ( value.empty() || *end != '\0' || value[0] == '-' )
+    {
+        std::printf( "Invalid value '%s' for option %s\n", value.c_str(), 
+                     option.c_str() );
+        return false;
+    }
+    count = static_cast<std::size_t>( parsed );
+    return true;
+}
+
+static bool readSeconds(const std::string& option, const std::string& value,
+                        double& seconds)
+{
+    char* end = nullptr;
+    seconds = std::strtod( value.c_str(), &end );
+    if ( value.empty() || *end != '\0' || seconds < 0.0 )
+    {
+        std::printf( "Invalid value '%s' for option %s\n", value.c_str(), 
+                     option.c_str() );
+        return false;
+    }
+    return true;
+}
+
+static bool readRate(const std::string& option, const std::string& value,
+                     double& rate)
+{
+    // Rates divide a second, so they have to be positive
+    if ( !readSeconds( option, value, rate ) || rate <= 0.0 )
+    {
+        std::printf( "Option %s expects a positive rate\n", option.c_str() );
+        return false;
+    }
+    return true;
+}
+
+static bool readScale(const std::string& option, const std::string& value,
+                      float& scale)
+{
+    double parsed{ 0.0 };
+    if ( !readSeconds( option, value, parsed ) || parsed <= 0.0 || parsed > 1.0 )
+    {
+        std::printf( "Option %s expects a scale above 0 and at most 1\n", 
+                     option.c_str() );
+        return false;
+    }
+    scale = static_cast<float>( parsed );
+    return true;
+}
+
+static bool readSize(const std::string& option, const std::string& value,
+                     int& size)
+{
+    std::size_t parsed{ 0 };
+    if ( !readCount( option, value, parsed ) || parsed == 0 || parsed > 16384 )
+    {
+        std::printf( "Option %s expects a size between 1 and 16384\n", 
+                     option.c_str() );
+        return false;
+    }
+    size = static_cast<int>( parsed );
+    return true;
+}
+
+/**
+* @section Argument parsing
+*/
+
+bool parseArguments(int argc, char** argv, RenderSettings& settings)
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string option{ argv[i] };
+        std::string value;
+
+        if ( option == "--help" || option == "-h" )
+        {
+            printUsage( argv[0] );
+            return false;
+        }
+        else if ( option == "--headless" )
+        {
+            settings.headless = true;
+        }
+        else if ( option == "--frames" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.frameLimit ) )
+                return false;
+        }
+        else if ( option == "--seconds" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readSeconds( option, value, settings.timeBudget ) )
+                return false;
+        }
+        else if ( option == "--width" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readSize( option, value, settings.width ) )
+                return false;
+        }
+        else if ( option == "--height" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readSize( option, value, settings.height ) )
+                return false;
+        }
+        else if ( option == "--stats-out" )
+        {
+            if ( !readValue( argc, argv, i, settings.statsOutput ) )
+                return false;
+        }
+        else if ( option == "--backend" )
+        {
+            if ( !readValue( argc, argv, i, settings.backend ) )
+                return false;
+            if ( settings.backend != "opengl" && settings.backend != "software" )
+            {
+                std::printf( "Unknown backend %s\n", settings.backend.c_str() );
+                return false;
+            }
+        }
+        else if ( option == "--scene" )
+        {
+            if ( !readValue( argc, argv, i, settings.scene ) )
+                return false;
+        }
+        else if ( option == "--mesh-file" )
+        {
+            if ( !readValue( argc, argv, i, settings.meshFile ) )
+                return false;
+        }
+        else if ( option == "--texture" )
+        {
+            if ( !readValue( argc, argv, i, settings.textureFile ) )
+                return false;
+        }
+        else if ( option == "--sync-load" )
+        {
+            settings.asyncLoad = false;
+        }
+        else if ( option == "--loader-threads" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.loaderThreads ) )
+                return false;
+        }
+        else if ( option == "--no-upload-context" )
+        {
+            settings.uploadContext = false;
+        }
+        else if ( option == "--instances" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.instances ) )
+                return false;
+        }
+        else if ( option == "--shader-cache" )
+        {
+            if ( !readValue( argc, argv, i, settings.shaderCache ) )
+                return false;
+        }
+        else if ( option == "--no-shader-cache" )
+        {
+            settings.shaderCache.clear();
+        }
+        else if ( option == "--no-sort" )
+        {
+            settings.sortQueue = false;
+        }
+        else if ( option == "--no-batch" )
+        {
+            settings.batch = false;
+        }
+        else if ( option == "--no-arena" )
+        {
+            settings.useArena = false;
+        }
+        else if ( option == "--no-mesh-opt" )
+        {
+            settings.optimizeMeshes = false;
+        }
+        else if ( option == "--vertex-format" )
+        {
+            if ( !readValue( argc, argv, i, settings.vertexFormat ) )
+                return false;
+        }
+        else if ( option == "--no-cull" )
+        {
+            settings.cull = false;
+        }
+        else if ( option == "--no-lod" )
+        {
+            settings.lod = false;
+        }
+        else if ( option == "--cull-path" )
+        {
+            if ( !readValue( argc, argv, i, settings.cullPath ) )
+                return false;
+        }
+        else if ( option == "--occlusion" )
+        {
+            if ( !readValue( argc, argv, i, settings.occlusion ) )
+                return false;
+        }
+        else if ( option == "--materials" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.materials ) )
+                return false;
+        }
+        else if ( option == "--no-texture-array" )
+        {
+            settings.textureArray = false;
+        }
+        else if ( option == "--no-pbo" )
+        {
+            settings.pixelBuffers = false;
+        }
+        else if ( option == "--texture-uploads" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.textureUploads ) )
+                return false;
+        }
+        else if ( option == "--pacing" )
+        {
+            if ( !readValue( argc, argv, i, settings.pacing ) )
+                return false;
+            PacingMode mode;
+            if ( !parsePacingMode( settings.pacing, mode ) )
+            {
+                std::printf( "Unknown pacing mode %s\n", settings.pacing.c_str() );
+                return false;
+            }
+        }
+        else if ( option == "--fps-limit" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readRate( option, value, settings.fpsLimit ) )
+                return false;
+        }
+        else if ( option == "--early-input" )
+        {
+            settings.lateInput = false;
+        }
+        else if ( option == "--synthetic-input" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readRate( option, value, settings.syntheticInput ) )
+                return false;
+        }
+        else if ( option == "--on-demand" )
+        {
+            settings.onDemand = true;
+        }
+        else if ( option == "--gpu-budget" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readSeconds( option, value, settings.gpuBudget ) )
+                return false;
+        }
+        else if ( option == "--render-scale" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readScale( option, value, settings.renderScale ) )
+                return false;
+        }
+        else if ( option == "--capture" )
+        {
+            if ( !readValue( argc, argv, i, settings.capture ) )
+                return false;
+        }
+        else if ( option == "--capture-format" )
+        {
+            if ( !readValue( argc, argv, i, settings.captureFormat ) )
+                return false;
+            CaptureFormat format;
+            if ( !parseCaptureFormat( settings.captureFormat, format ) )
+            {
+                std::printf( "Unknown capture format %s\n", 
+                             settings.captureFormat.c_str() );
+                return false;
+            }
+        }
+        else if ( option == "--capture-threads" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.captureThreads ) )
+                return false;
+        }
+        else if ( option == "--capture-drop" )
+        {
+            settings.captureDrop = true;
+        }
+        else if ( option == "--min-scale" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readScale( option, value, settings.minScale ) )
+                return false;
+        }
+        else if ( option == "--sweep" )
+        {
+            settings.sweep = true;
+        }
+        else if ( option == "--threads" )
+        {
+            if ( !readValue( argc, argv, i, value ) ||
+                 !readCount( option, value, settings.threads ) )
+                return false;
+        }
+        else if ( option == "--thread-sweep" )
+        {
+            settings.threadSweep = true;
+        }
+        else
+        {
+            std::printf( "Unknown option %s\n", option.c_str() );
+            printUsage( argv[0] );
+            return false;
+        }
+    }
+    return true;
+}
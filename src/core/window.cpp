@@ -1,4 +1,29 @@
 #include "window.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @brief Initial size of a frame's segment of the uniform ring; scenes 
+ * reserve more when they need it.
+ */
+static constexpr GLsizeiptr UNIFORM_RING_SIZE{ 64 * 1024 };
+
+static double median(std::vector<double> values)
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+    std::nth_element( values.begin(), values.begin() + values.size() / 2, 
+                      values.end() );
+    return values[values.size() / 2];
+}
 
 /**
 * @var My_GLFW_Window_Manager::initialization_success
@@ -6,6 +31,115 @@
 * successful (default true).
 */
 bool My_GLFW_Window_Manager::initialization_success_{ true };
+
+/**
+ * @var My_GLFW_Window_Manager::settings
+ * @brief Options given on construction.
+ */
+RenderSettings My_GLFW_Window_Manager::settings_{};
+
+/**
+ * @var My_GLFW_Window_Manager::headless
+ * @brief Windowless context, only created in headless mode.
+ */
+std::unique_ptr<HeadlessContext> My_GLFW_Window_Manager::headless_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::profiler
+ * @brief CPU and GPU timings of the display loop.
+ */
+std::unique_ptr<FrameProfiler> My_GLFW_Window_Manager::profiler_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::jobs
+ * @brief Worker threads that prepare the frames of the scene.
+ */
+std::unique_ptr<JobSystem> My_GLFW_Window_Manager::jobs_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::programCache
+ * @brief On-disk cache of linked shader programs.
+ */
+std::unique_ptr<ProgramCache> My_GLFW_Window_Manager::programCache_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::shaderPipeline
+ * @brief Builds shader programs while the first frames are drawn.
+ */
+std::unique_ptr<ShaderPipeline> My_GLFW_Window_Manager::shaderPipeline_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::assetLoader
+ * @brief Reads and uploads meshes and textures in the background.
+ */
+std::unique_ptr<AssetLoader> My_GLFW_Window_Manager::assetLoader_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::uploadWindow
+ * @brief Hidden window whose context the asset uploads run on.
+ */
+std::shared_ptr<GLFWwindow> My_GLFW_Window_Manager::uploadWindow_{ nullptr, 
+                                                            glfwDestroyWindow };
+
+/**
+ * @var My_GLFW_Window_Manager::framePacer
+ * @brief Spaces the frames of the display loop.
+ */
+std::unique_ptr<FramePacer> My_GLFW_Window_Manager::framePacer_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::inputQueue
+ * @brief Timestamped input events and their input-to-present latency.
+ */
+std::unique_ptr<InputQueue> My_GLFW_Window_Manager::inputQueue_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::uniformRing
+ * @brief Per-frame and per-draw uniform blocks.
+ */
+std::unique_ptr<UniformRing> My_GLFW_Window_Manager::uniformRing_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::sceneTarget
+ * @brief Scaled render target of dynamic resolution.
+ */
+std::unique_ptr<ScaledFramebuffer> My_GLFW_Window_Manager::sceneTarget_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::resolution
+ * @brief Render scale controller of dynamic resolution.
+ */
+std::unique_ptr<ResolutionController> My_GLFW_Window_Manager::resolution_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::frameCapture
+ * @brief Asynchronous capture of the presented frames.
+ */
+std::unique_ptr<FrameCapture> My_GLFW_Window_Manager::frameCapture_{ nullptr };
+
+/**
+ * @var My_GLFW_Window_Manager::viewDamaged
+ * @brief Set by the resize and key callbacks.
+ */
+bool My_GLFW_Window_Manager::viewDamaged_{ false };
+
+/**
+ * @var My_GLFW_Window_Manager::onDemandStats
+ * @brief Totals of an on-demand run.
+ */
+OnDemandStats My_GLFW_Window_Manager::onDemandStats_{};
+
+/**
+ * @var My_GLFW_Window_Manager::renderQueue
+ * @brief Collects, sorts and issues the draws of a frame.
+ */
+RenderQueue My_GLFW_Window_Manager::renderQueue_{};
+
+/**
+ * @var My_GLFW_Window_Manager::stateCache
+ * @brief Skips redundant binds while the queue is issued.
+ */
+GLStateCache My_GLFW_Window_Manager::stateCache_{};
 /**
  * @var My_GLFW_Window_Manager::window
  * @brief Pointer to the GLFW window.
@@ -35,13 +169,31 @@ const std::string My_GLFW_Window_Manager::title_{ "Triangle" };
 * @section Constructor & Initialization
 */
 
-My_GLFW_Window_Manager::My_GLFW_Window_Manager()
+My_GLFW_Window_Manager::My_GLFW_Window_Manager(const RenderSettings& settings)
 {
+    settings_ = settings;
+    windowWidth_ = settings.width;
+    windowHeight_ = settings.height;
     My_GLFW_Window_Manager::initialize();
 }
 
 void My_GLFW_Window_Manager::initialize()
 {
+    // The software backend draws without any context when there is no window
+    if ( settings_.headless && settings_.backend == "software" )
+    {
+        return;
+    }
+    // Without a window the context comes from EGL instead of GLFW
+    if ( settings_.headless )
+    {
+        if ( !createHeadlessContext() )
+        {
+            setInitializationSuccess(false);
+        }
+        return;
+    }
+
     // Try to initialize GLFW
     if ( !openGLFW() )
     {
@@ -67,6 +219,8 @@ void My_GLFW_Window_Manager::initialize()
     glViewport( 0, 0, getWindowWidth(), getWindowHeight() );
     // Attach a function to adjust the size of the viewport to resizing event
     glfwSetFramebufferSizeCallback( getWindow(), window_resize );
+    // Queue key events with their arrival time instead of sampling keys
+    glfwSetKeyCallback( getWindow(), key_callback );
 
     return;
     
@@ -78,6 +232,21 @@ void My_GLFW_Window_Manager::initialize()
 
 My_GLFW_Window_Manager::~My_GLFW_Window_Manager() 
 {
+    // Release GL objects while their context still exists; the loader 
+    // stops its upload thread before the upload context goes away
+    assetLoader_.reset();
+    uploadWindow_.reset();
+    inputQueue_.reset();
+    framePacer_.reset();
+    uniformRing_.reset();
+    frameCapture_.reset();
+    sceneTarget_.reset();
+    resolution_.reset();
+    shaderPipeline_.reset();
+    profiler_.reset();
+    jobs_.reset();
+    // Release the windowless context, if one was created
+    headless_.reset();
     // Terminate GLFW
     glfwTerminate();
 }
@@ -126,6 +295,8 @@ bool My_GLFW_Window_Manager::createWindow()
 {
     bool success{ true };
 
+    // The default framebuffer gets a depth buffer of its own
+    glfwWindowHint( GLFW_DEPTH_BITS, 24 );
     // Try to generate a window
     window_.reset(glfwCreateWindow(windowWidth_,
                              windowHeight_, title_.c_str(), nullptr, nullptr), 
@@ -155,63 +326,433 @@ bool My_GLFW_Window_Manager::createWindow()
         return success;                                     
 }
 
+bool My_GLFW_Window_Manager::createHeadlessContext()
+{
+    headless_ = std::make_unique<HeadlessContext>();
+    // Try to create a context without any window or display server
+    if ( !headless_->createContext() )
+    {
+        return false;
+    }
+    // Try to load OpenGL functions through EGL
+    if ( !gladLoadGLLoader( ( GLADloadproc ) HeadlessContext::getProcAddress ) )
+    {
+        std::printf( "Loading OpenGL functions for the headless context failed\n" );
+        return false;
+    }
+    // Draw into an offscreen framebuffer of the requested size
+    return headless_->createFramebuffer( getWindowWidth(), getWindowHeight() );
+}
+
+void My_GLFW_Window_Manager::startAssetLoader()
+{
+    UploadContext context;
+    if ( settings_.uploadContext && isHeadless() )
+    {
+        if ( headless_->createSharedContext() )
+        {
+            context.makeCurrent = []() { return headless_->makeSharedContextCurrent(); };
+            context.release = []() { headless_->releaseCurrentContext(); };
+        }
+    }
+    else if ( settings_.uploadContext )
+    {
+        // An invisible window is the only way GLFW creates a shared context
+        glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+        uploadWindow_.reset( glfwCreateWindow( 1, 1, "Uploads", nullptr, 
+                                               window_.get() ), glfwDestroyWindow );
+        glfwWindowHint( GLFW_VISIBLE, GLFW_TRUE );
+        if ( uploadWindow_ )
+        {
+            context.makeCurrent = []()
+            {
+                glfwMakeContextCurrent( uploadWindow_.get() );
+                return glfwGetCurrentContext() == uploadWindow_.get();
+            };
+            context.release = []() { glfwMakeContextCurrent( nullptr ); };
+        }
+    }
+    assetLoader_ = std::make_unique<AssetLoader>( settings_.loaderThreads, context );
+}
+
+void My_GLFW_Window_Manager::startPacing()
+{
+    PacingMode mode{ PacingMode::Vsync };
+    parsePacingMode( settings_.pacing, mode );
+    framePacer_ = std::make_unique<FramePacer>( mode, settings_.fpsLimit );
+    inputQueue_ = std::make_unique<InputQueue>();
+    // Offscreen frames are never shown, so they wait for no display
+    if ( !isHeadless() )
+    {
+        glfwSwapInterval( framePacer_->getSwapInterval() );
+    }
+    // A window blocked in glfwWaitEvents only wakes up for GLFW's own events
+    std::function<void()> wake;
+    if ( !isHeadless() )
+    {
+        wake = []() { glfwPostEmptyEvent(); };
+    }
+    inputQueue_->startSynthetic( settings_.syntheticInput, wake );
+}
+
+void My_GLFW_Window_Manager::startResolution()
+{
+    const bool scaled = settings_.gpuBudget > 0.0 || settings_.renderScale < 1.0f;
+    if ( settings_.onDemand )
+    {
+        // Scissored redraws keep the rest of the last frame, which another 
+        // scale would not match
+        if ( scaled )
+        {
+            std::printf( "Dynamic resolution is off in on-demand mode\n" );
+        }
+        // After a swap the window's back buffer is undefined, or an older 
+        // frame than the last one with more than two buffers, so the frame 
+        // is kept in a target of its own and presented whole. The headless 
+        // framebuffer is never swapped and keeps it anyway.
+        if ( !isHeadless() )
+        {
+            int width{ 0 }, height{ 0 };
+            getFramebufferSize( width, height );
+            sceneTarget_ = std::make_unique<ScaledFramebuffer>( std::max( width, 1 ), 
+                                                                std::max( height, 1 ) );
+        }
+        return;
+    }
+    if ( !scaled )
+    {
+        return;
+    }
+    int width{ 0 }, height{ 0 };
+    getFramebufferSize( width, height );
+    sceneTarget_ = std::make_unique<ScaledFramebuffer>( std::max( width, 1 ), 
+                                                        std::max( height, 1 ) );
+    resolution_ = std::make_unique<ResolutionController>( settings_.gpuBudget, 
+                                settings_.renderScale, settings_.minScale );
+}
+
+void My_GLFW_Window_Manager::bindSceneTarget()
+{
+    int width{ 0 }, height{ 0 };
+    getFramebufferSize( width, height );
+    // A minimized window has no pixels, keep the old target until it returns
+    if ( width > 0 && height > 0 && 
+         ( width != sceneTarget_->getWidth() || height != sceneTarget_->getHeight() ) )
+    {
+        sceneTarget_->resize( width, height );
+        // A new target holds no frame, the damage of this one is not enough
+        glDisable( GL_SCISSOR_TEST );
+    }
+    if ( !resolution_ )
+    {
+        // On-demand frames are drawn at full scale under their own scissor
+        sceneTarget_->bind( 1.0f );
+        return;
+    }
+    resolution_->beginFrame( profiler_->getFrameCount() );
+    sceneTarget_->bind( resolution_->getScale() );
+    profiler_->addCounter( FrameCounter::RenderScalePercent, static_cast<std::uint64_t>( 
+                                std::lround( 100.0f * resolution_->getScale() ) ) );
+    // Only clear the scaled corner
+    glEnable( GL_SCISSOR_TEST );
+    glScissor( 0, 0, sceneTarget_->getScaledWidth(), sceneTarget_->getScaledHeight() );
+}
+
+void My_GLFW_Window_Manager::presentSceneTarget()
+{
+    int width{ 0 }, height{ 0 };
+    getFramebufferSize( width, height );
+    const GLuint target = isHeadless() ? headless_->getFramebuffer()->getFBOId() : 0;
+    sceneTarget_->blitTo( target, width, height );
+}
+
+void My_GLFW_Window_Manager::captureFrame(std::size_t frames)
+{
+    int width{ 0 }, height{ 0 };
+    getFramebufferSize( width, height );
+    const GLuint target = isHeadless() ? headless_->getFramebuffer()->getFBOId() : 0;
+    frameCapture_->capture( target, width, height, frames );
+}
+
+void My_GLFW_Window_Manager::reportCapture() const
+{
+    frameCapture_->finish();
+    const FrameCaptureStats stats = frameCapture_->getStats();
+    const double captured = std::max<double>( static_cast<double>( stats.captured ), 1.0 );
+    std::printf( "Frame capture: %llu frames captured, %llu dropped, %llu written "
+                 "to %s (%.1f MiB), %llu failed\n", 
+                 static_cast<unsigned long long>( stats.captured ),
+                 static_cast<unsigned long long>( stats.dropped ),
+                 static_cast<unsigned long long>( stats.written ),
+                 frameCapture_->getDirectory().c_str(),
+                 stats.bytesWritten / ( 1024.0 * 1024.0 ),
+                 static_cast<unsigned long long>( stats.failed ) );
+    std::printf( "Frame capture: %.3f ms per frame on the render thread (%s "
+                 "buffers), %.3f ms per frame encoding on %zu threads\n", 
+                 stats.captureMs / captured, 
+                 frameCapture_->isPersistent() ? "persistent" : "mapped",
+                 stats.encodeMs / captured, settings_.captureThreads );
+    if ( stats.stalls > 0 )
+    {
+        std::printf( "Frame capture: %llu frames waited for a busy buffer, %.3f ms "
+                     "on average\n", static_cast<unsigned long long>( stats.stalls ),
+                     stats.stallMs / stats.stalls );
+    }
+}
+
+void My_GLFW_Window_Manager::key_callback(GLFWwindow* window, int key, 
+                                          int scancode, int action, int mods)
+{
+    ( void ) window;
+    ( void ) scancode;
+    ( void ) mods;
+    if ( inputQueue_ )
+    {
+        inputQueue_->push( { key, action, std::chrono::steady_clock::now() } );
+    }
+    viewDamaged_ = true;
+}
+
 /**
  * @section Rendering Member functions 
  */
 
+bool My_GLFW_Window_Manager::shouldClose(std::size_t frames, 
+                                         double seconds) const
+{
+    // Stop once the requested number of frames has been rendered
+    if ( settings_.frameLimit > 0 && frames >= settings_.frameLimit )
+    {
+        return true;
+    }
+    // Stop once the time budget has been used up
+    if ( settings_.timeBudget > 0.0 && seconds >= settings_.timeBudget )
+    {
+        return true;
+    }
+    // Only a window can be closed by the user
+    return !isHeadless() && glfwWindowShouldClose( window_.get() );
+}
+
+void My_GLFW_Window_Manager::swapBuffers()
+{
+    if ( isHeadless() )
+    {
+        headless_->swapBuffers();
+        return;
+    }
+    // Swap front and back buffers
+    glfwSwapBuffers( window_.get() );
+}
+
+void My_GLFW_Window_Manager::pollEvents()
+{
+    if ( !isHeadless() )
+    {
+        glfwPollEvents();
+    }
+    inputQueue_->deliver();
+}
+
+bool My_GLFW_Window_Manager::findDamage(const Scene& scene, std::size_t frames, 
+                                        DamageRect& damage)
+{
+    // Resizes, input and anything still building can change the whole view
+    bool damaged = viewDamaged_ || frames == 0 || inputQueue_->hasEvents() ||
+                   shaderPipeline_->getPendingCount() > 0 ||
+                   assetLoader_->getPendingCount() > 0;
+    viewDamaged_ = false;
+    damage = DamageRect{};
+    if ( !damaged && !scene.getDamage( frames, damage ) )
+    {
+        return false;
+    }
+    return true;
+}
+
+bool My_GLFW_Window_Manager::setScissor(const DamageRect& damage)
+{
+    int width{ 0 };
+    int height{ 0 };
+    getFramebufferSize( width, height );
+    if ( damage.isFull() )
+    {
+        onDemandStats_.redrawnArea += 1.0;
+        return false;
+    }
+    // Round outwards, a pixel more covers what antialiasing may touch
+    const int left = std::max( static_cast<int>( 
+                        std::floor( ( damage.left + 1.0f ) * 0.5f * width ) ) - 1, 0 );
+    const int bottom = std::max( static_cast<int>( 
+                        std::floor( ( damage.bottom + 1.0f ) * 0.5f * height ) ) - 1, 0 );
+    const int right = std::min( static_cast<int>( 
+                        std::ceil( ( damage.right + 1.0f ) * 0.5f * width ) ) + 1, width );
+    const int top = std::min( static_cast<int>( 
+                        std::ceil( ( damage.top + 1.0f ) * 0.5f * height ) ) + 1, height );
+    glEnable( GL_SCISSOR_TEST );
+    glScissor( left, bottom, right - left, top - bottom );
+    onDemandStats_.redrawnArea += static_cast<double>( right - left ) * 
+                                  ( top - bottom ) / ( static_cast<double>( width ) * height );
+    ++onDemandStats_.scissoredFrames;
+    return true;
+}
+
+void My_GLFW_Window_Manager::getFramebufferSize(int& width, int& height) const
+{
+    width = settings_.width;
+    height = settings_.height;
+    if ( !isHeadless() )
+    {
+        glfwGetFramebufferSize( window_.get(), &width, &height );
+    }
+}
+
+UniformAllocation My_GLFW_Window_Manager::writeFrameUniforms(std::size_t frames, 
+                                                             double seconds)
+{
+    int width{ 0 };
+    int height{ 0 };
+    getFramebufferSize( width, height );
+    // The scene sees the size it is rendered at
+    if ( sceneTarget_ )
+    {
+        width = sceneTarget_->getScaledWidth();
+        height = sceneTarget_->getScaledHeight();
+    }
+    width = std::max( width, 1 );
+    height = std::max( height, 1 );
+    FrameUniforms block{};
+    block.viewport[0] = static_cast<float>( width );
+    block.viewport[1] = static_cast<float>( height );
+    block.viewport[2] = 1.0f / width;
+    block.viewport[3] = 1.0f / height;
+    block.time[0] = static_cast<float>( seconds );
+    block.time[1] = static_cast<float>( frames );
+    const UniformAllocation allocation = uniformRing_->allocate( sizeof( block ) );
+    std::memcpy( allocation.data, &block, sizeof( block ) );
+    return allocation;
+}
+
+void My_GLFW_Window_Manager::waitForEvents()
+{
+    if ( isHeadless() )
+    {
+        inputQueue_->waitForEvents( IDLE_WAIT_SECONDS );
+    }
+    else
+    {
+        // Sleeps in the window system instead of spinning on glfwPollEvents
+        glfwWaitEventsTimeout( IDLE_WAIT_SECONDS );
+    }
+    inputQueue_->deliver();
+    ++onDemandStats_.idleWaits;
+}
+
 void My_GLFW_Window_Manager::processInput()
 {
-    // Check if the escape key is pressed
-    if ( glfwGetKey( window_.get() , GLFW_KEY_ESCAPE ) == GLFW_PRESS )
+    // Synthetic events come in without a window, keys only with one
+    for ( const InputEvent& event : inputQueue_->take() )
     {
-        glfwSetWindowShouldClose( window_.get(), true );
+        // Check if the escape key is pressed
+        if ( event.key == GLFW_KEY_ESCAPE && event.action == GLFW_PRESS )
+        {
+            glfwSetWindowShouldClose( window_.get(), true );
+        }
     }
 }
 
-void My_GLFW_Window_Manager::display()
+std::vector<std::size_t> My_GLFW_Window_Manager::startJobs()
 {
-     // Defining GLSL code for the vertex shader
-    const char *vertexShaderSource = 
-    "#version 330 core\n"
-    // Start location is 0, out variable aPos is triangle position
-    "layout (location = 0) in vec3 aPos;\n"
-    "void main()\n"
-    // Setting drawing position on the viewport, same as input.
-    "{\n"
-    "   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n" 
-    "}\0";
-
-    const char *fragmentShaderSource = 
-    "#version 330 core\n"
-    // Define out variable as FragColor.
-    "out vec4 FragColor;\n"
-    "void main()\n"
-    // Define value of FragColor as orange with 100% opacity.
-    "{\n"
-    "   FragColor = vec4(0.5f, 1.0f, 0.2f, 1.0f);\n"
-    "}\n\0";
-
-    std::vector<float> defaultTriangleVertices_ =
-    {
-        -0.5f, -0.5f, 0.0f,
-        0.5f, -0.5f, 0.0f,
-        0.0f,  0.5f, 0.0f
-    };
-    std::unique_ptr<Program> shaderProgram;
-    std::unique_ptr<BufferSetup> buffer;
-    try
+    jobs_ = std::make_unique<JobSystem>( settings_.threads );
+    // A thread sweep doubles the thread count up to the configured one
+    std::vector<std::size_t> threadSteps;
+    if ( settings_.threadSweep )
     {
-        // Create shader objects, if fail throws logic error
-        auto vertexShader = VertexShader(vertexShaderSource);
-        auto fragShader = FragmentShader(fragmentShaderSource);
+        const std::size_t maxThreads = jobs_->getThreadCount();
+        for ( std::size_t step = 1; step < maxThreads; step *= 2 )
+        {
+            threadSteps.push_back( step );
+        }
+        threadSteps.push_back( maxThreads );
+        jobs_->setThreadCount( threadSteps.front() );
+    }
+    return threadSteps;
+}
 
-        // Use the compiled shaders to get a linked shader program
-        shaderProgram = std::make_unique<Program>
-        (Program(vertexShader.getShaderID(), fragShader.getShaderID()));
+void My_GLFW_Window_Manager::stepThreadSweep(
+                const std::vector<std::size_t>& steps, std::size_t frames)
+{
+    // Move on to the next thread count of a sweep
+    if ( !steps.empty() && frames % THREAD_SWEEP_FRAMES == 0 )
+    {
+        const std::size_t step = std::min( frames / THREAD_SWEEP_FRAMES,
+                                           steps.size() - 1 );
+        if ( jobs_->getThreadCount() != steps[step] )
+        {
+            jobs_->setThreadCount( steps[step] );
+        }
+    }
+}
 
-        // Move triangle data to the GPU buffer
-        buffer = std::make_unique<BufferSetup>
-                            (BufferSetup(defaultTriangleVertices_));
+void My_GLFW_Window_Manager::startProfiler(std::size_t sceneLimit, 
+                        const std::vector<std::size_t>& steps, bool gpuTiming)
+{
+    // A scene that needs a fixed number of frames sets the limit itself
+    if ( settings_.frameLimit == 0 && settings_.timeBudget <= 0.0 )
+    {
+        settings_.frameLimit = steps.empty() ? sceneLimit :
+                               steps.size() * THREAD_SWEEP_FRAMES;
+        // A headless run has no close button, so make sure it ends
+        if ( settings_.frameLimit == 0 && isHeadless() )
+        {
+            settings_.frameLimit = DEFAULT_HEADLESS_FRAMES;
+        }
+    }
+    // Time every phase of every frame, keeping all frames of a limited run
+    profiler_ = std::make_unique<FrameProfiler>( std::min<std::size_t>( 
+                std::max<std::size_t>( 1024, settings_.frameLimit ), 65536 ), 
+                gpuTiming );
+}
+
+void My_GLFW_Window_Manager::display()
+{
+    if ( settings_.backend == "software" )
+    {
+        displaySoftware();
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point setupStart = Clock::now();
+    // Reuse linked programs of earlier runs unless the cache is disabled
+    if ( !settings_.shaderCache.empty() )
+    {
+        programCache_ = std::make_unique<ProgramCache>( settings_.shaderCache );
+    }
+    // Programs are submitted now and become ready during the first frames
+    shaderPipeline_ = std::make_unique<ShaderPipeline>( programCache_.get() );
+    const std::vector<std::size_t> threadSteps = startJobs();
+    startAssetLoader();
+    startPacing();
+    std::unique_ptr<Scene> scene;
+    try
+    {
+        // Throws logic error if the ring's target is not supported
+        uniformRing_ = std::make_unique<UniformRing>( GL_UNIFORM_BUFFER, 
+                                                      UNIFORM_RING_SIZE );
+        // Create the buffers of the scene, throws logic error
+        scene = createScene( settings_, *shaderPipeline_, *jobs_, *assetLoader_,
+                             *uniformRing_ );
+        // Throws logic error if the scaled target is not complete
+        startResolution();
+        // Throws logic error if the directory cannot be created
+        if ( !settings_.capture.empty() )
+        {
+            CaptureFormat format{ CaptureFormat::Png };
+            parseCaptureFormat( settings_.captureFormat, format );
+            frameCapture_ = std::make_unique<FrameCapture>( settings_.capture, format,
+                                                            settings_.captureThreads,
+                                                            settings_.captureDrop );
+        }
     }
     catch( const std::logic_error& except)
     {
@@ -224,29 +765,445 @@ void My_GLFW_Window_Manager::display()
     {
         std::cout << "OpenGL error: " << err << std::endl;
     }
-    // Main loop until the window should close
-    while( !glfwWindowShouldClose( window_.get() ) )
+    const double setupMs = std::chrono::duration<double, std::milli>( 
+                                    Clock::now() - setupStart ).count();
+    startProfiler( scene->getFrameLimit(), threadSteps, true );
+    // Count frames and time for the run limits
+    const Clock::time_point startTime = Clock::now();
+    const std::clock_t startCpu = std::clock();
+    std::size_t frames{ 0 };
+    double seconds{ 0.0 };
+    DamageRect damage;
+    // Flat scenes draw at equal depths and still overlap in draw order
+    glEnable( GL_DEPTH_TEST );
+    glDepthFunc( GL_LEQUAL );
+    // Main loop until the window should close or a run limit is reached
+    while( !shouldClose( frames, seconds ) )
     {
+        /**
+        * @subsection On-demand idling
+        */
+        if ( settings_.onDemand && !findDamage( *scene, frames, damage ) )
+        {
+            // Without a window or synthetic input nothing will ever change
+            if ( isHeadless() && settings_.syntheticInput <= 0.0 )
+            {
+                break;
+            }
+            waitForEvents();
+            seconds = std::chrono::duration<double>( Clock::now() - startTime ).count();
+            continue;
+        }
+        profiler_->beginFrame();
+        {
+            ProfileScope scope( *profiler_, FramePhase::Pace );
+            framePacer_->wait();
+        }
         /**
         * @subsection Input handling
         */
-        processInput();
+        {
+            ProfileScope scope( *profiler_, FramePhase::Input );
+            // Sample input as late as possible, after the pacer's wait
+            if ( settings_.lateInput )
+            {
+                pollEvents();
+            }
+            processInput();
+        }
+        stepThreadSweep( threadSteps, frames );
         /**
         * @subsection Frame rendering logic
         */
-        glClearColor( 0.2f, 0.3f, 0.3f, 1.0f );
-        glClear( GL_COLOR_BUFFER_BIT );
-
-        // Drawing logic for a triangle
-        glUseProgram(shaderProgram->getProgramID());
-        glBindVertexArray(buffer->getVAOId()); 
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        {
+            ProfileScope scope( *profiler_, FramePhase::Clear );
+            // The clear and the draws only touch the damaged area
+            if ( settings_.onDemand )
+            {
+                setScissor( damage );
+            }
+            if ( sceneTarget_ )
+            {
+                bindSceneTarget();
+            }
+            glClearColor( 0.2f, 0.3f, 0.3f, 1.0f );
+            glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Draw );
+            // Pick up the programs and assets that finished building
+            shaderPipeline_->poll();
+            assetLoader_->poll();
+            const UniformAllocation frameBlock = writeFrameUniforms( frames, seconds );
+            scene->update( frames );
+            scene->draw( renderQueue_, *profiler_ );
+            // Blocks written by the scene must be visible before the draws
+            uniformRing_->commit();
+            // Group draws by state, then issue them skipping redundant binds
+            if ( settings_.sortQueue )
+            {
+                renderQueue_.sort();
+            }
+            stateCache_.invalidate();
+            stateCache_.resetCounters();
+            stateCache_.bindUniformRange( FRAME_UNIFORM_BINDING, 
+                                          uniformRing_->getBufferId(), 
+                                          frameBlock.offset, frameBlock.size );
+            const std::size_t draws = renderQueue_.flush( stateCache_ );
+            // Blits of the swap are scissored too
+            glDisable( GL_SCISSOR_TEST );
+            scene->endFrame();
+            profiler_->addCounter( FrameCounter::UniformBytes, 
+                                   static_cast<std::uint64_t>( 
+                                        uniformRing_->getFrameBytes() ) );
+            uniformRing_->endFrame();
+            profiler_->addCounter( FrameCounter::DrawCalls, draws );
+            profiler_->addCounter( FrameCounter::BindsIssued, 
+                                   stateCache_.getBindsIssued() );
+            profiler_->addCounter( FrameCounter::BindsElided, 
+                                   stateCache_.getBindsElided() );
+            profiler_->addCounter( FrameCounter::TextureBinds, 
+                                   stateCache_.getTextureBindsIssued() );
+            // Stretch the scaled frame over the window
+            if ( sceneTarget_ )
+            {
+                presentSceneTarget();
+            }
+        }
+        /**
+        * @subsection Frame capture
+        */
+        if ( frameCapture_ )
+        {
+            ProfileScope scope( *profiler_, FramePhase::Capture );
+            captureFrame( frames );
+        }
         /**
         * @subsection Buffers swap & event handling
         */
-        // Swap front and back buffers
-        glfwSwapBuffers( window_.get() );
-        // Poll for and process events
-        glfwPollEvents();
+        {
+            ProfileScope scope( *profiler_, FramePhase::Swap );
+            swapBuffers();
+            inputQueue_->present( *profiler_ );
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Poll );
+            // Poll for and process events, unless that happens before input
+            if ( !settings_.lateInput )
+            {
+                pollEvents();
+            }
+        }
+        profiler_->endFrame();
+        // GPU times come back a few frames late, each against its own scale
+        std::size_t timedFrame{ 0 };
+        double gpuMs{ 0.0 };
+        if ( resolution_ && profiler_->getLatestGpuFrame( timedFrame, gpuMs ) )
+        {
+            resolution_->addGpuTime( timedFrame, gpuMs );
+        }
+
+        ++frames;
+        seconds = std::chrono::duration<double>( Clock::now() - startTime ).count();
+    }
+    // Let all queued work finish, so the totals and GPU timings are complete
+    glFinish();
+    seconds = std::chrono::duration<double>( Clock::now() - startTime ).count();
+    profiler_->collect();
+    reportRun( frames, seconds, setupMs );
+    if ( settings_.onDemand )
+    {
+        // Process time covers every thread, the busiest is the render thread
+        const double cpuSeconds = static_cast<double>( std::clock() - startCpu ) / 
+                                  CLOCKS_PER_SEC;
+        std::printf( "On-demand rendering: %zu frames drawn, %zu idle waits, "
+                     "%zu scissored, %.1f%% of the view redrawn per frame, "
+                     "%.3f s process CPU time (%.1f%% of a core)\n", frames, 
+                     onDemandStats_.idleWaits, onDemandStats_.scissoredFrames,
+                     frames > 0 ? 100.0 * onDemandStats_.redrawnArea / frames : 0.0,
+                     cpuSeconds, seconds > 0.0 ? 100.0 * cpuSeconds / seconds : 0.0 );
+    }
+    if ( frameCapture_ )
+    {
+        reportCapture();
+    }
+    if ( resolution_ && resolution_->getBudgetMs() <= 0.0 )
+    {
+        std::printf( "Dynamic resolution: fixed scale %.2f\n", resolution_->getScale() );
+    }
+    else if ( resolution_ )
+    {
+        const std::uint64_t timed = resolution_->getTimedFrames();
+        std::printf( "Dynamic resolution: budget %.2f ms, scale %.2f now, %.2f mean, "
+                     "%.2f to %.2f, %llu changes, %llu of %llu timed frames over "
+                     "budget (%.1f%%)\n", resolution_->getBudgetMs(), 
+                     resolution_->getScale(), resolution_->getMeanScale(),
+                     resolution_->getLowestScale(), resolution_->getHighestScale(),
+                     static_cast<unsigned long long>( resolution_->getChanges() ),
+                     static_cast<unsigned long long>( resolution_->getMisses() ),
+                     static_cast<unsigned long long>( timed ),
+                     timed > 0 ? 100.0 * resolution_->getMisses() / timed : 0.0 );
+    }
+    if ( !threadSteps.empty() )
+    {
+        reportThreadSweep( threadSteps );
+    }
+    scene->report( *profiler_ );
+}
+
+void My_GLFW_Window_Manager::displaySoftware()
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point setupStart = Clock::now();
+    const std::vector<std::size_t> threadSteps = startJobs();
+    startPacing();
+    std::unique_ptr<SoftwareScene> scene;
+    std::unique_ptr<SoftwareRasterizer> rasterizer;
+    std::unique_ptr<UploadFramebuffer> present;
+    try
+    {
+        // Create the scene and the buffers, throws logic error
+        scene = createSoftwareScene( settings_ );
+        rasterizer = std::make_unique<SoftwareRasterizer>( settings_.width, 
+                                                           settings_.height, *jobs_ );
+        // Only a window needs the frames in OpenGL
+        if ( !isHeadless() )
+        {
+            present = std::make_unique<UploadFramebuffer>( settings_.width, 
+                                                           settings_.height );
+        }
+    }
+    catch( const std::logic_error& except)
+    {
+        std::cout << except.what();
+        return;
+    }
+    const double setupMs = std::chrono::duration<double, std::milli>( 
+                                    Clock::now() - setupStart ).count();
+    // Without a context there is nothing the GPU could time
+    startProfiler( 0, threadSteps, !isHeadless() );
+    const Clock::time_point startTime = Clock::now();
+    std::size_t frames{ 0 };
+    double seconds{ 0.0 };
+    while( !shouldClose( frames, seconds ) )
+    {
+        profiler_->beginFrame();
+        {
+            ProfileScope scope( *profiler_, FramePhase::Pace );
+            framePacer_->wait();
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Input );
+            if ( settings_.lateInput )
+            {
+                pollEvents();
+            }
+            processInput();
+        }
+        stepThreadSweep( threadSteps, frames );
+        {
+            ProfileScope scope( *profiler_, FramePhase::Clear );
+            rasterizer->clear( packColor( 0.2f, 0.3f, 0.3f ) );
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Draw );
+            scene->update( frames );
+            scene->draw( *rasterizer, *profiler_ );
+            rasterizer->render();
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Swap );
+            // Show the frame by way of a texture
+            if ( present )
+            {
+                int width{ 0 }, height{ 0 };
+                glfwGetFramebufferSize( window_.get(), &width, &height );
+                present->upload( rasterizer->getColor() );
+                present->blitToWindow( width, height );
+                swapBuffers();
+            }
+            inputQueue_->present( *profiler_ );
+        }
+        {
+            ProfileScope scope( *profiler_, FramePhase::Poll );
+            if ( !settings_.lateInput )
+            {
+                pollEvents();
+            }
+        }
+        profiler_->endFrame();
+
+        ++frames;
+        seconds = std::chrono::duration<double>( Clock::now() - startTime ).count();
+    }
+    if ( present )
+    {
+        glFinish();
+        present.reset();
+    }
+    seconds = std::chrono::duration<double>( Clock::now() - startTime ).count();
+    profiler_->collect();
+    reportRun( frames, seconds, setupMs );
+    const SoftwareRasterizerStats& stats = rasterizer->getStats();
+    std::printf( "Software rasterizer: %dx%d pixels, %zu tiles, last frame "
+                 "%zu of %zu triangles set up, %zu bin entries\n", 
+                 rasterizer->getWidth(), rasterizer->getHeight(), stats.tiles, 
+                 stats.trianglesSetUp, stats.triangles, stats.binEntries );
+    if ( !threadSteps.empty() )
+    {
+        reportThreadSweep( threadSteps );
+    }
+}
+
+void My_GLFW_Window_Manager::reportRun(std::size_t frames, double seconds, 
+                                       double setupMs) const
+{
+    // Report throughput of limited runs
+    if ( isHeadless() || settings_.frameLimit > 0 || settings_.timeBudget > 0.0 )
+    {
+        const FrameTimeSummary cpu = profiler_->getCpuSummary();
+        const FrameTimeSummary gpu = profiler_->getGpuSummary();
+        std::printf( "Scene setup took %.3f ms\n", setupMs );
+        // The software backend builds no shader programs
+        if ( shaderPipeline_ )
+        {
+            std::printf( "Shader pipeline: %zu programs, %s compilation, "
+                         "slowest ready after %.3f ms\n", 
+                         shaderPipeline_->getProgramCount(),
+                         shaderPipeline_->isParallel() ? "parallel" : "serial",
+                         shaderPipeline_->getSlowestReadyMs() );
+        }
+        if ( programCache_ && programCache_->isSupported() )
+        {
+            const ProgramCacheStats& cache = programCache_->getStats();
+            std::printf( "Shader cache: %zu hits, %zu misses, %zu rejected, "
+                         "%.3f ms build time saved\n", cache.hits, cache.misses,
+                         cache.rejected, cache.savedMs );
+        }
+        if ( assetLoader_ && assetLoader_->getAssetCount() > 0 )
+        {
+            const AssetLoaderStats& assets = assetLoader_->getStats();
+            std::printf( "Asset loader: %zu meshes, %zu textures, %zu failed, "
+                         "%zu pending, %.1f MiB uploaded on the %s thread\n", 
+                         assets.meshes, assets.textures, assets.failed, 
+                         assetLoader_->getPendingCount(),
+                         assets.bytesUploaded / ( 1024.0 * 1024.0 ),
+                         assetLoader_->hasUploadThread() ? "upload" : "render" );
+        }
+        std::printf( "Job system: %zu threads, %llu jobs, %llu stolen\n", 
+                     jobs_->getThreadCount(), 
+                     static_cast<unsigned long long>( jobs_->getJobsRun() ),
+                     static_cast<unsigned long long>( jobs_->getJobsStolen() ) );
+        // Vertical sync only paces a window, offscreen frames are uncapped
+        if ( framePacer_ )
+        {
+            std::printf( "Frame pacing: %s", framePacer_->getModeName() );
+            if ( framePacer_->getMode() == PacingMode::Limited )
+            {
+                std::printf( " at %.1f frames/s, %.3f ms slept, %.3f ms spun, "
+                             "%llu missed, max overshoot %.3f ms", settings_.fpsLimit,
+                             framePacer_->getSleepMs(), framePacer_->getSpinMs(),
+                             static_cast<unsigned long long>( 
+                                        framePacer_->getMissedFrames() ),
+                             framePacer_->getMaxOvershootMs() );
+            }
+            std::printf( ", %s input\n", settings_.lateInput ? "late" : "early" );
+        }
+        if ( uniformRing_ )
+        {
+            std::printf( "Uniform ring: %lld KiB per frame, %lld byte alignment, %s, "
+                         "%.2f KiB and %.1f ranges written per frame, %llu stalls\n",
+                         static_cast<long long>( uniformRing_->getSegmentSize() / 1024 ),
+                         static_cast<long long>( uniformRing_->getAlignment() ),
+                         uniformRing_->isPersistent() ? "persistently mapped" 
+                                                      : "mapped unsynchronized",
+                         frames > 0 ? profiler_->getCounterTotal( 
+                                FrameCounter::UniformBytes ) / 1024.0 / frames : 0.0,
+                         frames > 0 ? static_cast<double>( 
+                                uniformRing_->getAllocationCount() ) / frames : 0.0,
+                         static_cast<unsigned long long>( 
+                                uniformRing_->getStallCount() ) );
+        }
+        std::printf( "Rendered %zu frames in %.3f s (%.1f frames/s)\n", frames, 
+                     seconds, seconds > 0.0 ? frames / seconds : 0.0 );
+        std::printf( "CPU frame time ms: p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+                     cpu.p50, cpu.p95, cpu.p99, cpu.max );
+        if ( profiler_->hasGpuTiming() )
+        {
+            std::printf( "GPU frame time ms: p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+                         gpu.p50, gpu.p95, gpu.p99, gpu.max );
+        }
+        if ( inputQueue_ && inputQueue_->getPresentedCount() > 0 )
+        {
+            const FrameTimeSummary input = inputQueue_->getLatencySummary();
+            std::printf( "Input-to-present latency ms: p50 %.3f p95 %.3f p99 %.3f "
+                         "max %.3f (%llu events)\n", input.p50, input.p95, 
+                         input.p99, input.max, static_cast<unsigned long long>( 
+                                        inputQueue_->getPresentedCount() ) );
+        }
+        // Print the counters that were used in this run
+        for ( std::size_t index = 0; index < FRAME_COUNTER_COUNT; ++index )
+        {
+            const FrameCounter counter = static_cast<FrameCounter>( index );
+            const std::uint64_t total = profiler_->getCounterTotal( counter );
+            if ( total > 0 )
+            {
+                std::printf( "%s: %llu total, %.1f per frame\n", 
+                             getCounterName( counter ), 
+                             static_cast<unsigned long long>( total ),
+                             frames > 0 ? double( total ) / frames : 0.0 );
+            }
+        }
+    }
+    // Dump the stored samples if requested
+    if ( !settings_.statsOutput.empty() && 
+         !profiler_->writeFile( settings_.statsOutput ) )
+    {
+        std::printf( "Writing frame timings to %s failed\n", 
+                     settings_.statsOutput.c_str() );
+    }
+}
+
+void My_GLFW_Window_Manager::reportThreadSweep(
+                                const std::vector<std::size_t>& steps) const
+{
+    // The first frames after the workers restart are not representative
+    const std::size_t warmup = THREAD_SWEEP_FRAMES / 4;
+    const std::size_t draw = static_cast<std::size_t>( FramePhase::Draw );
+    const std::size_t triangles = static_cast<std::size_t>( FrameCounter::Triangles );
+    std::vector<std::vector<double>> drawTimes( steps.size() );
+    std::vector<std::vector<double>> frameTimes( steps.size() );
+    std::vector<std::vector<double>> triangleRates( steps.size() );
+    for ( const FrameSample& sample : profiler_->getSamples() )
+    {
+        const std::size_t step = sample.frame / THREAD_SWEEP_FRAMES;
+        if ( step >= steps.size() || sample.frame % THREAD_SWEEP_FRAMES < warmup )
+        {
+            continue;
+        }
+        drawTimes[step].push_back( sample.cpuPhases[draw] );
+        frameTimes[step].push_back( sample.cpuFrame );
+        if ( sample.cpuPhases[draw] > 0.0 )
+        {
+            // Millions of triangles per second of the draw phase
+            triangleRates[step].push_back( sample.counters[triangles] * 1e-3 / 
+                                           sample.cpuPhases[draw] );
+        }
+    }
+
+    const bool countsTriangles = 
+                profiler_->getCounterTotal( FrameCounter::Triangles ) > 0;
+    std::printf( "%8s %14s %14s %8s", "threads", "draw median ms", 
+                 "cpu median ms", "speedup" );
+    std::printf( countsTriangles ? " %10s\n" : "\n", "Mtri/s" );
+    const double baseline = median( frameTimes.front() );
+    for ( std::size_t step = 0; step < steps.size(); ++step )
+    {
+        const double frame = median( frameTimes[step] );
+        std::printf( "%8zu %14.3f %14.3f %7.2fx", steps[step], 
+                     median( drawTimes[step] ), frame, 
+                     frame > 0.0 ? baseline / frame : 0.0 );
+        std::printf( countsTriangles ? " %10.2f\n" : "\n", 
+                     median( triangleRates[step] ) );
     }
 }
@@ -0,0 +1,526 @@
+#include "asset_loader.hpp"
+#include "texture.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <future>
+#include <limits>
+#include <stdexcept>
+
+/**
+* @section Helper functions
+*/
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+}
+
+static bool readPPMToken(std::FILE* file, long& value)
+{
+    // Tokens are separated by whitespace; '#' starts a comment line
+    int c = std::fgetc(file);
+    while (c != EOF && (std::isspace(c) || c == '#'))
+    {
+        if (c == '#')
+        {
+            while (c != EOF && c != '\n')
+            {
+                c = std::fgetc(file);
+            }
+        }
+        c = std::fgetc(file);
+    }
+    if (c == EOF || c < '0' || c > '9')
+    {
+        return false;
+    }
+    value = 0;
+    while (c >= '0' && c <= '9' && value < 1000000)
+    {
+        value = value * 10 + (c - '0');
+        c = std::fgetc(file);
+    }
+    // The single whitespace after the last token is consumed here
+    return c != EOF && std::isspace(c);
+}
+
+static std::string decodePPM(const std::string& path, std::vector<std::uint8_t>& pixels,
+                             int& width, int& height)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return "ERROR::ASSET_LOADER::OPEN_FAILED\n " + path;
+    }
+    char magic[2] = {};
+    long w{ 0 }, h{ 0 }, maximum{ 0 };
+    const bool header = std::fread(magic, 1, 2, file) == 2 && magic[0] == 'P' &&
+                        magic[1] == '6' && readPPMToken(file, w) &&
+                        readPPMToken(file, h) && readPPMToken(file, maximum);
+    if (!header || w <= 0 || h <= 0 || maximum != 255)
+    {
+        std::fclose(file);
+        return "ERROR::ASSET_LOADER::UNSUPPORTED_IMAGE\n " + path;
+    }
+    if (w > AssetLoader::MAX_IMAGE_SIZE || h > AssetLoader::MAX_IMAGE_SIZE)
+    {
+        std::fclose(file);
+        return "ERROR::ASSET_LOADER::IMAGE_TOO_LARGE\n " + path + " is " +
+               std::to_string(w) + "x" + std::to_string(h);
+    }
+    std::vector<std::uint8_t> rgb(static_cast<std::size_t>(w) * h * 3);
+    const bool complete = std::fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    std::fclose(file);
+    if (!complete)
+    {
+        return "ERROR::ASSET_LOADER::TRUNCATED_IMAGE\n " + path;
+    }
+
+    // PPM starts with the top row, OpenGL textures with the bottom one
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    pixels.resize(static_cast<std::size_t>(w) * h * 4);
+    for (long y = 0; y < h; ++y)
+    {
+        const std::uint8_t* source = &rgb[static_cast<std::size_t>(h - 1 - y) * w * 3];
+        std::uint8_t* target = &pixels[static_cast<std::size_t>(y) * w * 4];
+        for (long x = 0; x < w; ++x)
+        {
+            target[x * 4 + 0] = source[x * 3 + 0];
+            target[x * 4 + 1] = source[x * 3 + 1];
+            target[x * 4 + 2] = source[x * 3 + 2];
+            target[x * 4 + 3] = 255;
+        }
+    }
+    return {};
+}
+
+/**
+* @section Constructor & Destructor
+*/
+
+AssetLoader::AssetLoader(std::size_t readers, const UploadContext& context)
+    : pending_{ 0 }, stopping_{ false }
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(readers, 1); ++i)
+    {
+        readers_.emplace_back(&AssetLoader::readerLoop, this);
+    }
+    if (!context.makeCurrent)
+    {
+        return;
+    }
+    // Only keep the upload thread if its context can be made current
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    uploader_ = std::thread([this, context, &started]()
+    {
+        const bool current = context.makeCurrent();
+        started.set_value(current);
+        if (current)
+        {
+            uploaderLoop(context);
+        }
+    });
+    if (!result.get())
+    {
+        uploader_.join();
+        std::printf("Asset uploads fall back to the render thread\n");
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    readWake_.notify_all();
+    uploadWake_.notify_all();
+    for (std::thread& reader : readers_)
+    {
+        reader.join();
+    }
+    if (uploader_.joinable())
+    {
+        uploader_.join();
+    }
+    // Objects of shared contexts can be deleted from the render context
+    for (auto* queue : { &readQueue_, &uploadQueue_, &doneQueue_, &fenced_, &mainUploads_ })
+    {
+        for (std::unique_ptr<Task>& task : *queue)
+        {
+            discard(*task);
+        }
+    }
+    for (Entry& entry : entries_)
+    {
+        entry.mesh.reset();
+        glDeleteTextures(1, &entry.texture);
+    }
+}
+
+/**
+* @section Request Member functions
+*/
+
+AssetLoader::Handle AssetLoader::loadMesh(const std::string& path)
+{
+    return request(Kind::Mesh, path);
+}
+
+AssetLoader::Handle AssetLoader::loadTexture(const std::string& path)
+{
+    return request(Kind::Texture, path);
+}
+
+AssetLoader::Handle AssetLoader::request(Kind kind, const std::string& path)
+{
+    const Handle handle = entries_.size();
+    entries_.emplace_back();
+    entries_.back().kind = kind;
+    ++pending_;
+
+    auto task = std::make_unique<Task>();
+    task->handle = handle;
+    task->kind = kind;
+    task->path = path;
+    task->requested = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        readQueue_.push_back(std::move(task));
+    }
+    readWake_.notify_one();
+    return handle;
+}
+
+/**
+* @section Background Member functions
+*/
+
+void AssetLoader::readerLoop()
+{
+    for (;;)
+    {
+        std::unique_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            readWake_.wait(lock, [this]() { return stopping_ || !readQueue_.empty(); });
+            if (stopping_)
+            {
+                return;
+            }
+            task = std::move(readQueue_.front());
+            readQueue_.pop_front();
+        }
+        read(*task);
+        {
+            // Failed tasks skip the upload
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (task->error.empty())
+            {
+                uploadQueue_.push_back(std::move(task));
+            }
+            else
+            {
+                doneQueue_.push_back(std::move(task));
+            }
+        }
+        uploadWake_.notify_one();
+    }
+}
+
+void AssetLoader::uploaderLoop(UploadContext context)
+{
+    for (;;)
+    {
+        std::unique_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            uploadWake_.wait(lock, [this]() { return stopping_ || !uploadQueue_.empty(); });
+            if (stopping_)
+            {
+                break;
+            }
+            task = std::move(uploadQueue_.front());
+            uploadQueue_.pop_front();
+        }
+        std::size_t budget = std::numeric_limits<std::size_t>::max();
+        upload(*task, budget);
+        std::lock_guard<std::mutex> lock(mutex_);
+        doneQueue_.push_back(std::move(task));
+    }
+    if (context.release)
+    {
+        context.release();
+    }
+}
+
+void AssetLoader::read(Task& task)
+{
+    const Clock::time_point start = Clock::now();
+    // An exception leaving a reader thread would terminate the program
+    try
+    {
+        if (task.kind == Kind::Mesh)
+        {
+            task.mesh = std::make_unique<MeshFile>(task.path);
+            // Fault every page in now, so the upload only copies memory
+            volatile std::uint8_t sink = 0;
+            for (std::size_t s = 0; s < task.mesh->getLayout().getStreamCount(); ++s)
+            {
+                const std::uint8_t* bytes = task.mesh->getStream(s);
+                for (std::size_t offset = 0; offset < task.mesh->getStreamSize(s); offset += 4096)
+                {
+                    sink = sink + bytes[offset];
+                }
+            }
+            const std::uint8_t* indices = reinterpret_cast<const std::uint8_t*>(
+                                                task.mesh->getIndices());
+            for (std::size_t offset = 0; indices &&
+                 offset < task.mesh->getIndexCount() * sizeof(GLuint); offset += 4096)
+            {
+                sink = sink + indices[offset];
+            }
+        }
+        else
+        {
+            task.error = decodePPM(task.path, task.pixels, task.width, task.height);
+        }
+    }
+    catch (const std::logic_error& except)
+    {
+        task.error = except.what();
+        return;
+    }
+    catch (const std::exception& except)
+    {
+        task.mesh.reset();
+        task.pixels = std::vector<std::uint8_t>();
+        task.error = "ERROR::ASSET_LOADER::READ_FAILED\n " + task.path + ": " + 
+                     except.what();
+        return;
+    }
+    task.readMs = millisecondsSince(start);
+}
+
+bool AssetLoader::upload(Task& task, std::size_t& budget)
+{
+    const Clock::time_point start = Clock::now();
+    // Copies go through GL_COPY_WRITE_BUFFER, which is not part of any VAO
+    if (task.kind == Kind::Mesh)
+    {
+        const MeshFile& file = *task.mesh;
+        const std::size_t streams = file.getLayout().getStreamCount();
+        const std::size_t sections = streams + (file.getIndexCount() > 0 ? 1 : 0);
+        if (!task.started)
+        {
+            task.started = true;
+            task.buffers.resize(streams);
+            glGenBuffers(static_cast<GLsizei>(streams), task.buffers.data());
+            if (file.getIndexCount() > 0)
+            {
+                glGenBuffers(1, &task.elementBuffer);
+            }
+            for (std::size_t s = 0; s < sections; ++s)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, s < streams ? task.buffers[s]
+                                                               : task.elementBuffer);
+                const std::size_t size = s < streams ? file.getStreamSize(s)
+                                       : file.getIndexCount() * sizeof(GLuint);
+                glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size),
+                             nullptr, GL_STATIC_DRAW);
+            }
+        }
+        while (task.section < sections && budget > 0)
+        {
+            const bool indices = task.section == streams;
+            const std::uint8_t* data = indices
+                ? reinterpret_cast<const std::uint8_t*>(file.getIndices())
+                : file.getStream(task.section);
+            const std::size_t size = indices ? file.getIndexCount() * sizeof(GLuint)
+                                             : file.getStreamSize(task.section);
+            const std::size_t chunk = std::min({ size - task.offset, budget, UPLOAD_CHUNK });
+            glBindBuffer(GL_COPY_WRITE_BUFFER, indices ? task.elementBuffer
+                                                       : task.buffers[task.section]);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(task.offset),
+                            static_cast<GLsizeiptr>(chunk), data + task.offset);
+            task.offset += chunk;
+            task.bytes += chunk;
+            budget -= chunk;
+            if (task.offset == size)
+            {
+                ++task.section;
+                task.offset = 0;
+            }
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (task.section < sections)
+        {
+            task.uploadMs += millisecondsSince(start);
+            return false;
+        }
+    }
+    else
+    {
+        const std::size_t rowSize = static_cast<std::size_t>(task.width) * 4;
+        if (!task.started)
+        {
+            task.started = true;
+            glGenTextures(1, &task.texture);
+            glBindTexture(GL_TEXTURE_2D, task.texture);
+            allocateTextureStorage(GL_TEXTURE_2D,
+                                   computeMipLevels(task.width, task.height),
+                                   GL_RGBA8, task.width, task.height, 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, task.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // Whole rows, at least one per call
+        while (task.section < static_cast<std::size_t>(task.height) && budget > 0)
+        {
+            const std::size_t rows = std::min({
+                static_cast<std::size_t>(task.height) - task.section,
+                std::max<std::size_t>(std::min(budget, UPLOAD_CHUNK) / rowSize, 1) });
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(task.section),
+                            task.width, static_cast<GLsizei>(rows), GL_RGBA,
+                            GL_UNSIGNED_BYTE, &task.pixels[task.section * rowSize]);
+            task.section += rows;
+            task.bytes += rows * rowSize;
+            budget -= std::min(budget, rows * rowSize);
+        }
+        if (task.section < static_cast<std::size_t>(task.height))
+        {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            task.uploadMs += millisecondsSince(start);
+            return false;
+        }
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    // The fence tells the render thread when the commands have completed;
+    // flushing makes sure it is ever reached
+    task.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    task.uploadMs += millisecondsSince(start);
+    return true;
+}
+
+/**
+* @section Render thread Member functions
+*/
+
+void AssetLoader::poll()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Without an upload thread the decoded tasks are uploaded here
+        if (!hasUploadThread())
+        {
+            for (std::unique_ptr<Task>& task : uploadQueue_)
+            {
+                mainUploads_.push_back(std::move(task));
+            }
+            uploadQueue_.clear();
+        }
+        for (std::unique_ptr<Task>& task : doneQueue_)
+        {
+            fenced_.push_back(std::move(task));
+        }
+        doneQueue_.clear();
+    }
+
+    std::size_t budget = FALLBACK_UPLOAD_BUDGET;
+    while (!mainUploads_.empty() && budget > 0)
+    {
+        if (!upload(*mainUploads_.front(), budget))
+        {
+            break;
+        }
+        fenced_.push_back(std::move(mainUploads_.front()));
+        mainUploads_.pop_front();
+    }
+
+    // Fences signal in order of submission per context, but tasks of
+    // different contexts may finish in any order
+    for (auto it = fenced_.begin(); it != fenced_.end(); )
+    {
+        Task& task = **it;
+        if (task.error.empty())
+        {
+            const GLenum status = glClientWaitSync(task.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                ++it;
+                continue;
+            }
+        }
+        complete(task);
+        it = fenced_.erase(it);
+    }
+}
+
+void AssetLoader::finish()
+{
+    while (pending_ > 0)
+    {
+        poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void AssetLoader::complete(Task& task)
+{
+    Entry& entry = entries_[task.handle];
+    entry.readMs = task.readMs;
+    entry.uploadMs = task.uploadMs;
+    entry.bytes = task.bytes;
+    entry.readyMs = millisecondsSince(task.requested);
+    --pending_;
+    if (task.fence)
+    {
+        glDeleteSync(task.fence);
+        task.fence = nullptr;
+    }
+    if (!task.error.empty())
+    {
+        entry.state = State::Failed;
+        entry.error = task.error;
+        ++stats_.failed;
+        return;
+    }
+    if (task.kind == Kind::Mesh)
+    {
+        // Vertex arrays belong to one context, so the render thread makes it
+        entry.mesh = std::make_unique<BufferSetup>(task.mesh->getLayout(), task.buffers,
+                        task.elementBuffer,
+                        static_cast<GLsizei>(task.mesh->getVertexCount()),
+                        static_cast<GLsizei>(task.mesh->getIndexCount()));
+        entry.bounds = task.mesh->getBounds();
+        task.buffers.clear();
+        task.elementBuffer = 0;
+        ++stats_.meshes;
+    }
+    else
+    {
+        entry.texture = task.texture;
+        task.texture = 0;
+        ++stats_.textures;
+    }
+    stats_.bytesUploaded += task.bytes;
+    entry.state = State::Ready;
+}
+
+void AssetLoader::discard(Task& task)
+{
+    glDeleteBuffers(static_cast<GLsizei>(task.buffers.size()), task.buffers.data());
+    glDeleteBuffers(1, &task.elementBuffer);
+    glDeleteTextures(1, &task.texture);
+    if (task.fence)
+    {
+        glDeleteSync(task.fence);
+    }
+}
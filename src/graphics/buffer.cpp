@@ -1,7 +1,58 @@
 #include "buffer.hpp"
+#include <algorithm>
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @var UPLOAD_CHUNK
+ * @brief Largest block handed to the driver at once. Large meshes are 
+ * uploaded in pieces, which keeps the driver's staging memory small and 
+ * lets the pages of a mapped file be read while earlier pieces are copied.
+ */
+static constexpr std::size_t UPLOAD_CHUNK{ std::size_t{ 64 } << 20 };
+
+static void setAttributes(const VertexLayout& layout, 
+                          const std::vector<unsigned int>& buffers)
+{
+    for (const VertexAttribute& attribute : layout.getAttributes())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[attribute.stream]);
+        glVertexAttribPointer(attribute.location, attribute.components, 
+                              getAttributeType(attribute.format), 
+                              isNormalized(attribute.format) ? GL_TRUE : GL_FALSE,
+                              static_cast<GLsizei>(layout.getStride(attribute.stream)),
+                              (void*)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+static void uploadBuffer(GLenum target, std::size_t size, const void* data, 
+                         GLenum DRAW_TYPE)
+{
+    if (size <= UPLOAD_CHUNK)
+    {
+        glBufferData(target, static_cast<GLsizeiptr>(size), data, DRAW_TYPE);
+        return;
+    }
+    glBufferData(target, static_cast<GLsizeiptr>(size), nullptr, DRAW_TYPE);
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t offset = 0; offset < size; offset += UPLOAD_CHUNK)
+    {
+        glBufferSubData(target, static_cast<GLintptr>(offset), 
+                        static_cast<GLsizeiptr>(std::min(UPLOAD_CHUNK, size - offset)),
+                        bytes + offset);
+    }
+}
+
 
 BufferSetup::BufferSetup(const std::vector<float> &vertices, 
                             const GLenum &DRAW_TYPE)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, 
+      vertexCount_{ static_cast<GLsizei>(vertices.size() / 3) }, 
+      indexCount_{ 0 }, instanceCount_{ 0 }, ownsVertexBuffer_{ true }, 
+      arena_{ nullptr }, allocation_{ 0 }
 {
     // Generate and bind VAO first
     glGenVertexArrays(1, &VAO_);
@@ -26,4 +77,421 @@ BufferSetup::BufferSetup(const std::vector<float> &vertices,
     glBindVertexArray(0);
 }
 
+BufferSetup::BufferSetup(const Mesh &mesh, const GLenum &DRAW_TYPE)
+    : BufferSetup(mesh.vertices, DRAW_TYPE)
+{
+    indexCount_ = static_cast<GLsizei>(mesh.indices.size());
+    glBindVertexArray(VAO_);
+
+    // The element buffer binding is part of the VAO state
+    glGenBuffers(1, &EBO_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 
+                    mesh.indices.size() * sizeof(GLuint), 
+                    mesh.indices.data(), 
+                    DRAW_TYPE);
+
+    // Unbind the VAO before the EBO, which would otherwise detach it
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+BufferSetup::BufferSetup(const VertexLayout &layout, 
+                            const std::vector<std::vector<std::uint8_t>> &streams,
+                            const std::vector<GLuint> &indices,
+                            const GLenum &DRAW_TYPE)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, 
+      indexCount_{ static_cast<GLsizei>(indices.size()) }, instanceCount_{ 0 },
+      ownsVertexBuffer_{ true }, arena_{ nullptr }, allocation_{ 0 }
+{
+    if (streams.size() != layout.getStreamCount() || streams.empty())
+    {
+        throw std::logic_error("ERROR::BUFFER::STREAM_MISMATCH\n");
+    }
+    std::vector<const void*> data;
+    std::vector<std::size_t> sizes;
+    for (const std::vector<std::uint8_t>& stream : streams)
+    {
+        data.push_back(stream.data());
+        sizes.push_back(stream.size());
+    }
+    createStreams(layout, data, sizes, indices.data(), DRAW_TYPE);
+}
+
+BufferSetup::BufferSetup(const MeshFile &file, const GLenum &DRAW_TYPE)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, 
+      indexCount_{ static_cast<GLsizei>(file.getIndexCount()) }, instanceCount_{ 0 },
+      ownsVertexBuffer_{ true }, arena_{ nullptr }, allocation_{ 0 }
+{
+    // The mapped sections are handed to the driver as they are
+    std::vector<const void*> data;
+    std::vector<std::size_t> sizes;
+    for (std::size_t s = 0; s < file.getLayout().getStreamCount(); ++s)
+    {
+        data.push_back(file.getStream(s));
+        sizes.push_back(file.getStreamSize(s));
+    }
+    createStreams(file.getLayout(), data, sizes, file.getIndices(), DRAW_TYPE);
+}
+
+BufferSetup::BufferSetup(const VertexLayout &layout, 
+                            const std::vector<unsigned int> &buffers,
+                            unsigned int elementBuffer, GLsizei vertexCount,
+                            GLsizei indexCount)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ elementBuffer }, vertexCount_{ vertexCount }, 
+      indexCount_{ indexCount }, instanceCount_{ 0 }, ownsVertexBuffer_{ true }, 
+      arena_{ nullptr }, allocation_{ 0 }
+{
+    if (buffers.size() != layout.getStreamCount() || buffers.empty())
+    {
+        throw std::logic_error("ERROR::BUFFER::STREAM_MISMATCH\n");
+    }
+    VBO_ = buffers[0];
+    streamVBOs_.assign(buffers.begin() + 1, buffers.end());
+
+    glGenVertexArrays(1, &VAO_);
+    glBindVertexArray(VAO_);
+    setAttributes(layout, buffers);
+    if (EBO_ != 0)
+    {
+        // The element buffer binding is part of the VAO state
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    }
+
+    // Unbind VAO and VBO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
+BufferSetup::BufferSetup(BufferArena &arena, const std::vector<float> &vertices)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, indexCount_{ 0 }, 
+      instanceCount_{ 0 }, ownsVertexBuffer_{ false }, arena_{ &arena }, 
+      allocation_{ 0 }
+{
+    if (arena.getLayout().getStreamCount() != 1)
+    {
+        throw std::logic_error("ERROR::BUFFER::STREAM_MISMATCH\n");
+    }
+    const std::size_t vertexCount = vertices.size() * sizeof(float) / 
+                                    arena.getLayout().getStride(0);
+    allocateFrom(vertexCount, { vertices.data() }, {});
+}
+
+BufferSetup::BufferSetup(BufferArena &arena, const Mesh &mesh)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, indexCount_{ 0 }, 
+      instanceCount_{ 0 }, ownsVertexBuffer_{ false }, arena_{ &arena }, 
+      allocation_{ 0 }
+{
+    if (arena.getLayout().getStreamCount() != 1)
+    {
+        throw std::logic_error("ERROR::BUFFER::STREAM_MISMATCH\n");
+    }
+    const std::size_t vertexCount = mesh.vertices.size() * sizeof(float) / 
+                                    arena.getLayout().getStride(0);
+    allocateFrom(vertexCount, { mesh.vertices.data() }, mesh.indices);
+}
+
+BufferSetup::BufferSetup(BufferArena &arena, 
+                            const std::vector<std::vector<std::uint8_t>> &streams,
+                            const std::vector<GLuint> &indices)
+    : VBO_{ 0 }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, indexCount_{ 0 }, 
+      instanceCount_{ 0 }, ownsVertexBuffer_{ false }, arena_{ &arena }, 
+      allocation_{ 0 }
+{
+    if (streams.size() != arena.getLayout().getStreamCount())
+    {
+        throw std::logic_error("ERROR::BUFFER::STREAM_MISMATCH\n");
+    }
+    std::vector<const void*> data;
+    for (const std::vector<std::uint8_t>& stream : streams)
+    {
+        data.push_back(stream.data());
+    }
+    allocateFrom(streams[0].size() / arena.getLayout().getStride(0), data, indices);
+}
+
+void BufferSetup::createStreams(const VertexLayout &layout, 
+                                const std::vector<const void*> &streams,
+                                const std::vector<std::size_t> &sizes,
+                                const GLuint *indices, const GLenum &DRAW_TYPE)
+{
+    vertexCount_ = static_cast<GLsizei>(sizes[0] / layout.getStride(0));
+
+    // Generate and bind VAO first
+    glGenVertexArrays(1, &VAO_);
+    glBindVertexArray(VAO_);
+
+    // One vertex buffer per stream
+    std::vector<unsigned int> buffers(streams.size());
+    glGenBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+    for (std::size_t s = 0; s < streams.size(); ++s)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[s]);
+        uploadBuffer(GL_ARRAY_BUFFER, sizes[s], streams[s], DRAW_TYPE);
+    }
+    VBO_ = buffers[0];
+    streamVBOs_.assign(buffers.begin() + 1, buffers.end());
+
+    // Point every attribute at its stream, format and offset
+    setAttributes(layout, buffers);
+
+    if (indexCount_ > 0)
+    {
+        // The element buffer binding is part of the VAO state
+        glGenBuffers(1, &EBO_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+        uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexCount_ * sizeof(GLuint), indices, 
+                     DRAW_TYPE);
+    }
+
+    // Unbind VAO and VBO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void BufferSetup::allocateFrom(std::size_t vertexCount, 
+                               const std::vector<const void*> &streams,
+                               const std::vector<GLuint> &indices)
+{
+    allocation_ = arena_->allocate(vertexCount, streams, 
+                                   indices.empty() ? nullptr : indices.data(),
+                                   indices.size());
+    vertexCount_ = static_cast<GLsizei>(vertexCount);
+    indexCount_ = static_cast<GLsizei>(indices.size());
+}
+
+BufferSetup::BufferSetup(const StreamingBuffer &stream)
+    : VBO_{ stream.getBufferId() }, VAO_{ 0 }, EBO_{ 0 }, vertexCount_{ 0 }, 
+      indexCount_{ 0 }, instanceCount_{ 0 }, ownsVertexBuffer_{ false }, 
+      arena_{ nullptr }, allocation_{ 0 }
+{
+    // Generate and bind VAO first
+    glGenVertexArrays(1, &VAO_);
+    glBindVertexArray(VAO_);
+
+    // Read vertices from the stream, whose contents change every frame
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);  // Enable vertex attribute 0
+
+    // Unbind VAO and VBO
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+BufferSetup::~BufferSetup()
+{
+    release();
+}
+
+BufferSetup::BufferSetup(BufferSetup &&other) noexcept
+    : VBO_{ other.VBO_ }, VAO_{ other.VAO_ }, EBO_{ other.EBO_ }, 
+      streamVBOs_{ std::move(other.streamVBOs_) }, 
+      instanceVBOs_{ std::move(other.instanceVBOs_) },
+      vertexCount_{ other.vertexCount_ }, indexCount_{ other.indexCount_ }, 
+      instanceCount_{ other.instanceCount_ }, 
+      ownsVertexBuffer_{ other.ownsVertexBuffer_ }, arena_{ other.arena_ }, 
+      allocation_{ other.allocation_ }
+{
+    // Leave nothing behind for the other destructor to release
+    other.VBO_ = 0;
+    other.VAO_ = 0;
+    other.EBO_ = 0;
+    other.streamVBOs_.clear();
+    other.instanceVBOs_.clear();
+    other.arena_ = nullptr;
+}
+
+BufferSetup& BufferSetup::operator=(BufferSetup &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        VBO_ = other.VBO_;
+        VAO_ = other.VAO_;
+        EBO_ = other.EBO_;
+        streamVBOs_ = std::move(other.streamVBOs_);
+        instanceVBOs_ = std::move(other.instanceVBOs_);
+        vertexCount_ = other.vertexCount_;
+        indexCount_ = other.indexCount_;
+        instanceCount_ = other.instanceCount_;
+        ownsVertexBuffer_ = other.ownsVertexBuffer_;
+        arena_ = other.arena_;
+        allocation_ = other.allocation_;
+        other.VBO_ = 0;
+        other.VAO_ = 0;
+        other.EBO_ = 0;
+        other.streamVBOs_.clear();
+        other.instanceVBOs_.clear();
+        other.arena_ = nullptr;
+    }
+    return *this;
+}
+
+void BufferSetup::release()
+{
+    if (arena_)
+    {
+        arena_->free(allocation_);
+        arena_ = nullptr;
+        return;
+    }
+    // Deleting the name 0 is ignored, so moved-from objects are fine
+    glDeleteVertexArrays(1, &VAO_);
+    if (ownsVertexBuffer_)
+    {
+        glDeleteBuffers(1, &VBO_);
+    }
+    glDeleteBuffers(1, &EBO_);
+    glDeleteBuffers(static_cast<GLsizei>(streamVBOs_.size()), streamVBOs_.data());
+    glDeleteBuffers(static_cast<GLsizei>(instanceVBOs_.size()), instanceVBOs_.data());
+    VAO_ = 0;
+    VBO_ = 0;
+    EBO_ = 0;
+    streamVBOs_.clear();
+    instanceVBOs_.clear();
+}
+
+unsigned int BufferSetup::getVBOId() const
+{
+    return arena_ ? arena_->getVBOId() : VBO_;
+}
+
+unsigned int BufferSetup::getVAOId() const
+{
+    return arena_ ? arena_->getVAOId() : VAO_;
+}
+
+unsigned int BufferSetup::getEBOId() const
+{
+    if (indexCount_ == 0)
+    {
+        return 0;
+    }
+    return arena_ ? arena_->getEBOId() : EBO_;
+}
+
+GLint BufferSetup::getFirstVertex() const
+{
+    return arena_ ? arena_->getFirstVertex(allocation_) : 0;
+}
+
+GLuint BufferSetup::getFirstIndex() const
+{
+    return arena_ ? arena_->getFirstIndex(allocation_) : 0;
+}
+
+void BufferSetup::addInstanceBuffer(const std::vector<float> &data, 
+                            const std::vector<InstanceAttribute> &attributes,
+                            const GLenum &DRAW_TYPE)
+{
+    if (arena_)
+    {
+        // Instance attributes would change the VAO of every mesh in the arena
+        throw std::logic_error("ERROR::BUFFER::SHARED_VAO\n");
+    }
+    // Sum the components of one instance to get the stride
+    GLsizei components = 0;
+    for (const InstanceAttribute& attribute : attributes)
+    {
+        components += attribute.components;
+    }
+    if (components == 0 || data.size() % components != 0)
+    {
+        throw std::logic_error("ERROR::BUFFER::INSTANCE_LAYOUT_MISMATCH\n");
+    }
+
+    glBindVertexArray(VAO_);
+
+    // Generate and fill the instance buffer
+    unsigned int instanceVBO;
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 
+                    data.size() * sizeof(float), 
+                    data.data(), 
+                    DRAW_TYPE);
+    instanceVBOs_.push_back(instanceVBO);
+
+    // Point every attribute at its interleaved position and make it advance
+    // per instance instead of per vertex
+    const GLsizei stride = components * sizeof(float);
+    std::size_t offset = 0;
+    for (const InstanceAttribute& attribute : attributes)
+    {
+        glVertexAttribPointer(attribute.location, attribute.components, 
+                              GL_FLOAT, GL_FALSE, stride, 
+                              (void*)(offset * sizeof(float)));
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribDivisor(attribute.location, attribute.divisor);
+        offset += attribute.components;
+    }
+
+    // The smallest divisor decides how many instances the data covers
+    GLuint divisor = attributes.front().divisor;
+    for (const InstanceAttribute& attribute : attributes)
+    {
+        divisor = attribute.divisor < divisor ? attribute.divisor : divisor;
+    }
+    instanceCount_ = static_cast<GLsizei>(data.size() / components) * 
+                     static_cast<GLsizei>(divisor > 0 ? divisor : 1);
+
+    // Unbind VAO and VBO
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void BufferSetup::setInstanceIndices(GLuint location, unsigned int buffer, 
+                                     GLintptr offset)
+{
+    if (arena_)
+    {
+        throw std::logic_error("ERROR::BUFFER::SHARED_VAO\n");
+    }
+    glBindVertexArray(VAO_);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    // Integer attribute, so the indices are not converted to float
+    glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(GLuint), 
+                           (void*)offset);
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void BufferSetup::draw(GLenum mode) const
+{
+    glBindVertexArray(getVAOId());
+    if (indexCount_ > 0)
+    {
+        // Arena meshes start somewhere inside the shared buffers
+        const std::size_t firstIndex = getFirstIndex();
+        glDrawElementsBaseVertex(mode, indexCount_, GL_UNSIGNED_INT, 
+                                 (void*)(firstIndex * sizeof(GLuint)), 
+                                 getFirstVertex());
+        return;
+    }
+    glDrawArrays(mode, getFirstVertex(), vertexCount_);
+}
+
+void BufferSetup::draw(GLint first, GLsizei count, GLenum mode) const
+{
+    glBindVertexArray(getVAOId());
+    glDrawArrays(mode, getFirstVertex() + first, count);
+}
+
+void BufferSetup::drawInstanced(GLsizei instances, GLenum mode) const
+{
+    glBindVertexArray(getVAOId());
+    if (indexCount_ > 0)
+    {
+        const std::size_t firstIndex = getFirstIndex();
+        glDrawElementsInstancedBaseVertex(mode, indexCount_, GL_UNSIGNED_INT, 
+                                          (void*)(firstIndex * sizeof(GLuint)), 
+                                          instances, getFirstVertex());
+        return;
+    }
+    glDrawArraysInstanced(mode, getFirstVertex(), vertexCount_, instances);
+}
@@ -0,0 +1,384 @@
+#include "buffer_arena.hpp"
+#include <algorithm>
+#include <string>
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @brief A range to copy from the old buffers into the new ones.
+ */
+struct CopyRange
+{
+    std::uint32_t source;
+    std::uint32_t destination;
+    std::uint32_t size;
+};
+
+/**
+ * @brief Copies ranges of elementSize byte units between two buffers.
+ */
+static std::size_t copyRanges(unsigned int source, unsigned int destination, 
+                              const std::vector<CopyRange>& ranges, 
+                              std::size_t elementSize)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    std::size_t bytes = 0;
+    for (const CopyRange& range : ranges)
+    {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 
+                            static_cast<GLintptr>(range.source * elementSize),
+                            static_cast<GLintptr>(range.destination * elementSize),
+                            static_cast<GLsizeiptr>(range.size * elementSize));
+        bytes += range.size * elementSize;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return bytes;
+}
+
+/**
+ * @brief Packs ranges to the front in their current order, merging ranges 
+ * that stay next to each other into one copy.
+ */
+static std::vector<CopyRange> packRanges(std::vector<CopyRange> ranges)
+{
+    std::sort(ranges.begin(), ranges.end(), 
+              [](const CopyRange& a, const CopyRange& b) { return a.source < b.source; });
+    std::vector<CopyRange> merged;
+    std::uint32_t next = 0;
+    for (CopyRange range : ranges)
+    {
+        range.destination = next;
+        next += range.size;
+        if (!merged.empty() && 
+            merged.back().source + merged.back().size == range.source &&
+            merged.back().destination + merged.back().size == range.destination)
+        {
+            merged.back().size += range.size;
+            continue;
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+/**
+* @section Constructor
+*/
+
+BufferArena::BufferArena(const VertexLayout& layout, std::uint32_t vertexCapacity, 
+                         std::uint32_t indexCapacity)
+    : layout_{ layout }, VAO_{ 0 }, VBOs_(layout.getStreamCount(), 0), EBO_{ 0 },
+      vertices_{ vertexCapacity }, indices_{ indexCapacity }
+{
+    if (layout_.getStreamCount() == 0)
+    {
+        throw std::logic_error("ERROR::BUFFER_ARENA::EMPTY_LAYOUT\n");
+    }
+    glGenVertexArrays(1, &VAO_);
+    glGenBuffers(static_cast<GLsizei>(VBOs_.size()), VBOs_.data());
+    glGenBuffers(1, &EBO_);
+    for (std::size_t s = 0; s < VBOs_.size(); ++s)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBOs_[s]);
+        glBufferData(GL_COPY_WRITE_BUFFER, 
+                     static_cast<GLsizeiptr>(vertexCapacity * layout_.getStride(s)),
+                     nullptr, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO_);
+    glBufferData(GL_COPY_WRITE_BUFFER, 
+                 static_cast<GLsizeiptr>(indexCapacity * sizeof(GLuint)), 
+                 nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    bindAttributes();
+}
+
+BufferArena::~BufferArena()
+{
+    glDeleteVertexArrays(1, &VAO_);
+    glDeleteBuffers(static_cast<GLsizei>(VBOs_.size()), VBOs_.data());
+    glDeleteBuffers(1, &EBO_);
+}
+
+void BufferArena::bindAttributes()
+{
+    glBindVertexArray(VAO_);
+    for (const VertexAttribute& attribute : layout_.getAttributes())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBOs_[attribute.stream]);
+        glVertexAttribPointer(attribute.location, attribute.components, 
+                              getAttributeType(attribute.format), 
+                              isNormalized(attribute.format) ? GL_TRUE : GL_FALSE,
+                              static_cast<GLsizei>(layout_.getStride(attribute.stream)),
+                              (void*)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+
+    // Unbind the VAO before the buffers, which would otherwise detach the EBO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/**
+* @section Allocation
+*/
+
+BufferArena::Handle BufferArena::allocate(std::size_t vertexCount, 
+                                          const std::vector<const void*>& streams,
+                                          const GLuint* indices, 
+                                          std::size_t indexCount)
+{
+    if (streams.size() != VBOs_.size() || vertexCount == 0)
+    {
+        throw std::logic_error("ERROR::BUFFER_ARENA::LAYOUT_MISMATCH\n");
+    }
+    const std::uint32_t vertexSize = static_cast<std::uint32_t>(vertexCount);
+    const std::uint32_t indexSize = indices ? static_cast<std::uint32_t>(indexCount) 
+                                            : 0;
+
+    OffsetAllocator::Allocation vertexRange = vertices_.allocate(vertexSize);
+    OffsetAllocator::Allocation indexRange{ 0, OffsetAllocator::NO_SPACE };
+    if (indexSize > 0)
+    {
+        indexRange = indices_.allocate(indexSize);
+    }
+    if (vertexRange.node == OffsetAllocator::NO_SPACE || 
+        (indexSize > 0 && indexRange.node == OffsetAllocator::NO_SPACE))
+    {
+        // Give back what did fit, then make room for both
+        if (vertexRange.node != OffsetAllocator::NO_SPACE)
+        {
+            vertices_.free(vertexRange.node);
+        }
+        if (indexRange.node != OffsetAllocator::NO_SPACE)
+        {
+            indices_.free(indexRange.node);
+        }
+        reserve(vertexSize, indexSize);
+        vertexRange = vertices_.allocate(vertexSize);
+        if (indexSize > 0)
+        {
+            indexRange = indices_.allocate(indexSize);
+        }
+        if (vertexRange.node == OffsetAllocator::NO_SPACE || 
+            (indexSize > 0 && indexRange.node == OffsetAllocator::NO_SPACE))
+        {
+            // Uploading at the offset of a failed allocation would overwrite 
+            // a live mesh
+            if (vertexRange.node != OffsetAllocator::NO_SPACE)
+            {
+                vertices_.free(vertexRange.node);
+            }
+            if (indexRange.node != OffsetAllocator::NO_SPACE)
+            {
+                indices_.free(indexRange.node);
+            }
+            throw std::logic_error("ERROR::BUFFER_ARENA::NO_SPACE\n " + 
+                                   std::to_string(vertexSize) + " vertices, " + 
+                                   std::to_string(indexSize) + " indices");
+        }
+    }
+
+    // Upload through the copy target, which leaves every VAO untouched
+    for (std::size_t s = 0; s < VBOs_.size(); ++s)
+    {
+        const std::size_t stride = layout_.getStride(s);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBOs_[s]);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, 
+                        static_cast<GLintptr>(vertexRange.offset * stride),
+                        static_cast<GLsizeiptr>(vertexSize * stride), streams[s]);
+    }
+    if (indexSize > 0)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO_);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, 
+                        static_cast<GLintptr>(indexRange.offset * sizeof(GLuint)),
+                        static_cast<GLsizeiptr>(indexSize * sizeof(GLuint)), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    const Slot slot{ vertexRange.node, indexRange.node, true };
+    if (!freeSlots_.empty())
+    {
+        const Handle handle = freeSlots_.back();
+        freeSlots_.pop_back();
+        slots_[handle] = slot;
+        return handle;
+    }
+    slots_.push_back(slot);
+    return slots_.size() - 1;
+}
+
+void BufferArena::free(Handle handle)
+{
+    Slot& slot = slots_[handle];
+    vertices_.free(slot.vertexNode);
+    if (slot.indexNode != OffsetAllocator::NO_SPACE)
+    {
+        indices_.free(slot.indexNode);
+    }
+    slot.live = false;
+    freeSlots_.push_back(handle);
+}
+
+GLint BufferArena::getFirstVertex(Handle handle) const
+{
+    return static_cast<GLint>(vertices_.getOffset(slots_[handle].vertexNode));
+}
+
+GLuint BufferArena::getFirstIndex(Handle handle) const
+{
+    const Slot& slot = slots_[handle];
+    return slot.indexNode != OffsetAllocator::NO_SPACE ? 
+           indices_.getOffset(slot.indexNode) : 0;
+}
+
+/**
+* @section Maintenance
+*/
+
+void BufferArena::reserve(std::uint32_t vertices, std::uint32_t indices)
+{
+    // Compacting is enough if the free space would fit in one piece
+    std::uint32_t vertexCapacity = vertices_.getCapacity();
+    if (vertices_.getFreeSize() < vertices)
+    {
+        vertexCapacity = std::max(vertexCapacity * 2, 
+                                  vertexCapacity - vertices_.getFreeSize() + vertices);
+    }
+    std::uint32_t indexCapacity = indices_.getCapacity();
+    if (indices_.getFreeSize() < indices)
+    {
+        indexCapacity = std::max(indexCapacity * 2, 
+                                 indexCapacity - indices_.getFreeSize() + indices);
+    }
+    if (vertexCapacity != vertices_.getCapacity() || 
+        indexCapacity != indices_.getCapacity())
+    {
+        ++stats_.grows;
+    }
+    else
+    {
+        ++stats_.defragmentations;
+    }
+    rebuild(vertexCapacity, indexCapacity);
+}
+
+void BufferArena::defragment()
+{
+    ++stats_.defragmentations;
+    rebuild(vertices_.getCapacity(), indices_.getCapacity());
+}
+
+void BufferArena::rebuild(std::uint32_t vertexCapacity, std::uint32_t indexCapacity)
+{
+    // Where every live range is now, and where it goes
+    std::vector<CopyRange> vertexRanges;
+    std::vector<CopyRange> indexRanges;
+    std::vector<std::pair<std::uint32_t, Handle>> vertexOrder;
+    std::vector<std::pair<std::uint32_t, Handle>> indexOrder;
+    for (Handle handle = 0; handle < slots_.size(); ++handle)
+    {
+        const Slot& slot = slots_[handle];
+        if (!slot.live)
+        {
+            continue;
+        }
+        const std::uint32_t vertexOffset = vertices_.getOffset(slot.vertexNode);
+        vertexRanges.push_back({ vertexOffset, vertexOffset, 
+                                 vertices_.getSize(slot.vertexNode) });
+        vertexOrder.push_back({ vertexOffset, handle });
+        if (slot.indexNode != OffsetAllocator::NO_SPACE)
+        {
+            const std::uint32_t indexOffset = indices_.getOffset(slot.indexNode);
+            indexRanges.push_back({ indexOffset, indexOffset, 
+                                    indices_.getSize(slot.indexNode) });
+            indexOrder.push_back({ indexOffset, handle });
+        }
+    }
+    vertexRanges = packRanges(vertexRanges);
+    indexRanges = packRanges(indexRanges);
+
+    // New buffers receive the live ranges, the old ones are dropped
+    std::vector<unsigned int> newVBOs(VBOs_.size());
+    glGenBuffers(static_cast<GLsizei>(newVBOs.size()), newVBOs.data());
+    for (std::size_t s = 0; s < VBOs_.size(); ++s)
+    {
+        const std::size_t stride = layout_.getStride(s);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBOs[s]);
+        glBufferData(GL_COPY_WRITE_BUFFER, 
+                     static_cast<GLsizeiptr>(vertexCapacity * stride),
+                     nullptr, GL_STATIC_DRAW);
+        stats_.bytesMoved += copyRanges(VBOs_[s], newVBOs[s], vertexRanges, stride);
+    }
+    unsigned int newEBO;
+    glGenBuffers(1, &newEBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, 
+                 static_cast<GLsizeiptr>(indexCapacity * sizeof(GLuint)),
+                 nullptr, GL_STATIC_DRAW);
+    stats_.bytesMoved += copyRanges(EBO_, newEBO, indexRanges, sizeof(GLuint));
+    glDeleteBuffers(static_cast<GLsizei>(VBOs_.size()), VBOs_.data());
+    glDeleteBuffers(1, &EBO_);
+    VBOs_ = newVBOs;
+    EBO_ = newEBO;
+    bindAttributes();
+
+    // Allocating in address order from empty allocators hands out the 
+    // packed offsets again
+    std::sort(vertexOrder.begin(), vertexOrder.end());
+    std::sort(indexOrder.begin(), indexOrder.end());
+    std::vector<std::uint32_t> vertexSizes(slots_.size(), 0);
+    std::vector<std::uint32_t> indexSizes(slots_.size(), 0);
+    for (const std::pair<std::uint32_t, Handle>& entry : vertexOrder)
+    {
+        vertexSizes[entry.second] = vertices_.getSize(slots_[entry.second].vertexNode);
+    }
+    for (const std::pair<std::uint32_t, Handle>& entry : indexOrder)
+    {
+        indexSizes[entry.second] = indices_.getSize(slots_[entry.second].indexNode);
+    }
+    vertices_.reset(vertexCapacity);
+    indices_.reset(indexCapacity);
+    for (const std::pair<std::uint32_t, Handle>& entry : vertexOrder)
+    {
+        slots_[entry.second].vertexNode = 
+            vertices_.allocate(vertexSizes[entry.second]).node;
+        if (slots_[entry.second].vertexNode == OffsetAllocator::NO_SPACE)
+        {
+            throw std::logic_error("ERROR::BUFFER_ARENA::REBUILD\n " + 
+                                   std::to_string(vertexCapacity) + " vertices");
+        }
+    }
+    for (const std::pair<std::uint32_t, Handle>& entry : indexOrder)
+    {
+        slots_[entry.second].indexNode = 
+            indices_.allocate(indexSizes[entry.second]).node;
+        if (slots_[entry.second].indexNode == OffsetAllocator::NO_SPACE)
+        {
+            throw std::logic_error("ERROR::BUFFER_ARENA::REBUILD\n " + 
+                                   std::to_string(indexCapacity) + " indices");
+        }
+    }
+}
+
+BufferArenaStats BufferArena::getStats() const
+{
+    BufferArenaStats stats = stats_;
+    stats.allocations = slots_.size() - freeSlots_.size();
+    stats.vertexCapacity = vertices_.getCapacity();
+    stats.usedVertices = vertices_.getCapacity() - vertices_.getFreeSize();
+    stats.indexCapacity = indices_.getCapacity();
+    stats.usedIndices = indices_.getCapacity() - indices_.getFreeSize();
+    if (vertices_.getFreeSize() > 0)
+    {
+        stats.fragmentation = 1.0 - static_cast<double>(vertices_.getLargestFree()) / 
+                                    vertices_.getFreeSize();
+    }
+    return stats;
+}
@@ -0,0 +1,628 @@
+#include "frame_capture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+/**
+ * @var FENCE_TIMEOUT
+ * @brief Nanoseconds waited for a fence before waiting again.
+ */
+static constexpr GLuint64 FENCE_TIMEOUT{ 1000000000 };
+
+/**
+* @section Formats
+*/
+
+bool parseCaptureFormat(const std::string& name, CaptureFormat& format)
+{
+    if (name == "png")
+    {
+        format = CaptureFormat::Png;
+    }
+    else if (name == "raw")
+    {
+        format = CaptureFormat::Raw;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+* @section PNG encoding
+*/
+
+static std::uint32_t crc32(const std::uint8_t* data, std::size_t size,
+                           std::uint32_t crc = 0)
+{
+    static const std::array<std::uint32_t, 256> table = []()
+    {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static std::uint32_t adler32(const std::uint8_t* data, std::size_t size)
+{
+    // 5552 bytes are the most that cannot overflow before the modulo
+    std::uint32_t a = 1, b = 0;
+    while (size > 0)
+    {
+        const std::size_t block = std::min<std::size_t>(size, 5552);
+        for (std::size_t i = 0; i < block; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+/**
+ * @class BitWriter
+ * @brief Appends bit fields to a byte vector, least significant bit first
+ * as deflate stores them.
+ */
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out_(out), bits_{ 0 }, count_{ 0 } {}
+
+    void write(std::uint32_t value, int count)
+    {
+        bits_ |= static_cast<std::uint64_t>(value) << count_;
+        count_ += count;
+        while (count_ >= 8)
+        {
+            out_.push_back(static_cast<std::uint8_t>(bits_));
+            bits_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    /**
+     * @brief Writes a Huffman code, which deflate stores most significant
+     * bit first.
+     */
+    void writeCode(std::uint32_t code, int count)
+    {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        write(reversed, count);
+    }
+
+    void flush()
+    {
+        if (count_ > 0)
+        {
+            out_.push_back(static_cast<std::uint8_t>(bits_));
+        }
+        bits_ = 0;
+        count_ = 0;
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+    std::uint64_t bits_;
+    int count_;
+};
+
+/**
+ * @struct FixedCode
+ * @brief A fixed Huffman code, bit reversed ready for the writer.
+ */
+struct FixedCode
+{
+    std::uint16_t bits;
+    std::uint8_t count;
+};
+
+static void writeLiteral(BitWriter& writer, std::uint32_t symbol)
+{
+    // The fixed Huffman code of RFC 1951, 3.2.6, reversed once
+    static const std::array<FixedCode, 288> codes = []()
+    {
+        std::array<FixedCode, 288> entries{};
+        for (std::uint32_t i = 0; i < 288; ++i)
+        {
+            std::uint32_t code = 0;
+            int count = 0;
+            if (i < 144)
+            {
+                code = 0x30 + i;
+                count = 8;
+            }
+            else if (i < 256)
+            {
+                code = 0x190 + i - 144;
+                count = 9;
+            }
+            else if (i < 280)
+            {
+                code = i - 256;
+                count = 7;
+            }
+            else
+            {
+                code = 0xC0 + i - 280;
+                count = 8;
+            }
+            std::uint32_t reversed = 0;
+            for (int bit = 0; bit < count; ++bit)
+            {
+                reversed = (reversed << 1) | ((code >> bit) & 1);
+            }
+            entries[i] = { static_cast<std::uint16_t>(reversed),
+                           static_cast<std::uint8_t>(count) };
+        }
+        return entries;
+    }();
+    writer.write(codes[symbol].bits, codes[symbol].count);
+}
+
+static void writeMatch(BitWriter& writer, std::size_t length, std::size_t distance)
+{
+    static const std::uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11,
+        13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163,
+        195, 227, 258 };
+    static const std::uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1,
+        1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const std::uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13,
+        17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049,
+        3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const std::uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2,
+        3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    int code = 28;
+    while (LENGTH_BASE[code] > length)
+    {
+        --code;
+    }
+    writeLiteral(writer, 257 + code);
+    writer.write(static_cast<std::uint32_t>(length - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+    code = 29;
+    while (DISTANCE_BASE[code] > distance)
+    {
+        --code;
+    }
+    writer.writeCode(static_cast<std::uint32_t>(code), 5);
+    writer.write(static_cast<std::uint32_t>(distance - DISTANCE_BASE[code]), DISTANCE_EXTRA[code]);
+}
+
+/**
+ * @brief Compresses data into a zlib stream of one fixed Huffman block,
+ * taking the most recent earlier occurrence of every 3 byte sequence as the
+ * match candidate.
+ */
+static void deflate(const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>& out)
+{
+    constexpr std::size_t WINDOW = 32768;
+    constexpr std::size_t MAX_MATCH = 258;
+    constexpr int HASH_BITS = 15;
+    std::vector<std::uint32_t> head(std::size_t{ 1 } << HASH_BITS, 0);
+    const auto hash = [&data](std::size_t i)
+    {
+        const std::uint32_t value = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+
+    // CMF and FLG: deflate with a 32 KiB window, fastest compression
+    out.push_back(0x78);
+    out.push_back(0x01);
+    BitWriter writer(out);
+    writer.write(1, 1);
+    writer.write(1, 2);
+    const std::size_t size = data.size();
+    std::size_t i = 0;
+    while (i < size)
+    {
+        std::size_t length = 0;
+        std::size_t distance = 0;
+        if (i + 3 <= size)
+        {
+            const std::uint32_t h = hash(i);
+            // Positions are stored plus one, so 0 means empty
+            const std::size_t candidate = head[h];
+            head[h] = static_cast<std::uint32_t>(i + 1);
+            if (candidate > 0 && i - (candidate - 1) <= WINDOW)
+            {
+                const std::uint8_t* a = data.data() + candidate - 1;
+                const std::uint8_t* b = data.data() + i;
+                const std::size_t limit = std::min(MAX_MATCH, size - i);
+                while (length < limit && a[length] == b[length])
+                {
+                    ++length;
+                }
+                distance = i - (candidate - 1);
+            }
+        }
+        if (length >= 3)
+        {
+            writeMatch(writer, length, distance);
+            i += length;
+        }
+        else
+        {
+            writeLiteral(writer, data[i]);
+            ++i;
+        }
+    }
+    writeLiteral(writer, 256);
+    writer.flush();
+
+    const std::uint32_t checksum = adler32(data.data(), data.size());
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        out.push_back(static_cast<std::uint8_t>(checksum >> shift));
+    }
+}
+
+static void appendChunk(std::vector<std::uint8_t>& file, const char* type,
+                        const std::uint8_t* data, std::size_t size)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        file.push_back(static_cast<std::uint8_t>(size >> shift));
+    }
+    const std::size_t start = file.size();
+    file.insert(file.end(), type, type + 4);
+    file.insert(file.end(), data, data + size);
+    const std::uint32_t crc = crc32(file.data() + start, size + 4);
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        file.push_back(static_cast<std::uint8_t>(crc >> shift));
+    }
+}
+
+std::vector<std::uint8_t> encodePng(const std::uint8_t* pixels, int width, int height)
+{
+    // Rows top down, each a filter byte and RGB minus the row above
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * 3;
+    std::vector<std::uint8_t> filtered((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        const std::uint8_t* row = pixels + static_cast<std::size_t>(height - 1 - y) * width * 4;
+        const std::uint8_t* above = y > 0 ? row + static_cast<std::size_t>(width) * 4 : nullptr;
+        std::uint8_t* out = filtered.data() + static_cast<std::size_t>(y) * (rowBytes + 1);
+        *out++ = 2;
+        for (int x = 0; x < width; ++x)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                *out++ = static_cast<std::uint8_t>(row[x * 4 + channel] -
+                                                   (above ? above[x * 4 + channel] : 0));
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::uint8_t header[13] = {};
+    for (int i = 0; i < 4; ++i)
+    {
+        header[i] = static_cast<std::uint8_t>(width >> (24 - 8 * i));
+        header[4 + i] = static_cast<std::uint8_t>(height >> (24 - 8 * i));
+    }
+    // 8 bits per channel, RGB, deflate, adaptive filters, no interlace
+    header[8] = 8;
+    header[9] = 2;
+    appendChunk(file, "IHDR", header, sizeof(header));
+    std::vector<std::uint8_t> compressed;
+    compressed.reserve(filtered.size() / 4);
+    deflate(filtered, compressed);
+    appendChunk(file, "IDAT", compressed.data(), compressed.size());
+    appendChunk(file, "IEND", nullptr, 0);
+    return file;
+}
+
+std::vector<std::uint8_t> encodePpm(const std::uint8_t* pixels, int width, int height)
+{
+    const std::string header = "P6\n" + std::to_string(width) + " " +
+                               std::to_string(height) + "\n255\n";
+    std::vector<std::uint8_t> file(header.begin(), header.end());
+    file.reserve(header.size() + static_cast<std::size_t>(width) * height * 3);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        const std::uint8_t* row = pixels + static_cast<std::size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x)
+        {
+            file.insert(file.end(), row + x * 4, row + x * 4 + 3);
+        }
+    }
+    return file;
+}
+
+/**
+* @section Constructor & Destructor
+*/
+
+FrameCapture::FrameCapture(const std::string& directory, CaptureFormat format,
+                           std::size_t encoders, bool dropFrames)
+    : directory_{ directory }, format_{ format }, dropFrames_{ dropFrames },
+      persistent_{ false },
+      width_{ 0 }, height_{ 0 }, slots_{}, next_{ 0 }, stats_{},
+      stopping_{ false }
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error || !std::filesystem::is_directory(directory_))
+    {
+        throw std::logic_error("ERROR::FRAME_CAPTURE::DIRECTORY\n " + directory_);
+    }
+    persistent_ = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    for (std::size_t i = 0; i < std::max<std::size_t>(encoders, 1); ++i)
+    {
+        encoders_.emplace_back(&FrameCapture::encoderLoop, this);
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    for (std::thread& encoder : encoders_)
+    {
+        encoder.join();
+    }
+    release();
+}
+
+/**
+* @section Member functions
+*/
+
+void FrameCapture::allocate(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+    for (Slot& slot : slots_)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (persistent_)
+        {
+            // Coherent, so the pixels are visible once the fence signalled
+            const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT |
+                                     GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags);
+            slot.mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+            if (!slot.mapped)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                release();
+                throw std::logic_error("ERROR::FRAME_CAPTURE::MAPPING_FAILED\n");
+            }
+        }
+        else
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            slot.pixels.resize(static_cast<std::size_t>(size));
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::release()
+{
+    for (Slot& slot : slots_)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.mapped)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+        slot = Slot{};
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    width_ = 0;
+    height_ = 0;
+}
+
+void FrameCapture::capture(GLuint framebuffer, int width, int height, std::size_t frame)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (width != width_ || height != height_)
+    {
+        finish();
+        release();
+        allocate(width, height);
+    }
+    retire(false);
+
+    // Frames are read in order, so the next slot is the oldest
+    Slot& slot = slots_[next_];
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (slot.state != SlotState::Free && dropFrames_)
+    {
+        ++stats_.dropped;
+        return;
+    }
+    if (slot.state != SlotState::Free)
+    {
+        // Its readback was issued SLOTS frames ago and is all but done, 
+        // the encoders may take longer
+        const auto stallStart = std::chrono::steady_clock::now();
+        if (slot.state == SlotState::Reading)
+        {
+            lock.unlock();
+            retireSlot(slot, true);
+            lock.lock();
+        }
+        freed_.wait(lock, [&slot]() { return slot.state == SlotState::Free; });
+        ++stats_.stalls;
+        stats_.stallMs += std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - stallStart).count();
+    }
+    slot.state = SlotState::Reading;
+    slot.frame = frame;
+    ++stats_.captured;
+    lock.unlock();
+
+    GLint readFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    next_ = (next_ + 1) % SLOTS;
+
+    lock.lock();
+    stats_.captureMs += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameCapture::retire(bool wait)
+{
+    for (std::size_t i = 0; i < SLOTS; ++i)
+    {
+        retireSlot(slots_[(next_ + i) % SLOTS], wait);
+    }
+}
+
+bool FrameCapture::retireSlot(Slot& slot, bool wait)
+{
+    // Only this thread moves slots out of Reading
+    if (!slot.fence)
+    {
+        return false;
+    }
+    GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    }
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    if (!persistent_)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                static_cast<GLsizeiptr>(slot.pixels.size()),
+                                GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            std::memcpy(slot.pixels.data(), mapped, slot.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot.state = SlotState::Encoding;
+        queue_.push_back(static_cast<std::size_t>(&slot - slots_.data()));
+    }
+    queued_.notify_one();
+    return true;
+}
+
+void FrameCapture::finish()
+{
+    retire(true);
+    std::unique_lock<std::mutex> lock(mutex_);
+    freed_.wait(lock, [this]()
+    {
+        return std::all_of(slots_.begin(), slots_.end(), [](const Slot& slot)
+        {
+            return slot.state == SlotState::Free;
+        });
+    });
+}
+
+FrameCaptureStats FrameCapture::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void FrameCapture::encoderLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        queued_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty())
+        {
+            return;
+        }
+        Slot& slot = slots_[queue_.front()];
+        queue_.pop_front();
+        const int width = width_;
+        const int height = height_;
+        lock.unlock();
+
+        // The slot is not read into again until it is Free
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint8_t* pixels = persistent_ ?
+                                     static_cast<const std::uint8_t*>(slot.mapped) :
+                                     slot.pixels.data();
+        const std::vector<std::uint8_t> file = format_ == CaptureFormat::Png ?
+                                               encodePng(pixels, width, height) :
+                                               encodePpm(pixels, width, height);
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%06zu.%s", slot.frame,
+                      format_ == CaptureFormat::Png ? "png" : "ppm");
+        std::FILE* output = std::fopen((directory_ + name).c_str(), "wb");
+        bool written = output != nullptr &&
+                       std::fwrite(file.data(), 1, file.size(), output) == file.size();
+        if (output != nullptr)
+        {
+            written = std::fclose(output) == 0 && written;
+        }
+        const double milliseconds = std::chrono::duration<double, std::milli>(
+                                        std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        stats_.encodeMs += milliseconds;
+        stats_.written += written ? 1 : 0;
+        stats_.failed += written ? 0 : 1;
+        stats_.bytesWritten += written ? file.size() : 0;
+        slot.state = SlotState::Free;
+        freed_.notify_all();
+    }
+}
@@ -0,0 +1,141 @@
+#include "framebuffer.hpp"
+#include <algorithm>
+#include <cmath>
+
+Framebuffer::Framebuffer(int width, int height)
+    : FBO_{ 0 }, colorRBO_{ 0 }, depthRBO_{ 0 }, width_{ width }, 
+      height_{ height }
+{
+    // Generate storage for the color and depth values
+    glGenRenderbuffers(1, &colorRBO_);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+    glGenRenderbuffers(1, &depthRBO_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Generate the framebuffer and attach the storage
+    glGenFramebuffers(1, &FBO_);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
+                              GL_RENDERBUFFER, colorRBO_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
+                              GL_RENDERBUFFER, depthRBO_);
+
+    // Check that the driver accepts the attachment combination
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        glDeleteFramebuffers(1, &FBO_);
+        glDeleteRenderbuffers(1, &colorRBO_);
+        glDeleteRenderbuffers(1, &depthRBO_);
+        throw std::logic_error(std::string("ERROR::FRAMEBUFFER::INCOMPLETE\n ")
+                               + std::to_string(status));
+    }
+}
+
+Framebuffer::~Framebuffer()
+{
+    glDeleteFramebuffers(1, &FBO_);
+    glDeleteRenderbuffers(1, &colorRBO_);
+    glDeleteRenderbuffers(1, &depthRBO_);
+}
+
+void Framebuffer::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    glViewport(0, 0, width_, height_);
+}
+
+ScaledFramebuffer::ScaledFramebuffer(int width, int height)
+    : target_{ std::make_unique<Framebuffer>(width, height) }, 
+      scaledWidth_{ width }, scaledHeight_{ height }
+{
+}
+
+void ScaledFramebuffer::resize(int width, int height)
+{
+    if (width == target_->getWidth() && height == target_->getHeight())
+    {
+        return;
+    }
+    // Free the old attachments first, both at once may not fit
+    target_.reset();
+    target_ = std::make_unique<Framebuffer>(width, height);
+}
+
+void ScaledFramebuffer::bind(float scale)
+{
+    scale = std::min(std::max(scale, 0.0f), 1.0f);
+    scaledWidth_ = std::max(static_cast<int>(std::lround(target_->getWidth() * scale)), 1);
+    scaledHeight_ = std::max(static_cast<int>(std::lround(target_->getHeight() * scale)), 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, target_->getFBOId());
+    glViewport(0, 0, scaledWidth_, scaledHeight_);
+}
+
+void ScaledFramebuffer::blitTo(GLuint target, int width, int height) const
+{
+    // A corner of the full size is copied as is
+    const bool stretched = scaledWidth_ != width || scaledHeight_ != height;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target_->getFBOId());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+    glBlitFramebuffer(0, 0, scaledWidth_, scaledHeight_, 0, 0, width, height, 
+                      GL_COLOR_BUFFER_BIT, stretched ? GL_LINEAR : GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, width, height);
+}
+
+UploadFramebuffer::UploadFramebuffer(int width, int height)
+    : FBO_{ 0 }, texture_{ 0 }, width_{ width }, height_{ height }
+{
+    // Generate the texture the pixels are uploaded to
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, 
+                 GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Generate the framebuffer the blit reads from
+    glGenFramebuffers(1, &FBO_);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO_);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
+                           GL_TEXTURE_2D, texture_, 0);
+    GLenum status = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        glDeleteFramebuffers(1, &FBO_);
+        glDeleteTextures(1, &texture_);
+        throw std::logic_error(std::string("ERROR::FRAMEBUFFER::INCOMPLETE\n ")
+                               + std::to_string(status));
+    }
+}
+
+UploadFramebuffer::~UploadFramebuffer()
+{
+    glDeleteFramebuffers(1, &FBO_);
+    glDeleteTextures(1, &texture_);
+}
+
+void UploadFramebuffer::upload(const std::uint32_t* pixels)
+{
+    // Rows of packed RGBA8 pixels are always 4 byte aligned
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, 
+                    GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void UploadFramebuffer::blitToWindow(int width, int height) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width, height, 
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
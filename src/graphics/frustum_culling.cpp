@@ -0,0 +1,324 @@
+#include "frustum_culling.hpp"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HELLO_TRIANGLE_SSE2 1
+#endif
+
+// AVX2 code is compiled for its own functions only and run after a check
+#if defined(HELLO_TRIANGLE_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define HELLO_TRIANGLE_AVX2 1
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2,popcnt")))
+#else
+#include <intrin.h>
+#define AVX2_TARGET
+#endif
+#endif
+
+/**
+* @section Helper functions
+*/
+
+static std::size_t writeMask4(unsigned mask, std::size_t base, 
+                              std::uint32_t* visible)
+{
+    // Write every candidate and only advance past the visible ones, so 
+    // there is no branch to mispredict
+    std::size_t count = 0;
+    for (unsigned lane = 0; lane < 4; ++lane)
+    {
+        visible[count] = static_cast<std::uint32_t>(base + lane);
+        count += (mask >> lane) & 1u;
+    }
+    return count;
+}
+
+/**
+* @section Frustum
+*/
+
+Frustum makeFrustum(const float* m)
+{
+    // Rows of the column-major matrix
+    auto row = [m](int r, int c) { return m[c * 4 + r]; };
+    Frustum frustum;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            // Left/bottom/near planes are w + row, right/top/far are w - row
+            frustum.planes[axis * 2][c] = row(3, c) + row(axis, c);
+            frustum.planes[axis * 2 + 1][c] = row(3, c) - row(axis, c);
+        }
+    }
+    for (float* plane : frustum.planes)
+    {
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] +
+                                       plane[2] * plane[2]);
+        for (int c = 0; c < 4; ++c)
+        {
+            plane[c] /= length;
+        }
+    }
+    return frustum;
+}
+
+/**
+* @section Kernel selection
+*/
+
+#ifdef HELLO_TRIANGLE_AVX2
+static bool hasAVX2()
+{
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    // The processor must support AVX2 and the OS must save the YMM registers
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+#endif
+
+bool isCullPathSupported(CullPath path)
+{
+    switch (path)
+    {
+#ifdef HELLO_TRIANGLE_AVX2
+        case CullPath::AVX2: 
+        {
+            static const bool supported = hasAVX2();
+            return supported;
+        }
+#endif
+#ifdef HELLO_TRIANGLE_SSE2
+        case CullPath::SSE2: return true;
+#endif
+        case CullPath::Scalar: return true;
+        default: return false;
+    }
+}
+
+CullPath detectCullPath()
+{
+    if (isCullPathSupported(CullPath::AVX2))
+    {
+        return CullPath::AVX2;
+    }
+    if (isCullPathSupported(CullPath::SSE2))
+    {
+        return CullPath::SSE2;
+    }
+    return CullPath::Scalar;
+}
+
+const char* getCullPathName(CullPath path)
+{
+    switch (path)
+    {
+        case CullPath::Scalar: return "scalar";
+        case CullPath::SSE2:   return "sse2";
+        case CullPath::AVX2:   return "avx2";
+        default:               return "unknown";
+    }
+}
+
+/**
+* @section Kernels
+*/
+
+static std::size_t cullScalar(const Frustum& frustum, const InstanceStore& store,
+                              std::size_t begin, std::size_t end, 
+                              std::uint32_t* visible)
+{
+    const float* x = store.getCenterX();
+    const float* y = store.getCenterY();
+    const float* z = store.getCenterZ();
+    const float* r = store.getRadius();
+    std::size_t count = 0;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        // Visible unless the sphere is entirely behind one of the planes
+        bool inside = true;
+        for (const float* plane : frustum.planes)
+        {
+            // Same order of operations as the SIMD kernels, for equal results
+            const float distance = plane[0] * x[i] + plane[3] + 
+                                   plane[1] * y[i] + plane[2] * z[i];
+            if (distance + r[i] < 0.0f)
+            {
+                inside = false;
+                break;
+            }
+        }
+        visible[count] = static_cast<std::uint32_t>(i);
+        count += inside ? 1 : 0;
+    }
+    return count;
+}
+
+#ifdef HELLO_TRIANGLE_SSE2
+static std::size_t cullSSE2(const Frustum& frustum, const InstanceStore& store,
+                            std::size_t begin, std::size_t end, 
+                            std::uint32_t* visible)
+{
+    const float* x = store.getCenterX();
+    const float* y = store.getCenterY();
+    const float* z = store.getCenterZ();
+    const float* r = store.getRadius();
+    // Broadcast every plane coefficient once
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m128 zero = _mm_setzero_ps();
+    std::size_t count = 0;
+    for (std::size_t i = begin; i < end; i += 4)
+    {
+        const __m128 px = _mm_load_ps(x + i);
+        const __m128 py = _mm_load_ps(y + i);
+        const __m128 pz = _mm_load_ps(z + i);
+        const __m128 pr = _mm_load_ps(r + i);
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (const __m128* plane : planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(plane[0], px), plane[3]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane[1], py));
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane[2], pz));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, pr), 
+                                                     zero));
+        }
+        count += writeMask4(static_cast<unsigned>(_mm_movemask_ps(inside)), i, 
+                            visible + count);
+    }
+    return count;
+}
+#endif
+
+#ifdef HELLO_TRIANGLE_AVX2
+/**
+ * @brief For every 8-bit mask, the lanes of its set bits moved to the front.
+ */
+struct CompactTable
+{
+    alignas(32) std::int32_t lanes[256][8];
+
+    CompactTable()
+    {
+        for (unsigned mask = 0; mask < 256; ++mask)
+        {
+            int count = 0;
+            for (int lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                {
+                    lanes[mask][count++] = lane;
+                }
+            }
+            while (count < 8)
+            {
+                lanes[mask][count++] = 0;
+            }
+        }
+    }
+};
+
+static const CompactTable compactTable;
+
+AVX2_TARGET
+static std::size_t cullAVX2(const Frustum& frustum, const InstanceStore& store,
+                            std::size_t begin, std::size_t end, 
+                            std::uint32_t* visible)
+{
+    const float* x = store.getCenterX();
+    const float* y = store.getCenterY();
+    const float* z = store.getCenterZ();
+    const float* r = store.getRadius();
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+        }
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(begin)),
+                                       _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    std::size_t count = 0;
+    for (std::size_t i = begin; i < end; i += 8)
+    {
+        const __m256 px = _mm256_load_ps(x + i);
+        const __m256 py = _mm256_load_ps(y + i);
+        const __m256 pz = _mm256_load_ps(z + i);
+        const __m256 pr = _mm256_load_ps(r + i);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const __m256* plane : planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(plane[0], px), plane[3]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(plane[1], py));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(plane[2], pz));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(
+                            _mm256_add_ps(distance, pr), zero, _CMP_GE_OQ));
+        }
+        // Move the visible indices to the front and store all eight; the 
+        // extra ones are overwritten by the next block
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+        const __m256i lanes = _mm256_load_si256(
+                reinterpret_cast<const __m256i*>(compactTable.lanes[mask]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + count),
+                            _mm256_permutevar8x32_epi32(indices, lanes));
+        count += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+        indices = _mm256_add_epi32(indices, step);
+    }
+    return count;
+}
+#endif
+
+std::size_t cullSpheres(const Frustum& frustum, const InstanceStore& store,
+                        std::size_t begin, std::size_t end, CullPath path, 
+                        std::uint32_t* visible)
+{
+    // Whole SIMD blocks: the padding entries are never visible
+    end = (end + INSTANCE_PADDING - 1) / INSTANCE_PADDING * INSTANCE_PADDING;
+    if (end > store.getPaddedSize())
+    {
+        end = store.getPaddedSize();
+    }
+    if (begin >= end)
+    {
+        return 0;
+    }
+    switch (path)
+    {
+#ifdef HELLO_TRIANGLE_AVX2
+        case CullPath::AVX2: return cullAVX2(frustum, store, begin, end, visible);
+#endif
+#ifdef HELLO_TRIANGLE_SSE2
+        case CullPath::SSE2: return cullSSE2(frustum, store, begin, end, visible);
+#endif
+        default: return cullScalar(frustum, store, begin, end, visible);
+    }
+}
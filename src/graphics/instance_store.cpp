@@ -0,0 +1,41 @@
+#include "instance_store.hpp"
+#include <limits>
+
+/**
+* @section InstanceStore
+*/
+
+void InstanceStore::reserve(std::size_t count)
+{
+    const std::size_t padded = (count + INSTANCE_PADDING - 1) / INSTANCE_PADDING * 
+                               INSTANCE_PADDING;
+    centerX_.reserve(padded);
+    centerY_.reserve(padded);
+    centerZ_.reserve(padded);
+    radius_.reserve(padded);
+}
+
+std::uint32_t InstanceStore::add(float x, float y, float z, float radius)
+{
+    if (count_ == radius_.size())
+    {
+        // Open a new block of padding entries that are never visible
+        const std::size_t padded = count_ + INSTANCE_PADDING;
+        centerX_.resize(padded, 0.0f);
+        centerY_.resize(padded, 0.0f);
+        centerZ_.resize(padded, 0.0f);
+        radius_.resize(padded, -std::numeric_limits<float>::infinity());
+    }
+    centerX_[count_] = x;
+    centerY_[count_] = y;
+    centerZ_[count_] = z;
+    radius_[count_] = radius;
+    return static_cast<std::uint32_t>(count_++);
+}
+
+void InstanceStore::setCenter(std::size_t index, float x, float y, float z)
+{
+    centerX_[index] = x;
+    centerY_[index] = y;
+    centerZ_[index] = z;
+}
@@ -0,0 +1,257 @@
+#include "mesh.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+/**
+* @section Helper types
+*/
+
+/**
+ * @brief Bit pattern of one vertex, so equal keys mean identical vertices.
+ */
+struct VertexKey
+{
+    std::uint32_t bits[3];
+
+    bool operator==(const VertexKey& other) const
+    {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && 
+               bits[2] == other.bits[2];
+    }
+};
+
+struct VertexKeyHash
+{
+    std::size_t operator()(const VertexKey& key) const
+    {
+        // FNV-1a over the three words
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (std::uint32_t word : key.bits)
+        {
+            hash ^= word;
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+/**
+* @section Deduplication
+*/
+
+Mesh makeIndexedMesh(const std::vector<float>& vertices)
+{
+    const std::size_t count = vertices.size() / 3;
+    Mesh mesh;
+    mesh.indices.reserve(count);
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> unique;
+    unique.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        VertexKey key;
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            // Adding zero folds -0.0 into 0.0, which compare equal
+            const float value = vertices[i * 3 + c] + 0.0f;
+            std::memcpy(&key.bits[c], &value, sizeof(float));
+        }
+        const GLuint next = static_cast<GLuint>(unique.size());
+        auto inserted = unique.emplace(key, next);
+        if (inserted.second)
+        {
+            mesh.vertices.insert(mesh.vertices.end(), &vertices[i * 3], 
+                                 &vertices[i * 3] + 3);
+        }
+        mesh.indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+
+/**
+* @section Triangle order
+*/
+
+void optimizeVertexCache(Mesh& mesh, std::size_t cacheSize)
+{
+    const std::size_t vertexCount = mesh.vertices.size() / 3;
+    const std::size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles around every vertex, as one array with per-vertex offsets
+    std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+    for (GLuint index : mesh.indices)
+    {
+        ++liveTriangles[index];
+    }
+    std::vector<std::size_t> offsets(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+    std::vector<std::uint32_t> adjacency(mesh.indices.size());
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t t = 0; t < triangleCount; ++t)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            adjacency[fill[mesh.indices[t * 3 + c]]++] = 
+                static_cast<std::uint32_t>(t);
+        }
+    }
+
+    // Tipsify: fan out around one vertex at a time, and move on to the 
+    // candidate that stays longest in the cache
+    std::vector<std::size_t> timeStamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnds;
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> output;
+    output.reserve(mesh.indices.size());
+    std::size_t time = cacheSize + 1;
+    std::size_t cursor = 0;
+    std::int64_t fanning = 0;
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        const std::size_t vertex = static_cast<std::size_t>(fanning);
+        for (std::size_t a = offsets[vertex]; a < offsets[vertex + 1]; ++a)
+        {
+            const std::uint32_t t = adjacency[a];
+            if (emitted[t])
+            {
+                continue;
+            }
+            emitted[t] = true;
+            for (std::size_t c = 0; c < 3; ++c)
+            {
+                const GLuint v = mesh.indices[t * 3 + c];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - timeStamps[v] > cacheSize)
+                {
+                    // Not in the cache, so this use transforms it again
+                    timeStamps[v] = time++;
+                }
+            }
+        }
+
+        // Best candidate that still has triangles and will still be cached
+        fanning = -1;
+        std::int64_t bestPriority = -1;
+        for (GLuint v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+            {
+                continue;
+            }
+            std::int64_t priority = 0;
+            if (time - timeStamps[v] + 2 * liveTriangles[v] <= cacheSize)
+            {
+                priority = static_cast<std::int64_t>(time - timeStamps[v]);
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0)
+        {
+            continue;
+        }
+
+        // Dead end: go back to recently used vertices, then scan in order
+        while (!deadEnds.empty() && fanning < 0)
+        {
+            const GLuint v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0)
+            {
+                fanning = v;
+            }
+        }
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (liveTriangles[cursor] > 0)
+            {
+                fanning = static_cast<std::int64_t>(cursor);
+            }
+            ++cursor;
+        }
+    }
+    mesh.indices.swap(output);
+}
+
+/**
+* @section Vertex order
+*/
+
+void optimizeVertexFetch(Mesh& mesh)
+{
+    const std::size_t vertexCount = mesh.vertices.size() / 3;
+    const GLuint unused = ~0u;
+    std::vector<GLuint> remap(vertexCount, unused);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    GLuint next = 0;
+    for (GLuint& index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = next++;
+            vertices.insert(vertices.end(), &mesh.vertices[index * 3], 
+                            &mesh.vertices[index * 3] + 3);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+/**
+* @section Measurement
+*/
+
+double computeACMR(const std::vector<GLuint>& indices, std::size_t vertexCount,
+                   std::size_t cacheSize)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0;
+    }
+    // A vertex is cached if it missed within the last cacheSize misses
+    std::vector<std::size_t> missTime(vertexCount, 0);
+    std::size_t misses = 0;
+    for (GLuint index : indices)
+    {
+        if (missTime[index] == 0 || misses - missTime[index] >= cacheSize)
+        {
+            missTime[index] = ++misses;
+        }
+    }
+    return static_cast<double>(misses) / triangleCount;
+}
+
+Mesh processMesh(const std::vector<float>& soup, MeshProcessReport& report)
+{
+    const auto start = std::chrono::steady_clock::now();
+    Mesh mesh = makeIndexedMesh(soup);
+    report.inputVertices = soup.size() / 3;
+    report.uniqueVertices = mesh.vertices.size() / 3;
+    report.triangles = mesh.indices.size() / 3;
+    report.acmrIndexed = computeACMR(mesh.indices, report.uniqueVertices);
+
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    report.acmrOptimized = computeACMR(mesh.indices, mesh.vertices.size() / 3);
+    report.milliseconds = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count();
+    return mesh;
+}
@@ -0,0 +1,114 @@
+#include "mesh_batch.hpp"
+
+MeshBatch::MeshBatch()
+    : VAO_{ 0 }, VBO_{ 0 }, EBO_{ 0 }, indirectBuffer_{ 0 }, vertexCount_{ 0 },
+      indexCount_{ 0 }
+{
+}
+
+MeshBatch::~MeshBatch()
+{
+    glDeleteVertexArrays(1, &VAO_);
+    glDeleteBuffers(1, &VBO_);
+    glDeleteBuffers(1, &EBO_);
+    glDeleteBuffers(1, &indirectBuffer_);
+}
+
+std::size_t MeshBatch::addMesh(const std::vector<float>& vertices, 
+                               const std::vector<GLuint>& indices)
+{
+    if (VAO_ != 0)
+    {
+        throw std::logic_error("ERROR::MESH_BATCH::ALREADY_BUILT\n");
+    }
+    // Remember where this mesh starts in the shared buffers
+    DrawElementsIndirectCommand command;
+    command.count = static_cast<GLuint>(indices.size());
+    command.instanceCount = 1;
+    command.firstIndex = static_cast<GLuint>(indices_.size());
+    command.baseVertex = static_cast<GLint>(vertices_.size() / 3);
+    command.baseInstance = static_cast<GLuint>(commands_.size());
+    commands_.push_back(command);
+
+    vertices_.insert(vertices_.end(), vertices.begin(), vertices.end());
+    indices_.insert(indices_.end(), indices.begin(), indices.end());
+    return commands_.size() - 1;
+}
+
+void MeshBatch::build(const GLenum& DRAW_TYPE)
+{
+    vertexCount_ = vertices_.size() / 3;
+    indexCount_ = indices_.size();
+
+    // Generate and bind VAO first
+    glGenVertexArrays(1, &VAO_);
+    glBindVertexArray(VAO_);
+
+    // Shared vertex buffer
+    glGenBuffers(1, &VBO_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(float), 
+                 vertices_.data(), DRAW_TYPE);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Shared element buffer, its binding is stored in the VAO
+    glGenBuffers(1, &EBO_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLuint), 
+                 indices_.data(), DRAW_TYPE);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect)
+    {
+        // The GPU reads the draw commands straight from a buffer
+        glGenBuffers(1, &indirectBuffer_);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, 
+                     commands_.size() * sizeof(DrawElementsIndirectCommand),
+                     commands_.data(), DRAW_TYPE);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        // Unpack the commands into the arrays of the base vertex multi-draw
+        counts_.reserve(commands_.size());
+        offsets_.reserve(commands_.size());
+        baseVertices_.reserve(commands_.size());
+        for (const DrawElementsIndirectCommand& command : commands_)
+        {
+            counts_.push_back(static_cast<GLsizei>(command.count));
+            offsets_.push_back(reinterpret_cast<const void*>(
+                        static_cast<std::size_t>(command.firstIndex) * sizeof(GLuint)));
+            baseVertices_.push_back(command.baseVertex);
+        }
+    }
+
+    // The data lives on the GPU now
+    vertices_ = std::vector<float>();
+    indices_ = std::vector<GLuint>();
+}
+
+void MeshBatch::draw() const
+{
+    if (commands_.empty())
+    {
+        return;
+    }
+    if (indirectBuffer_ != 0)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                    static_cast<GLsizei>(commands_.size()), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts_.data(), 
+                                      GL_UNSIGNED_INT, offsets_.data(),
+                                      static_cast<GLsizei>(counts_.size()),
+                                      baseVertices_.data());
+    }
+}
@@ -0,0 +1,342 @@
+#include "mesh_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+* @section Helper functions
+*/
+
+static const char MESH_FILE_MAGIC[8] = { 'H', 'T', 'M', 'E', 'S', 'H', '\r', '\n' };
+
+static std::uint64_t alignSection(std::uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~std::uint64_t{ MESH_FILE_ALIGNMENT - 1 };
+}
+
+static bool isLittleEndian()
+{
+    const std::uint32_t one{ 1 };
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+MeshBounds computeBounds(const std::vector<float>& positions)
+{
+    MeshBounds bounds{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    for (std::size_t i = 0; i + 2 < positions.size(); i += 3)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            const float value = positions[i + axis];
+            bounds.min[axis] = i == 0 ? value : std::min(bounds.min[axis], value);
+            bounds.max[axis] = i == 0 ? value : std::max(bounds.max[axis], value);
+        }
+    }
+    return bounds;
+}
+
+/**
+* @section MappedFile
+*/
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+    : data_{ nullptr }, size_{ 0 }, file_{ INVALID_HANDLE_VALUE }, mapping_{ nullptr }
+{
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size))
+    {
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+        throw std::logic_error("ERROR::MAPPED_FILE::OPEN_FAILED\n " + path);
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0)
+    {
+        return;
+    }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)
+                                : nullptr;
+    if (!view)
+    {
+        if (mapping_)
+        {
+            CloseHandle(mapping_);
+        }
+        CloseHandle(file_);
+        throw std::logic_error("ERROR::MAPPED_FILE::MAP_FAILED\n " + path);
+    }
+    data_ = static_cast<const std::uint8_t*>(view);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+    : data_{ nullptr }, size_{ 0 }, file_{ -1 }
+{
+    file_ = open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (file_ < 0 || fstat(file_, &status) != 0)
+    {
+        if (file_ >= 0)
+        {
+            close(file_);
+        }
+        throw std::logic_error("ERROR::MAPPED_FILE::OPEN_FAILED\n " + path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    // Mapping zero bytes fails, an empty file simply has no data
+    if (size_ == 0)
+    {
+        return;
+    }
+    void* view = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+    if (view == MAP_FAILED)
+    {
+        close(file_);
+        throw std::logic_error("ERROR::MAPPED_FILE::MAP_FAILED\n " + path);
+    }
+    // Sections are consumed front to back, so let the kernel read far ahead
+    madvise(view, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const std::uint8_t*>(view);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        munmap(const_cast<std::uint8_t*>(data_), size_);
+    }
+    close(file_);
+}
+
+#endif
+
+/**
+* @section MeshFile
+*/
+
+MeshFile::MeshFile(const std::string& path)
+    : file_(path), layout_{}, vertexCount_{ 0 }, indexCount_{ 0 }, bounds_{}
+{
+    // The sections are used in place, so the host must share the byte order
+    if (!isLittleEndian())
+    {
+        throw std::logic_error("ERROR::MESH_FILE::BIG_ENDIAN_HOST\n " + path);
+    }
+    const std::uint8_t* data = file_.getData();
+    const std::uint64_t size = file_.getSize();
+    MeshFileHeader header;
+    if (size < sizeof(header))
+    {
+        throw std::logic_error("ERROR::MESH_FILE::TRUNCATED\n " + path);
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::NOT_A_MESH_FILE\n " + path);
+    }
+    if (header.version != MESH_FILE_VERSION)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::UNSUPPORTED_VERSION\n " + path);
+    }
+    if (header.attributeCount == 0 || header.attributeCount > MESH_FILE_MAX_ATTRIBUTES ||
+        header.streamCount == 0 || header.streamCount > header.attributeCount ||
+        header.indexSize != sizeof(GLuint) || header.indexCount % 3 != 0)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::INVALID_HEADER\n " + path);
+    }
+
+    // Both tables follow the header directly
+    const std::uint64_t attributesOffset = sizeof(header);
+    const std::uint64_t sectionsOffset = attributesOffset +
+                            header.attributeCount * sizeof(MeshFileAttribute);
+    const std::uint64_t tablesEnd = sectionsOffset +
+                            (header.streamCount + 1) * sizeof(MeshFileSection);
+    if (tablesEnd > size)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::TRUNCATED\n " + path);
+    }
+    try
+    {
+        for (std::uint32_t a = 0; a < header.attributeCount; ++a)
+        {
+            MeshFileAttribute attribute;
+            std::memcpy(&attribute, data + attributesOffset + a * sizeof(attribute),
+                        sizeof(attribute));
+            if (attribute.format > static_cast<std::uint32_t>(AttributeFormat::Snorm16))
+            {
+                throw std::logic_error("ERROR::MESH_FILE::INVALID_ATTRIBUTE\n ");
+            }
+            layout_.add(attribute.location, static_cast<GLint>(attribute.components),
+                        static_cast<AttributeFormat>(attribute.format), attribute.stream);
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::INVALID_ATTRIBUTE\n " + path);
+    }
+    if (layout_.getStreamCount() != header.streamCount)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::INVALID_HEADER\n " + path);
+    }
+
+    // Every section must be aligned, inside the file and as large as the
+    // counts say; this bounds every later read of the mapping
+    sections_.resize(header.streamCount + 1);
+    std::memcpy(sections_.data(), data + sectionsOffset,
+                sections_.size() * sizeof(MeshFileSection));
+    for (std::size_t s = 0; s < sections_.size(); ++s)
+    {
+        const MeshFileSection& section = sections_[s];
+        const bool indices = s == header.streamCount;
+        const std::uint64_t elementSize = indices ? header.indexSize
+                                                  : layout_.getStride(s);
+        const std::uint64_t count = indices ? header.indexCount : header.vertexCount;
+        if (section.offset % MESH_FILE_ALIGNMENT != 0 || section.offset < tablesEnd ||
+            section.offset > size || section.size > size - section.offset ||
+            count > section.size / elementSize || section.size != count * elementSize)
+        {
+            throw std::logic_error("ERROR::MESH_FILE::INVALID_SECTION\n " + path);
+        }
+    }
+    vertexCount_ = static_cast<std::size_t>(header.vertexCount);
+    indexCount_ = static_cast<std::size_t>(header.indexCount);
+    std::memcpy(bounds_.min, header.boundsMin, sizeof(bounds_.min));
+    std::memcpy(bounds_.max, header.boundsMax, sizeof(bounds_.max));
+}
+
+const std::uint8_t* MeshFile::getStream(std::size_t stream) const
+{
+    return file_.getData() + sections_[stream].offset;
+}
+
+std::size_t MeshFile::getStreamSize(std::size_t stream) const
+{
+    return static_cast<std::size_t>(sections_[stream].size);
+}
+
+const GLuint* MeshFile::getIndices() const
+{
+    if (indexCount_ == 0)
+    {
+        return nullptr;
+    }
+    // Sections are 16 byte aligned and the mapping starts on a page
+    return reinterpret_cast<const GLuint*>(file_.getData() + sections_.back().offset);
+}
+
+/**
+* @section Writing
+*/
+
+void writeMeshFile(const std::string& path, const VertexLayout& layout,
+                   const std::vector<std::vector<std::uint8_t>>& streams,
+                   const std::vector<GLuint>& indices, const MeshBounds& bounds)
+{
+    if (streams.size() != layout.getStreamCount() || streams.empty() ||
+        layout.getAttributes().size() > MESH_FILE_MAX_ATTRIBUTES ||
+        indices.size() % 3 != 0)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::STREAM_MISMATCH\n");
+    }
+    const std::size_t vertexCount = streams[0].size() / layout.getStride(0);
+    for (std::size_t s = 0; s < streams.size(); ++s)
+    {
+        if (streams[s].size() != vertexCount * layout.getStride(s))
+        {
+            throw std::logic_error("ERROR::MESH_FILE::STREAM_MISMATCH\n");
+        }
+    }
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+    header.version = MESH_FILE_VERSION;
+    header.attributeCount = static_cast<std::uint32_t>(layout.getAttributes().size());
+    header.streamCount = static_cast<std::uint32_t>(streams.size());
+    header.indexSize = sizeof(GLuint);
+    header.vertexCount = vertexCount;
+    header.indexCount = indices.size();
+    std::memcpy(header.boundsMin, bounds.min, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, bounds.max, sizeof(header.boundsMax));
+
+    std::vector<MeshFileAttribute> attributes;
+    for (const VertexAttribute& attribute : layout.getAttributes())
+    {
+        attributes.push_back({ attribute.location,
+                               static_cast<std::uint32_t>(attribute.components),
+                               static_cast<std::uint32_t>(attribute.format),
+                               static_cast<std::uint32_t>(attribute.stream) });
+    }
+
+    // Lay the sections out after the tables, each on an aligned offset
+    std::vector<MeshFileSection> sections(streams.size() + 1);
+    std::uint64_t offset = sizeof(header) + attributes.size() * sizeof(MeshFileAttribute) +
+                           sections.size() * sizeof(MeshFileSection);
+    for (std::size_t s = 0; s < sections.size(); ++s)
+    {
+        offset = alignSection(offset);
+        sections[s].offset = offset;
+        sections[s].size = s < streams.size() ? streams[s].size()
+                                              : indices.size() * sizeof(GLuint);
+        offset += sections[s].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::WRITE_FAILED\n " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(attributes.data()),
+               attributes.size() * sizeof(MeshFileAttribute));
+    file.write(reinterpret_cast<const char*>(sections.data()),
+               sections.size() * sizeof(MeshFileSection));
+    std::uint64_t written = sizeof(header) + attributes.size() * sizeof(MeshFileAttribute) +
+                            sections.size() * sizeof(MeshFileSection);
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    for (std::size_t s = 0; s < sections.size(); ++s)
+    {
+        file.write(padding, static_cast<std::streamsize>(sections[s].offset - written));
+        const char* bytes = s < streams.size()
+            ? reinterpret_cast<const char*>(streams[s].data())
+            : reinterpret_cast<const char*>(indices.data());
+        file.write(bytes, static_cast<std::streamsize>(sections[s].size));
+        written = sections[s].offset + sections[s].size;
+    }
+    if (!file)
+    {
+        throw std::logic_error("ERROR::MESH_FILE::WRITE_FAILED\n " + path);
+    }
+}
@@ -0,0 +1,414 @@
+#include "mesh_lod.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+/**
+* @section Helper types
+*/
+
+/**
+ * @brief Sum of the squared distances to a set of weighted planes, as the
+ * upper triangle of a symmetric 4x4 matrix, and the sum of the weights.
+ */
+struct Quadric
+{
+    double m[10]{};
+    double weight{ 0.0 };
+
+    void addPlane(const double* normal, double d, double planeWeight)
+    {
+        const double plane[4] = { normal[0], normal[1], normal[2], d };
+        std::size_t k = 0;
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = row; column < 4; ++column)
+            {
+                m[k++] += planeWeight * plane[row] * plane[column];
+            }
+        }
+        weight += planeWeight;
+    }
+
+    void add(const Quadric& other)
+    {
+        for (std::size_t k = 0; k < 10; ++k)
+        {
+            m[k] += other.m[k];
+        }
+        weight += other.weight;
+    }
+
+    double evaluate(const float* vertex) const
+    {
+        const double x = vertex[0], y = vertex[1], z = vertex[2];
+        return m[0] * x * x + m[4] * y * y + m[7] * z * z +
+               2.0 * (m[1] * x * y + m[2] * x * z + m[5] * y * z) +
+               2.0 * (m[3] * x + m[6] * y + m[8] * z) + m[9];
+    }
+};
+
+/**
+ * @brief Moving vertex from onto vertex to, valid while neither changed
+ * since the cost was computed.
+ */
+struct Collapse
+{
+    double cost;
+    GLuint from;
+    GLuint to;
+    std::uint32_t fromStamp;
+    std::uint32_t toStamp;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+/**
+ * @brief Weight of the planes that hold border edges in place, relative to
+ * the area weight of the face planes.
+ */
+constexpr double BORDER_WEIGHT{ 10.0 };
+
+/**
+ * @brief Cosine of the largest turn of a triangle's normal a collapse may
+ * cause; beyond it the triangle folds over.
+ */
+constexpr double MIN_NORMAL_COSINE{ 0.2 };
+
+/**
+ * @brief Share of the previous level's triangles a level must get below,
+ * otherwise simplification is stuck and the chain ends.
+ */
+constexpr double MIN_PROGRESS{ 0.9 };
+
+static void crossNormal(const float* a, const float* b, const float* c,
+                        double* normal)
+{
+    const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static double length(const double* v)
+{
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+/**
+* @section Simplification
+*/
+
+LodChain buildLodChain(const Mesh& mesh, std::size_t maxLevels, float ratio,
+                       std::size_t minTriangles)
+{
+    const auto start = std::chrono::steady_clock::now();
+    LodChain chain;
+    chain.mesh = mesh;
+    const std::size_t vertexCount = mesh.vertices.size() / 3;
+    const std::size_t triangleCount = mesh.indices.size() / 3;
+    chain.lods.push_back({ 0, mesh.indices.size(), 0.0f });
+    maxLevels = std::min(maxLevels, MAX_LOD_LEVELS);
+    if (triangleCount == 0 || ratio <= 0.0f || ratio >= 1.0f)
+    {
+        return chain;
+    }
+
+    // Working copy of the triangles, renumbered as vertices collapse
+    const float* positions = mesh.vertices.data();
+    std::vector<GLuint> indices = mesh.indices;
+    std::vector<bool> alive(triangleCount, true);
+    std::size_t live = triangleCount;
+
+    // Every vertex starts with the planes of its triangles, weighted by
+    // area, and knows the triangles around it
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<std::uint32_t>> around(vertexCount);
+    std::unordered_map<std::uint64_t, std::uint32_t> edgeUses;
+    edgeUses.reserve(triangleCount * 3);
+    for (std::size_t t = 0; t < triangleCount; ++t)
+    {
+        const GLuint* corners = &indices[t * 3];
+        double normal[3];
+        crossNormal(positions + corners[0] * 3, positions + corners[1] * 3,
+                    positions + corners[2] * 3, normal);
+        const double area = length(normal);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            around[corners[c]].push_back(static_cast<std::uint32_t>(t));
+            const GLuint a = std::min(corners[c], corners[(c + 1) % 3]);
+            const GLuint b = std::max(corners[c], corners[(c + 1) % 3]);
+            ++edgeUses[(static_cast<std::uint64_t>(a) << 32) | b];
+        }
+        if (area == 0.0)
+        {
+            continue;
+        }
+        for (double& component : normal)
+        {
+            component /= area;
+        }
+        const float* p = positions + corners[0] * 3;
+        const double d = -(normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2]);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            quadrics[corners[c]].addPlane(normal, d, area * 0.5);
+        }
+    }
+
+    // An edge of a single triangle is a border; a plane through it,
+    // upright on the triangle, keeps collapses from pulling it inwards
+    for (std::size_t t = 0; t < triangleCount; ++t)
+    {
+        const GLuint* corners = &indices[t * 3];
+        double normal[3];
+        crossNormal(positions + corners[0] * 3, positions + corners[1] * 3,
+                    positions + corners[2] * 3, normal);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            const GLuint a = corners[c];
+            const GLuint b = corners[(c + 1) % 3];
+            const std::uint64_t key = (static_cast<std::uint64_t>(std::min(a, b)) << 32) |
+                                      std::max(a, b);
+            if (edgeUses[key] != 1)
+            {
+                continue;
+            }
+            const float* pa = positions + a * 3;
+            const float* pb = positions + b * 3;
+            const double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+            double border[3] = { edge[1] * normal[2] - edge[2] * normal[1],
+                                 edge[2] * normal[0] - edge[0] * normal[2],
+                                 edge[0] * normal[1] - edge[1] * normal[0] };
+            const double borderLength = length(border);
+            if (borderLength == 0.0)
+            {
+                continue;
+            }
+            for (double& component : border)
+            {
+                component /= borderLength;
+            }
+            const double d = -(border[0] * pa[0] + border[1] * pa[1] + border[2] * pa[2]);
+            const double weight = BORDER_WEIGHT * (edge[0] * edge[0] +
+                                  edge[1] * edge[1] + edge[2] * edge[2]);
+            quadrics[a].addPlane(border, d, weight);
+            quadrics[b].addPlane(border, d, weight);
+        }
+    }
+
+    // Cheapest collapse first; entries go stale when either end changes
+    std::vector<std::uint32_t> stamps(vertexCount, 0);
+    std::vector<bool> removed(vertexCount, false);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    const auto push = [&](GLuint from, GLuint to)
+    {
+        Quadric merged = quadrics[from];
+        merged.add(quadrics[to]);
+        heap.push({ std::max(merged.evaluate(positions + to * 3), 0.0), from, to,
+                    stamps[from], stamps[to] });
+    };
+    for (std::size_t t = 0; t < triangleCount; ++t)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            push(indices[t * 3 + c], indices[t * 3 + (c + 1) % 3]);
+            push(indices[t * 3 + (c + 1) % 3], indices[t * 3 + c]);
+        }
+    }
+
+    // Moving from onto to must not fold any triangle that survives it
+    const auto flips = [&](GLuint from, GLuint to)
+    {
+        for (std::uint32_t t : around[from])
+        {
+            const GLuint* corners = &indices[t * 3];
+            if (!alive[t] || corners[0] == to || corners[1] == to || corners[2] == to)
+            {
+                continue;
+            }
+            const float* before[3];
+            const float* after[3];
+            for (std::size_t c = 0; c < 3; ++c)
+            {
+                before[c] = positions + corners[c] * 3;
+                after[c] = corners[c] == from ? positions + to * 3 : before[c];
+            }
+            double oldNormal[3];
+            double newNormal[3];
+            crossNormal(before[0], before[1], before[2], oldNormal);
+            crossNormal(after[0], after[1], after[2], newNormal);
+            const double oldLength = length(oldNormal);
+            const double newLength = length(newNormal);
+            if (oldLength == 0.0)
+            {
+                continue;
+            }
+            const double dot = oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] +
+                               oldNormal[2] * newNormal[2];
+            if (newLength == 0.0 || dot < MIN_NORMAL_COSINE * oldLength * newLength)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // The ends of an edge may only share the neighbours of the triangles on
+    // it, otherwise the collapse pinches the surface into a fold
+    std::vector<GLuint> fromRing;
+    std::vector<GLuint> toRing;
+    const auto pinches = [&](GLuint from, GLuint to)
+    {
+        const auto gather = [&](GLuint vertex, std::vector<GLuint>& ring)
+        {
+            ring.clear();
+            for (std::uint32_t t : around[vertex])
+            {
+                if (alive[t])
+                {
+                    ring.insert(ring.end(), &indices[t * 3], &indices[t * 3] + 3);
+                }
+            }
+            std::sort(ring.begin(), ring.end());
+            ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+        };
+        gather(from, fromRing);
+        gather(to, toRing);
+        std::size_t shared = 0;
+        for (std::uint32_t t : around[from])
+        {
+            const GLuint* corners = &indices[t * 3];
+            shared += alive[t] && (corners[0] == to || corners[1] == to || 
+                                   corners[2] == to) ? 1 : 0;
+        }
+        std::size_t common = 0;
+        for (GLuint vertex : fromRing)
+        {
+            common += vertex != from && vertex != to && 
+                      std::binary_search(toRing.begin(), toRing.end(), vertex) ? 1 : 0;
+        }
+        return common != shared;
+    };
+
+    double maxError = 0.0;
+    std::size_t previous = live;
+    while (chain.lods.size() < maxLevels)
+    {
+        const std::size_t target = static_cast<std::size_t>(previous * ratio);
+        if (target < minTriangles)
+        {
+            break;
+        }
+        while (live > target && !heap.empty())
+        {
+            const Collapse collapse = heap.top();
+            heap.pop();
+            const GLuint from = collapse.from;
+            const GLuint to = collapse.to;
+            if (removed[from] || removed[to] || stamps[from] != collapse.fromStamp ||
+                stamps[to] != collapse.toStamp || pinches(from, to) || flips(from, to))
+            {
+                continue;
+            }
+
+            // Triangles on the edge vanish, the others move to the kept vertex
+            for (std::uint32_t t : around[from])
+            {
+                GLuint* corners = &indices[t * 3];
+                if (!alive[t])
+                {
+                    continue;
+                }
+                if (corners[0] == to || corners[1] == to || corners[2] == to)
+                {
+                    alive[t] = false;
+                    --live;
+                    continue;
+                }
+                for (std::size_t c = 0; c < 3; ++c)
+                {
+                    corners[c] = corners[c] == from ? to : corners[c];
+                }
+                around[to].push_back(t);
+            }
+            around[from].clear();
+            removed[from] = true;
+            quadrics[to].add(quadrics[from]);
+            ++stamps[to];
+            if (quadrics[to].weight > 0.0)
+            {
+                maxError = std::max(maxError, std::sqrt(collapse.cost / quadrics[to].weight));
+            }
+
+            // New costs for every edge of the kept vertex
+            std::vector<std::uint32_t>& triangles = around[to];
+            triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                            [&](std::uint32_t t) { return !alive[t]; }), triangles.end());
+            for (std::uint32_t t : triangles)
+            {
+                for (std::size_t c = 0; c < 3; ++c)
+                {
+                    const GLuint other = indices[t * 3 + c];
+                    if (other != to)
+                    {
+                        push(to, other);
+                        push(other, to);
+                    }
+                }
+            }
+        }
+        if (live > previous * MIN_PROGRESS)
+        {
+            break;
+        }
+
+        // Snapshot the surviving triangles as the next level, reordered for
+        // the vertex cache; the vertices are borrowed, not copied
+        Mesh level;
+        level.indices.reserve(live * 3);
+        for (std::size_t t = 0; t < triangleCount; ++t)
+        {
+            if (alive[t])
+            {
+                level.indices.insert(level.indices.end(), &indices[t * 3],
+                                     &indices[t * 3] + 3);
+            }
+        }
+        level.vertices.swap(chain.mesh.vertices);
+        optimizeVertexCache(level);
+        level.vertices.swap(chain.mesh.vertices);
+        chain.lods.push_back({ chain.mesh.indices.size(), level.indices.size(),
+                               static_cast<float>(maxError) });
+        chain.mesh.indices.insert(chain.mesh.indices.end(), level.indices.begin(),
+                                  level.indices.end());
+        previous = live;
+    }
+    chain.milliseconds = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count();
+    return chain;
+}
+
+/**
+* @section Selection
+*/
+
+std::size_t selectLod(const std::vector<MeshLod>& lods, float radius,
+                      float distance, float pixelScale, float maxPixels)
+{
+    // Errors grow with every level, so the first from the coarse end that
+    // fits is the coarsest that does
+    for (std::size_t level = lods.size(); level-- > 1;)
+    {
+        if (lods[level].error * radius * pixelScale <= maxPixels * distance)
+        {
+            return level;
+        }
+    }
+    return 0;
+}
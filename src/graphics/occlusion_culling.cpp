@@ -0,0 +1,197 @@
+#include "occlusion_culling.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HELLO_TRIANGLE_SSE2 1
+#endif
+
+/**
+* @section Modes
+*/
+
+bool parseOcclusionMode(const std::string& name, OcclusionMode& mode)
+{
+    if (name == "off")
+    {
+        mode = OcclusionMode::Off;
+    }
+    else if (name == "hiz")
+    {
+        mode = OcclusionMode::HiZ;
+    }
+    else if (name == "queries")
+    {
+        mode = OcclusionMode::Queries;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char* getOcclusionModeName(OcclusionMode mode)
+{
+    switch (mode)
+    {
+        case OcclusionMode::Off:     return "off";
+        case OcclusionMode::HiZ:     return "hiz";
+        case OcclusionMode::Queries: return "queries";
+        default:                     return "unknown";
+    }
+}
+
+/**
+* @section DepthPyramid
+*/
+
+static bool isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+DepthPyramid::DepthPyramid(int width, int height)
+    : width_{ width }, height_{ height }
+{
+    if (!isPowerOfTwo(width) || !isPowerOfTwo(height))
+    {
+        throw std::logic_error(std::string("ERROR::DEPTH_PYRAMID::SIZE\n ") +
+                               std::to_string(width) + "x" + std::to_string(height));
+    }
+    for (int level = 0; ; ++level)
+    {
+        const int levelWidth = std::max(width_ >> level, 1);
+        const int levelHeight = std::max(height_ >> level, 1);
+        levels_.emplace_back(static_cast<std::size_t>(levelWidth) * levelHeight, 1.0f);
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+    }
+}
+
+void DepthPyramid::build(const float* depth, std::size_t pitch)
+{
+    for (int y = 0; y < height_; ++y)
+    {
+        std::memcpy(levels_[0].data() + static_cast<std::size_t>(y) * width_,
+                    depth + y * pitch, width_ * sizeof(float));
+    }
+    for (std::size_t level = 1; level < levels_.size(); ++level)
+    {
+        const int sourceWidth = std::max(width_ >> (level - 1), 1);
+        const int sourceHeight = std::max(height_ >> (level - 1), 1);
+        const int levelWidth = std::max(width_ >> level, 1);
+        const int levelHeight = std::max(height_ >> level, 1);
+        const float* source = levels_[level - 1].data();
+        float* target = levels_[level].data();
+        for (int y = 0; y < levelHeight; ++y)
+        {
+            // A side that is already one texel wide is not halved
+            const float* row0 = source + static_cast<std::size_t>(
+                                    std::min(y * 2, sourceHeight - 1)) * sourceWidth;
+            const float* row1 = source + static_cast<std::size_t>(
+                                    std::min(y * 2 + 1, sourceHeight - 1)) * sourceWidth;
+            float* out = target + static_cast<std::size_t>(y) * levelWidth;
+            int x = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+            if (sourceWidth > 1)
+            {
+                for (; x + 4 <= levelWidth; x += 4)
+                {
+                    // Farthest of each column pair, then of neighbouring columns
+                    const __m128 low = _mm_max_ps(_mm_loadu_ps(row0 + x * 2),
+                                                  _mm_loadu_ps(row1 + x * 2));
+                    const __m128 high = _mm_max_ps(_mm_loadu_ps(row0 + x * 2 + 4),
+                                                   _mm_loadu_ps(row1 + x * 2 + 4));
+                    const __m128 even = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+                    const __m128 odd = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(out + x, _mm_max_ps(even, odd));
+                }
+            }
+#endif
+            for (; x < levelWidth; ++x)
+            {
+                const int x0 = std::min(x * 2, sourceWidth - 1);
+                const int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                out[x] = std::max(std::max(row0[x0], row0[x1]),
+                                  std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool DepthPyramid::isOccluded(const float* viewProjection, float x, float y,
+                              float z, float radius) const
+{
+    // Project the corners of the sphere's box
+    float minX = 0.0f, maxX = 0.0f, minY = 0.0f, maxY = 0.0f, nearest = 1.0f;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const float px = x + ((corner & 1) ? radius : -radius);
+        const float py = y + ((corner & 2) ? radius : -radius);
+        const float pz = z + ((corner & 4) ? radius : -radius);
+        float clip[4];
+        for (int row = 0; row < 4; ++row)
+        {
+            clip[row] = viewProjection[row] * px + viewProjection[4 + row] * py +
+                        viewProjection[8 + row] * pz + viewProjection[12 + row];
+        }
+        if (clip[3] <= 0.0f || clip[2] < -clip[3])
+        {
+            return false;
+        }
+        const float inverseW = 1.0f / clip[3];
+        const float ndcX = clip[0] * inverseW;
+        const float ndcY = clip[1] * inverseW;
+        if (corner == 0)
+        {
+            minX = maxX = ndcX;
+            minY = maxY = ndcY;
+        }
+        minX = std::min(minX, ndcX);
+        maxX = std::max(maxX, ndcX);
+        minY = std::min(minY, ndcY);
+        maxY = std::max(maxY, ndcY);
+        nearest = std::min(nearest, clip[2] * inverseW * 0.5f + 0.5f);
+    }
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+    {
+        return false;
+    }
+
+    // Texels of level 0 under the rectangle, edges included
+    const auto toTexel = [](float ndc, int size)
+    {
+        const float texel = (std::min(std::max(ndc, -1.0f), 1.0f) * 0.5f + 0.5f) * size;
+        return std::min(static_cast<int>(texel), size - 1);
+    };
+    int x0 = toTexel(minX, width_), x1 = toTexel(maxX, width_);
+    int y0 = toTexel(minY, height_), y1 = toTexel(maxY, height_);
+
+    // Go up until the rectangle spans at most two texels each way
+    std::size_t level = 0;
+    while (level + 1 < levels_.size() && (x1 - x0 > 1 || y1 - y0 > 1))
+    {
+        x0 >>= 1;
+        x1 >>= 1;
+        y0 >>= 1;
+        y1 >>= 1;
+        ++level;
+    }
+    const int levelWidth = std::max(width_ >> level, 1);
+    const float* texels = levels_[level].data();
+    float farthest = 0.0f;
+    for (int ty = y0; ty <= y1; ++ty)
+    {
+        for (int tx = x0; tx <= x1; ++tx)
+        {
+            farthest = std::max(farthest, texels[static_cast<std::size_t>(ty) * levelWidth + tx]);
+        }
+    }
+    return nearest > farthest;
+}
@@ -0,0 +1,309 @@
+#include "offset_allocator.hpp"
+
+/**
+* @section Bin mapping
+*/
+
+static std::uint32_t highestBit(std::uint32_t value)
+{
+    return 31u - static_cast<std::uint32_t>(__builtin_clz(value));
+}
+
+static std::uint32_t lowestBit(std::uint32_t value)
+{
+    return static_cast<std::uint32_t>(__builtin_ctz(value));
+}
+
+/**
+ * @brief Bin that holds ranges of the given size.
+ */
+static void binOf(std::uint32_t size, std::uint32_t& firstLevel, 
+                  std::uint32_t& secondLevel)
+{
+    const std::uint32_t bins = OffsetAllocator::SECOND_LEVEL_BINS;
+    if (size < bins)
+    {
+        // Small sizes get one bin each
+        firstLevel = 0;
+        secondLevel = size;
+        return;
+    }
+    const std::uint32_t bit = highestBit(size);
+    firstLevel = bit - 2;
+    secondLevel = (size >> (bit - 3)) & (bins - 1);
+}
+
+/**
+* @section Constructor
+*/
+
+OffsetAllocator::OffsetAllocator(std::uint32_t capacity)
+    : bins_{}, firstLevelMap_{ 0 }, secondLevelMaps_{}, last_{ NONE },
+      capacity_{ 0 }, freeSize_{ 0 }
+{
+    reset(capacity);
+}
+
+void OffsetAllocator::reset(std::uint32_t capacity)
+{
+    nodes_.clear();
+    unusedNodes_.clear();
+    bins_.fill(NONE);
+    firstLevelMap_ = 0;
+    secondLevelMaps_.fill(0);
+    capacity_ = capacity;
+    freeSize_ = 0;
+    last_ = NONE;
+    if (capacity > 0)
+    {
+        last_ = createNode(0, capacity);
+        insertFree(last_);
+    }
+}
+
+/**
+* @section Free lists
+*/
+
+std::uint32_t OffsetAllocator::createNode(std::uint32_t offset, std::uint32_t size)
+{
+    std::uint32_t node;
+    if (!unusedNodes_.empty())
+    {
+        node = unusedNodes_.back();
+        unusedNodes_.pop_back();
+    }
+    else
+    {
+        node = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back({});
+    }
+    nodes_[node] = { offset, size, NONE, NONE, NONE, NONE, false };
+    return node;
+}
+
+void OffsetAllocator::insertFree(std::uint32_t node)
+{
+    std::uint32_t firstLevel;
+    std::uint32_t secondLevel;
+    binOf(nodes_[node].size, firstLevel, secondLevel);
+    const std::uint32_t bin = firstLevel * SECOND_LEVEL_BINS + secondLevel;
+
+    // Push to the front of the bin's list
+    nodes_[node].binPrevious = NONE;
+    nodes_[node].binNext = bins_[bin];
+    if (bins_[bin] != NONE)
+    {
+        nodes_[bins_[bin]].binPrevious = node;
+    }
+    bins_[bin] = node;
+    firstLevelMap_ |= 1u << firstLevel;
+    secondLevelMaps_[firstLevel] |= static_cast<std::uint8_t>(1u << secondLevel);
+    nodes_[node].used = false;
+    freeSize_ += nodes_[node].size;
+}
+
+void OffsetAllocator::removeFree(std::uint32_t node)
+{
+    Node& removed = nodes_[node];
+    if (removed.binPrevious != NONE)
+    {
+        nodes_[removed.binPrevious].binNext = removed.binNext;
+    }
+    else
+    {
+        // First of its bin, which may become empty
+        std::uint32_t firstLevel;
+        std::uint32_t secondLevel;
+        binOf(removed.size, firstLevel, secondLevel);
+        const std::uint32_t bin = firstLevel * SECOND_LEVEL_BINS + secondLevel;
+        bins_[bin] = removed.binNext;
+        if (removed.binNext == NONE)
+        {
+            secondLevelMaps_[firstLevel] &= static_cast<std::uint8_t>(
+                                                ~(1u << secondLevel));
+            if (secondLevelMaps_[firstLevel] == 0)
+            {
+                firstLevelMap_ &= ~(1u << firstLevel);
+            }
+        }
+    }
+    if (removed.binNext != NONE)
+    {
+        nodes_[removed.binNext].binPrevious = removed.binPrevious;
+    }
+    freeSize_ -= removed.size;
+}
+
+/**
+* @section Allocation
+*/
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(std::uint32_t size)
+{
+    const Allocation failed{ 0, NO_SPACE };
+    if (size == 0 || size > freeSize_)
+    {
+        return failed;
+    }
+
+    // Round the size up to the next bin boundary, so that every range in 
+    // the bin found is large enough
+    std::uint32_t node = NONE;
+    std::uint32_t rounded = size;
+    bool representable = true;
+    if (size >= SECOND_LEVEL_BINS)
+    {
+        const std::uint32_t step = (1u << (highestBit(size) - 3)) - 1;
+        representable = rounded <= 0xFFFFFFFFu - step;
+        rounded += representable ? step : 0;
+    }
+    std::uint32_t firstLevel;
+    std::uint32_t secondLevel;
+    binOf(rounded, firstLevel, secondLevel);
+    if (representable && firstLevel < FIRST_LEVEL_BINS)
+    {
+        // Smallest non-empty bin at or above that one
+        std::uint32_t secondMap = secondLevelMaps_[firstLevel] & (0xFFu << secondLevel);
+        if (secondMap == 0)
+        {
+            const std::uint32_t firstMap = firstLevel + 1 < FIRST_LEVEL_BINS ? 
+                                           firstLevelMap_ & (~0u << (firstLevel + 1)) : 0;
+            if (firstMap != 0)
+            {
+                firstLevel = lowestBit(firstMap);
+                secondMap = secondLevelMaps_[firstLevel];
+            }
+        }
+        if (secondMap != 0)
+        {
+            secondLevel = lowestBit(secondMap);
+            node = bins_[firstLevel * SECOND_LEVEL_BINS + secondLevel];
+        }
+    }
+    if (node == NONE)
+    {
+        // Ranges of the size's own bin may still be large enough, such as 
+        // one that is exactly as large as the request
+        binOf(size, firstLevel, secondLevel);
+        for (std::uint32_t candidate = bins_[firstLevel * SECOND_LEVEL_BINS + secondLevel];
+             candidate != NONE; candidate = nodes_[candidate].binNext)
+        {
+            if (nodes_[candidate].size >= size)
+            {
+                node = candidate;
+                break;
+            }
+        }
+        if (node == NONE)
+        {
+            return failed;
+        }
+    }
+    removeFree(node);
+
+    // Keep the front of the range and give the rest back
+    const std::uint32_t remainder = nodes_[node].size - size;
+    if (remainder > 0)
+    {
+        const std::uint32_t rest = createNode(nodes_[node].offset + size, remainder);
+        nodes_[rest].neighbourPrevious = node;
+        nodes_[rest].neighbourNext = nodes_[node].neighbourNext;
+        if (nodes_[node].neighbourNext != NONE)
+        {
+            nodes_[nodes_[node].neighbourNext].neighbourPrevious = rest;
+        }
+        else
+        {
+            last_ = rest;
+        }
+        nodes_[node].neighbourNext = rest;
+        nodes_[node].size = size;
+        insertFree(rest);
+    }
+    nodes_[node].used = true;
+    return { nodes_[node].offset, node };
+}
+
+void OffsetAllocator::free(std::uint32_t node)
+{
+    // Absorb a free neighbour before the range
+    const std::uint32_t previous = nodes_[node].neighbourPrevious;
+    if (previous != NONE && !nodes_[previous].used)
+    {
+        removeFree(previous);
+        nodes_[node].offset = nodes_[previous].offset;
+        nodes_[node].size += nodes_[previous].size;
+        nodes_[node].neighbourPrevious = nodes_[previous].neighbourPrevious;
+        if (nodes_[node].neighbourPrevious != NONE)
+        {
+            nodes_[nodes_[node].neighbourPrevious].neighbourNext = node;
+        }
+        unusedNodes_.push_back(previous);
+    }
+
+    // And one after it
+    const std::uint32_t next = nodes_[node].neighbourNext;
+    if (next != NONE && !nodes_[next].used)
+    {
+        removeFree(next);
+        nodes_[node].size += nodes_[next].size;
+        nodes_[node].neighbourNext = nodes_[next].neighbourNext;
+        if (nodes_[node].neighbourNext != NONE)
+        {
+            nodes_[nodes_[node].neighbourNext].neighbourPrevious = node;
+        }
+        else
+        {
+            last_ = node;
+        }
+        unusedNodes_.push_back(next);
+    }
+    insertFree(node);
+}
+
+void OffsetAllocator::grow(std::uint32_t capacity)
+{
+    if (capacity <= capacity_)
+    {
+        return;
+    }
+    const std::uint32_t added = capacity - capacity_;
+    if (last_ != NONE && !nodes_[last_].used)
+    {
+        // Extend the free range at the end
+        removeFree(last_);
+        nodes_[last_].size += added;
+        insertFree(last_);
+    }
+    else
+    {
+        const std::uint32_t node = createNode(capacity_, added);
+        nodes_[node].neighbourPrevious = last_;
+        if (last_ != NONE)
+        {
+            nodes_[last_].neighbourNext = node;
+        }
+        last_ = node;
+        insertFree(node);
+    }
+    capacity_ = capacity;
+}
+
+std::uint32_t OffsetAllocator::getLargestFree() const
+{
+    if (firstLevelMap_ == 0)
+    {
+        return 0;
+    }
+    // The largest ranges are in the highest non-empty bin
+    const std::uint32_t firstLevel = highestBit(firstLevelMap_);
+    const std::uint32_t secondLevel = highestBit(secondLevelMaps_[firstLevel]);
+    std::uint32_t largest = 0;
+    for (std::uint32_t node = bins_[firstLevel * SECOND_LEVEL_BINS + secondLevel];
+         node != NONE; node = nodes_[node].binNext)
+    {
+        largest = nodes_[node].size > largest ? nodes_[node].size : largest;
+    }
+    return largest;
+}
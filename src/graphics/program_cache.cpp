@@ -0,0 +1,206 @@
+#include "program_cache.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+/**
+ * @struct BinaryHeader
+ * @brief Header in front of every cached program binary.
+ */
+struct BinaryHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint32_t reserved;
+    std::uint64_t key;
+    std::uint64_t size;
+    double buildMs;
+};
+
+/**
+ * @var CACHE_MAGIC
+ * @brief First bytes of every cache file.
+ */
+static constexpr char CACHE_MAGIC[4]{ 'H', 'T', 'P', 'B' };
+
+/**
+ * @var CACHE_VERSION
+ * @brief Version of the file layout, bumped whenever BinaryHeader changes.
+ */
+static constexpr std::uint32_t CACHE_VERSION{ 1 };
+
+/**
+* @section Helper functions
+*/
+
+static std::uint64_t hashBytes(std::uint64_t hash, const char* bytes, 
+                               std::size_t length)
+{
+    // 64-bit FNV-1a
+    for ( std::size_t i = 0; i < length; ++i )
+    {
+        hash ^= static_cast<unsigned char>( bytes[i] );
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static std::string getString(GLenum name)
+{
+    const GLubyte* value = glGetString( name );
+    return value ? reinterpret_cast<const char*>( value ) : "";
+}
+
+/**
+* @section Constructor
+*/
+
+ProgramCache::ProgramCache(const std::string& directory)
+    : directory_{ directory }, supported_{ false }
+{
+    driver_ = getString( GL_VENDOR ) + '\n' + getString( GL_RENDERER ) + '\n' 
+            + getString( GL_VERSION );
+
+    // Binaries need OpenGL 4.1 or the extension, and at least one format
+    GLint formats{ 0 };
+    if ( GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary )
+    {
+        glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+    }
+    if ( formats <= 0 )
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories( directory_, error );
+    if ( error )
+    {
+        std::printf( "Shader cache disabled, cannot create %s: %s\n", 
+                     directory_.c_str(), error.message().c_str() );
+        return;
+    }
+    supported_ = true;
+}
+
+/**
+* @section Cache Member functions
+*/
+
+std::uint64_t ProgramCache::makeKey(const char* vertexSource, 
+                                    const char* fragmentSource) const
+{
+    // The terminating zeros separate the parts, so moving text from one 
+    // source to the next changes the key
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hashBytes( hash, vertexSource, std::strlen( vertexSource ) + 1 );
+    hash = hashBytes( hash, fragmentSource, std::strlen( fragmentSource ) + 1 );
+    hash = hashBytes( hash, driver_.c_str(), driver_.size() + 1 );
+    return hash;
+}
+
+std::string ProgramCache::pathOf(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf( name, sizeof( name ), "%016llx.bin", 
+                   static_cast<unsigned long long>( key ) );
+    return ( std::filesystem::path( directory_ ) / name ).string();
+}
+
+bool ProgramCache::load(std::uint64_t key, GLuint program)
+{
+    if ( !supported_ )
+    {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // Read and validate the header before trusting the size it gives
+    std::ifstream file( pathOf( key ), std::ios::binary );
+    BinaryHeader header{};
+    if ( !file || !file.read( reinterpret_cast<char*>( &header ), 
+                              sizeof( header ) ) ||
+         std::memcmp( header.magic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) ) != 0 ||
+         header.version != CACHE_VERSION || header.key != key || 
+         header.size == 0 || header.size > ( 1ULL << 30 ) )
+    {
+        ++stats_.misses;
+        return false;
+    }
+    std::vector<char> binary( header.size );
+    if ( !file.read( binary.data(), static_cast<std::streamsize>( binary.size() ) ) )
+    {
+        ++stats_.misses;
+        return false;
+    }
+
+    // The driver decides whether the binary is still usable
+    glProgramBinary( program, header.format, binary.data(), 
+                     static_cast<GLsizei>( binary.size() ) );
+    GLint success{ 0 };
+    glGetProgramiv( program, GL_LINK_STATUS, &success );
+    if ( !success )
+    {
+        ++stats_.rejected;
+        ++stats_.misses;
+        return false;
+    }
+
+    const double loadMs = std::chrono::duration<double, std::milli>( 
+                    std::chrono::steady_clock::now() - start ).count();
+    ++stats_.hits;
+    stats_.savedMs += header.buildMs - loadMs;
+    return true;
+}
+
+void ProgramCache::store(std::uint64_t key, GLuint program, double buildMs)
+{
+    if ( !supported_ )
+    {
+        return;
+    }
+    GLint length{ 0 };
+    glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+    if ( length <= 0 )
+    {
+        return;
+    }
+    std::vector<char> binary( static_cast<std::size_t>( length ) );
+    GLenum format{ 0 };
+    GLsizei written{ 0 };
+    glGetProgramBinary( program, length, &written, &format, binary.data() );
+    if ( written <= 0 )
+    {
+        return;
+    }
+
+    BinaryHeader header{};
+    std::memcpy( header.magic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+    header.version = CACHE_VERSION;
+    header.format = format;
+    header.key = key;
+    header.size = static_cast<std::uint64_t>( written );
+    header.buildMs = buildMs;
+
+    // Write to a temporary file first, so a concurrent run never reads a 
+    // half written entry
+    const std::string path = pathOf( key );
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file( temporary, std::ios::binary | std::ios::trunc );
+        file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+        file.write( binary.data(), written );
+        if ( !file )
+        {
+            std::printf( "Writing shader cache entry %s failed\n", 
+                         temporary.c_str() );
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename( temporary, path, error );
+}
@@ -0,0 +1,285 @@
+#include "render_queue.hpp"
+#include <algorithm>
+
+/**
+* @section GLStateCache
+*/
+
+GLStateCache::GLStateCache()
+    : program_{ 0 }, vao_{ 0 }, activeUnit_{ 0 }, textures_{}, 
+      textureTargets_{}, uniformRanges_{}, valid_{ false }, bindsIssued_{ 0 }, bindsElided_{ 0 },
+      textureBindsIssued_{ 0 }
+{
+}
+
+void GLStateCache::invalidate()
+{
+    valid_ = false;
+}
+
+void GLStateCache::ensureValid()
+{
+    if (valid_)
+    {
+        return;
+    }
+    // Nothing is known, so every tracked binding must be issued again
+    program_ = ~0u;
+    vao_ = ~0u;
+    activeUnit_ = ~0u;
+    textures_.fill(~0u);
+    textureTargets_.fill(GL_NONE);
+    uniformRanges_.fill({ ~0u, 0, 0 });
+    valid_ = true;
+}
+
+bool GLStateCache::change(GLuint& current, GLuint value)
+{
+    if (current == value)
+    {
+        ++bindsElided_;
+        return false;
+    }
+    current = value;
+    ++bindsIssued_;
+    return true;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    ensureValid();
+    if (change(program_, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    ensureValid();
+    if (change(vao_, vao))
+    {
+        glBindVertexArray(vao);
+    }
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    ensureValid();
+    // A different target on the same unit is a different binding
+    if (textureTargets_[unit] != target)
+    {
+        textureTargets_[unit] = target;
+        textures_[unit] = ~0u;
+    }
+    if (textures_[unit] == texture)
+    {
+        ++bindsElided_;
+        return;
+    }
+    if (activeUnit_ != unit)
+    {
+        activeUnit_ = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    textures_[unit] = texture;
+    ++bindsIssued_;
+    ++textureBindsIssued_;
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindUniformRange(GLuint binding, GLuint buffer, GLintptr offset,
+                                    GLsizeiptr size)
+{
+    ensureValid();
+    UniformRange& current = uniformRanges_[binding];
+    if (current.buffer == buffer && current.offset == offset && current.size == size)
+    {
+        ++bindsElided_;
+        return;
+    }
+    current = { buffer, offset, size };
+    ++bindsIssued_;
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+}
+
+void GLStateCache::resetCounters()
+{
+    bindsIssued_ = 0;
+    bindsElided_ = 0;
+    textureBindsIssued_ = 0;
+}
+
+/**
+* @section Sort keys
+*/
+
+std::uint64_t makeSortKey(std::uint32_t program, std::uint32_t vao, 
+                          std::uint32_t texture, float depth)
+{
+    // Quantize depth to 20 bits, clamping values outside [0, 1]
+    const float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+    const std::uint64_t depthBits = static_cast<std::uint64_t>(
+                                        clamped * 1048575.0f);
+    return (static_cast<std::uint64_t>(program & 0xFFFFu) << 48) |
+           (static_cast<std::uint64_t>(vao & 0xFFFFu) << 32) |
+           (static_cast<std::uint64_t>(texture & 0xFFFu) << 20) |
+           depthBits;
+}
+
+/**
+* @section RenderQueue
+*/
+
+void RenderQueue::submit(const DrawItem& item)
+{
+    items_.push_back(item);
+}
+
+void RenderQueue::submit(const std::vector<DrawItem>& items)
+{
+    items_.insert(items_.end(), items.begin(), items.end());
+}
+
+void RenderQueue::sort()
+{
+    const std::size_t count = items_.size();
+    order_.resize(count);
+    scratch_.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        order_[i] = { items_[i].key, static_cast<std::uint32_t>(i) };
+    }
+    if (count < 2)
+    {
+        return;
+    }
+
+    // Histogram of every byte of every key, built in a single pass
+    std::array<std::array<std::size_t, 256>, 8> histograms{};
+    for (const SortEntry& entry : order_)
+    {
+        for (std::size_t byte = 0; byte < 8; ++byte)
+        {
+            ++histograms[byte][(entry.key >> (byte * 8)) & 0xFF];
+        }
+    }
+
+    // One stable counting pass per byte, least significant first
+    for (std::size_t byte = 0; byte < 8; ++byte)
+    {
+        std::array<std::size_t, 256>& histogram = histograms[byte];
+        const std::size_t digit = (order_[0].key >> (byte * 8)) & 0xFF;
+        if (histogram[digit] == count)
+        {
+            // Every key has the same digit, this pass would change nothing
+            continue;
+        }
+        std::size_t offset = 0;
+        for (std::size_t& bucket : histogram)
+        {
+            const std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const SortEntry& entry : order_)
+        {
+            scratch_[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+        }
+        order_.swap(scratch_);
+    }
+}
+
+std::size_t RenderQueue::flush(GLStateCache& state)
+{
+    // Submit in sorted order, or in submission order if sort was skipped
+    if (order_.size() != items_.size())
+    {
+        order_.resize(items_.size());
+        for (std::size_t i = 0; i < items_.size(); ++i)
+        {
+            order_[i] = { items_[i].key, static_cast<std::uint32_t>(i) };
+        }
+    }
+    for (const SortEntry& entry : order_)
+    {
+        const DrawItem& item = items_[entry.index];
+        state.useProgram(item.program);
+        state.bindVertexArray(item.vao);
+        if (item.texture != 0)
+        {
+            state.bindTexture(0, item.textureTarget, item.texture);
+        }
+        if (item.uniformBuffer != 0)
+        {
+            state.bindUniformRange(OBJECT_UNIFORM_BINDING, item.uniformBuffer, 
+                                   item.uniformOffset, item.uniformSize);
+        }
+        if (item.occlusionQuery != 0)
+        {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, item.occlusionQuery);
+        }
+        if (item.conditionQuery != 0)
+        {
+            glBeginConditionalRender(item.conditionQuery, GL_QUERY_WAIT);
+        }
+        if (item.batch != nullptr)
+        {
+            item.batch->draw();
+        }
+        else if (item.indexType != GL_NONE)
+        {
+            const void* indices = reinterpret_cast<const void*>(item.indexOffset);
+            if (item.instances > 0 && item.baseInstance != 0)
+            {
+                glDrawElementsInstancedBaseVertexBaseInstance(item.mode, item.count,
+                                                              item.indexType, indices,
+                                                              item.instances,
+                                                              item.baseVertex,
+                                                              item.baseInstance);
+            }
+            else if (item.instances > 0)
+            {
+                glDrawElementsInstancedBaseVertex(item.mode, item.count, 
+                                                  item.indexType, indices,
+                                                  item.instances, 
+                                                  item.baseVertex);
+            }
+            else
+            {
+                glDrawElementsBaseVertex(item.mode, item.count, item.indexType,
+                                         indices, item.baseVertex);
+            }
+        }
+        else if (item.instances > 0 && item.baseInstance != 0)
+        {
+            glDrawArraysInstancedBaseInstance(item.mode, item.first, item.count,
+                                              item.instances, item.baseInstance);
+        }
+        else if (item.instances > 0)
+        {
+            glDrawArraysInstanced(item.mode, item.first, item.count, 
+                                  item.instances);
+        }
+        else
+        {
+            glDrawArrays(item.mode, item.first, item.count);
+        }
+        if (item.conditionQuery != 0)
+        {
+            glEndConditionalRender();
+        }
+        if (item.occlusionQuery != 0)
+        {
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_TRUE);
+        }
+    }
+    const std::size_t draws = items_.size();
+    items_.clear();
+    order_.clear();
+    return draws;
+}
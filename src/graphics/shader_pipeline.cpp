@@ -0,0 +1,185 @@
+#include "shader_pipeline.hpp"
+#include <algorithm>
+#include <cstdio>
+
+/**
+* @section Helper functions
+*/
+
+static std::string getShaderLog(unsigned int shader, const char* shaderType)
+{
+    char infoLog[512];
+    glGetShaderInfoLog(shader, 512, NULL, infoLog);
+    return std::string("ERROR::SHADER::") + shaderType + 
+           "::COMPILATION_FAILED\n " + infoLog;
+}
+
+/**
+* @section Constructor & Destructor
+*/
+
+ShaderPipeline::ShaderPipeline(ProgramCache* cache)
+    : cache_{ cache }, parallel_{ false }, pending_{ 0 }, slowestReadyMs_{ 0.0 }
+{
+    // Let the driver use as many compiler threads as it likes
+    if (GLAD_GL_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        parallel_ = true;
+    }
+    else if (GLAD_GL_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+        parallel_ = true;
+    }
+}
+
+ShaderPipeline::~ShaderPipeline()
+{
+    for (Entry& entry : entries_)
+    {
+        glDeleteShader(entry.vertexShader);
+        glDeleteShader(entry.fragmentShader);
+        glDeleteProgram(entry.program);
+    }
+}
+
+/**
+* @section Build Member functions
+*/
+
+ShaderPipeline::Handle ShaderPipeline::submit(const char* vertexSource, 
+                                              const char* fragmentSource)
+{
+    Entry entry;
+    entry.program = glCreateProgram();
+    entry.submitted = Clock::now();
+
+    // A cached binary makes the program usable right away
+    if (cache_ && cache_->isSupported())
+    {
+        entry.key = cache_->makeKey(vertexSource, fragmentSource);
+        if (cache_->load(entry.key, entry.program))
+        {
+            entry.state = State::Ready;
+            entries_.push_back(entry);
+            return entries_.size() - 1;
+        }
+        glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 
+                            GL_TRUE);
+    }
+
+    // Submit both compiles and the link without asking for any status, so 
+    // the driver is free to work on them in the background
+    entry.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(entry.vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(entry.vertexShader);
+
+    entry.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(entry.fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(entry.fragmentShader);
+
+    glAttachShader(entry.program, entry.vertexShader);
+    glAttachShader(entry.program, entry.fragmentShader);
+    glLinkProgram(entry.program);
+
+    entry.buildMs = std::chrono::duration<double, std::milli>(
+                                    Clock::now() - entry.submitted).count();
+    entries_.push_back(entry);
+    ++pending_;
+    return entries_.size() - 1;
+}
+
+void ShaderPipeline::poll()
+{
+    if (pending_ == 0)
+    {
+        return;
+    }
+    for (Entry& entry : entries_)
+    {
+        if (entry.state != State::Pending)
+        {
+            continue;
+        }
+        if (parallel_)
+        {
+            // Non-blocking check of the driver's background build
+            GLint complete = GL_FALSE;
+            glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (complete)
+            {
+                finalize(entry);
+            }
+        }
+        else
+        {
+            // Without the extension every status query may block, so only 
+            // pay for one program per frame
+            finalize(entry);
+            return;
+        }
+    }
+}
+
+void ShaderPipeline::finish()
+{
+    for (Entry& entry : entries_)
+    {
+        if (entry.state == State::Pending)
+        {
+            finalize(entry);
+        }
+    }
+}
+
+void ShaderPipeline::finalize(Entry& entry)
+{
+    --pending_;
+    const Clock::time_point start = Clock::now();
+    int success;
+
+    // Report the first stage that failed
+    glGetShaderiv(entry.vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        entry.error = getShaderLog(entry.vertexShader, "VERTEX");
+    }
+    glGetShaderiv(entry.fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success && entry.error.empty())
+    {
+        entry.error = getShaderLog(entry.fragmentShader, "FRAGMENT");
+    }
+    glGetProgramiv(entry.program, GL_LINK_STATUS, &success);
+    if (!success && entry.error.empty())
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(entry.program, 512, NULL, infoLog);
+        entry.error = std::string("ERROR::SHADER::PROGRAM::LINKING_FAILED\n") 
+                    + infoLog;
+    }
+
+    // The shaders are not needed once the program is linked
+    glDeleteShader(entry.vertexShader);
+    glDeleteShader(entry.fragmentShader);
+    entry.vertexShader = 0;
+    entry.fragmentShader = 0;
+
+    if (!entry.error.empty())
+    {
+        entry.state = State::Failed;
+        std::printf("%s\n", entry.error.c_str());
+        return;
+    }
+
+    entry.state = State::Ready;
+    const Clock::time_point now = Clock::now();
+    entry.buildMs += std::chrono::duration<double, std::milli>(
+                                    now - start).count();
+    slowestReadyMs_ = std::max(slowestReadyMs_, 
+        std::chrono::duration<double, std::milli>(now - entry.submitted).count());
+    if (cache_ && cache_->isSupported())
+    {
+        cache_->store(entry.key, entry.program, entry.buildMs);
+    }
+}
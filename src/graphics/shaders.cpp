@@ -1,4 +1,5 @@
 #include "shaders.hpp"
+#include <chrono>
 
 void Shader::generateID(GLenum shaderType)
 {
@@ -45,10 +46,55 @@ FragmentShader::FragmentShader(const char *source)
 }
 
 Program::Program(const unsigned int vertexShaderID, const unsigned int fragShaderID)
+{
+    shaderProgram_ = glCreateProgram();
+    link(vertexShaderID, fragShaderID);
+}
+
+Program::Program(const char *vertexSource, const char *fragmentSource, 
+                 ProgramCache *cache)
+{
+    shaderProgram_ = glCreateProgram();
+    // Try the binary of an earlier run first
+    std::uint64_t key = 0;
+    if (cache && cache->isSupported())
+    {
+        key = cache->makeKey(vertexSource, fragmentSource);
+        if (cache->load(key, shaderProgram_))
+        {
+            return;
+        }
+        // Ask the driver to keep the binary around so it can be cached
+        glProgramParameteri(shaderProgram_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 
+                            GL_TRUE);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        // Create shader objects, if fail throws logic error
+        VertexShader vertexShader(vertexSource);
+        FragmentShader fragShader(fragmentSource);
+        link(vertexShader.getShaderID(), fragShader.getShaderID());
+    }
+    catch (const std::logic_error&)
+    {
+        glDeleteProgram(shaderProgram_);
+        throw;
+    }
+    const double buildMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+
+    if (cache && cache->isSupported())
+    {
+        cache->store(key, shaderProgram_, buildMs);
+    }
+}
+
+void Program::link(const unsigned int vertexShaderID, const unsigned int fragShaderID)
 {
     int success;
     char infoLog[512];
-    shaderProgram_ = glCreateProgram();
     glAttachShader(shaderProgram_, vertexShaderID);
     glAttachShader(shaderProgram_, fragShaderID);
     glLinkProgram(shaderProgram_);
@@ -62,4 +108,4 @@ Program::Program(const unsigned int vertexShaderID, const unsigned int fragShade
     }
     glDeleteShader(vertexShaderID);
     glDeleteShader(fragShaderID);
-}
+}
\ No newline at end of file
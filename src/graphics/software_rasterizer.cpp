@@ -0,0 +1,652 @@
+#include "software_rasterizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HELLO_TRIANGLE_SSE2 1
+#endif
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @var GUARD_BAND
+ * @brief Triangles are clipped to this multiple of the viewport, so snapped
+ * coordinates of MAX_SIZE pixels keep edge steps below 2^18.
+ */
+static constexpr float GUARD_BAND{ 4.0f };
+
+/**
+ * @var EDGE_LIMIT
+ * @brief Edge values at the corner of a tile are clamped to this magnitude;
+ * the steps within a tile never add more than 2^29, so the sign stays right
+ * and 32 bits suffice.
+ */
+static constexpr std::int64_t EDGE_LIMIT{ std::int64_t{ 1 } << 30 };
+
+/**
+ * @var MAX_CLIPPED
+ * @brief Corners of a triangle after clipping it against six planes.
+ */
+static constexpr std::size_t MAX_CLIPPED{ 9 };
+
+std::uint32_t packColor(float red, float green, float blue, float alpha)
+{
+    auto channel = [](float value) {
+        return static_cast<std::uint32_t>(std::lrintf(
+                            std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+    };
+    return channel(red) | (channel(green) << 8) | (channel(blue) << 16) |
+           (channel(alpha) << 24);
+}
+
+static float planeDistance(const SoftwareVertex& vertex, int plane)
+{
+    // Inside is >= 0: near, far, then the guard band left, right, bottom, top
+    const float* p = vertex.position;
+    switch (plane)
+    {
+        case 0:  return p[2] + p[3];
+        case 1:  return p[3] - p[2];
+        case 2:  return GUARD_BAND * p[3] + p[0];
+        case 3:  return GUARD_BAND * p[3] - p[0];
+        case 4:  return GUARD_BAND * p[3] + p[1];
+        default: return GUARD_BAND * p[3] - p[1];
+    }
+}
+
+static SoftwareVertex lerpVertex(const SoftwareVertex& a, const SoftwareVertex& b,
+                                 float t)
+{
+    SoftwareVertex result;
+    for (int i = 0; i < 4; ++i)
+    {
+        result.position[i] = a.position[i] + (b.position[i] - a.position[i]) * t;
+    }
+    for (std::size_t i = 0; i < SOFTWARE_MAX_VARYINGS; ++i)
+    {
+        result.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+    }
+    return result;
+}
+
+static std::int64_t clampEdge(std::int64_t value)
+{
+    return std::min(std::max(value, -EDGE_LIMIT), EDGE_LIMIT);
+}
+
+/**
+* @section Constructor
+*/
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, JobSystem& jobs)
+    : jobs_{ jobs }, width_{ 0 }, height_{ 0 }, tilesX_{ 0 }, tilesY_{ 0 }
+{
+    resize(width, height);
+}
+
+void SoftwareRasterizer::resize(int width, int height)
+{
+    if (width < 1 || height < 1 || width > MAX_SIZE || height > MAX_SIZE)
+    {
+        throw std::logic_error(std::string("ERROR::SOFTWARE_RASTERIZER::INVALID_SIZE\n ")
+                               + std::to_string(width) + "x" + std::to_string(height));
+    }
+    width_ = width;
+    height_ = height;
+    tilesX_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+    color_.assign(static_cast<std::size_t>(width) * height, 0);
+    // Depth rows are padded to whole groups of four for the SIMD loads
+    depth_.assign(static_cast<std::size_t>((width + 3) & ~3) * height, 1.0f);
+}
+
+/**
+* @section Drawing Member functions
+*/
+
+void SoftwareRasterizer::clear(std::uint32_t color, float depth)
+{
+    const std::size_t depthPitch = static_cast<std::size_t>((width_ + 3) & ~3);
+    jobs_.parallelFor(static_cast<std::size_t>(height_), 16,
+                      [&](std::size_t begin, std::size_t end) {
+        std::fill(color_.begin() + begin * width_, color_.begin() + end * width_,
+                  color);
+        std::fill(depth_.begin() + begin * depthPitch,
+                  depth_.begin() + end * depthPitch, depth);
+    });
+}
+
+void SoftwareRasterizer::draw(const SoftwareProgram& program, const float* vertices,
+                              std::size_t stride, std::size_t vertexCount,
+                              const std::uint32_t* indices, std::size_t indexCount)
+{
+    Draw recorded;
+    recorded.program = &program;
+    recorded.vertices = vertices;
+    recorded.stride = stride;
+    recorded.vertexCount = vertexCount;
+    recorded.indices = indices;
+    recorded.triangleCount = (indices ? indexCount : vertexCount) / 3;
+    draws_.push_back(recorded);
+}
+
+void SoftwareRasterizer::draw(const SoftwareProgram& program,
+                              const std::vector<float>& vertices, std::size_t stride)
+{
+    draw(program, vertices.data(), stride, vertices.size() / stride);
+}
+
+void SoftwareRasterizer::draw(const SoftwareProgram& program, const Mesh& mesh)
+{
+    draw(program, mesh.vertices.data(), 3, mesh.vertices.size() / 3,
+         mesh.indices.data(), mesh.indices.size());
+}
+
+void SoftwareRasterizer::render()
+{
+    stats_ = SoftwareRasterizerStats{};
+    stats_.draws = draws_.size();
+    const std::size_t tiles = static_cast<std::size_t>(tilesX_) * tilesY_;
+    stats_.tiles = tiles;
+
+    // Vertex pass: run the vertex functor once per vertex
+    shaded_.resize(draws_.size());
+    for (std::size_t d = 0; d < draws_.size(); ++d)
+    {
+        const Draw& recorded = draws_[d];
+        std::vector<SoftwareVertex>& shaded = shaded_[d];
+        shaded.resize(recorded.vertexCount);
+        jobs_.parallelFor(recorded.vertexCount, 4096,
+                          [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                SoftwareVertex& out = shaded[i];
+                std::fill(out.varyings, out.varyings + SOFTWARE_MAX_VARYINGS, 0.0f);
+                recorded.program->vertex(recorded.vertices + i * recorded.stride, out);
+            }
+        });
+        stats_.vertices += recorded.vertexCount;
+        stats_.triangles += recorded.triangleCount;
+    }
+
+    // Setup pass: clip, snap and bin chunks of triangles
+    std::size_t chunkCount = 0;
+    for (std::size_t d = 0; d < draws_.size(); ++d)
+    {
+        for (std::size_t first = 0; first < draws_[d].triangleCount;
+             first += SETUP_GRAIN)
+        {
+            if (chunkCount == chunks_.size())
+            {
+                chunks_.emplace_back();
+            }
+            SetupChunk& chunk = chunks_[chunkCount++];
+            chunk.draw = d;
+            chunk.firstTriangle = first;
+            chunk.triangleCount = std::min(SETUP_GRAIN,
+                                           draws_[d].triangleCount - first);
+        }
+    }
+    jobs_.parallelFor(chunkCount, 1, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c)
+        {
+            setupChunk(chunks_[c]);
+        }
+    });
+
+    // Give every tile a range of the bins; within a tile the chunks follow
+    // each other in submission order. The counts become write positions.
+    binStart_.assign(tiles + 1, 0);
+    std::size_t running = 0;
+    for (std::size_t tile = 0; tile < tiles; ++tile)
+    {
+        binStart_[tile] = running;
+        for (std::size_t c = 0; c < chunkCount; ++c)
+        {
+            const std::uint32_t count = chunks_[c].tileCounts[tile];
+            chunks_[c].tileCounts[tile] = static_cast<std::uint32_t>(running);
+            running += count;
+        }
+    }
+    binStart_[tiles] = running;
+    bins_.resize(running);
+    stats_.binEntries = running;
+    jobs_.parallelFor(chunkCount, 1, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c)
+        {
+            SetupChunk& chunk = chunks_[c];
+            for (std::size_t ref = 0; ref < chunk.tileRefs.size(); ++ref)
+            {
+                bins_[chunk.tileCounts[chunk.tileRefs[ref]]++] =
+                        &chunk.triangles[chunk.triangleRefs[ref]];
+            }
+        }
+    });
+    for (std::size_t c = 0; c < chunkCount; ++c)
+    {
+        stats_.trianglesSetUp += chunks_[c].triangles.size();
+    }
+
+    // Raster pass: one job per tile, so no two jobs touch the same pixel
+    jobs_.parallelFor(tiles, 1, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t tile = begin; tile < end; ++tile)
+        {
+            rasterTile(tile);
+        }
+    });
+    draws_.clear();
+}
+
+/**
+* @section Setup
+*/
+
+void SoftwareRasterizer::setupChunk(SetupChunk& chunk)
+{
+    const Draw& recorded = draws_[chunk.draw];
+    const std::vector<SoftwareVertex>& shaded = shaded_[chunk.draw];
+    const SoftwareProgram& program = *recorded.program;
+    chunk.triangles.clear();
+    chunk.tileRefs.clear();
+    chunk.triangleRefs.clear();
+    chunk.tileCounts.assign(static_cast<std::size_t>(tilesX_) * tilesY_, 0);
+
+    for (std::size_t t = chunk.firstTriangle;
+         t < chunk.firstTriangle + chunk.triangleCount; ++t)
+    {
+        const SoftwareVertex* corners[3];
+        bool valid = true;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            const std::size_t index = recorded.indices ? recorded.indices[t * 3 + i]
+                                                       : t * 3 + i;
+            valid = valid && index < shaded.size();
+            corners[i] = valid ? &shaded[index] : nullptr;
+        }
+        if (!valid)
+        {
+            continue;
+        }
+
+        // Skip triangles entirely outside one plane of the view volume
+        std::uint32_t outside[3] = { 0, 0, 0 };
+        bool clip = false;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float* p = corners[i]->position;
+            outside[i] = (p[0] < -p[3] ? 1u : 0u) | (p[0] > p[3] ? 2u : 0u) |
+                         (p[1] < -p[3] ? 4u : 0u) | (p[1] > p[3] ? 8u : 0u) |
+                         (p[2] < -p[3] ? 16u : 0u) | (p[2] > p[3] ? 32u : 0u);
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                clip = clip || planeDistance(*corners[i], plane) < 0.0f;
+            }
+        }
+        if (outside[0] & outside[1] & outside[2])
+        {
+            continue;
+        }
+        if (!clip)
+        {
+            setupTriangle(chunk, program, corners);
+            continue;
+        }
+
+        // Sutherland-Hodgman against the near and far planes and the guard
+        // band, then a fan over the remaining polygon
+        SoftwareVertex polygon[2][MAX_CLIPPED];
+        std::size_t count = 3;
+        for (int i = 0; i < 3; ++i)
+        {
+            polygon[0][i] = *corners[i];
+        }
+        int current = 0;
+        for (int plane = 0; plane < 6 && count >= 3; ++plane)
+        {
+            const SoftwareVertex* in = polygon[current];
+            SoftwareVertex* out = polygon[1 - current];
+            std::size_t outCount = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const SoftwareVertex& a = in[i];
+                const SoftwareVertex& b = in[(i + 1) % count];
+                const float da = planeDistance(a, plane);
+                const float db = planeDistance(b, plane);
+                if (da >= 0.0f)
+                {
+                    out[outCount++] = a;
+                }
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    out[outCount++] = lerpVertex(a, b, da / (da - db));
+                }
+            }
+            count = outCount;
+            current = 1 - current;
+        }
+        for (std::size_t i = 2; i < count; ++i)
+        {
+            const SoftwareVertex* fan[3] = { &polygon[current][0],
+                                             &polygon[current][i - 1],
+                                             &polygon[current][i] };
+            setupTriangle(chunk, program, fan);
+        }
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(SetupChunk& chunk,
+                                       const SoftwareProgram& program,
+                                       const SoftwareVertex* const* corners)
+{
+    // Project to the screen and snap to the subpixel grid
+    const float scale = static_cast<float>(1 << SUBPIXEL_BITS);
+    std::int64_t x[3], y[3];
+    float z[3], inverseW[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const float* p = corners[i]->position;
+        if (!(p[3] > 0.0f))
+        {
+            return;
+        }
+        inverseW[i] = 1.0f / p[3];
+        x[i] = std::lrintf((p[0] * inverseW[i] * 0.5f + 0.5f) * width_ * scale);
+        y[i] = std::lrintf((p[1] * inverseW[i] * 0.5f + 0.5f) * height_ * scale);
+        z[i] = p[2] * inverseW[i] * 0.5f + 0.5f;
+    }
+    std::int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0 || (area < 0 && program.cullBackFaces))
+    {
+        return;
+    }
+    // Make every triangle counterclockwise, so inside means all edges >= 0
+    int order[3] = { 0, 1, 2 };
+    if (area < 0)
+    {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    SetupTriangle triangle;
+    std::int64_t minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 1; i < 3; ++i)
+    {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+    triangle.minX = static_cast<int>(std::max<std::int64_t>(minX >> SUBPIXEL_BITS, 0));
+    triangle.minY = static_cast<int>(std::max<std::int64_t>(minY >> SUBPIXEL_BITS, 0));
+    triangle.maxX = static_cast<int>(std::min<std::int64_t>((maxX >> SUBPIXEL_BITS) + 1,
+                                                             width_));
+    triangle.maxY = static_cast<int>(std::min<std::int64_t>((maxY >> SUBPIXEL_BITS) + 1,
+                                                             height_));
+    if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+    {
+        return;
+    }
+
+    for (int edge = 0; edge < 3; ++edge)
+    {
+        // The edge opposite corner edge, from corner a to corner b
+        const int a = order[(edge + 1) % 3];
+        const int b = order[(edge + 2) % 3];
+        const std::int64_t edgeA = y[a] - y[b];
+        const std::int64_t edgeB = x[b] - x[a];
+        std::int64_t edgeC = -(edgeA * x[a] + edgeB * y[a]);
+        // Top-left fill rule: pixels exactly on other edges are left out
+        const bool topLeft = edgeA > 0 || (edgeA == 0 && edgeB < 0);
+        if (!topLeft)
+        {
+            edgeC -= 1;
+        }
+        triangle.edgeA[edge] = static_cast<std::int32_t>(edgeA);
+        triangle.edgeB[edge] = static_cast<std::int32_t>(edgeB);
+        triangle.edgeC[edge] = edgeC;
+    }
+    triangle.inverseArea = 1.0f / static_cast<float>(area);
+    triangle.depth[0] = z[order[0]];
+    triangle.depth[1] = z[order[1]] - z[order[0]];
+    triangle.depth[2] = z[order[2]] - z[order[0]];
+    for (int i = 0; i < 3; ++i)
+    {
+        triangle.inverseW[i] = inverseW[order[i]];
+        for (std::size_t v = 0; v < SOFTWARE_MAX_VARYINGS; ++v)
+        {
+            triangle.varyings[i][v] = corners[order[i]]->varyings[v] * inverseW[order[i]];
+        }
+    }
+    triangle.program = &program;
+
+    // Bin into every tile of the bounds that some part of the triangle may
+    // cover, testing each edge at the tile corner where it is largest
+    const std::uint32_t index = static_cast<std::uint32_t>(chunk.triangles.size());
+    bool binned = false;
+    const int tileX0 = triangle.minX / TILE_SIZE;
+    const int tileX1 = (triangle.maxX - 1) / TILE_SIZE;
+    const int tileY0 = triangle.minY / TILE_SIZE;
+    const int tileY1 = (triangle.maxY - 1) / TILE_SIZE;
+    const std::int64_t tileSpan = std::int64_t{ TILE_SIZE } << SUBPIXEL_BITS;
+    for (int ty = tileY0; ty <= tileY1; ++ty)
+    {
+        for (int tx = tileX0; tx <= tileX1; ++tx)
+        {
+            const std::int64_t left = std::int64_t{ tx } * tileSpan;
+            const std::int64_t bottom = std::int64_t{ ty } * tileSpan;
+            bool overlaps = true;
+            for (int edge = 0; edge < 3 && overlaps; ++edge)
+            {
+                const std::int64_t cornerX = left + (triangle.edgeA[edge] > 0 ? tileSpan : 0);
+                const std::int64_t cornerY = bottom + (triangle.edgeB[edge] > 0 ? tileSpan : 0);
+                overlaps = triangle.edgeA[edge] * cornerX + triangle.edgeB[edge] * cornerY +
+                           triangle.edgeC[edge] >= 0;
+            }
+            if (!overlaps)
+            {
+                continue;
+            }
+            const std::uint32_t tile = static_cast<std::uint32_t>(ty * tilesX_ + tx);
+            chunk.tileRefs.push_back(tile);
+            chunk.triangleRefs.push_back(index);
+            ++chunk.tileCounts[tile];
+            binned = true;
+        }
+    }
+    if (binned)
+    {
+        chunk.triangles.push_back(triangle);
+    }
+}
+
+/**
+* @section Rasterization
+*/
+
+void SoftwareRasterizer::rasterTile(std::size_t tile)
+{
+    const int x0 = static_cast<int>(tile % tilesX_) * TILE_SIZE;
+    const int y0 = static_cast<int>(tile / tilesX_) * TILE_SIZE;
+    const int x1 = std::min(x0 + TILE_SIZE, width_);
+    const int y1 = std::min(y0 + TILE_SIZE, height_);
+    for (std::size_t entry = binStart_[tile]; entry < binStart_[tile + 1]; ++entry)
+    {
+        const SetupTriangle& triangle = *bins_[entry];
+        rasterTriangle(triangle, std::max(x0, triangle.minX),
+                       std::max(y0, triangle.minY), std::min(x1, triangle.maxX),
+                       std::min(y1, triangle.maxY));
+    }
+}
+
+void SoftwareRasterizer::rasterTriangle(const SetupTriangle& triangle, int x0,
+                                        int y0, int x1, int y1)
+{
+    const SoftwareProgram& program = *triangle.program;
+    const std::size_t depthPitch = static_cast<std::size_t>((width_ + 3) & ~3);
+    const std::size_t varyingCount = std::min(program.varyings, SOFTWARE_MAX_VARYINGS);
+    // Groups of four pixels start at a multiple of four
+    const int xStart = x0 & ~3;
+    const std::int64_t half = std::int64_t{ 1 } << (SUBPIXEL_BITS - 1);
+    const std::int64_t sampleX = (std::int64_t{ xStart } << SUBPIXEL_BITS) + half;
+    const std::int64_t sampleY = (std::int64_t{ y0 } << SUBPIXEL_BITS) + half;
+    std::int32_t base[3], stepX[3], stepY[3];
+    for (int edge = 0; edge < 3; ++edge)
+    {
+        base[edge] = static_cast<std::int32_t>(clampEdge(
+                        triangle.edgeA[edge] * sampleX +
+                        triangle.edgeB[edge] * sampleY + triangle.edgeC[edge]));
+        stepX[edge] = triangle.edgeA[edge] << SUBPIXEL_BITS;
+        stepY[edge] = triangle.edgeB[edge] << SUBPIXEL_BITS;
+    }
+
+    // Runs the fragment functor on the pixels of a group that passed
+    auto shade = [&](unsigned mask, int x, int y, const float* b1, const float* b2) {
+        if (!program.fragment)
+        {
+            return;
+        }
+        float varyings[SOFTWARE_MAX_VARYINGS] = {};
+        std::uint32_t* row = color_.data() + static_cast<std::size_t>(y) * width_;
+        while (mask != 0)
+        {
+            int lane = 0;
+            while ((mask & (1u << lane)) == 0)
+            {
+                ++lane;
+            }
+            mask &= mask - 1;
+            if (varyingCount > 0)
+            {
+                // Perspective correct: interpolate v / w and 1 / w
+                const float w1 = b1[lane], w2 = b2[lane], w0 = 1.0f - w1 - w2;
+                const float w = 1.0f / (w0 * triangle.inverseW[0] +
+                                        w1 * triangle.inverseW[1] +
+                                        w2 * triangle.inverseW[2]);
+                for (std::size_t v = 0; v < varyingCount; ++v)
+                {
+                    varyings[v] = (w0 * triangle.varyings[0][v] +
+                                   w1 * triangle.varyings[1][v] +
+                                   w2 * triangle.varyings[2][v]) * w;
+                }
+            }
+            row[x + lane] = program.fragment(varyings);
+        }
+    };
+
+#ifdef HELLO_TRIANGLE_SSE2
+    __m128i laneStep[3], groupStep[3];
+    for (int edge = 0; edge < 3; ++edge)
+    {
+        // Edge change across the lanes of a group, and from group to group
+        laneStep[edge] = _mm_setr_epi32(0, stepX[edge], stepX[edge] * 2, 
+                                        stepX[edge] * 3);
+        groupStep[edge] = _mm_set1_epi32(stepX[edge] * 4);
+    }
+    const __m128 inverseArea = _mm_set1_ps(triangle.inverseArea);
+    const __m128 depth0 = _mm_set1_ps(triangle.depth[0]);
+    const __m128 depth1 = _mm_set1_ps(triangle.depth[1]);
+    const __m128 depth2 = _mm_set1_ps(triangle.depth[2]);
+    alignas(16) float b1[4], b2[4];
+    for (int y = y0; y < y1; ++y)
+    {
+        __m128i e[3];
+        for (int edge = 0; edge < 3; ++edge)
+        {
+            e[edge] = _mm_add_epi32(_mm_set1_epi32(base[edge] + (y - y0) * stepY[edge]),
+                                    laneStep[edge]);
+        }
+        float* depthRow = depth_.data() + static_cast<std::size_t>(y) * depthPitch;
+        for (int x = xStart; x < x1; x += 4)
+        {
+            // A pixel is inside if no edge value is negative
+            const __m128i any = _mm_or_si128(_mm_or_si128(e[0], e[1]), e[2]);
+            unsigned mask = static_cast<unsigned>(~_mm_movemask_ps(
+                                        _mm_castsi128_ps(any))) & 0xFu;
+            // Leave out the lanes before x0 and after x1
+            if (x < x0)
+            {
+                mask &= 0xFu << (x0 - x);
+            }
+            if (x + 4 > x1)
+            {
+                mask &= 0xFu >> (x + 4 - x1);
+            }
+            if (mask != 0)
+            {
+                const __m128 w1 = _mm_mul_ps(_mm_cvtepi32_ps(e[1]), inverseArea);
+                const __m128 w2 = _mm_mul_ps(_mm_cvtepi32_ps(e[2]), inverseArea);
+                if (program.depthTest)
+                {
+                    const __m128 z = _mm_add_ps(depth0, _mm_add_ps(
+                                        _mm_mul_ps(w1, depth1), _mm_mul_ps(w2, depth2)));
+                    const __m128 stored = _mm_load_ps(depthRow + x);
+                    mask &= static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(z, stored)));
+                    // Write the new depth of the passing lanes only
+                    const __m128 pass = _mm_castsi128_ps(_mm_cmpgt_epi32(
+                            _mm_and_si128(_mm_set1_epi32(static_cast<int>(mask)),
+                                          _mm_setr_epi32(1, 2, 4, 8)),
+                            _mm_setzero_si128()));
+                    _mm_store_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z),
+                                                         _mm_andnot_ps(pass, stored)));
+                }
+                if (mask != 0)
+                {
+                    _mm_store_ps(b1, w1);
+                    _mm_store_ps(b2, w2);
+                    shade(mask, x, y, b1, b2);
+                }
+            }
+            for (int edge = 0; edge < 3; ++edge)
+            {
+                e[edge] = _mm_add_epi32(e[edge], groupStep[edge]);
+            }
+        }
+    }
+#else
+    float b1[4], b2[4];
+    for (int y = y0; y < y1; ++y)
+    {
+        float* depthRow = depth_.data() + static_cast<std::size_t>(y) * depthPitch;
+        for (int x = xStart; x < x1; x += 4)
+        {
+            unsigned mask = 0;
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const int px = x + lane;
+                std::int32_t e[3];
+                for (int edge = 0; edge < 3; ++edge)
+                {
+                    e[edge] = base[edge] + (y - y0) * stepY[edge] +
+                              (px - xStart) * stepX[edge];
+                }
+                if (px < x0 || px >= x1 || (e[0] | e[1] | e[2]) < 0)
+                {
+                    continue;
+                }
+                b1[lane] = e[1] * triangle.inverseArea;
+                b2[lane] = e[2] * triangle.inverseArea;
+                if (program.depthTest)
+                {
+                    const float z = triangle.depth[0] + (b1[lane] * triangle.depth[1] +
+                                                         b2[lane] * triangle.depth[2]);
+                    if (!(z < depthRow[px]))
+                    {
+                        continue;
+                    }
+                    depthRow[px] = z;
+                }
+                mask |= 1u << lane;
+            }
+            if (mask != 0)
+            {
+                shade(mask, x, y, b1, b2);
+            }
+        }
+    }
+#endif
+}
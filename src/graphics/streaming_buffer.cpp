@@ -0,0 +1,127 @@
+#include "streaming_buffer.hpp"
+
+/**
+ * @var FENCE_TIMEOUT
+ * @brief Nanoseconds waited for a fence before waiting again.
+ */
+static constexpr GLuint64 FENCE_TIMEOUT{ 1000000000 };
+
+StreamingBuffer::StreamingBuffer(GLenum target, GLsizeiptr segmentSize)
+    : target_{ target }, buffer_{ 0 }, segmentSize_{ segmentSize }, 
+      persistent_{ false }, mapped_{ nullptr }, fences_{}, segment_{ 0 }, 
+      bytesStreamed_{ 0 }, stalls_{ 0 }
+{
+    const GLsizeiptr totalSize = segmentSize_ * static_cast<GLsizeiptr>(SEGMENTS);
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(target_, buffer_);
+
+    // Prefer immutable storage that stays mapped for the buffer's lifetime
+    persistent_ = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    if (persistent_)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | 
+                                 GL_MAP_COHERENT_BIT;
+        glBufferStorage(target_, totalSize, nullptr, flags);
+        mapped_ = glMapBufferRange(target_, 0, totalSize, flags);
+        if (!mapped_)
+        {
+            glBindBuffer(target_, 0);
+            glDeleteBuffers(1, &buffer_);
+            throw std::logic_error("ERROR::STREAMING_BUFFER::MAPPING_FAILED\n");
+        }
+    }
+    else
+    {
+        glBufferData(target_, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target_, 0);
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    for (GLsync fence : fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (mapped_)
+    {
+        glBindBuffer(target_, buffer_);
+        glUnmapBuffer(target_);
+        glBindBuffer(target_, 0);
+    }
+    glDeleteBuffers(1, &buffer_);
+}
+
+void StreamingBuffer::waitForSegment(std::size_t segment)
+{
+    GLsync& fence = fences_[segment];
+    if (!fence)
+    {
+        return;
+    }
+    // Poll first, so an already signalled fence never counts as a stall
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        ++stalls_;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 
+                                      FENCE_TIMEOUT);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void* StreamingBuffer::map(GLsizeiptr bytes)
+{
+    if (bytes > segmentSize_)
+    {
+        throw std::logic_error(std::string("ERROR::STREAMING_BUFFER::SEGMENT_OVERFLOW\n ")
+                               + std::to_string(bytes) + " > " 
+                               + std::to_string(segmentSize_));
+    }
+    waitForSegment(segment_);
+
+    const GLintptr offset = segmentSize_ * static_cast<GLintptr>(segment_);
+    if (persistent_)
+    {
+        return static_cast<char*>(mapped_) + offset;
+    }
+    // The fence already guarantees the GPU is done, so skip the driver's 
+    // own synchronization
+    glBindBuffer(target_, buffer_);
+    mapped_ = glMapBufferRange(target_, offset, bytes > 0 ? bytes : 1, 
+                               GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | 
+                               GL_MAP_INVALIDATE_RANGE_BIT);
+    glBindBuffer(target_, 0);
+    return mapped_;
+}
+
+GLintptr StreamingBuffer::commit(GLsizeiptr bytes)
+{
+    if (!persistent_ && mapped_)
+    {
+        glBindBuffer(target_, buffer_);
+        glUnmapBuffer(target_);
+        glBindBuffer(target_, 0);
+        mapped_ = nullptr;
+    }
+    bytesStreamed_ += static_cast<std::uint64_t>(bytes);
+    return segmentSize_ * static_cast<GLintptr>(segment_);
+}
+
+void StreamingBuffer::endFrame()
+{
+    // The segment is free again once every command issued so far completes
+    if (fences_[segment_])
+    {
+        glDeleteSync(fences_[segment_]);
+    }
+    fences_[segment_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    segment_ = (segment_ + 1) % SEGMENTS;
+}
@@ -0,0 +1,279 @@
+#include "texture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+/**
+* @section Storage functions
+*/
+
+GLsizei computeMipLevels(GLsizei width, GLsizei height)
+{
+    GLsizei levels{ 1 };
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+    {
+        ++levels;
+    }
+    return levels;
+}
+
+void downsampleRGBA8(const std::uint8_t* source, GLsizei width, GLsizei height,
+                     std::uint8_t* target)
+{
+    const GLsizei targetWidth = std::max(width / 2, 1);
+    const GLsizei targetHeight = std::max(height / 2, 1);
+    for (GLsizei y = 0; y < targetHeight; ++y)
+    {
+        // A side of 1 pixel averages the same row or column twice
+        const GLsizei y0 = std::min(y * 2, height - 1);
+        const GLsizei y1 = std::min(y * 2 + 1, height - 1);
+        for (GLsizei x = 0; x < targetWidth; ++x)
+        {
+            const GLsizei x0 = std::min(x * 2, width - 1);
+            const GLsizei x1 = std::min(x * 2 + 1, width - 1);
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const unsigned sum = source[(y0 * width + x0) * 4 + channel] +
+                                     source[(y0 * width + x1) * 4 + channel] +
+                                     source[(y1 * width + x0) * 4 + channel] +
+                                     source[(y1 * width + x1) * 4 + channel];
+                target[(y * targetWidth + x) * 4 + channel] =
+                    static_cast<std::uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool allocateTextureStorage(GLenum target, GLsizei levels, GLenum internalFormat,
+                            GLsizei width, GLsizei height, GLsizei layers)
+{
+    if (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage)
+    {
+        if (target == GL_TEXTURE_2D_ARRAY)
+        {
+            glTexStorage3D(target, levels, internalFormat, width, height, layers);
+        }
+        else
+        {
+            glTexStorage2D(target, levels, internalFormat, width, height);
+        }
+        return true;
+    }
+    // Mutable storage needs every level specified to be complete
+    for (GLsizei level = 0; level < levels; ++level)
+    {
+        if (target == GL_TEXTURE_2D_ARRAY)
+        {
+            glTexImage3D(target, level, static_cast<GLint>(internalFormat), width,
+                         height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else
+        {
+            glTexImage2D(target, level, static_cast<GLint>(internalFormat), width,
+                         height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return false;
+}
+
+/**
+* @section Texture
+*/
+
+Texture::Texture(GLenum target, GLsizei width, GLsizei height, GLsizei layers)
+    : target_{ target }, texture_{ 0 }, width_{ width }, height_{ height },
+      layers_{ layers }, levels_{ computeMipLevels(width, height) },
+      immutable_{ false }, mipsDirty_{ false }
+{
+    if ((target_ != GL_TEXTURE_2D && target_ != GL_TEXTURE_2D_ARRAY) ||
+        width_ <= 0 || height_ <= 0 || layers_ <= 0 ||
+        (target_ == GL_TEXTURE_2D && layers_ != 1))
+    {
+        throw std::logic_error("ERROR::TEXTURE::INVALID_SIZE\n");
+    }
+    glGenTextures(1, &texture_);
+    glBindTexture(target_, texture_);
+    immutable_ = allocateTextureStorage(target_, levels_, GL_RGBA8, width_,
+                                        height_, layers_);
+    glTexParameteri(target_, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target_, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target_, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(target_, 0);
+}
+
+Texture::~Texture()
+{
+    glDeleteTextures(1, &texture_);
+}
+
+void Texture::upload(GLint layer, const void* pixels, GLint level)
+{
+    const GLsizei width = std::max(width_ >> level, 1);
+    const GLsizei height = std::max(height_ >> level, 1);
+    glBindTexture(target_, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (target_ == GL_TEXTURE_2D_ARRAY)
+    {
+        glTexSubImage3D(target_, level, 0, 0, layer, width, height, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels);
+    }
+    else
+    {
+        glTexSubImage2D(target_, level, 0, 0, width, height, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels);
+    }
+    glBindTexture(target_, 0);
+    if (level == 0)
+    {
+        mipsDirty_ = true;
+    }
+}
+
+std::size_t Texture::getMipChainSize() const
+{
+    std::size_t size{ 0 };
+    for (GLint level = 0; level < levels_; ++level)
+    {
+        size += static_cast<std::size_t>(std::max(width_ >> level, 1)) *
+                std::max(height_ >> level, 1) * 4;
+    }
+    return size;
+}
+
+void Texture::generateMipmaps()
+{
+    if (!mipsDirty_ || levels_ == 1)
+    {
+        return;
+    }
+    // Rebuilds every layer of an array, there is no per-layer variant
+    glBindTexture(target_, texture_);
+    glGenerateMipmap(target_);
+    glBindTexture(target_, 0);
+    mipsDirty_ = false;
+}
+
+/**
+* @section TextureStreamer
+*/
+
+TextureStreamer::TextureStreamer(GLsizeiptr bytesPerFrame, bool pixelBuffers)
+    : ring_{ nullptr }, bytesPerFrame_{ bytesPerFrame }, queue_{}, stats_{}
+{
+    if (pixelBuffers)
+    {
+        // Throws logic error if the ring cannot be mapped
+        ring_ = std::make_unique<StreamingBuffer>(GL_PIXEL_UNPACK_BUFFER,
+                                                  bytesPerFrame_);
+    }
+}
+
+void TextureStreamer::queue(Texture& texture, GLint layer, const std::uint8_t* pixels)
+{
+    if (static_cast<GLsizeiptr>(texture.getMipChainSize()) > bytesPerFrame_)
+    {
+        throw std::logic_error(std::string("ERROR::TEXTURE_STREAMER::LAYER_TOO_LARGE\n ")
+                               + std::to_string(texture.getMipChainSize()) + " > "
+                               + std::to_string(bytesPerFrame_));
+    }
+    queue_.push_back({ &texture, layer, pixels });
+}
+
+std::size_t TextureStreamer::flush()
+{
+    if (queue_.empty())
+    {
+        return 0;
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // Take the layers that fit into one segment, in the order they came
+    std::size_t count{ 0 };
+    GLsizeiptr bytes{ 0 };
+    while (count < queue_.size() &&
+           bytes + static_cast<GLsizeiptr>(queue_[count].texture->getMipChainSize())
+               <= bytesPerFrame_)
+    {
+        bytes += static_cast<GLsizeiptr>(queue_[count].texture->getMipChainSize());
+        ++count;
+    }
+
+    std::uint8_t* mapped = ring_ ? static_cast<std::uint8_t*>(ring_->map(bytes)) : nullptr;
+    std::size_t offset{ 0 };
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // Levels are built in system memory, mapped memory is slow to read
+        Texture& texture = *queue_[i].texture;
+        chain_.resize(texture.getMipChainSize());
+        std::memcpy(chain_.data(), queue_[i].pixels, texture.getLayerSize());
+        std::size_t level{ 0 };
+        for (GLsizei width = texture.getWidth(), height = texture.getHeight();
+             width > 1 || height > 1; width = std::max(width / 2, 1),
+             height = std::max(height / 2, 1))
+        {
+            const std::size_t size = static_cast<std::size_t>(width) * height * 4;
+            downsampleRGBA8(&chain_[level], width, height, &chain_[level + size]);
+            level += size;
+        }
+        if (mapped)
+        {
+            std::memcpy(mapped + offset, chain_.data(), chain_.size());
+            offset += chain_.size();
+            continue;
+        }
+        // Without pixel buffers the driver copies before the call returns
+        level = 0;
+        for (GLint mip = 0; mip < texture.getLevelCount(); ++mip)
+        {
+            texture.upload(queue_[i].layer, &chain_[level], mip);
+            level += static_cast<std::size_t>(std::max(texture.getWidth() >> mip, 1)) *
+                     std::max(texture.getHeight() >> mip, 1) * 4;
+        }
+    }
+
+    if (ring_)
+    {
+        // Offsets into the bound pixel buffer take the place of pointers
+        const GLintptr base = ring_->commit(bytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring_->getBufferId());
+        offset = static_cast<std::size_t>(base);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Texture& texture = *queue_[i].texture;
+            for (GLint mip = 0; mip < texture.getLevelCount(); ++mip)
+            {
+                texture.upload(queue_[i].layer,
+                               reinterpret_cast<const void*>(offset), mip);
+                offset += static_cast<std::size_t>(std::max(texture.getWidth() >> mip, 1)) *
+                          std::max(texture.getHeight() >> mip, 1) * 4;
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+
+    stats_.layers += count;
+    stats_.bytes += static_cast<std::uint64_t>(bytes);
+    stats_.submitMs += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start).count();
+    return count;
+}
+
+void TextureStreamer::endFrame()
+{
+    if (ring_)
+    {
+        ring_->endFrame();
+    }
+}
+
+TextureStreamerStats TextureStreamer::getStats() const
+{
+    TextureStreamerStats stats = stats_;
+    stats.stalls = ring_ ? ring_->getStallCount() : 0;
+    return stats;
+}
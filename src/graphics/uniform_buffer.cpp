@@ -0,0 +1,196 @@
+#include "uniform_buffer.hpp"
+#include <algorithm>
+
+/**
+* @section UniformBlockLayout
+*/
+
+UniformBlockLayout::UniformBlockLayout(GLuint program, const std::string& name)
+    : name_{ name }, index_{ GL_INVALID_INDEX }, dataSize_{ 0 }
+{
+    index_ = glGetUniformBlockIndex(program, name_.c_str());
+    if (index_ == GL_INVALID_INDEX)
+    {
+        throw std::logic_error("ERROR::UNIFORM_BLOCK::NOT_FOUND\n " + name_);
+    }
+    GLint dataSize{ 0 };
+    GLint count{ 0 };
+    glGetActiveUniformBlockiv(program, index_, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+    glGetActiveUniformBlockiv(program, index_, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+    dataSize_ = dataSize;
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // One query per property for all members of the block at once
+    std::vector<GLint> indices(static_cast<std::size_t>(count));
+    glGetActiveUniformBlockiv(program, index_, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES,
+                              indices.data());
+    const std::vector<GLuint> members(indices.begin(), indices.end());
+    std::vector<GLint> types(members.size());
+    std::vector<GLint> sizes(members.size());
+    std::vector<GLint> offsets(members.size());
+    std::vector<GLint> arrayStrides(members.size());
+    std::vector<GLint> matrixStrides(members.size());
+    glGetActiveUniformsiv(program, count, members.data(), GL_UNIFORM_TYPE, types.data());
+    glGetActiveUniformsiv(program, count, members.data(), GL_UNIFORM_SIZE, sizes.data());
+    glGetActiveUniformsiv(program, count, members.data(), GL_UNIFORM_OFFSET, 
+                          offsets.data());
+    glGetActiveUniformsiv(program, count, members.data(), GL_UNIFORM_ARRAY_STRIDE,
+                          arrayStrides.data());
+    glGetActiveUniformsiv(program, count, members.data(), GL_UNIFORM_MATRIX_STRIDE,
+                          matrixStrides.data());
+    GLint maxLength{ 0 };
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(static_cast<std::size_t>(std::max(maxLength, 1)));
+    for (std::size_t i = 0; i < members.size(); ++i)
+    {
+        GLsizei length{ 0 };
+        glGetActiveUniformName(program, members[i], static_cast<GLsizei>(buffer.size()),
+                               &length, buffer.data());
+        UniformMember member;
+        member.name.assign(buffer.data(), static_cast<std::size_t>(length));
+        member.type = static_cast<GLenum>(types[i]);
+        member.size = sizes[i];
+        member.offset = offsets[i];
+        member.arrayStride = arrayStrides[i];
+        member.matrixStride = matrixStrides[i];
+        members_.push_back(member);
+    }
+    // Members in memory order, which is how writers walk them
+    std::sort(members_.begin(), members_.end(), 
+              [](const UniformMember& a, const UniformMember& b)
+              {
+                  return a.offset < b.offset;
+              });
+}
+
+void UniformBlockLayout::bind(GLuint program, GLuint binding) const
+{
+    glUniformBlockBinding(program, index_, binding);
+}
+
+const UniformMember* UniformBlockLayout::findMember(const std::string& member) const
+{
+    // Blocks with an instance name report their members as "Block.member"
+    for (const UniformMember& candidate : members_)
+    {
+        if (candidate.name == member || candidate.name == member + "[0]" ||
+            candidate.name == name_ + "." + member ||
+            candidate.name == name_ + "." + member + "[0]")
+        {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+GLint UniformBlockLayout::getOffset(const std::string& member) const
+{
+    const UniformMember* found = findMember(member);
+    return found ? found->offset : -1;
+}
+
+std::vector<std::string> listUniformBlocks(GLuint program)
+{
+    GLint count{ 0 };
+    GLint maxLength{ 0 };
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    std::vector<char> buffer(static_cast<std::size_t>(std::max(maxLength, 1)));
+    std::vector<std::string> names;
+    for (GLint index = 0; index < count; ++index)
+    {
+        GLsizei length{ 0 };
+        glGetActiveUniformBlockName(program, static_cast<GLuint>(index), 
+                                    static_cast<GLsizei>(buffer.size()), &length,
+                                    buffer.data());
+        names.emplace_back(buffer.data(), static_cast<std::size_t>(length));
+    }
+    return names;
+}
+
+/**
+* @section UniformRing
+*/
+
+UniformRing::UniformRing(GLenum target, GLsizeiptr bytesPerFrame)
+    : target_{ target }, alignment_{ 1 }, ring_{ nullptr }, mapped_{ nullptr },
+      head_{ 0 }, committed_{ false }, allocations_{ 0 }
+{
+    GLint alignment{ 0 };
+    if (target_ == GL_UNIFORM_BUFFER)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+    else if (target_ == GL_SHADER_STORAGE_BUFFER && GLAD_GL_VERSION_4_3)
+    {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+    else
+    {
+        throw std::logic_error("ERROR::UNIFORM_RING::UNSUPPORTED_TARGET\n");
+    }
+    // std140 vec4 members want 16 bytes even where the driver allows less
+    alignment_ = std::max<GLsizeiptr>(alignment, 16);
+    // Throws logic error if the buffer cannot be mapped
+    ring_ = std::make_unique<StreamingBuffer>(target_, alignSize(bytesPerFrame));
+}
+
+void UniformRing::reserve(GLsizeiptr bytesPerFrame)
+{
+    if (bytesPerFrame <= ring_->getSegmentSize())
+    {
+        return;
+    }
+    endFrame();
+    ring_.reset();
+    ring_ = std::make_unique<StreamingBuffer>(target_, alignSize(bytesPerFrame));
+    head_ = 0;
+}
+
+UniformAllocation UniformRing::allocate(GLsizeiptr size)
+{
+    if (committed_)
+    {
+        throw std::logic_error("ERROR::UNIFORM_RING::ALREADY_COMMITTED\n");
+    }
+    const GLsizeiptr start = alignSize(head_);
+    if (start + size > ring_->getSegmentSize())
+    {
+        throw std::logic_error(std::string("ERROR::UNIFORM_RING::FRAME_OVERFLOW\n ")
+                               + std::to_string(start + size) + " > "
+                               + std::to_string(ring_->getSegmentSize()));
+    }
+    // Map the whole segment, how much of it the frame needs is not known yet
+    if (!mapped_)
+    {
+        mapped_ = static_cast<std::uint8_t*>(ring_->map(ring_->getSegmentSize()));
+    }
+    head_ = start + size;
+    ++allocations_;
+    UniformAllocation allocation;
+    allocation.data = mapped_ + start;
+    allocation.offset = ring_->getSegmentOffset() + start;
+    allocation.size = size;
+    return allocation;
+}
+
+void UniformRing::commit()
+{
+    if (mapped_ && !committed_)
+    {
+        ring_->commit(head_);
+    }
+    committed_ = true;
+}
+
+void UniformRing::endFrame()
+{
+    commit();
+    ring_->endFrame();
+    mapped_ = nullptr;
+    head_ = 0;
+    committed_ = false;
+}
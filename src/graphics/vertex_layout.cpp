@@ -0,0 +1,152 @@
+#include "vertex_layout.hpp"
+#include "vertex_packing.hpp"
+#include <cstring>
+
+/**
+* @section Format properties
+*/
+
+GLenum getAttributeType(AttributeFormat format)
+{
+    switch (format)
+    {
+    case AttributeFormat::Float32:          return GL_FLOAT;
+    case AttributeFormat::Half:             return GL_HALF_FLOAT;
+    case AttributeFormat::Snorm2_10_10_10:  return GL_INT_2_10_10_10_REV;
+    case AttributeFormat::Unorm8:           return GL_UNSIGNED_BYTE;
+    case AttributeFormat::Snorm8:           return GL_BYTE;
+    case AttributeFormat::Unorm16:          return GL_UNSIGNED_SHORT;
+    case AttributeFormat::Snorm16:          return GL_SHORT;
+    }
+    return GL_FLOAT;
+}
+
+bool isNormalized(AttributeFormat format)
+{
+    return format != AttributeFormat::Float32 && format != AttributeFormat::Half;
+}
+
+std::size_t getAttributeSize(AttributeFormat format, GLint components)
+{
+    const std::size_t count = static_cast<std::size_t>(components);
+    switch (format)
+    {
+    case AttributeFormat::Float32:          return count * 4;
+    case AttributeFormat::Half:             return count * 2;
+    case AttributeFormat::Snorm2_10_10_10:  return 4;
+    case AttributeFormat::Unorm8:           return count;
+    case AttributeFormat::Snorm8:           return count;
+    case AttributeFormat::Unorm16:          return count * 2;
+    case AttributeFormat::Snorm16:          return count * 2;
+    }
+    return 0;
+}
+
+/**
+* @section VertexLayout
+*/
+
+VertexLayout& VertexLayout::add(GLuint location, GLint components, 
+                                AttributeFormat format, std::size_t stream)
+{
+    if (components < 1 || components > 4 || stream > strides_.size() ||
+        (format == AttributeFormat::Snorm2_10_10_10 && components != 4))
+    {
+        throw std::logic_error("ERROR::VERTEX_LAYOUT::INVALID_ATTRIBUTE\n");
+    }
+    if (stream == strides_.size())
+    {
+        strides_.push_back(0);
+    }
+    // Attributes start on four byte boundaries, which all GPUs fetch well
+    const std::size_t size = getAttributeSize(format, components);
+    attributes_.push_back({ location, components, format, stream, strides_[stream] });
+    strides_[stream] += (size + 3) & ~std::size_t{ 3 };
+    return *this;
+}
+
+std::size_t VertexLayout::getVertexSize() const
+{
+    std::size_t size = 0;
+    for (std::size_t stride : strides_)
+    {
+        size += stride;
+    }
+    return size;
+}
+
+/**
+* @section Packing
+*/
+
+std::vector<std::vector<std::uint8_t>> packVertices(
+    const VertexLayout& layout, const std::vector<std::vector<float>>& sources,
+    std::size_t vertexCount)
+{
+    const std::vector<VertexAttribute>& attributes = layout.getAttributes();
+    if (sources.size() != attributes.size())
+    {
+        throw std::logic_error("ERROR::VERTEX_LAYOUT::SOURCE_MISMATCH\n");
+    }
+    std::vector<std::vector<std::uint8_t>> streams(layout.getStreamCount());
+    for (std::size_t s = 0; s < streams.size(); ++s)
+    {
+        streams[s].assign(layout.getStride(s) * vertexCount, 0);
+    }
+
+    std::vector<std::uint8_t> packed;
+    for (std::size_t a = 0; a < attributes.size(); ++a)
+    {
+        const VertexAttribute& attribute = attributes[a];
+        const std::vector<float>& source = sources[a];
+        const std::size_t values = vertexCount * attribute.components;
+        if (source.size() != values)
+        {
+            throw std::logic_error("ERROR::VERTEX_LAYOUT::SOURCE_MISMATCH\n");
+        }
+
+        // Convert the whole attribute at once, so the SIMD loops run long
+        const std::size_t size = getAttributeSize(attribute.format, 
+                                                  attribute.components);
+        packed.resize(size * vertexCount);
+        switch (attribute.format)
+        {
+        case AttributeFormat::Float32:
+            std::memcpy(packed.data(), source.data(), packed.size());
+            break;
+        case AttributeFormat::Half:
+            packHalf(source.data(), 
+                     reinterpret_cast<std::uint16_t*>(packed.data()), values);
+            break;
+        case AttributeFormat::Snorm2_10_10_10:
+            packSnorm2_10_10_10(source.data(), 
+                     reinterpret_cast<std::uint32_t*>(packed.data()), vertexCount);
+            break;
+        case AttributeFormat::Unorm8:
+            packUnorm8(source.data(), packed.data(), values);
+            break;
+        case AttributeFormat::Snorm8:
+            packSnorm8(source.data(), 
+                       reinterpret_cast<std::int8_t*>(packed.data()), values);
+            break;
+        case AttributeFormat::Unorm16:
+            packUnorm16(source.data(), 
+                        reinterpret_cast<std::uint16_t*>(packed.data()), values);
+            break;
+        case AttributeFormat::Snorm16:
+            packSnorm16(source.data(), 
+                        reinterpret_cast<std::int16_t*>(packed.data()), values);
+            break;
+        }
+
+        // Interleave into the stream
+        std::vector<std::uint8_t>& stream = streams[attribute.stream];
+        const std::size_t stride = layout.getStride(attribute.stream);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+        {
+            std::memcpy(stream.data() + v * stride + attribute.offset, 
+                        packed.data() + v * size, size);
+        }
+    }
+    return streams;
+}
@@ -0,0 +1,250 @@
+#include "vertex_packing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HELLO_TRIANGLE_SSE2 1
+#endif
+
+/**
+* @section Scalar conversions
+*/
+
+static std::uint16_t halfFromFloat(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint32_t sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7FFFFFFFu;
+
+    if (bits >= (143u << 23))
+    {
+        // Too large for a half: infinity, or a quiet NaN
+        return static_cast<std::uint16_t>(sign | (bits > (255u << 23) ? 0x7E00u 
+                                                                      : 0x7C00u));
+    }
+    if (bits < (113u << 23))
+    {
+        // Denormal half: let the float adder do the rounding
+        const std::uint32_t magicBits = 126u << 23;
+        float magic;
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+        float absolute;
+        std::memcpy(&absolute, &bits, sizeof(absolute));
+        absolute += magic;
+        std::uint32_t rounded;
+        std::memcpy(&rounded, &absolute, sizeof(rounded));
+        return static_cast<std::uint16_t>(sign | (rounded - magicBits));
+    }
+    // Normal half: rebias the exponent and round to nearest even
+    const std::uint32_t mantissaOdd = (bits >> 13) & 1u;
+    bits += 0xFFFu - (112u << 23) + mantissaOdd;
+    return static_cast<std::uint16_t>(sign | (bits >> 13));
+}
+
+static int roundClamped(float value, float low, float high, float scale)
+{
+    return static_cast<int>(std::lrintf(std::min(std::max(value, low), high) * 
+                                        scale));
+}
+
+/**
+* @section SSE2 helpers
+*/
+
+#ifdef HELLO_TRIANGLE_SSE2
+static __m128i roundClamped4(__m128 value, float low, float high, float scale)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(low)), _mm_set1_ps(high));
+    // Uses the default round-to-nearest mode, like lrintf
+    return _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(scale)));
+}
+
+static __m128i halfFromFloat4(__m128 value)
+{
+    const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i halfMax = _mm_set1_epi32(143 << 23);
+    const __m128i floatInfinity = _mm_set1_epi32(255 << 23);
+    const __m128i minNormal = _mm_set1_epi32(113 << 23);
+    const __m128i denormalMagic = _mm_set1_epi32(126 << 23);
+    const __m128i normalBias = _mm_set1_epi32(0xFFF - (112 << 23));
+
+    const __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(signMask));
+    const __m128 absolute = _mm_xor_ps(value, sign);
+    const __m128i bits = _mm_castps_si128(absolute);
+
+    // Infinity or NaN for values too large for a half
+    const __m128i isNan = _mm_cmpgt_epi32(bits, floatInfinity);
+    const __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)),
+                                         _mm_set1_epi32(0x7C00));
+    const __m128i isRegular = _mm_cmpgt_epi32(halfMax, bits);
+
+    // Denormal results, rounded by the float adder
+    const __m128i isDenormal = _mm_cmpgt_epi32(minNormal, bits);
+    const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, 
+                                            _mm_castsi128_ps(denormalMagic))), 
+                                           denormalMagic);
+
+    // Normal results, rounded to nearest even
+    const __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(bits, 18), 31);
+    const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), 
+                                                        mantissaOdd), 13);
+
+    const __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), 
+                                        _mm_andnot_si128(isDenormal, normal));
+    const __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), 
+                                        _mm_andnot_si128(isRegular, special));
+    return _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+/**
+ * @brief Narrows four 32-bit lanes holding 16-bit patterns to 16 bits.
+ */
+static __m128i narrow16(__m128i value)
+{
+    // Sign extend the low halves so the saturating pack keeps them intact
+    value = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+    return _mm_packs_epi32(value, value);
+}
+#endif
+
+/**
+* @section Packing routines
+*/
+
+void packHalf(const float* input, std::uint16_t* output, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i packed = narrow16(halfFromFloat4(_mm_loadu_ps(input + i)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        output[i] = halfFromFloat(input[i]);
+    }
+}
+
+void packUnorm8(const float* input, std::uint8_t* output, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i packed = roundClamped4(_mm_loadu_ps(input + i), 0.0f, 1.0f, 255.0f);
+        packed = _mm_packs_epi32(packed, packed);
+        packed = _mm_packus_epi16(packed, packed);
+        const int word = _mm_cvtsi128_si32(packed);
+        std::memcpy(output + i, &word, sizeof(word));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        output[i] = static_cast<std::uint8_t>(roundClamped(input[i], 0.0f, 1.0f, 
+                                                           255.0f));
+    }
+}
+
+void packSnorm8(const float* input, std::int8_t* output, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i packed = roundClamped4(_mm_loadu_ps(input + i), -1.0f, 1.0f, 127.0f);
+        packed = _mm_packs_epi32(packed, packed);
+        packed = _mm_packs_epi16(packed, packed);
+        const int word = _mm_cvtsi128_si32(packed);
+        std::memcpy(output + i, &word, sizeof(word));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        output[i] = static_cast<std::int8_t>(roundClamped(input[i], -1.0f, 1.0f, 
+                                                          127.0f));
+    }
+}
+
+void packUnorm16(const float* input, std::uint16_t* output, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i packed = roundClamped4(_mm_loadu_ps(input + i), 0.0f, 1.0f, 
+                                             65535.0f);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), narrow16(packed));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        output[i] = static_cast<std::uint16_t>(roundClamped(input[i], 0.0f, 1.0f, 
+                                                            65535.0f));
+    }
+}
+
+void packSnorm16(const float* input, std::int16_t* output, std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i packed = roundClamped4(_mm_loadu_ps(input + i), -1.0f, 1.0f, 
+                                       32767.0f);
+        packed = _mm_packs_epi32(packed, packed);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        output[i] = static_cast<std::int16_t>(roundClamped(input[i], -1.0f, 1.0f, 
+                                                           32767.0f));
+    }
+}
+
+void packSnorm2_10_10_10(const float* input, std::uint32_t* output, 
+                         std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef HELLO_TRIANGLE_SSE2
+    // Four vectors per step, transposed so each register holds one component
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(input + i * 4);
+        __m128 y = _mm_loadu_ps(input + i * 4 + 4);
+        __m128 z = _mm_loadu_ps(input + i * 4 + 8);
+        __m128 w = _mm_loadu_ps(input + i * 4 + 12);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        const __m128i tenBits = _mm_set1_epi32(0x3FF);
+        const __m128i px = _mm_and_si128(roundClamped4(x, -1.0f, 1.0f, 511.0f), 
+                                         tenBits);
+        const __m128i py = _mm_and_si128(roundClamped4(y, -1.0f, 1.0f, 511.0f), 
+                                         tenBits);
+        const __m128i pz = _mm_and_si128(roundClamped4(z, -1.0f, 1.0f, 511.0f), 
+                                         tenBits);
+        const __m128i pw = roundClamped4(w, -1.0f, 1.0f, 1.0f);
+        const __m128i packed = _mm_or_si128(_mm_or_si128(px, _mm_slli_epi32(py, 10)),
+                                            _mm_or_si128(_mm_slli_epi32(pz, 20), 
+                                                         _mm_slli_epi32(pw, 30)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        const float* vector = input + i * 4;
+        const std::uint32_t x = static_cast<std::uint32_t>(
+                    roundClamped(vector[0], -1.0f, 1.0f, 511.0f)) & 0x3FFu;
+        const std::uint32_t y = static_cast<std::uint32_t>(
+                    roundClamped(vector[1], -1.0f, 1.0f, 511.0f)) & 0x3FFu;
+        const std::uint32_t z = static_cast<std::uint32_t>(
+                    roundClamped(vector[2], -1.0f, 1.0f, 511.0f)) & 0x3FFu;
+        const std::uint32_t w = static_cast<std::uint32_t>(
+                    roundClamped(vector[3], -1.0f, 1.0f, 1.0f)) & 0x3u;
+        output[i] = x | (y << 10) | (z << 20) | (w << 30);
+    }
+}
@@ -0,0 +1,113 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/**
+* @section Constructor
+*/
+
+BatchScene::BatchScene(std::size_t meshes, bool batched, ShaderPipeline& pipeline)
+    : pipeline_{ pipeline }, batched_{ batched }
+{
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4(aPos, 1.0);\n" 
+    "   color = vec3(0.5 + 0.5 * aPos.xy, 0.6);\n"
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = vec4(color, 1.0f);\n"
+    "}\n\0";
+
+    program_ = pipeline_.submit( vertexShaderSource, fragmentShaderSource );
+
+    // Every cell of the grid gets its own polygon with 3 to 8 corners
+    const std::size_t count = std::max<std::size_t>( meshes, 1 );
+    const std::size_t side = static_cast<std::size_t>( 
+                        std::ceil( std::sqrt( static_cast<double>( count ) ) ) );
+    const float cell = 2.0f / side;
+    batch_ = std::make_unique<MeshBatch>();
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const std::size_t corners = 3 + i % 6;
+        const float centerX = -1.0f + cell * ( i % side + 0.5f );
+        const float centerY = -1.0f + cell * ( i / side + 0.5f );
+        const float radius = cell * 0.45f;
+        const float rotation = static_cast<float>( i ) * 0.37f;
+        vertices.clear();
+        indices.clear();
+        for ( std::size_t corner = 0; corner < corners; ++corner )
+        {
+            const float angle = rotation + 6.2831853f * corner / corners;
+            vertices.insert( vertices.end(), { 
+                centerX + radius * std::cos( angle ), 
+                centerY + radius * std::sin( angle ), 0.0f } );
+        }
+        // Triangle fan around the first corner
+        for ( GLuint corner = 1; corner + 1 < corners; ++corner )
+        {
+            indices.insert( indices.end(), { 0, corner, corner + 1 } );
+        }
+        batch_->addMesh( vertices, indices );
+    }
+    batch_->build();
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void BatchScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    (void)profiler;
+    if ( !pipeline_.isReady( program_ ) )
+    {
+        return;
+    }
+    DrawItem item;
+    item.program = pipeline_.getProgramID( program_ );
+    item.vao = batch_->getVAOId();
+    item.key = makeSortKey( item.program, item.vao, 0, 0.0f );
+    if ( batched_ )
+    {
+        item.batch = batch_.get();
+        queue.submit( item );
+        return;
+    }
+    // One indexed draw per mesh, reading the same shared buffers
+    item.indexType = GL_UNSIGNED_INT;
+    for ( std::size_t mesh = 0; mesh < batch_->getMeshCount(); ++mesh )
+    {
+        const DrawElementsIndirectCommand& command = batch_->getCommand( mesh );
+        item.count = static_cast<GLsizei>( command.count );
+        item.indexOffset = static_cast<GLintptr>( command.firstIndex * sizeof( GLuint ) );
+        item.baseVertex = command.baseVertex;
+        queue.submit( item );
+    }
+}
+
+void BatchScene::report(const FrameProfiler& profiler) const
+{
+    (void)profiler;
+    const char* path = "separate glDrawElementsBaseVertex calls";
+    if ( batched_ )
+    {
+        path = batch_->isIndirect() ? "glMultiDrawElementsIndirect" 
+                                    : "glMultiDrawElementsBaseVertex";
+    }
+    std::printf( "Mesh batch: %zu meshes, %zu vertices, %zu indices, drawn with %s\n",
+                 batch_->getMeshCount(), batch_->getVertexCount(), 
+                 batch_->getIndexCount(), path );
+}
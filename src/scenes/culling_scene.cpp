@@ -0,0 +1,944 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <utility>
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @brief Vertical field of view of the camera, 60 degrees.
+ */
+constexpr float FIELD_OF_VIEW{ 1.0472f };
+
+/**
+ * @brief Range of the radii of the instances.
+ */
+constexpr float MIN_RADIUS{ 0.2f };
+constexpr float MAX_RADIUS{ 0.5f };
+
+/**
+ * @brief Closest a cell's box may come to the camera and still be tested
+ * with a query. The near plane clips nearer boxes, which then prove nothing.
+ */
+constexpr float PROXY_MIN_DISTANCE{ 0.2f };
+
+static void multiply(const float* a, const float* b, float* result)
+{
+    // Column-major 4x4 product a * b
+    for ( int column = 0; column < 4; ++column )
+    {
+        for ( int row = 0; row < 4; ++row )
+        {
+            float sum = 0.0f;
+            for ( int k = 0; k < 4; ++k )
+            {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+}
+
+static void perspective(float fovY, float aspect, float near, float far, 
+                        float* result)
+{
+    const float f = 1.0f / std::tan( fovY * 0.5f );
+    std::fill( result, result + 16, 0.0f );
+    result[0] = f / aspect;
+    result[5] = f;
+    result[10] = ( far + near ) / ( near - far );
+    result[11] = -1.0f;
+    result[14] = 2.0f * far * near / ( near - far );
+}
+
+static void rotateView(float yaw, float pitch, float* result)
+{
+    // Inverse of a camera at the origin turned by yaw, then tilted by pitch
+    const float cy = std::cos( yaw ), sy = std::sin( yaw );
+    const float cp = std::cos( pitch ), sp = std::sin( pitch );
+    const float view[16] = {
+        cy,       sy * sp,  -sy * cp, 0.0f,
+        0.0f,     cp,       sp,       0.0f,
+        sy,       -cy * sp, cy * cp,  0.0f,
+        0.0f,     0.0f,     0.0f,     1.0f
+    };
+    std::memcpy( result, view, sizeof(view) );
+}
+
+static Mesh makeIcosphere(int subdivisions)
+{
+    // Twelve vertices of an icosahedron, then every triangle split in four
+    // with its edge midpoints pushed out onto the unit sphere
+    const float t = ( 1.0f + std::sqrt( 5.0f ) ) * 0.5f;
+    Mesh mesh;
+    mesh.vertices = {
+        -1, t, 0,   1, t, 0,  -1,-t, 0,   1,-t, 0,
+         0,-1, t,   0, 1, t,   0,-1,-t,   0, 1,-t,
+         t, 0,-1,   t, 0, 1,  -t, 0,-1,  -t, 0, 1
+    };
+    mesh.indices = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+    };
+    const auto normalize = [&mesh]( std::size_t vertex )
+    {
+        float* p = &mesh.vertices[vertex * 3];
+        const float length = std::sqrt( p[0] * p[0] + p[1] * p[1] + p[2] * p[2] );
+        p[0] /= length;
+        p[1] /= length;
+        p[2] /= length;
+    };
+    for ( std::size_t vertex = 0; vertex < 12; ++vertex )
+    {
+        normalize( vertex );
+    }
+    for ( int level = 0; level < subdivisions; ++level )
+    {
+        std::map<std::pair<GLuint, GLuint>, GLuint> midpoints;
+        const auto midpoint = [&]( GLuint a, GLuint b )
+        {
+            const auto key = std::make_pair( std::min( a, b ), std::max( a, b ) );
+            const auto found = midpoints.find( key );
+            if ( found != midpoints.end() )
+            {
+                return found->second;
+            }
+            const GLuint vertex = static_cast<GLuint>( mesh.vertices.size() / 3 );
+            for ( std::size_t c = 0; c < 3; ++c )
+            {
+                mesh.vertices.push_back( 0.5f * ( mesh.vertices[a * 3 + c] + 
+                                                  mesh.vertices[b * 3 + c] ) );
+            }
+            normalize( vertex );
+            midpoints.emplace( key, vertex );
+            return vertex;
+        };
+        std::vector<GLuint> indices;
+        indices.reserve( mesh.indices.size() * 4 );
+        for ( std::size_t i = 0; i < mesh.indices.size(); i += 3 )
+        {
+            const GLuint a = mesh.indices[i];
+            const GLuint b = mesh.indices[i + 1];
+            const GLuint c = mesh.indices[i + 2];
+            const GLuint ab = midpoint( a, b );
+            const GLuint bc = midpoint( b, c );
+            const GLuint ca = midpoint( c, a );
+            indices.insert( indices.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  
+                                             ab, bc, ca } );
+        }
+        mesh.indices.swap( indices );
+    }
+    return mesh;
+}
+
+static void appendBox(const float* low, const float* high, 
+                      std::vector<float>& vertices)
+{
+    // Two triangles for each of the six faces; corner bit i picks high on
+    // axis i
+    static const int faces[6][4] = {
+        { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 },
+        { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 }
+    };
+    for ( const int* face : faces )
+    {
+        for ( int corner : { face[0], face[1], face[2], face[0], face[2], face[3] } )
+        {
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                vertices.push_back( ( corner >> axis ) & 1 ? high[axis] : low[axis] );
+            }
+        }
+    }
+}
+
+static double median(std::vector<double> values)
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+    std::nth_element( values.begin(), values.begin() + values.size() / 2, 
+                      values.end() );
+    return values[values.size() / 2];
+}
+
+/**
+* @section Constructor and Destructor
+*/
+
+CullingScene::CullingScene(std::size_t instances, bool cull, bool lod,
+                           const std::string& cullPath, 
+                           const std::string& occlusion, JobSystem& jobs,
+                           ShaderPipeline& pipeline)
+    : jobs_{ jobs }, pipeline_{ pipeline }, program_{ 0 }, boundsBuffer_{ 0 }, 
+      boundsTexture_{ 0 }, viewProjectionLocation_{ -1 }, 
+      occlusionMatrix_{}, proxyProgram_{ 0 }, proxyViewProjectionLocation_{ -1 },
+      path_{ CullPath::Scalar }, occlusion_{ OcclusionMode::Off }, cull_{ cull }, 
+      lod_{ lod }, baseInstance_{ false }, occlusionFallback_{ false }, frame_{ 0 }, extent_{ 1.0f }, 
+      lodBuildMs_{ 0.0 }, lodVisible_{}, visibleTotal_{ 0 }, trianglesTotal_{ 0 },
+      occluderTotal_{ 0 }, testedTotal_{ 0 }, occludedTotal_{ 0 }
+{
+    // Pick the kernel first, so a bad choice fails before any work
+    if ( cullPath == "auto" )
+    {
+        path_ = detectCullPath();
+    }
+    else if ( cullPath == "scalar" || cullPath == "sse2" || cullPath == "avx2" )
+    {
+        path_ = cullPath == "scalar" ? CullPath::Scalar : 
+                cullPath == "sse2" ? CullPath::SSE2 : CullPath::AVX2;
+        if ( !isCullPathSupported( path_ ) )
+        {
+            throw std::logic_error( std::string( "ERROR::SCENE::UNSUPPORTED_CULL_PATH\n " ) + 
+                                    cullPath );
+        }
+    }
+    else
+    {
+        throw std::logic_error( std::string( "ERROR::SCENE::UNKNOWN_CULL_PATH\n " ) + 
+                                cullPath );
+    }
+    if ( !parseOcclusionMode( occlusion, occlusion_ ) )
+    {
+        throw std::logic_error( std::string( "ERROR::SCENE::UNKNOWN_OCCLUSION_MODE\n " ) + 
+                                occlusion );
+    }
+
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in uint aInstance;\n"
+    "uniform samplerBuffer bounds;\n"
+    "uniform mat4 viewProjection;\n"
+    "flat out uint instance;\n"
+    "void main()\n"
+    "{\n"
+    // Center and radius of the instance's bounding sphere
+    "   vec4 sphere = texelFetch(bounds, int(aInstance));\n"
+    "   instance = aInstance;\n"
+    "   gl_Position = viewProjection * vec4(sphere.xyz + aPos * sphere.w, 1.0);\n" 
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    "flat in uint instance;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   uint hash = instance * 2654435761u;\n"
+    "   vec3 color = vec3(uvec3(hash >> 8, hash >> 16, hash >> 24) & 255u) / 255.0;\n"
+    "   FragColor = vec4(0.3 + 0.7 * color, 1.0f);\n"
+    "}\n\0";
+
+    // Start building the program; drawing waits until it is ready
+    program_ = pipeline_.submit( vertexShaderSource, fragmentShaderSource );
+
+    // Scatter the instances through a cube around the camera, keeping the 
+    // density constant whatever their number
+    const std::size_t count = std::max<std::size_t>( instances, 1 );
+    extent_ = 2.0f * std::cbrt( static_cast<float>( count ) );
+    std::mt19937 random( 7 );
+    std::uniform_real_distribution<float> position( -extent_, extent_ );
+    std::uniform_real_distribution<float> radius( MIN_RADIUS, MAX_RADIUS );
+    std::vector<float> spheres;
+    spheres.reserve( count * 4 );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const float x = position( random );
+        const float y = position( random );
+        const float z = position( random );
+        const float r = radius( random );
+        spheres.insert( spheres.end(), { x, y, z, r } );
+    }
+
+    // Store them grouped by grid cell, so every cell is a range of indices
+    const std::size_t cells = GRID_CELLS * GRID_CELLS * GRID_CELLS;
+    const auto cellOf = [this]( const float* sphere )
+    {
+        std::size_t cell = 0;
+        for ( int axis = 2; axis >= 0; --axis )
+        {
+            const float unit = ( sphere[axis] + extent_ ) / ( 2.0f * extent_ );
+            cell = cell * GRID_CELLS + std::min( static_cast<std::size_t>( 
+                        std::max( unit, 0.0f ) * GRID_CELLS ), GRID_CELLS - 1 );
+        }
+        return cell;
+    };
+    cellFirst_.assign( cells + 1, 0 );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        ++cellFirst_[cellOf( &spheres[i * 4] ) + 1];
+    }
+    for ( std::size_t cell = 0; cell < cells; ++cell )
+    {
+        cellFirst_[cell + 1] += cellFirst_[cell];
+    }
+    std::vector<float> bounds( count * 4 );
+    std::vector<std::uint32_t> next( cellFirst_.begin(), cellFirst_.end() - 1 );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const std::uint32_t slot = next[cellOf( &spheres[i * 4] )]++;
+        std::memcpy( &bounds[slot * 4], &spheres[i * 4], 4 * sizeof(float) );
+    }
+    store_.reserve( count );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        store_.add( bounds[i * 4], bounds[i * 4 + 1], bounds[i * 4 + 2], 
+                    bounds[i * 4 + 3] );
+    }
+
+    // The shader reads the spheres through a buffer texture
+    glGenBuffers( 1, &boundsBuffer_ );
+    glBindBuffer( GL_TEXTURE_BUFFER, boundsBuffer_ );
+    glBufferData( GL_TEXTURE_BUFFER, bounds.size() * sizeof(float), 
+                  bounds.data(), GL_STATIC_DRAW );
+    glGenTextures( 1, &boundsTexture_ );
+    glBindTexture( GL_TEXTURE_BUFFER, boundsTexture_ );
+    glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, boundsBuffer_ );
+    glBindTexture( GL_TEXTURE_BUFFER, 0 );
+    glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+    // A sphere of unit radius, scaled by the instance in the shader, and 
+    // its coarser levels, all in one element buffer
+    const LodChain chain = buildLodChain( makeIcosphere( SPHERE_SUBDIVISIONS ) );
+    lods_ = chain.lods;
+    lodBuildMs_ = chain.milliseconds;
+    buffer_ = std::make_unique<BufferSetup>( chain.mesh );
+
+    // Each level's or cell's draw starts at its own instances in the 
+    // stream, which takes a base instance; without one every instance gets
+    // the full mesh, and occlusion falls back to the CPU
+    baseInstance_ = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance;
+    lod_ = lod_ && baseInstance_;
+    if ( occlusion_ == OcclusionMode::Queries && !baseInstance_ )
+    {
+        occlusion_ = OcclusionMode::HiZ;
+        occlusionFallback_ = true;
+    }
+
+    // Every frame streams at most one index per instance
+    visible_.resize( store_.getPaddedSize() );
+    sorted_.resize( store_.getPaddedSize() );
+    levels_.resize( store_.getPaddedSize() );
+    chunkCounts_.resize( ( store_.getPaddedSize() + GRAIN - 1 ) / GRAIN );
+    chunkOccluded_.resize( chunkCounts_.size() );
+    lodCounts_.resize( chunkCounts_.size() * MAX_LOD_LEVELS );
+    packOffsets_.resize( chunkCounts_.size() * MAX_LOD_LEVELS );
+    stream_ = std::make_unique<StreamingBuffer>( GL_ARRAY_BUFFER, 
+                    static_cast<GLsizeiptr>( visible_.size() * sizeof(GLuint) ) );
+
+    if ( occlusion_ == OcclusionMode::HiZ )
+    {
+        // Throws logic error if the sizes are not supported
+        occlusionBuffer_ = std::make_unique<SoftwareRasterizer>( OCCLUSION_WIDTH, 
+                                                                 OCCLUSION_HEIGHT, jobs_ );
+        pyramid_ = std::make_unique<DepthPyramid>( OCCLUSION_WIDTH, OCCLUSION_HEIGHT );
+
+        // The coarsest level with enough triangles, over its own vertices
+        std::size_t level = 0;
+        while ( level + 1 < chain.lods.size() && 
+                chain.lods[level + 1].indexCount / 3 >= OCCLUDER_TRIANGLES )
+        {
+            ++level;
+        }
+        std::vector<std::uint32_t> remap( chain.mesh.vertices.size() / 3, UINT32_MAX );
+        for ( std::size_t i = 0; i < chain.lods[level].indexCount; ++i )
+        {
+            const GLuint index = chain.mesh.indices[chain.lods[level].firstIndex + i];
+            if ( remap[index] == UINT32_MAX )
+            {
+                remap[index] = static_cast<std::uint32_t>( occluderMesh_.vertices.size() / 3 );
+                occluderMesh_.vertices.insert( occluderMesh_.vertices.end(), 
+                                               &chain.mesh.vertices[index * 3],
+                                               &chain.mesh.vertices[index * 3] + 3 );
+            }
+            occluderMesh_.indices.push_back( remap[index] );
+        }
+        const std::size_t occluderVertexCount = occluderMesh_.vertices.size() / 3;
+        for ( std::size_t occluder = 0; occluder < OCCLUDERS; ++occluder )
+        {
+            for ( GLuint index : occluderMesh_.indices )
+            {
+                occluderIndices_.push_back( static_cast<std::uint32_t>( 
+                                        occluder * occluderVertexCount + index ) );
+            }
+        }
+        occluderVertices_.reserve( OCCLUDERS * occluderMesh_.vertices.size() );
+        occluderProgram_.vertex = [this]( const float* in, SoftwareVertex& out )
+        {
+            for ( int row = 0; row < 4; ++row )
+            {
+                out.position[row] = occlusionMatrix_[row] * in[0] + 
+                                    occlusionMatrix_[4 + row] * in[1] +
+                                    occlusionMatrix_[8 + row] * in[2] + 
+                                    occlusionMatrix_[12 + row];
+            }
+        };
+
+        // The camera sits at the origin, so the biggest instances on screen
+        // are those with the largest radius over distance
+        std::vector<std::pair<float, std::uint32_t>> sizes( store_.size() );
+        for ( std::size_t i = 0; i < store_.size(); ++i )
+        {
+            const float* sphere = &bounds[i * 4];
+            const float distance = std::sqrt( sphere[0] * sphere[0] + 
+                                              sphere[1] * sphere[1] + 
+                                              sphere[2] * sphere[2] );
+            sizes[i] = { sphere[3] / std::max( distance, 1e-3f ), 
+                         static_cast<std::uint32_t>( i ) };
+        }
+        const std::size_t candidates = std::min( OCCLUDER_CANDIDATES, sizes.size() );
+        std::partial_sort( sizes.begin(), sizes.begin() + candidates, sizes.end(), 
+                           std::greater<std::pair<float, std::uint32_t>>() );
+        for ( std::size_t i = 0; i < candidates; ++i )
+        {
+            occluderCandidates_.push_back( sizes[i].second );
+        }
+    }
+
+    if ( occlusion_ == OcclusionMode::Queries )
+    {
+        const char *proxyVertexSource = 
+        "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n"
+        "uniform mat4 viewProjection;\n"
+        "void main()\n"
+        "{\n"
+        "   gl_Position = viewProjection * vec4(aPos, 1.0);\n" 
+        "}\0";
+
+        const char *proxyFragmentSource = 
+        "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "   FragColor = vec4(1.0);\n"
+        "}\n\0";
+        proxyProgram_ = pipeline_.submit( proxyVertexSource, proxyFragmentSource );
+
+        // The box of a cell grows by the largest radius, which spheres near
+        // its sides reach out by
+        std::vector<float> boxes;
+        boxes.reserve( cells * 36 * 3 );
+        const float size = 2.0f * extent_ / GRID_CELLS;
+        for ( std::size_t cell = 0; cell < cells; ++cell )
+        {
+            const std::size_t coords[3] = { cell % GRID_CELLS, 
+                                            cell / GRID_CELLS % GRID_CELLS,
+                                            cell / ( GRID_CELLS * GRID_CELLS ) };
+            float low[3];
+            float high[3];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                low[axis] = -extent_ + size * coords[axis] - MAX_RADIUS;
+                high[axis] = low[axis] + size + 2.0f * MAX_RADIUS;
+            }
+            appendBox( low, high, boxes );
+        }
+        proxies_ = std::make_unique<BufferSetup>( boxes );
+        queries_.resize( cells );
+        glGenQueries( static_cast<GLsizei>( cells ), queries_.data() );
+    }
+}
+
+CullingScene::~CullingScene()
+{
+    if ( !queries_.empty() )
+    {
+        glDeleteQueries( static_cast<GLsizei>( queries_.size() ), queries_.data() );
+    }
+    glDeleteTextures( 1, &boundsTexture_ );
+    glDeleteBuffers( 1, &boundsBuffer_ );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void CullingScene::update(std::size_t frame)
+{
+    frame_ = frame;
+}
+
+void CullingScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    if ( !pipeline_.isReady( program_ ) )
+    {
+        return;
+    }
+    // Turn the camera slowly at the center of the cube
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+    const float aspect = viewport[3] > 0 ? 
+                         static_cast<float>( viewport[2] ) / viewport[3] : 1.0f;
+    float projection[16];
+    float view[16];
+    float viewProjection[16];
+    perspective( FIELD_OF_VIEW, aspect, 0.1f, extent_, projection );
+    rotateView( 0.01f * frame_, 0.3f * std::sin( 0.004f * frame_ ), view );
+    multiply( projection, view, viewProjection );
+    const Frustum frustum = makeFrustum( viewProjection );
+    if ( occlusion_ == OcclusionMode::HiZ )
+    {
+        renderOccluders( frustum, viewProjection );
+    }
+    else if ( occlusion_ == OcclusionMode::Queries )
+    {
+        profiler.addCounter( FrameCounter::OccludedInstances, collectQueries() );
+    }
+
+    // Cull every chunk into its own range of visible_, then sort the
+    // survivors of the chunk by level of detail into the same range of 
+    // sorted_, keeping their order within a level. Queries draw a cell at 
+    // one level, so their instances stay in index order.
+    const std::size_t padded = store_.getPaddedSize();
+    const std::size_t chunks = chunkCounts_.size();
+    const std::size_t levels = lod_ && occlusion_ != OcclusionMode::Queries ? 
+                               lods_.size() : 1;
+    const float pixelScale = 0.5f * viewport[3] / std::tan( 0.5f * FIELD_OF_VIEW );
+    const auto cullStart = std::chrono::steady_clock::now();
+    jobs_.parallelFor( chunks, 1, [&]( std::size_t first, std::size_t last ) 
+    {
+        const float* x = store_.getCenterX();
+        const float* y = store_.getCenterY();
+        const float* z = store_.getCenterZ();
+        const float* radius = store_.getRadius();
+        for ( std::size_t chunk = first; chunk < last; ++chunk )
+        {
+            const std::size_t begin = chunk * GRAIN;
+            const std::size_t end = std::min( begin + GRAIN, padded );
+            std::uint32_t* found = visible_.data() + begin;
+            std::size_t count = 0;
+            if ( cull_ )
+            {
+                count = cullSpheres( frustum, store_, begin, end, path_, found );
+            }
+            else
+            {
+                // Every instance but the padding
+                count = std::min( end, store_.size() ) - std::min( begin, store_.size() );
+                for ( std::size_t i = 0; i < count; ++i )
+                {
+                    found[i] = static_cast<std::uint32_t>( begin + i );
+                }
+            }
+            if ( occlusion_ == OcclusionMode::HiZ )
+            {
+                // Keep the instances the pyramid cannot prove hidden
+                std::size_t kept = 0;
+                for ( std::size_t i = 0; i < count; ++i )
+                {
+                    const std::uint32_t instance = found[i];
+                    found[kept] = instance;
+                    kept += pyramid_->isOccluded( viewProjection, x[instance], 
+                                                  y[instance], z[instance], 
+                                                  radius[instance] ) ? 0 : 1;
+                }
+                chunkOccluded_[chunk] = count - kept;
+                count = kept;
+            }
+            chunkCounts_[chunk] = count;
+
+            std::size_t* counts = &lodCounts_[chunk * MAX_LOD_LEVELS];
+            std::fill( counts, counts + MAX_LOD_LEVELS, 0 );
+            std::uint8_t* level = levels_.data() + begin;
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                // The camera sits at the origin
+                const std::uint32_t instance = found[i];
+                const float distance = std::sqrt( x[instance] * x[instance] + 
+                                                  y[instance] * y[instance] + 
+                                                  z[instance] * z[instance] );
+                level[i] = static_cast<std::uint8_t>( levels == 1 ? 0 : 
+                                selectLod( lods_, radius[instance], distance, 
+                                           pixelScale, LOD_PIXEL_ERROR ) );
+                ++counts[level[i]];
+            }
+            std::size_t starts[MAX_LOD_LEVELS];
+            std::size_t next = begin;
+            for ( std::size_t lod = 0; lod < levels; ++lod )
+            {
+                starts[lod] = next;
+                next += counts[lod];
+            }
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                sorted_[starts[level[i]]++] = found[i];
+            }
+        }
+    } );
+
+    // The stream holds every level's instances back to back, and within a
+    // level the chunks back to back
+    std::size_t lodFirst[MAX_LOD_LEVELS] = {};
+    std::size_t lodTotals[MAX_LOD_LEVELS] = {};
+    for ( std::size_t chunk = 0; chunk < chunks; ++chunk )
+    {
+        for ( std::size_t lod = 0; lod < levels; ++lod )
+        {
+            lodTotals[lod] += lodCounts_[chunk * MAX_LOD_LEVELS + lod];
+        }
+    }
+    std::size_t total = 0;
+    for ( std::size_t lod = 0; lod < levels; ++lod )
+    {
+        lodFirst[lod] = total;
+        total += lodTotals[lod];
+        lodVisible_[lod] += lodTotals[lod];
+    }
+    for ( std::size_t lod = 0, next = 0; lod < levels; ++lod )
+    {
+        for ( std::size_t chunk = 0; chunk < chunks; ++chunk )
+        {
+            packOffsets_[chunk * MAX_LOD_LEVELS + lod] = next;
+            next += lodCounts_[chunk * MAX_LOD_LEVELS + lod];
+        }
+    }
+    cullMs_.push_back( std::chrono::duration<double, std::milli>( 
+                            std::chrono::steady_clock::now() - cullStart ).count() );
+    if ( occlusion_ == OcclusionMode::HiZ )
+    {
+        std::size_t occluded = 0;
+        for ( std::size_t chunkOccluded : chunkOccluded_ )
+        {
+            occluded += chunkOccluded;
+        }
+        testedTotal_ += total + occluded;
+        occludedTotal_ += occluded;
+        profiler.addCounter( FrameCounter::OccludedInstances, occluded );
+    }
+
+    // Pack the sorted chunks into the mapped stream
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>( 
+                                std::max<std::size_t>( total, 1 ) * sizeof(GLuint) );
+    GLuint* mapped = static_cast<GLuint*>( stream_->map( bytes ) );
+    jobs_.parallelFor( chunks, 1, [&]( std::size_t first, std::size_t last ) 
+    {
+        for ( std::size_t chunk = first; chunk < last; ++chunk )
+        {
+            const std::uint32_t* source = sorted_.data() + chunk * GRAIN;
+            for ( std::size_t lod = 0; lod < levels; ++lod )
+            {
+                const std::size_t count = lodCounts_[chunk * MAX_LOD_LEVELS + lod];
+                std::memcpy( mapped + packOffsets_[chunk * MAX_LOD_LEVELS + lod], 
+                             source, count * sizeof(GLuint) );
+                source += count;
+            }
+        }
+    } );
+    const GLintptr offset = stream_->commit( bytes );
+    buffer_->setInstanceIndices( 1, stream_->getBufferId(), offset );
+    profiler.addCounter( FrameCounter::VisibleInstances, total );
+    profiler.addCounter( FrameCounter::BytesStreamed, 
+                         static_cast<std::uint64_t>( bytes ) );
+    visibleTotal_ += total;
+    if ( total == 0 )
+    {
+        return;
+    }
+
+    // The queue binds the program, so only the uniforms are set here
+    const GLuint program = pipeline_.getProgramID( program_ );
+    if ( viewProjectionLocation_ < 0 )
+    {
+        viewProjectionLocation_ = glGetUniformLocation( program, "viewProjection" );
+    }
+    glUseProgram( program );
+    glUniformMatrix4fv( viewProjectionLocation_, 1, GL_FALSE, viewProjection );
+    if ( occlusion_ == OcclusionMode::Queries && pipeline_.isReady( proxyProgram_ ) )
+    {
+        const GLuint proxyProgram = pipeline_.getProgramID( proxyProgram_ );
+        if ( proxyViewProjectionLocation_ < 0 )
+        {
+            proxyViewProjectionLocation_ = glGetUniformLocation( proxyProgram, 
+                                                                 "viewProjection" );
+        }
+        glUseProgram( proxyProgram );
+        glUniformMatrix4fv( proxyViewProjectionLocation_, 1, GL_FALSE, viewProjection );
+        const std::uint64_t triangles = submitCells( queue, program, pixelScale );
+        profiler.addCounter( FrameCounter::Triangles, triangles );
+        trianglesTotal_ += triangles;
+        return;
+    }
+
+    // One instanced draw per level, starting at the level's instances
+    DrawItem item;
+    item.program = program;
+    item.vao = buffer_->getVAOId();
+    item.texture = boundsTexture_;
+    item.textureTarget = GL_TEXTURE_BUFFER;
+    item.indexType = GL_UNSIGNED_INT;
+    item.key = makeSortKey( item.program, item.vao, item.texture, 0.0f );
+    std::uint64_t triangles = 0;
+    for ( std::size_t lod = 0; lod < levels; ++lod )
+    {
+        if ( lodTotals[lod] == 0 )
+        {
+            continue;
+        }
+        item.indexOffset = static_cast<GLintptr>( lods_[lod].firstIndex * sizeof(GLuint) );
+        item.count = static_cast<GLsizei>( lods_[lod].indexCount );
+        item.instances = static_cast<GLsizei>( lodTotals[lod] );
+        item.baseInstance = static_cast<GLuint>( lodFirst[lod] );
+        queue.submit( item );
+        triangles += lodTotals[lod] * ( lods_[lod].indexCount / 3 );
+    }
+    profiler.addCounter( FrameCounter::Triangles, triangles );
+    trianglesTotal_ += triangles;
+}
+
+void CullingScene::renderOccluders(const Frustum& frustum, const float* viewProjection)
+{
+    const auto start = std::chrono::steady_clock::now();
+    // The candidates come biggest first, so the first inside the frustum 
+    // are the biggest in view
+    const float* x = store_.getCenterX();
+    const float* y = store_.getCenterY();
+    const float* z = store_.getCenterZ();
+    const float* radius = store_.getRadius();
+    occluderVertices_.clear();
+    std::size_t occluders = 0;
+    for ( std::uint32_t instance : occluderCandidates_ )
+    {
+        if ( occluders == OCCLUDERS )
+        {
+            break;
+        }
+        bool inside = true;
+        for ( const float* plane : frustum.planes )
+        {
+            inside = inside && plane[0] * x[instance] + plane[1] * y[instance] + 
+                               plane[2] * z[instance] + plane[3] >= -radius[instance];
+        }
+        if ( !inside )
+        {
+            continue;
+        }
+        for ( std::size_t i = 0; i < occluderMesh_.vertices.size(); i += 3 )
+        {
+            occluderVertices_.insert( occluderVertices_.end(), {
+                x[instance] + radius[instance] * occluderMesh_.vertices[i],
+                y[instance] + radius[instance] * occluderMesh_.vertices[i + 1],
+                z[instance] + radius[instance] * occluderMesh_.vertices[i + 2] } );
+        }
+        ++occluders;
+    }
+
+    // Depth only, then the farthest depth of every texel's area per level
+    std::memcpy( occlusionMatrix_, viewProjection, sizeof(occlusionMatrix_) );
+    occlusionBuffer_->clear( 0, 1.0f );
+    occlusionBuffer_->draw( occluderProgram_, occluderVertices_.data(), 3, 
+                            occluderVertices_.size() / 3, occluderIndices_.data(), 
+                            occluders * occluderMesh_.indices.size() );
+    occlusionBuffer_->render();
+    pyramid_->build( occlusionBuffer_->getDepth(), occlusionBuffer_->getDepthPitch() );
+    occluderTotal_ += occluders;
+    occlusionMs_.push_back( std::chrono::duration<double, std::milli>( 
+                                std::chrono::steady_clock::now() - start ).count() );
+}
+
+std::size_t CullingScene::collectQueries()
+{
+    // Results of the last frame; those not ready yet are left out rather
+    // than waited for
+    std::size_t occluded = 0;
+    for ( std::size_t i = 0; i < queriedCells_.size(); ++i )
+    {
+        const GLuint query = queries_[queriedCells_[i]];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv( query, GL_QUERY_RESULT_AVAILABLE, &available );
+        if ( available == GL_FALSE )
+        {
+            continue;
+        }
+        GLuint passed = GL_TRUE;
+        glGetQueryObjectuiv( query, GL_QUERY_RESULT, &passed );
+        testedTotal_ += queriedCounts_[i];
+        occluded += passed == GL_FALSE ? queriedCounts_[i] : 0;
+    }
+    queriedCells_.clear();
+    queriedCounts_.clear();
+    occludedTotal_ += occluded;
+    return occluded;
+}
+
+std::uint64_t CullingScene::submitCells(RenderQueue& queue, GLuint program, 
+                                        float pixelScale)
+{
+    const auto start = std::chrono::steady_clock::now();
+    // Visible instances before an index: whole chunks, then a search in 
+    // the chunk, whose instances are in index order
+    const auto visibleBefore = [this]( std::size_t index )
+    {
+        const std::size_t chunk = index / GRAIN;
+        if ( chunk >= chunkCounts_.size() )
+        {
+            return packOffsets_[( chunkCounts_.size() - 1 ) * MAX_LOD_LEVELS] + 
+                   chunkCounts_.back();
+        }
+        const std::uint32_t* begin = sorted_.data() + chunk * GRAIN;
+        return packOffsets_[chunk * MAX_LOD_LEVELS] + static_cast<std::size_t>( 
+                    std::lower_bound( begin, begin + chunkCounts_[chunk], 
+                                      static_cast<std::uint32_t>( index ) ) - begin );
+    };
+
+    // Cells with visible instances, nearest first by the closest point of
+    // their box, which the proxy draws
+    cellOrder_.clear();
+    const float size = 2.0f * extent_ / GRID_CELLS;
+    for ( std::size_t cell = 0; cell + 1 < cellFirst_.size(); ++cell )
+    {
+        if ( visibleBefore( cellFirst_[cell + 1] ) == visibleBefore( cellFirst_[cell] ) )
+        {
+            continue;
+        }
+        const std::size_t coords[3] = { cell % GRID_CELLS, cell / GRID_CELLS % GRID_CELLS,
+                                        cell / ( GRID_CELLS * GRID_CELLS ) };
+        float squared = 0.0f;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            const float low = -extent_ + size * coords[axis] - MAX_RADIUS;
+            const float high = low + size + 2.0f * MAX_RADIUS;
+            const float outside = std::max( std::max( low, -high ), 0.0f );
+            squared += outside * outside;
+        }
+        cellOrder_.push_back( { std::sqrt( squared ), static_cast<std::uint32_t>( cell ) } );
+    }
+    std::sort( cellOrder_.begin(), cellOrder_.end() );
+
+    // Every cell submits its proxy and its draw under the same key, which 
+    // the stable sort keeps in order and the depths keep front to back
+    DrawItem proxy;
+    proxy.program = pipeline_.getProgramID( proxyProgram_ );
+    proxy.vao = proxies_->getVAOId();
+    proxy.count = 36;
+    DrawItem item;
+    item.program = program;
+    item.vao = buffer_->getVAOId();
+    item.texture = boundsTexture_;
+    item.textureTarget = GL_TEXTURE_BUFFER;
+    item.indexType = GL_UNSIGNED_INT;
+    std::uint64_t triangles = 0;
+    for ( std::size_t rank = 0; rank < cellOrder_.size(); ++rank )
+    {
+        const float distance = cellOrder_[rank].first;
+        const std::uint32_t cell = cellOrder_[rank].second;
+        const std::size_t first = visibleBefore( cellFirst_[cell] );
+        const std::size_t count = visibleBefore( cellFirst_[cell + 1] ) - first;
+        const std::uint64_t key = makeSortKey( item.program, item.vao, item.texture,
+                            ( rank + 0.5f ) / static_cast<float>( cellOrder_.size() ) );
+        item.conditionQuery = 0;
+        if ( distance > PROXY_MIN_DISTANCE )
+        {
+            proxy.first = static_cast<GLint>( cell * 36 );
+            proxy.occlusionQuery = queries_[cell];
+            proxy.key = key;
+            queue.submit( proxy );
+            item.conditionQuery = queries_[cell];
+            queriedCells_.push_back( cell );
+            queriedCounts_.push_back( count );
+        }
+        const std::size_t lod = lod_ ? selectLod( lods_, MAX_RADIUS, distance, 
+                                                   pixelScale, LOD_PIXEL_ERROR ) : 0;
+        item.indexOffset = static_cast<GLintptr>( lods_[lod].firstIndex * sizeof(GLuint) );
+        item.count = static_cast<GLsizei>( lods_[lod].indexCount );
+        item.instances = static_cast<GLsizei>( count );
+        item.baseInstance = static_cast<GLuint>( first );
+        item.key = key;
+        queue.submit( item );
+        lodVisible_[lod] += count;
+        triangles += count * ( lods_[lod].indexCount / 3 );
+    }
+    occlusionMs_.push_back( std::chrono::duration<double, std::milli>( 
+                                std::chrono::steady_clock::now() - start ).count() );
+    return triangles;
+}
+
+void CullingScene::endFrame()
+{
+    // Fence the segment only after the draw that reads it was issued
+    if ( pipeline_.isReady( program_ ) )
+    {
+        stream_->endFrame();
+    }
+}
+
+void CullingScene::report(const FrameProfiler& profiler) const
+{
+    (void)profiler;
+    const double frames = cullMs_.empty() ? 1.0 : static_cast<double>( cullMs_.size() );
+    std::printf( "Culling: %s, %zu instances, %.0f visible per frame (%.1f%%)\n", 
+                 cull_ ? getCullPathName( path_ ) : "off", store_.size(), 
+                 visibleTotal_ / frames, 
+                 100.0 * visibleTotal_ / frames / store_.size() );
+    if ( cull_ || lod_ )
+    {
+        std::printf( "Culling: median %.3f ms per frame on %zu threads\n", 
+                     median( cullMs_ ), jobs_.getThreadCount() );
+    }
+
+    if ( occlusion_ == OcclusionMode::Off )
+    {
+        std::printf( "Occlusion: off\n" );
+    }
+    else
+    {
+        // Queries only learn of the cells they tested, a frame late
+        std::printf( "Occlusion: %s%s, %.1f%% of %llu tested instances hidden\n", 
+                     getOcclusionModeName( occlusion_ ), 
+                     occlusionFallback_ ? " (queries need base instances)" : "",
+                     testedTotal_ > 0 ? 100.0 * occludedTotal_ / testedTotal_ : 0.0,
+                     static_cast<unsigned long long>( testedTotal_ ) );
+        if ( occlusion_ == OcclusionMode::HiZ )
+        {
+            std::printf( "Occlusion: median %.3f ms per frame rasterizing %.1f "
+                         "occluders into %dx%d\n", median( occlusionMs_ ), 
+                         occluderTotal_ / frames, OCCLUSION_WIDTH, OCCLUSION_HEIGHT );
+        }
+        else
+        {
+            std::printf( "Occlusion: median %.3f ms per frame submitting up to %zu cells\n",
+                         median( occlusionMs_ ), GRID_CELLS * GRID_CELLS * GRID_CELLS );
+        }
+    }
+
+    std::printf( "LOD: %zu levels built in %.2f ms, triangles", lods_.size(), 
+                 lodBuildMs_ );
+    for ( const MeshLod& lod : lods_ )
+    {
+        std::printf( " %zu", lod.indexCount / 3 );
+    }
+    std::printf( ", errors" );
+    for ( const MeshLod& lod : lods_ )
+    {
+        std::printf( " %.4f", lod.error );
+    }
+    std::printf( "\n" );
+    if ( !lod_ )
+    {
+        std::printf( "LOD: off%s, every instance drawn at full detail\n", 
+                     baseInstance_ ? "" : " (base instances not supported)" );
+        return;
+    }
+    std::printf( "LOD: instances per frame by level" );
+    for ( std::size_t lod = 0; lod < lods_.size(); ++lod )
+    {
+        std::printf( " %.0f", lodVisible_[lod] / frames );
+    }
+    const double full = static_cast<double>( visibleTotal_ ) * ( lods_[0].indexCount / 3 );
+    std::printf( "\nLOD: %.0f triangles per frame, %.0f at full detail (%.1fx fewer)\n", 
+                 trianglesTotal_ / frames, full / frames, 
+                 trianglesTotal_ > 0 ? full / trianglesTotal_ : 0.0 );
+}
@@ -0,0 +1,178 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+/**
+* @section Helper functions
+*/
+
+static float hashToUnit(std::uint32_t value)
+{
+    // Integer hash (lowbias32) mapped to [0, 1)
+    value ^= value >> 16;
+    value *= 0x7feb352dU;
+    value ^= value >> 15;
+    value *= 0x846ca68bU;
+    value ^= value >> 16;
+    return static_cast<float>( value >> 8 ) / 16777216.0f;
+}
+
+static double median(std::vector<double> values)
+{
+    if ( values.empty() )
+    {
+        return 0.0;
+    }
+    std::nth_element( values.begin(), values.begin() + values.size() / 2, 
+                      values.end() );
+    return values[values.size() / 2];
+}
+
+/**
+* @section Constructor
+*/
+
+InstancedScene::InstancedScene(std::size_t instances, bool sweep, 
+                               ShaderPipeline& pipeline)
+    : pipeline_{ pipeline }, program_{ 0 }, drawnInstances_{ 0 }
+{
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    // Mesh position, shared by all instances
+    "layout (location = 0) in vec3 aPos;\n"
+    // Per-instance offset, scale and color
+    "layout (location = 1) in vec2 aOffset;\n"
+    "layout (location = 2) in float aScale;\n"
+    "layout (location = 3) in vec3 aColor;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "   color = aColor;\n"
+    "   gl_Position = vec4(aPos.xy * aScale + aOffset, aPos.z, 1.0);\n" 
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = vec4(color, 1.0f);\n"
+    "}\n\0";
+
+    const std::vector<float> triangleVertices =
+    {
+        -0.5f, -0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        0.0f,  0.5f, 0.0f
+    };
+
+    // Start building the program; drawing waits until it is ready
+    program_ = pipeline_.submit(vertexShaderSource, fragmentShaderSource);
+
+    buffer_ = std::make_unique<BufferSetup>(triangleVertices);
+
+    // Lay the instances out on a square grid covering the viewport
+    const std::size_t count = std::max<std::size_t>( instances, 1 );
+    const std::size_t side = static_cast<std::size_t>( 
+                        std::ceil( std::sqrt( static_cast<double>( count ) ) ) );
+    const float cell = 2.0f / side;
+    std::vector<float> instanceData;
+    instanceData.reserve( count * 6 );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const std::uint32_t seed = static_cast<std::uint32_t>( i ) * 3U;
+        // Offset
+        instanceData.push_back( -1.0f + cell * ( i % side + 0.5f ) );
+        instanceData.push_back( -1.0f + cell * ( i / side + 0.5f ) );
+        // Scale
+        instanceData.push_back( cell * 0.9f );
+        // Color
+        instanceData.push_back( 0.2f + 0.8f * hashToUnit( seed ) );
+        instanceData.push_back( 0.2f + 0.8f * hashToUnit( seed + 1U ) );
+        instanceData.push_back( 0.2f + 0.8f * hashToUnit( seed + 2U ) );
+    }
+    buffer_->addInstanceBuffer( instanceData, { {1, 2}, {2, 1}, {3, 3} } );
+
+    // Double the instance count every step up to the full count
+    if ( sweep )
+    {
+        for ( std::size_t step = 1; step < count; step *= 2 )
+        {
+            steps_.push_back( static_cast<GLsizei>( step ) );
+        }
+    }
+    steps_.push_back( static_cast<GLsizei>( count ) );
+    drawnInstances_ = steps_.front();
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void InstancedScene::update(std::size_t frame)
+{
+    const std::size_t step = std::min( frame / SWEEP_FRAMES, 
+                                       steps_.size() - 1 );
+    drawnInstances_ = steps_[step];
+}
+
+void InstancedScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    (void)profiler;
+    if (!pipeline_.isReady(program_))
+    {
+        return;
+    }
+    // All instances with a single draw call
+    DrawItem item;
+    item.program = pipeline_.getProgramID(program_);
+    item.vao = buffer_->getVAOId();
+    item.count = buffer_->getVertexCount();
+    item.instances = drawnInstances_;
+    item.key = makeSortKey(item.program, item.vao, 0, 0.0f);
+    queue.submit(item);
+}
+
+std::size_t InstancedScene::getFrameLimit() const
+{
+    // A sweep ends after its last step, a single count runs freely
+    return steps_.size() > 1 ? steps_.size() * SWEEP_FRAMES : 0;
+}
+
+void InstancedScene::report(const FrameProfiler& profiler) const
+{
+    if ( steps_.size() < 2 )
+    {
+        return;
+    }
+    // The first frames after a count change are not representative
+    const std::size_t warmup = SWEEP_FRAMES / 4;
+    std::vector<std::vector<double>> cpuTimes( steps_.size() );
+    std::vector<std::vector<double>> gpuTimes( steps_.size() );
+    for ( const FrameSample& sample : profiler.getSamples() )
+    {
+        const std::size_t step = sample.frame / SWEEP_FRAMES;
+        if ( step >= steps_.size() || sample.frame % SWEEP_FRAMES < warmup )
+        {
+            continue;
+        }
+        cpuTimes[step].push_back( sample.cpuFrame );
+        if ( sample.gpuValid )
+        {
+            gpuTimes[step].push_back( sample.gpuFrame );
+        }
+    }
+
+    std::printf( "%12s %14s %14s %16s\n", "instances", "cpu median ms", 
+                 "gpu median ms", "gpu ns/instance" );
+    for ( std::size_t step = 0; step < steps_.size(); ++step )
+    {
+        const double cpu = median( cpuTimes[step] );
+        const double gpu = median( gpuTimes[step] );
+        std::printf( "%12d %14.3f %14.3f %16.2f\n", steps_[step], cpu, gpu, 
+                     gpu * 1e6 / steps_[step] );
+    }
+}
@@ -0,0 +1,191 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+/**
+* @section Helper functions
+*/
+
+static float heightAt(float x, float y)
+{
+    return 0.1f * std::sin( 6.0f * x ) * std::cos( 6.0f * y );
+}
+
+/**
+* @section Constructor
+*/
+
+MeshScene::MeshScene(std::size_t triangles, bool optimize, 
+                     const std::string& vertexFormat, ShaderPipeline& pipeline)
+    : pipeline_{ pipeline }, optimize_{ optimize }, vertexFormat_{ vertexFormat },
+      vertexSize_{ 0 }
+{
+    // Pick the layout first, so an unknown format fails before any work
+    VertexLayout layout;
+    if ( vertexFormat_ == "float" )
+    {
+        layout.add( 0, 3, AttributeFormat::Float32 )
+              .add( 1, 3, AttributeFormat::Float32 )
+              .add( 2, 2, AttributeFormat::Float32 );
+    }
+    else if ( vertexFormat_ == "packed" || vertexFormat_ == "split" )
+    {
+        const std::size_t attributeStream = vertexFormat_ == "split" ? 1 : 0;
+        layout.add( 0, 3, AttributeFormat::Half )
+              .add( 1, 4, AttributeFormat::Snorm2_10_10_10, attributeStream )
+              .add( 2, 2, AttributeFormat::Unorm16, attributeStream );
+    }
+    else
+    {
+        throw std::logic_error( std::string( "ERROR::SCENE::UNKNOWN_VERTEX_FORMAT\n " ) + 
+                                vertexFormat_ );
+    }
+    vertexSize_ = layout.getVertexSize();
+
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec3 aNormal;\n"
+    "layout (location = 2) in vec2 aTexCoord;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4(aPos.xy * 0.9, aPos.z, 1.0);\n" 
+    "   float light = max(dot(normalize(aNormal), vec3(0.36, 0.48, 0.8)), 0.0);\n"
+    "   color = vec3(aTexCoord, 0.6) * (0.3 + 0.7 * light);\n"
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = vec4(color, 1.0f);\n"
+    "}\n\0";
+
+    program_ = pipeline_.submit( vertexShaderSource, fragmentShaderSource );
+
+    // A grid of side x side quads, two triangles each
+    const std::size_t side = std::max<std::size_t>( 1, static_cast<std::size_t>( 
+                        std::sqrt( static_cast<double>( triangles ) / 2.0 ) ) );
+    const float step = 2.0f / side;
+    std::vector<std::size_t> order( side * side * 2 );
+    for ( std::size_t i = 0; i < order.size(); ++i )
+    {
+        order[i] = i;
+    }
+    // Shuffle the triangles, as exporters often leave them in no useful order
+    std::mt19937 random( 42 );
+    std::shuffle( order.begin(), order.end(), random );
+
+    std::vector<float> soup;
+    soup.reserve( order.size() * 9 );
+    for ( std::size_t triangle : order )
+    {
+        const std::size_t quad = triangle / 2;
+        // Corners come from integer grid positions, so shared corners of 
+        // neighbouring triangles are bitwise identical
+        const std::size_t column = quad % side;
+        const std::size_t row = quad / side;
+        const float x0 = -1.0f + step * column;
+        const float y0 = -1.0f + step * row;
+        const float x1 = -1.0f + step * ( column + 1 );
+        const float y1 = -1.0f + step * ( row + 1 );
+        const float z00 = heightAt( x0, y0 );
+        const float z10 = heightAt( x1, y0 );
+        const float z01 = heightAt( x0, y1 );
+        const float z11 = heightAt( x1, y1 );
+        if ( triangle % 2 == 0 )
+        {
+            soup.insert( soup.end(), { x0, y0, z00, x1, y0, z10, x1, y1, z11 } );
+        }
+        else
+        {
+            soup.insert( soup.end(), { x0, y0, z00, x1, y1, z11, x0, y1, z01 } );
+        }
+    }
+
+    Mesh mesh;
+    if ( optimize_ )
+    {
+        mesh = processMesh( soup, processReport_ );
+    }
+    else
+    {
+        mesh = makeIndexedMesh( soup );
+        processReport_.inputVertices = soup.size() / 3;
+        processReport_.uniqueVertices = mesh.vertices.size() / 3;
+        processReport_.triangles = mesh.indices.size() / 3;
+        processReport_.acmrIndexed = computeACMR( mesh.indices, 
+                                                  processReport_.uniqueVertices );
+        processReport_.acmrOptimized = processReport_.acmrIndexed;
+    }
+
+    // Derive the normal and texture coordinate of every unique vertex
+    const std::size_t vertexCount = mesh.vertices.size() / 3;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    const std::size_t normalComponents = vertexFormat_ == "float" ? 3 : 4;
+    normals.reserve( vertexCount * normalComponents );
+    texCoords.reserve( vertexCount * 2 );
+    for ( std::size_t v = 0; v < vertexCount; ++v )
+    {
+        const float x = mesh.vertices[v * 3];
+        const float y = mesh.vertices[v * 3 + 1];
+        const float dx = 0.6f * std::cos( 6.0f * x ) * std::cos( 6.0f * y );
+        const float dy = -0.6f * std::sin( 6.0f * x ) * std::sin( 6.0f * y );
+        const float length = std::sqrt( dx * dx + dy * dy + 1.0f );
+        normals.insert( normals.end(), { -dx / length, -dy / length, 1.0f / length } );
+        if ( normalComponents == 4 )
+        {
+            normals.push_back( 0.0f );
+        }
+        texCoords.insert( texCoords.end(), { 0.5f + 0.5f * x, 0.5f + 0.5f * y } );
+    }
+    buffer_ = std::make_unique<BufferSetup>( layout, 
+                    packVertices( layout, { mesh.vertices, normals, texCoords }, 
+                                  vertexCount ), 
+                    mesh.indices );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void MeshScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    (void)profiler;
+    if ( !pipeline_.isReady( program_ ) )
+    {
+        return;
+    }
+    DrawItem item;
+    item.program = pipeline_.getProgramID( program_ );
+    item.vao = buffer_->getVAOId();
+    item.count = buffer_->getIndexCount();
+    item.indexType = GL_UNSIGNED_INT;
+    item.key = makeSortKey( item.program, item.vao, 0, 0.0f );
+    queue.submit( item );
+}
+
+void MeshScene::report(const FrameProfiler& profiler) const
+{
+    (void)profiler;
+    std::printf( "Mesh: %zu triangles, %zu soup vertices -> %zu unique\n",
+                 processReport_.triangles, processReport_.inputVertices,
+                 processReport_.uniqueVertices );
+    std::printf( "ACMR (%zu entry FIFO): soup 3.000, indexed %.3f, %s %.3f\n",
+                 DEFAULT_VERTEX_CACHE_SIZE, processReport_.acmrIndexed,
+                 optimize_ ? "optimized" : "not optimized", 
+                 processReport_.acmrOptimized );
+    if ( optimize_ )
+    {
+        std::printf( "Mesh processing took %.3f ms\n", processReport_.milliseconds );
+    }
+    std::printf( "Vertex format: %s, %zu bytes per vertex, %zu bytes of vertices\n",
+                 vertexFormat_.c_str(), vertexSize_, 
+                 vertexSize_ * processReport_.uniqueVertices );
+}
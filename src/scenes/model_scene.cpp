@@ -0,0 +1,192 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+/**
+* @section Helper functions
+*/
+
+static void printFrameTimes(const char* label, std::vector<double> times)
+{
+    if ( times.empty() )
+    {
+        return;
+    }
+    std::sort( times.begin(), times.end() );
+    std::printf( "  %s: %zu frames, CPU frame time ms p50 %.3f max %.3f\n",
+                 label, times.size(), times[times.size() / 2], times.back() );
+}
+
+/**
+* @section Constructor
+*/
+
+ModelScene::ModelScene(const std::string& path, const std::string& texturePath,
+                       bool asyncLoad, AssetLoader& loader,
+                       ShaderPipeline& pipeline)
+    : loader_{ loader }, pipeline_{ pipeline }, textured_{ !texturePath.empty() },
+      fitLocation_{ -1 }, angleLocation_{ -1 }, texturedLocation_{ -1 }, fit_{},
+      fitted_{ false }, angle_{ 0.0f }, path_{ path }, texturePath_{ texturePath },
+      frame_{ 0 }, loadedFrame_{ std::numeric_limits<std::size_t>::max() }
+{
+    const char *vertexShaderSource =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec3 aNormal;\n"
+    "layout (location = 2) in vec2 aTexCoord;\n"
+    "uniform vec4 fit;\n"
+    "uniform float angle;\n"
+    "out vec3 color;\n"
+    "out vec2 texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   vec3 p = (aPos - fit.xyz) * fit.w;\n"
+    "   float c = cos(angle), s = sin(angle);\n"
+    "   p = vec3(c * p.x + s * p.z, p.y, c * p.z - s * p.x);\n"
+    "   vec3 n = vec3(c * aNormal.x + s * aNormal.z, aNormal.y, \n"
+    "                 c * aNormal.z - s * aNormal.x);\n"
+    "   gl_Position = vec4(p.xy, p.z * 0.5, 1.0);\n"
+    "   float light = length(n) > 0.0 ? \n"
+    "                 max(dot(normalize(n), vec3(0.36, 0.48, 0.8)), 0.0) : 1.0;\n"
+    "   color = vec3(0.3 + 0.7 * light);\n"
+    "   texCoord = aTexCoord;\n"
+    "}\0";
+
+    // Sampler units default to 0, where the queue binds the item's texture
+    const char *fragmentShaderSource =
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "in vec2 texCoord;\n"
+    "uniform sampler2D image;\n"
+    "uniform bool textured;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   vec3 albedo = textured ? texture(image, texCoord).rgb \n"
+    "                          : vec3(0.5 + 0.5 * texCoord, 0.6);\n"
+    "   FragColor = vec4(albedo * color, 1.0f);\n"
+    "}\n\0";
+
+    program_ = pipeline_.submit( vertexShaderSource, fragmentShaderSource );
+
+    // Reading, decoding and uploading happen off the render thread
+    mesh_ = loader_.loadMesh( path_ );
+    texture_ = textured_ ? loader_.loadTexture( texturePath_ ) : 0;
+    if ( asyncLoad )
+    {
+        return;
+    }
+    loader_.finish();
+    for ( const AssetLoader::Handle asset : { mesh_, texture_ } )
+    {
+        if ( loader_.getState( asset ) == AssetLoader::State::Failed )
+        {
+            throw std::logic_error( "ERROR::SCENE::ASSET_FAILED\n " +
+                                    loader_.getError( asset ) );
+        }
+    }
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+bool ModelScene::isLoaded() const
+{
+    return loader_.isReady( mesh_ ) && ( !textured_ || loader_.isReady( texture_ ) );
+}
+
+void ModelScene::update(std::size_t frame)
+{
+    frame_ = frame;
+    angle_ = 0.01f * frame;
+}
+
+void ModelScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    if ( !pipeline_.isReady( program_ ) || !isLoaded() )
+    {
+        return;
+    }
+    const BufferSetup& mesh = *loader_.getMesh( mesh_ );
+    if ( !fitted_ )
+    {
+        // Scale the largest extent of the bounds to the width of the view
+        const MeshBounds& bounds = loader_.getBounds( mesh_ );
+        float extent{ 0.0f };
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            fit_[axis] = 0.5f * ( bounds.min[axis] + bounds.max[axis] );
+            extent = std::max( extent, bounds.max[axis] - bounds.min[axis] );
+        }
+        fit_[3] = extent > 0.0f ? 1.6f / extent : 1.0f;
+        fitted_ = true;
+        loadedFrame_ = frame_;
+    }
+    if ( mesh.getIndexCount() == 0 )
+    {
+        return;
+    }
+    // The queue binds the program, so only the uniforms are set here
+    const GLuint program = pipeline_.getProgramID( program_ );
+    if ( fitLocation_ < 0 )
+    {
+        fitLocation_ = glGetUniformLocation( program, "fit" );
+        angleLocation_ = glGetUniformLocation( program, "angle" );
+        texturedLocation_ = glGetUniformLocation( program, "textured" );
+    }
+    glUseProgram( program );
+    glUniform4fv( fitLocation_, 1, fit_ );
+    glUniform1f( angleLocation_, angle_ );
+    glUniform1i( texturedLocation_, textured_ ? 1 : 0 );
+
+    DrawItem item;
+    item.program = program;
+    item.vao = mesh.getVAOId();
+    item.texture = textured_ ? loader_.getTexture( texture_ ) : 0;
+    item.count = mesh.getIndexCount();
+    item.indexType = GL_UNSIGNED_INT;
+    item.key = makeSortKey( item.program, item.vao, item.texture, 0.0f );
+    queue.submit( item );
+    profiler.addCounter( FrameCounter::Triangles, mesh.getIndexCount() / 3 );
+}
+
+void ModelScene::report(const FrameProfiler& profiler) const
+{
+    std::printf( "Model: %s%s%s\n", path_.c_str(), textured_ ? ", texture " : "",
+                 texturePath_.c_str() );
+    for ( std::size_t i = 0; i < ( textured_ ? 2u : 1u ); ++i )
+    {
+        const AssetLoader::Handle asset = i == 0 ? mesh_ : texture_;
+        const char* name = i == 0 ? "mesh" : "texture";
+        if ( loader_.getState( asset ) == AssetLoader::State::Pending )
+        {
+            std::printf( "  %s: still loading\n", name );
+            continue;
+        }
+        if ( loader_.getState( asset ) == AssetLoader::State::Failed )
+        {
+            std::printf( "  %s failed: %s\n", name, 
+                         loader_.getError( asset ).c_str() );
+            continue;
+        }
+        // Read time includes faulting in every page, from disk or the cache
+        const double megabytes = loader_.getBytes( asset ) / ( 1024.0 * 1024.0 );
+        const double uploadMs = loader_.getUploadMs( asset );
+        std::printf( "  %s: %.1f MiB, read in %.3f ms, uploaded in %.3f ms "
+                     "(%.1f MiB/s), ready after %.3f ms\n",
+                     name, megabytes, loader_.getReadMs( asset ), uploadMs,
+                     uploadMs > 0.0 ? megabytes / ( uploadMs * 1e-3 ) : 0.0,
+                     loader_.getReadyMs( asset ) );
+    }
+    // Frames while loading should cost no more than frames after it
+    std::vector<double> loading;
+    std::vector<double> loaded;
+    for ( const FrameSample& sample : profiler.getSamples() )
+    {
+        ( sample.frame < loadedFrame_ ? loading : loaded ).push_back( sample.cpuFrame );
+    }
+    printFrameTimes( "while loading", loading );
+    printFrameTimes( "after loading", loaded );
+}
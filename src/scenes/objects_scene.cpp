@@ -0,0 +1,265 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/**
+* @section Helper functions
+*/
+
+static std::uint32_t hashIndex(std::uint32_t value)
+{
+    // Integer hash (lowbias32)
+    value ^= value >> 16;
+    value *= 0x7feb352dU;
+    value ^= value >> 15;
+    value *= 0x846ca68bU;
+    value ^= value >> 16;
+    return value;
+}
+
+static void writeVec4(std::uint8_t* block, GLint offset, float x, float y, 
+                      float z, float w)
+{
+    // Members the program does not use have no offset
+    if ( offset < 0 )
+    {
+        return;
+    }
+    const float values[4] = { x, y, z, w };
+    std::memcpy( block + offset, values, sizeof( values ) );
+}
+
+/**
+* @section Constructor
+*/
+
+ObjectsScene::ObjectsScene(std::size_t objects, bool useArena, 
+                           JobSystem& jobs, UniformRing& uniforms, 
+                           ShaderPipeline& pipeline)
+    : jobs_{ jobs }, uniforms_{ uniforms }, pipeline_{ pipeline }, 
+      blocks_( PROGRAMS ), side_{ 1 }, frame_{ 0 }
+{
+    // Sway is amplitude x, y, angular speed and phase
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (std140) uniform Frame\n"
+    "{\n"
+    "   vec4 viewport;\n"
+    "   vec4 time;\n"
+    "};\n"
+    "layout (std140) uniform Object\n"
+    "{\n"
+    "   vec4 sway;\n"
+    "   vec4 color;\n"
+    "};\n"
+    "out vec4 shade;\n"
+    "void main()\n"
+    "{\n"
+    "   vec2 offset = sway.xy * sin(time.x * sway.z + sway.w);\n"
+    "   gl_Position = vec4(aPos.xy + offset, aPos.z, 1.0);\n" 
+    "   shade = color;\n"
+    "}\0";
+
+    // One program per tint, differing only in their constant color
+    const char* tints[PROGRAMS] = {
+        "vec4(0.9f, 0.4f, 0.3f, 1.0f)", "vec4(0.3f, 0.8f, 0.4f, 1.0f)",
+        "vec4(0.3f, 0.5f, 0.9f, 1.0f)", "vec4(0.9f, 0.8f, 0.3f, 1.0f)"
+    };
+    for ( const char* tint : tints )
+    {
+        const std::string fragmentShaderSource = 
+            std::string( "#version 330 core\n"
+                         "in vec4 shade;\n"
+                         "out vec4 FragColor;\n"
+                         "void main()\n"
+                         "{\n"
+                         "   FragColor = shade * " ) + tint + ";\n}\n";
+        programs_.push_back( pipeline_.submit( vertexShaderSource, 
+                                               fragmentShaderSource.c_str() ) );
+    }
+
+    if ( useArena )
+    {
+        // Start small, so the arena has to grow while the meshes arrive
+        VertexLayout positions;
+        positions.add( 0, 3, AttributeFormat::Float32 );
+        arena_ = std::make_unique<BufferArena>( positions, 4096, 0 );
+    }
+
+    // Place the objects on a grid
+    const std::size_t count = std::max<std::size_t>( objects, 1 );
+    side_ = static_cast<std::size_t>( 
+                        std::ceil( std::sqrt( static_cast<double>( count ) ) ) );
+    objects_.reserve( count );
+    meshes_.reserve( count );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const std::uint32_t hash = hashIndex( static_cast<std::uint32_t>( i ) );
+        Object object;
+        object.program = ( hash >> 8 ) % PROGRAMS;
+        object.baseDepth = static_cast<float>( hash & 0xFF ) / 255.0f;
+        object.depth = object.baseDepth;
+        objects_.push_back( object );
+        meshes_.push_back( std::make_unique<BufferSetup>( createMesh( i, 0 ) ) );
+    }
+    lists_.resize( ( count + GRAIN - 1 ) / GRAIN );
+    // Room for the frame's own block and one block per object
+    uniforms_.reserve( uniforms_.alignSize( sizeof( FrameUniforms ) ) + 
+                       uniforms_.alignSize( OBJECT_BLOCK_SIZE ) * 
+                       static_cast<GLsizeiptr>( count ) );
+}
+
+BufferSetup ObjectsScene::createMesh(std::size_t object, std::size_t generation)
+{
+    // One to three triangles stacked inside the object's cell
+    const std::size_t triangles = 1 + hashIndex( static_cast<std::uint32_t>( 
+                                        object * 7919 + generation ) ) % 3;
+    const float cell = 2.0f / side_;
+    const float centerX = -1.0f + cell * ( object % side_ + 0.5f );
+    const float centerY = -1.0f + cell * ( object / side_ + 0.5f );
+    std::vector<float> vertices;
+    for ( std::size_t t = 0; t < triangles; ++t )
+    {
+        const float half = cell * 0.45f / ( t + 1 );
+        vertices.insert( vertices.end(), {
+            centerX - half, centerY - half, 0.0f,
+            centerX + half, centerY - half, 0.0f,
+            centerX,        centerY + half, 0.0f } );
+    }
+    if ( arena_ )
+    {
+        return BufferSetup( *arena_, vertices );
+    }
+    return BufferSetup( vertices );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void ObjectsScene::update(std::size_t frame)
+{
+    frame_ = frame;
+    // Replace a moving window of objects with meshes of a new size
+    const std::size_t churn = std::max<std::size_t>( objects_.size() / CHURN_DIVISOR, 1 );
+    for ( std::size_t i = 0; i < churn; ++i )
+    {
+        const std::size_t object = ( frame * churn + i ) % objects_.size();
+        const std::size_t generation = ( frame * churn + i ) / objects_.size() + 1;
+        // Release the old mesh first, so its range can be reused
+        meshes_[object].reset();
+        meshes_[object] = std::make_unique<BufferSetup>( 
+                                createMesh( object, generation ) );
+    }
+}
+
+void ObjectsScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    (void)profiler;
+    // Look the programs up once, so the jobs only read plain values
+    GLuint programIds[PROGRAMS];
+    for ( std::size_t program = 0; program < PROGRAMS; ++program )
+    {
+        // Objects whose program is still building are skipped
+        programIds[program] = pipeline_.isReady( programs_[program] ) ? 
+                              pipeline_.getProgramID( programs_[program] ) : 0;
+        ObjectBlock& block = blocks_[program];
+        if ( programIds[program] == 0 || block.reflected )
+        {
+            continue;
+        }
+        // Ask the program where the members went, once it has linked
+        const UniformBlockLayout object( programIds[program], "Object" );
+        if ( object.getDataSize() > OBJECT_BLOCK_SIZE )
+        {
+            throw std::logic_error( "ERROR::SCENE::OBJECT_BLOCK_TOO_LARGE\n" );
+        }
+        object.bind( programIds[program], OBJECT_UNIFORM_BINDING );
+        block.swayOffset = object.getOffset( "sway" );
+        block.colorOffset = object.getOffset( "color" );
+        for ( const std::string& name : listUniformBlocks( programIds[program] ) )
+        {
+            if ( name == "Frame" )
+            {
+                UniformBlockLayout( programIds[program], name ).bind( 
+                                    programIds[program], FRAME_UNIFORM_BINDING );
+            }
+        }
+        block.reflected = true;
+    }
+
+    // One range holds the blocks of all objects, each at an aligned offset
+    const GLsizeiptr stride = uniforms_.alignSize( OBJECT_BLOCK_SIZE );
+    const UniformAllocation blocks = uniforms_.allocate( 
+                            stride * static_cast<GLsizeiptr>( objects_.size() ) );
+    const GLuint uniformBuffer = uniforms_.getBufferId();
+    const float swing = 0.1f / side_;
+
+    // Every job moves its objects and fills its own list of draw items
+    const float time = 0.002f * frame_;
+    jobs_.parallelFor( lists_.size(), 1, [&]( std::size_t first, std::size_t last ) 
+    {
+        for ( std::size_t list = first; list < last; ++list )
+        {
+            std::vector<DrawItem>& items = lists_[list];
+            items.clear();
+            const std::size_t end = std::min( ( list + 1 ) * GRAIN, objects_.size() );
+            for ( std::size_t i = list * GRAIN; i < end; ++i )
+            {
+                Object& object = objects_[i];
+                const float depth = object.baseDepth + time;
+                object.depth = depth - std::floor( depth );
+                if ( programIds[object.program] == 0 )
+                {
+                    continue;
+                }
+                // Nearer objects are brighter
+                const ObjectBlock& layout = blocks_[object.program];
+                std::uint8_t* block = blocks.data + stride * static_cast<GLsizeiptr>( i );
+                const float brightness = 1.0f - 0.6f * object.depth;
+                writeVec4( block, layout.swayOffset, swing, swing * 0.5f, 
+                           2.0f + object.baseDepth, object.baseDepth * 6.2832f );
+                writeVec4( block, layout.colorOffset, brightness, brightness, 
+                           brightness, 1.0f );
+                const BufferSetup& mesh = *meshes_[i];
+                DrawItem item;
+                item.uniformBuffer = uniformBuffer;
+                item.uniformOffset = blocks.offset + stride * static_cast<GLintptr>( i );
+                item.uniformSize = OBJECT_BLOCK_SIZE;
+                item.program = programIds[object.program];
+                item.vao = mesh.getVAOId();
+                item.first = mesh.getFirstVertex();
+                item.count = mesh.getVertexCount();
+                item.key = makeSortKey( static_cast<std::uint32_t>( object.program ), 
+                                        item.vao, 0, object.depth );
+                items.push_back( item );
+            }
+        }
+    } );
+
+    // Hand the prepared lists to the queue in object order
+    for ( const std::vector<DrawItem>& items : lists_ )
+    {
+        queue.submit( items );
+    }
+}
+
+void ObjectsScene::report(const FrameProfiler& profiler) const
+{
+    (void)profiler;
+    if ( !arena_ )
+    {
+        std::printf( "Objects: %zu meshes with their own buffers\n", meshes_.size() );
+        return;
+    }
+    const BufferArenaStats stats = arena_->getStats();
+    std::printf( "Buffer arena: %zu meshes, %zu of %zu vertices used, "
+                 "fragmentation %.2f\n", stats.allocations, stats.usedVertices,
+                 stats.vertexCapacity, stats.fragmentation );
+    std::printf( "Buffer arena: %zu grows, %zu defragmentations, %zu bytes moved\n",
+                 stats.grows, stats.defragmentations, stats.bytesMoved );
+}
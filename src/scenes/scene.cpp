@@ -0,0 +1,62 @@
+#include "scene.hpp"
+
+std::unique_ptr<Scene> createScene(const RenderSettings& settings, 
+                                   ShaderPipeline& pipeline, JobSystem& jobs,
+                                   AssetLoader& loader, UniformRing& uniforms)
+{
+    if ( settings.scene == "triangle" )
+    {
+        return std::make_unique<TriangleScene>( pipeline );
+    }
+    if ( settings.scene == "instanced" )
+    {
+        return std::make_unique<InstancedScene>( settings.instances, 
+                                                 settings.sweep, pipeline );
+    }
+    if ( settings.scene == "streaming" )
+    {
+        return std::make_unique<StreamingScene>( settings.instances, jobs, 
+                                                 pipeline );
+    }
+    if ( settings.scene == "objects" )
+    {
+        return std::make_unique<ObjectsScene>( settings.instances, 
+                                                settings.useArena, jobs, 
+                                                uniforms, pipeline );
+    }
+    if ( settings.scene == "batch" )
+    {
+        return std::make_unique<BatchScene>( settings.instances, settings.batch,
+                                             pipeline );
+    }
+    if ( settings.scene == "mesh" )
+    {
+        return std::make_unique<MeshScene>( settings.instances, 
+                                            settings.optimizeMeshes, 
+                                            settings.vertexFormat, pipeline );
+    }
+    if ( settings.scene == "culling" )
+    {
+        return std::make_unique<CullingScene>( settings.instances, settings.cull,
+                                               settings.lod, settings.cullPath, 
+                                               settings.occlusion, jobs, pipeline );
+    }
+    if ( settings.scene == "model" )
+    {
+        return std::make_unique<ModelScene>( settings.meshFile, 
+                                             settings.textureFile, 
+                                             settings.asyncLoad, loader, 
+                                             pipeline );
+    }
+    if ( settings.scene == "textured" )
+    {
+        return std::make_unique<TexturedScene>( settings.instances, 
+                                                settings.materials,
+                                                settings.textureArray, 
+                                                settings.pixelBuffers,
+                                                settings.textureUploads, 
+                                                pipeline );
+    }
+    throw std::logic_error( std::string( "ERROR::SCENE::UNKNOWN\n " ) + 
+                            settings.scene );
+}
@@ -0,0 +1,17 @@
+#include "software_scene.hpp"
+#include <stdexcept>
+#include <string>
+
+std::unique_ptr<SoftwareScene> createSoftwareScene(const RenderSettings& settings)
+{
+    if ( settings.scene == "triangle" )
+    {
+        return std::make_unique<SoftwareTriangleScene>();
+    }
+    if ( settings.scene == "terrain" )
+    {
+        return std::make_unique<SoftwareTerrainScene>( settings.instances );
+    }
+    throw std::logic_error( std::string( "ERROR::SCENE::NO_SOFTWARE_VERSION\n " ) + 
+                            settings.scene );
+}
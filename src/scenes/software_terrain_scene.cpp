@@ -0,0 +1,145 @@
+#include "software_scene.hpp"
+#include <algorithm>
+#include <cmath>
+
+/**
+* @section Helper functions
+*/
+
+static float heightAt(float x, float z)
+{
+    return 0.15f * std::sin( 5.0f * x ) * std::cos( 4.0f * z ) + 
+           0.05f * std::sin( 13.0f * x + 7.0f * z );
+}
+
+static void lookAtPerspective(const float* eye, float aspect, float* result)
+{
+    // Camera looking at the origin with y up, as a column-major matrix
+    float forward[3] = { -eye[0], -eye[1], -eye[2] };
+    const float length = std::sqrt( forward[0] * forward[0] + 
+                                    forward[1] * forward[1] + 
+                                    forward[2] * forward[2] );
+    for ( float& value : forward )
+    {
+        value /= length;
+    }
+    float side[3] = { -forward[2], 0.0f, forward[0] };
+    const float sideLength = std::sqrt( side[0] * side[0] + side[2] * side[2] );
+    side[0] /= sideLength;
+    side[2] /= sideLength;
+    const float up[3] = { side[1] * forward[2] - side[2] * forward[1],
+                          side[2] * forward[0] - side[0] * forward[2],
+                          side[0] * forward[1] - side[1] * forward[0] };
+    const float f = 1.0f / std::tan( 0.5f * 1.0472f );
+    const float near = 0.05f, far = 10.0f;
+    const float rows[3][3] = { { side[0], side[1], side[2] },
+                               { up[0], up[1], up[2] },
+                               { -forward[0], -forward[1], -forward[2] } };
+    float view[16] = {};
+    for ( int r = 0; r < 3; ++r )
+    {
+        for ( int c = 0; c < 3; ++c )
+        {
+            view[c * 4 + r] = rows[r][c];
+        }
+        view[12 + r] = -( rows[r][0] * eye[0] + rows[r][1] * eye[1] + 
+                          rows[r][2] * eye[2] );
+    }
+    view[15] = 1.0f;
+    // Projection rows applied to the view matrix
+    for ( int c = 0; c < 4; ++c )
+    {
+        const float x = view[c * 4], y = view[c * 4 + 1], z = view[c * 4 + 2], 
+                    w = view[c * 4 + 3];
+        result[c * 4 + 0] = f / aspect * x;
+        result[c * 4 + 1] = f * y;
+        result[c * 4 + 2] = ( far + near ) / ( near - far ) * z + 
+                            2.0f * far * near / ( near - far ) * w;
+        result[c * 4 + 3] = -z;
+    }
+}
+
+/**
+* @section Constructor
+*/
+
+SoftwareTerrainScene::SoftwareTerrainScene(std::size_t triangles)
+    : viewProjection_{}, angle_{ 0.0f }
+{
+    // Two triangles per grid cell
+    const std::size_t cells = std::max<std::size_t>( 
+            static_cast<std::size_t>( std::sqrt( triangles / 2.0 ) ), 1 );
+    const std::size_t side = cells + 1;
+    vertices_.reserve( side * side * 6 );
+    for ( std::size_t j = 0; j < side; ++j )
+    {
+        for ( std::size_t i = 0; i < side; ++i )
+        {
+            const float x = -1.0f + 2.0f * i / cells;
+            const float z = -1.0f + 2.0f * j / cells;
+            // Normal from the central differences of the height
+            const float e = 1e-3f;
+            const float dx = ( heightAt( x + e, z ) - heightAt( x - e, z ) ) / ( 2 * e );
+            const float dz = ( heightAt( x, z + e ) - heightAt( x, z - e ) ) / ( 2 * e );
+            const float length = std::sqrt( dx * dx + 1.0f + dz * dz );
+            vertices_.insert( vertices_.end(), { x, heightAt( x, z ), z, 
+                              -dx / length, 1.0f / length, -dz / length } );
+        }
+    }
+    indices_.reserve( cells * cells * 6 );
+    for ( std::size_t j = 0; j < cells; ++j )
+    {
+        for ( std::size_t i = 0; i < cells; ++i )
+        {
+            const std::uint32_t corner = static_cast<std::uint32_t>( j * side + i );
+            const std::uint32_t next = corner + static_cast<std::uint32_t>( side );
+            indices_.insert( indices_.end(), { corner, next, corner + 1, 
+                                               corner + 1, next, next + 1 } );
+        }
+    }
+
+    // Transform by the matrix of the frame and light with a fixed sun
+    program_.varyings = 2;
+    program_.vertex = [this]( const float* in, SoftwareVertex& out )
+    {
+        const float* m = viewProjection_;
+        for ( int r = 0; r < 4; ++r )
+        {
+            out.position[r] = m[r] * in[0] + m[4 + r] * in[1] + 
+                              m[8 + r] * in[2] + m[12 + r];
+        }
+        const float light = 0.36f * in[3] + 0.8f * in[4] + 0.48f * in[5];
+        out.varyings[0] = std::max( light, 0.0f );
+        out.varyings[1] = in[1];
+    };
+    program_.fragment = []( const float* varyings )
+    {
+        // Green lowlands, brown highlands
+        const float height = std::min( std::max( varyings[1] * 3.0f + 0.5f, 0.0f ), 1.0f );
+        const float shade = 0.25f + 0.75f * varyings[0];
+        return packColor( ( 0.2f + 0.4f * height ) * shade, 
+                          ( 0.6f - 0.2f * height ) * shade, 0.2f * shade );
+    };
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void SoftwareTerrainScene::update(std::size_t frame)
+{
+    // Orbit the camera around the terrain
+    angle_ = 0.01f * frame;
+}
+
+void SoftwareTerrainScene::draw(SoftwareRasterizer& rasterizer, 
+                                FrameProfiler& profiler)
+{
+    const float eye[3] = { 2.2f * std::cos( angle_ ), 1.2f, 2.2f * std::sin( angle_ ) };
+    lookAtPerspective( eye, static_cast<float>( rasterizer.getWidth() ) / 
+                       rasterizer.getHeight(), viewProjection_ );
+    rasterizer.draw( program_, vertices_.data(), 6, vertices_.size() / 6, 
+                     indices_.data(), indices_.size() );
+    profiler.addCounter( FrameCounter::DrawCalls, 1 );
+    profiler.addCounter( FrameCounter::Triangles, indices_.size() / 3 );
+}
@@ -0,0 +1,32 @@
+#include "software_scene.hpp"
+
+SoftwareTriangleScene::SoftwareTriangleScene()
+{
+    // Same vertices as the OpenGL triangle scene
+    vertices_ =
+    {
+        -0.5f, -0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        0.0f,  0.5f, 0.0f
+    };
+
+    // Setting drawing position on the viewport, same as input
+    program_.vertex = []( const float* in, SoftwareVertex& out )
+    {
+        out.position[0] = in[0];
+        out.position[1] = in[1];
+        out.position[2] = in[2];
+        out.position[3] = 1.0f;
+    };
+    // Orange with 100% opacity
+    const std::uint32_t color = packColor( 0.5f, 1.0f, 0.2f, 1.0f );
+    program_.fragment = [color]( const float* ) { return color; };
+}
+
+void SoftwareTriangleScene::draw(SoftwareRasterizer& rasterizer, 
+                                 FrameProfiler& profiler)
+{
+    rasterizer.draw( program_, vertices_ );
+    profiler.addCounter( FrameCounter::DrawCalls, 1 );
+    profiler.addCounter( FrameCounter::Triangles, vertices_.size() / 9 );
+}
@@ -0,0 +1,121 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/**
+* @section Constructor
+*/
+
+StreamingScene::StreamingScene(std::size_t triangles, JobSystem& jobs,
+                               ShaderPipeline& pipeline)
+    : jobs_{ jobs }, pipeline_{ pipeline }, program_{ 0 }, triangles_{ std::max<std::size_t>( triangles, 1 ) }, side_{ 1 }, 
+      frame_{ 0 }
+{
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "out vec2 position;\n"
+    "void main()\n"
+    "{\n"
+    "   position = aPos.xy;\n"
+    "   gl_Position = vec4(aPos, 1.0);\n" 
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    "in vec2 position;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    // Shade by screen position, so the moving geometry is easy to follow
+    "{\n"
+    "   FragColor = vec4(0.5f + 0.5f * position, 0.6f, 1.0f);\n"
+    "}\n\0";
+
+    // Start building the program; drawing waits until it is ready
+    program_ = pipeline_.submit(vertexShaderSource, fragmentShaderSource);
+
+    // Each frame writes three vertices of three floats per triangle
+    const GLsizeiptr frameBytes = static_cast<GLsizeiptr>( 
+                                        triangles_ * 9 * sizeof(float) );
+    stream_ = std::make_unique<StreamingBuffer>( GL_ARRAY_BUFFER, frameBytes );
+    buffer_ = std::make_unique<BufferSetup>( *stream_ );
+
+    side_ = static_cast<std::size_t>( 
+                std::ceil( std::sqrt( static_cast<double>( triangles_ ) ) ) );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void StreamingScene::update(std::size_t frame)
+{
+    frame_ = frame;
+}
+
+void StreamingScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    if ( !pipeline_.isReady( program_ ) )
+    {
+        return;
+    }
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>( 
+                                        triangles_ * 9 * sizeof(float) );
+    float* vertices = static_cast<float*>( stream_->map( bytes ) );
+
+    // Spin every triangle around the center of its grid cell, each job 
+    // writing its own range of the mapped segment
+    const float cell = 2.0f / side_;
+    const float radius = cell * 0.45f;
+    const float step = 2.0943951f;
+    const std::size_t side = side_;
+    const std::size_t frame = frame_;
+    jobs_.parallelFor( triangles_, GRAIN, [=]( std::size_t begin, std::size_t end ) 
+    {
+        float* out = vertices + begin * 9;
+        for ( std::size_t i = begin; i < end; ++i )
+        {
+            const float centerX = -1.0f + cell * ( i % side + 0.5f );
+            const float centerY = -1.0f + cell * ( i / side + 0.5f );
+            const float angle = 0.03f * frame + 0.1f * i;
+            for ( int corner = 0; corner < 3; ++corner )
+            {
+                *out++ = centerX + radius * std::cos( angle + corner * step );
+                *out++ = centerY + radius * std::sin( angle + corner * step );
+                *out++ = 0.0f;
+            }
+        }
+    } );
+
+    // Draw exactly the segment that was just written
+    const GLintptr offset = stream_->commit( bytes );
+    profiler.addCounter( FrameCounter::BytesStreamed, 
+                         static_cast<std::uint64_t>( bytes ) );
+    DrawItem item;
+    item.program = pipeline_.getProgramID( program_ );
+    item.vao = buffer_->getVAOId();
+    item.first = static_cast<GLint>( offset / ( 3 * sizeof(float) ) );
+    item.count = static_cast<GLsizei>( triangles_ * 3 );
+    item.key = makeSortKey( item.program, item.vao, 0, 0.0f );
+    queue.submit( item );
+}
+
+void StreamingScene::endFrame()
+{
+    // Fence the segment only after the draw that reads it was issued
+    if ( pipeline_.isReady( program_ ) )
+    {
+        stream_->endFrame();
+    }
+}
+
+void StreamingScene::report(const FrameProfiler& profiler) const
+{
+    (void)profiler;
+    std::printf( "Streaming buffer: %s mapping, %llu bytes streamed, "
+                 "%llu fence waits\n", 
+                 stream_->isPersistent() ? "persistent" : "unsynchronized",
+                 static_cast<unsigned long long>( stream_->getBytesStreamed() ),
+                 static_cast<unsigned long long>( stream_->getStallCount() ) );
+}
@@ -0,0 +1,159 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+/**
+* @section Constructor & Destructor
+*/
+
+SyntheticScene::SyntheticScene(const SyntheticParams& params,
+                               ShaderPipeline& pipeline)
+    : params_{ params }, pipeline_{ pipeline }, target_{ 0 }, frame_{ 0 }
+{
+    // Every draw needs a triangle, every program and texture switch a draw
+    params_.triangles = std::max<std::size_t>( params_.triangles, 1 );
+    params_.draws = std::min( std::max<std::size_t>( params_.draws, 1 ),
+                              params_.triangles );
+    params_.programs = std::min( std::max<std::size_t>( params_.programs, 1 ),
+                                 params_.draws );
+    params_.stateChanges = std::min( params_.stateChanges, params_.draws - 1 );
+
+    const char *vertexShaderSource =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "out vec2 texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4(aPos, 1.0);\n"
+    "   texCoord = aPos.xy * 0.5 + 0.5;\n"
+    "}\0";
+
+    // The programs only differ in their tint, which keeps the driver from
+    // sharing one binary between them
+    for ( std::size_t program = 0; program < params_.programs; ++program )
+    {
+        const std::string tint = "vec4(" + std::to_string( 0.5f + 0.5f *
+                        static_cast<float>( program ) / params_.programs ) +
+                        ", 0.8, 0.6, 1.0)";
+        const std::string fragmentShaderSource = std::string(
+                         "#version 330 core\n"
+                         "in vec2 texCoord;\n"
+                         "uniform sampler2D image;\n"
+                         "out vec4 FragColor;\n"
+                         "void main()\n"
+                         "{\n"
+                         "   FragColor = texture(image, texCoord) * " ) + tint +
+                         ";\n}\n";
+        programs_.push_back( pipeline_.submit( vertexShaderSource,
+                                               fragmentShaderSource.c_str() ) );
+    }
+
+    // Small triangles, one per cell of a grid over the view
+    const std::size_t side = static_cast<std::size_t>(
+                std::ceil( std::sqrt( static_cast<double>( params_.triangles ) ) ) );
+    const float cell = 2.0f / side;
+    std::vector<float> vertices;
+    vertices.reserve( params_.triangles * 9 );
+    for ( std::size_t i = 0; i < params_.triangles; ++i )
+    {
+        const float left = -1.0f + cell * ( i % side );
+        const float bottom = -1.0f + cell * ( i / side );
+        vertices.insert( vertices.end(), {
+            left + cell * 0.1f, bottom + cell * 0.1f, 0.0f,
+            left + cell * 0.9f, bottom + cell * 0.1f, 0.0f,
+            left + cell * 0.5f, bottom + cell * 0.9f, 0.0f } );
+    }
+    buffer_ = std::make_unique<BufferSetup>( vertices );
+
+    // Two textures to switch between, which differ in a single texel
+    std::vector<std::uint8_t> pixels( 4 * 4 * 4, 255 );
+    for ( int texture = 0; texture < 2; ++texture )
+    {
+        pixels[0] = static_cast<std::uint8_t>( 128 * texture );
+        textures_[texture] = std::make_unique<Texture>( GL_TEXTURE_2D, 4, 4 );
+        textures_[texture]->upload( 0, pixels.data() );
+        textures_[texture]->generateMipmaps();
+    }
+
+    if ( params_.uploadBytes == 0 )
+    {
+        return;
+    }
+    // Throws logic error if the ring cannot be mapped
+    const GLsizeiptr size = static_cast<GLsizeiptr>( params_.uploadBytes );
+    staging_ = std::make_unique<StreamingBuffer>( GL_COPY_READ_BUFFER, size );
+    glGenBuffers( 1, &target_ );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, target_ );
+    glBufferData( GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_COPY );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+SyntheticScene::~SyntheticScene()
+{
+    glDeleteBuffers( 1, &target_ );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+void SyntheticScene::update(std::size_t frame)
+{
+    frame_ = frame;
+}
+
+void SyntheticScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    if ( staging_ )
+    {
+        // Write every byte, as a real upload would, then let the GPU copy it
+        const GLsizeiptr size = static_cast<GLsizeiptr>( params_.uploadBytes );
+        std::memset( staging_->map( size ), static_cast<int>( frame_ & 0xff ),
+                     params_.uploadBytes );
+        const GLintptr offset = staging_->commit( size );
+        glBindBuffer( GL_COPY_READ_BUFFER, staging_->getBufferId() );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, target_ );
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0,
+                             size );
+        glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+        glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+        profiler.addCounter( FrameCounter::BytesStreamed, params_.uploadBytes );
+    }
+
+    // Draw d covers the triangles from d * triangles / draws on
+    DrawItem item;
+    item.vao = buffer_->getVAOId();
+    item.textureTarget = GL_TEXTURE_2D;
+    std::size_t drawn{ 0 };
+    for ( std::size_t draw = 0; draw < params_.draws; ++draw )
+    {
+        const std::size_t program = draw * params_.programs / params_.draws;
+        if ( !pipeline_.isReady( programs_[program] ) )
+        {
+            continue;
+        }
+        const std::size_t first = draw * params_.triangles / params_.draws;
+        const std::size_t last = ( draw + 1 ) * params_.triangles / params_.draws;
+        // Runs of draws alternate between the textures
+        const std::size_t run = draw * ( params_.stateChanges + 1 ) / params_.draws;
+        item.program = pipeline_.getProgramID( programs_[program] );
+        item.texture = textures_[run % 2]->getId();
+        item.first = static_cast<GLint>( first * 3 );
+        item.count = static_cast<GLsizei>( ( last - first ) * 3 );
+        item.key = makeSortKey( static_cast<std::uint32_t>( program ), item.vao,
+                                static_cast<std::uint32_t>( run % 2 ), 0.0f );
+        queue.submit( item );
+        drawn += last - first;
+    }
+    profiler.addCounter( FrameCounter::Triangles, drawn );
+}
+
+void SyntheticScene::endFrame()
+{
+    if ( staging_ )
+    {
+        staging_->endFrame();
+    }
+}
@@ -0,0 +1,280 @@
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+/**
+* @section Helper functions
+*/
+
+static void fillMaterial(std::vector<std::uint8_t>& pixels, std::size_t material,
+                         std::size_t frame)
+{
+    // A checkerboard in the material's color whose stripes scroll with frame
+    const GLsizei size = TexturedScene::MATERIAL_SIZE;
+    const std::uint8_t red = static_cast<std::uint8_t>( 64 + material * 53 % 192 );
+    const std::uint8_t green = static_cast<std::uint8_t>( 64 + material * 97 % 192 );
+    const std::uint8_t blue = static_cast<std::uint8_t>( 64 + material * 151 % 192 );
+    const std::size_t checker = 16 + material % 4 * 16;
+    pixels.resize( static_cast<std::size_t>( size ) * size * 4 );
+    for ( GLsizei y = 0; y < size; ++y )
+    {
+        for ( GLsizei x = 0; x < size; ++x )
+        {
+            const bool dark = ( ( x + frame ) / checker + y / checker ) % 2 == 1;
+            std::uint8_t* pixel = &pixels[( static_cast<std::size_t>( y ) * size + x ) * 4];
+            pixel[0] = dark ? red / 3 : red;
+            pixel[1] = dark ? green / 3 : green;
+            pixel[2] = dark ? blue / 3 : blue;
+            pixel[3] = 255;
+        }
+    }
+}
+
+/**
+* @section Constructor
+*/
+
+TexturedScene::TexturedScene(std::size_t quads, std::size_t materials,
+                             bool textureArray, bool pixelBuffers,
+                             std::size_t uploadsPerFrame, ShaderPipeline& pipeline)
+    : pipeline_{ pipeline }, side_{ 1 }, textureArray_{ textureArray }, frame_{ 0 }
+{
+    const char *vertexShaderSource =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "layout (location = 2) in float aLayer;\n"
+    "out vec3 texCoord;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "   texCoord = vec3(aTexCoord, aLayer);\n"
+    "}\0";
+
+    // Only the sampler type differs, the layer is ignored for 2D textures
+    const char *arrayFragmentShaderSource =
+    "#version 330 core\n"
+    "in vec3 texCoord;\n"
+    "uniform sampler2DArray image;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = texture(image, texCoord);\n"
+    "}\n\0";
+
+    const char *fragmentShaderSource =
+    "#version 330 core\n"
+    "in vec3 texCoord;\n"
+    "uniform sampler2D image;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = texture(image, texCoord.xy);\n"
+    "}\n\0";
+
+    program_ = pipeline_.submit( vertexShaderSource, textureArray_ ?
+                                 arrayFragmentShaderSource : fragmentShaderSource );
+
+    // Quads fill a grid in material order, so each material is one range
+    const std::size_t count = std::max<std::size_t>( quads, 1 );
+    const std::size_t materialCount = std::min( std::max<std::size_t>( materials, 1 ),
+                                                count );
+    side_ = static_cast<std::size_t>(
+                        std::ceil( std::sqrt( static_cast<double>( count ) ) ) );
+    const float cell = 2.0f / side_;
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    vertices.reserve( count * 4 * 5 );
+    indices.reserve( count * 6 );
+    for ( std::size_t material = 0; material <= materialCount; ++material )
+    {
+        firstQuads_.push_back( count * material / materialCount );
+    }
+    for ( std::size_t material = 0; material < materialCount; ++material )
+    {
+        for ( std::size_t quad = firstQuads_[material];
+              quad < firstQuads_[material + 1]; ++quad )
+        {
+            const float left = -1.0f + cell * ( quad % side_ ) + cell * 0.05f;
+            const float bottom = -1.0f + cell * ( quad / side_ ) + cell * 0.05f;
+            const float size = cell * 0.9f;
+            const float layer = static_cast<float>( material );
+            const GLuint base = static_cast<GLuint>( quad * 4 );
+            vertices.insert( vertices.end(), {
+                left, bottom, 0.0f, 0.0f, layer,
+                left + size, bottom, 1.0f, 0.0f, layer,
+                left + size, bottom + size, 1.0f, 1.0f, layer,
+                left, bottom + size, 0.0f, 1.0f, layer } );
+            indices.insert( indices.end(), { base, base + 1, base + 2,
+                                             base, base + 2, base + 3 } );
+        }
+    }
+    VertexLayout layout;
+    layout.add( 0, 2, AttributeFormat::Float32 )
+          .add( 1, 2, AttributeFormat::Float32 )
+          .add( 2, 1, AttributeFormat::Float32 );
+    std::vector<std::uint8_t> stream( vertices.size() * sizeof( float ) );
+    std::memcpy( stream.data(), vertices.data(), stream.size() );
+    buffer_ = std::make_unique<BufferSetup>( layout,
+                        std::vector<std::vector<std::uint8_t>>{ stream }, indices );
+
+    // Immutable storage for every level, filled once from client memory
+    if ( textureArray_ )
+    {
+        textures_.push_back( std::make_unique<Texture>( GL_TEXTURE_2D_ARRAY,
+                        MATERIAL_SIZE, MATERIAL_SIZE,
+                        static_cast<GLsizei>( materialCount ) ) );
+    }
+    else
+    {
+        for ( std::size_t material = 0; material < materialCount; ++material )
+        {
+            textures_.push_back( std::make_unique<Texture>( GL_TEXTURE_2D,
+                                            MATERIAL_SIZE, MATERIAL_SIZE ) );
+        }
+    }
+    std::vector<std::uint8_t> pixels;
+    for ( std::size_t material = 0; material < materialCount; ++material )
+    {
+        fillMaterial( pixels, material, 0 );
+        Texture& texture = *textures_[textureArray_ ? 0 : material];
+        texture.upload( textureArray_ ? static_cast<GLint>( material ) : 0,
+                        pixels.data() );
+    }
+    for ( std::unique_ptr<Texture>& texture : textures_ )
+    {
+        texture->generateMipmaps();
+    }
+
+    // A segment of the ring holds the layers of one frame
+    staging_.resize( std::min( uploadsPerFrame, materialCount ) );
+    const GLsizeiptr layerSize = static_cast<GLsizeiptr>( textures_[0]->getMipChainSize() );
+    streamer_ = std::make_unique<TextureStreamer>(
+            layerSize * static_cast<GLsizeiptr>( std::max<std::size_t>( staging_.size(), 1 ) ),
+            pixelBuffers );
+}
+
+/**
+* @section Rendering Member functions
+*/
+
+std::size_t TexturedScene::getUploadedMaterial(std::size_t frame, 
+                                               std::size_t upload) const
+{
+    // Walk through the materials, a few of them every frame
+    return ( frame * staging_.size() + upload ) % ( firstQuads_.size() - 1 );
+}
+
+void TexturedScene::update(std::size_t frame)
+{
+    frame_ = frame;
+    for ( std::size_t i = 0; i < staging_.size(); ++i )
+    {
+        const std::size_t material = getUploadedMaterial( frame, i );
+        fillMaterial( staging_[i], material, frame );
+        Texture& texture = *textures_[textureArray_ ? 0 : material];
+        streamer_->queue( texture, textureArray_ ? static_cast<GLint>( material ) : 0,
+                          staging_[i].data() );
+    }
+}
+
+bool TexturedScene::getDamage(std::size_t frame, DamageRect& damage) const
+{
+    if ( staging_.empty() )
+    {
+        return false;
+    }
+    // Rows of the grid that hold a quad of an uploaded material
+    const float cell = 2.0f / side_;
+    std::size_t firstRow = side_;
+    std::size_t lastRow{ 0 };
+    bool wholeRows{ false };
+    std::size_t firstColumn = side_;
+    std::size_t lastColumn{ 0 };
+    for ( std::size_t i = 0; i < staging_.size(); ++i )
+    {
+        const std::size_t material = getUploadedMaterial( frame, i );
+        const std::size_t first = firstQuads_[material];
+        const std::size_t last = firstQuads_[material + 1] - 1;
+        firstRow = std::min( firstRow, first / side_ );
+        lastRow = std::max( lastRow, last / side_ );
+        wholeRows = wholeRows || first / side_ != last / side_;
+        firstColumn = std::min( firstColumn, first % side_ );
+        lastColumn = std::max( lastColumn, last % side_ );
+    }
+    if ( wholeRows )
+    {
+        firstColumn = 0;
+        lastColumn = side_ - 1;
+    }
+    damage.left = -1.0f + cell * firstColumn;
+    damage.right = -1.0f + cell * ( lastColumn + 1 );
+    damage.bottom = -1.0f + cell * firstRow;
+    damage.top = -1.0f + cell * ( lastRow + 1 );
+    return true;
+}
+
+void TexturedScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    const std::uint64_t streamed = streamer_->getStats().bytes;
+    streamer_->flush();
+    profiler.addCounter( FrameCounter::BytesStreamed,
+                         streamer_->getStats().bytes - streamed );
+    if ( !pipeline_.isReady( program_ ) )
+    {
+        return;
+    }
+    DrawItem item;
+    item.program = pipeline_.getProgramID( program_ );
+    item.vao = buffer_->getVAOId();
+    item.indexType = GL_UNSIGNED_INT;
+    // One draw per material; only their textures differ
+    for ( std::size_t material = 0; material + 1 < firstQuads_.size(); ++material )
+    {
+        const Texture& texture = *textures_[textureArray_ ? 0 : material];
+        item.texture = texture.getId();
+        item.textureTarget = texture.getTarget();
+        item.count = static_cast<GLsizei>(
+                ( firstQuads_[material + 1] - firstQuads_[material] ) * 6 );
+        item.indexOffset = static_cast<GLintptr>(
+                firstQuads_[material] * 6 * sizeof( GLuint ) );
+        item.key = makeSortKey( item.program, item.vao, item.texture, 0.0f );
+        queue.submit( item );
+    }
+    profiler.addCounter( FrameCounter::Triangles, ( firstQuads_.back() ) * 2 );
+}
+
+void TexturedScene::endFrame()
+{
+    streamer_->endFrame();
+}
+
+void TexturedScene::report(const FrameProfiler& profiler) const
+{
+    const Texture& texture = *textures_[0];
+    const std::size_t frames = std::max<std::size_t>( profiler.getFrameCount(), 1 );
+    std::printf( "Textures: %zu materials of %dx%d in %s, %d mip levels, %s storage, "
+                 "%.1f texture binds per frame\n", firstQuads_.size() - 1,
+                 texture.getWidth(), texture.getHeight(),
+                 textureArray_ ? "one 2D array texture" : "2D textures of their own",
+                 texture.getLevelCount(), texture.isImmutable() ? "immutable" : "mutable",
+                 static_cast<double>( profiler.getCounterTotal(
+                                            FrameCounter::TextureBinds ) ) / frames );
+    // Submit time is the CPU side; the copy itself overlaps later frames
+    const TextureStreamerStats stats = streamer_->getStats();
+    const double megabytes = stats.bytes / ( 1024.0 * 1024.0 );
+    const char* path = "client memory";
+    if ( streamer_->usesPixelBuffers() )
+    {
+        path = streamer_->isPersistent() ? "a persistently mapped pixel buffer ring"
+                                         : "a pixel buffer ring";
+    }
+    std::printf( "Texture uploads: %llu layers, %.1f MiB from %s, submitted in "
+                 "%.3f ms per frame (%.1f MiB/s), %llu stalls\n",
+                 static_cast<unsigned long long>( stats.layers ), megabytes, path,
+                 stats.submitMs / frames,
+                 stats.submitMs > 0.0 ? megabytes / ( stats.submitMs * 1e-3 ) : 0.0,
+                 static_cast<unsigned long long>( stats.stalls ) );
+}
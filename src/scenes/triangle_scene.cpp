@@ -0,0 +1,55 @@
+#include "scene.hpp"
+
+TriangleScene::TriangleScene(ShaderPipeline& pipeline)
+    : pipeline_{ pipeline }
+{
+     // Defining GLSL code for the vertex shader
+    const char *vertexShaderSource = 
+    "#version 330 core\n"
+    // Start location is 0, out variable aPos is triangle position
+    "layout (location = 0) in vec3 aPos;\n"
+    "void main()\n"
+    // Setting drawing position on the viewport, same as input.
+    "{\n"
+    "   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n" 
+    "}\0";
+
+    const char *fragmentShaderSource = 
+    "#version 330 core\n"
+    // Define out variable as FragColor.
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    // Define value of FragColor as orange with 100% opacity.
+    "{\n"
+    "   FragColor = vec4(0.5f, 1.0f, 0.2f, 1.0f);\n"
+    "}\n\0";
+
+    std::vector<float> defaultTriangleVertices_ =
+    {
+        -0.5f, -0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        0.0f,  0.5f, 0.0f
+    };
+
+    // Start building the program; drawing waits until it is ready
+    program_ = pipeline_.submit(vertexShaderSource, fragmentShaderSource);
+
+    // Move triangle data to the GPU buffer
+    buffer_ = std::make_unique<BufferSetup>(defaultTriangleVertices_);
+}
+
+void TriangleScene::draw(RenderQueue& queue, FrameProfiler& profiler)
+{
+    (void)profiler;
+    if (!pipeline_.isReady(program_))
+    {
+        return;
+    }
+    // Drawing logic for a triangle
+    DrawItem item;
+    item.program = pipeline_.getProgramID(program_);
+    item.vao = buffer_->getVAOId();
+    item.count = buffer_->getVertexCount();
+    item.key = makeSortKey(item.program, item.vao, 0, 0.0f);
+    queue.submit(item);
+}
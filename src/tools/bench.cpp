@@ -0,0 +1,195 @@
+/**
+ * @file bench.cpp
+ * @brief Headless benchmark of synthetic scenes.
+ *
+ * Runs every case of getBenchSuite, or those matching --filter, on a
+ * windowless EGL context and writes the results as JSON. With --baseline
+ * the results are compared against an earlier results file, and the
+ * program exits with a failure status if a metric regressed by more than
+ * the threshold, so a script can stop on it.
+ *
+ * Usage:
+ * @code
+ * hello_triangle_bench --out before.json
+ * hello_triangle_bench --out after.json --baseline before.json --threshold 5
+ * @endcode
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "benchmark.hpp"
+#include "headless.hpp"
+
+/**
+* @section Helper functions
+*/
+
+static void printUsage(const char* program)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --out <file>        JSON file of the results (bench_results.json)\n"
+        "  --baseline <file>   compare with the results of an earlier run and\n"
+        "                      fail if a metric regressed\n"
+        "  --threshold <pct>   change that counts as a regression (10)\n"
+        "  --warmup <n>        frames run before measuring (30)\n"
+        "  --frames <n>        frames measured per case (200)\n"
+        "  --width <pixels>    width of the framebuffer (640)\n"
+        "  --height <pixels>   height of the framebuffer (480)\n"
+        "  --filter <text>     only run cases whose name contains text\n"
+        "  --list              print the names of the cases and exit\n"
+        "  --help              show this text\n", program );
+}
+
+static bool readNumber(const char* text, double& value)
+{
+    char* end{ nullptr };
+    value = std::strtod( text, &end );
+    return end != text && *end == '\0' && value >= 0.0;
+}
+
+static bool parseBenchArguments(int argc, char** argv, BenchOptions& options)
+{
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string option{ argv[i] };
+        if ( option == "--list" )
+        {
+            options.list = true;
+            continue;
+        }
+        if ( option == "--help" || i + 1 >= argc )
+        {
+            printUsage( argv[0] );
+            return false;
+        }
+        const char* value = argv[++i];
+        double number{ 0.0 };
+        const bool isNumber = readNumber( value, number );
+        if ( option == "--out" )
+        {
+            options.output = value;
+        }
+        else if ( option == "--baseline" )
+        {
+            options.baseline = value;
+        }
+        else if ( option == "--filter" )
+        {
+            options.filter = value;
+        }
+        else if ( option == "--threshold" && isNumber )
+        {
+            options.threshold = number;
+        }
+        else if ( option == "--warmup" && isNumber )
+        {
+            options.warmupFrames = static_cast<std::size_t>( number );
+        }
+        else if ( option == "--frames" && isNumber && number >= 1.0 )
+        {
+            options.measuredFrames = static_cast<std::size_t>( number );
+        }
+        else if ( option == "--width" && isNumber && number >= 1.0 )
+        {
+            options.width = static_cast<int>( number );
+        }
+        else if ( option == "--height" && isNumber && number >= 1.0 )
+        {
+            options.height = static_cast<int>( number );
+        }
+        else
+        {
+            std::printf( "Invalid option %s %s\n", option.c_str(), value );
+            printUsage( argv[0] );
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+* @section main
+*/
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if ( !parseBenchArguments( argc, argv, options ) )
+    {
+        return EXIT_FAILURE;
+    }
+    std::vector<BenchCase> suite;
+    for ( const BenchCase& benchCase : getBenchSuite() )
+    {
+        if ( benchCase.name.find( options.filter ) != std::string::npos )
+        {
+            suite.push_back( benchCase );
+        }
+    }
+    if ( options.list )
+    {
+        for ( const BenchCase& benchCase : suite )
+        {
+            std::printf( "%s\n", benchCase.name.c_str() );
+        }
+        return 0;
+    }
+    // Read the baseline first, a typo should not cost a whole run
+    BenchFile baseline;
+    if ( !options.baseline.empty() && !readBenchResults( options.baseline, baseline ) )
+    {
+        std::printf( "No benchmark results in %s\n", options.baseline.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    HeadlessContext context;
+    if ( !context.createContext() ||
+         !gladLoadGLLoader( ( GLADloadproc ) HeadlessContext::getProcAddress ) ||
+         !context.createFramebuffer( options.width, options.height ) )
+    {
+        std::printf( "Creating the headless OpenGL context failed\n" );
+        return EXIT_FAILURE;
+    }
+    std::printf( "Renderer: %s, %dx%d, %zu warm-up and %zu measured frames\n",
+                 reinterpret_cast<const char*>( glGetString( GL_RENDERER ) ),
+                 options.width, options.height, options.warmupFrames,
+                 options.measuredFrames );
+
+    std::vector<BenchResult> results;
+    try
+    {
+        for ( const BenchCase& benchCase : suite )
+        {
+            results.push_back( runBenchCase( benchCase, options ) );
+            const BenchResult& result = results.back();
+            std::printf( "%-24s CPU ms p50 %8.3f p95 %8.3f  GPU ms p50 %8.3f  "
+                         "%9.3f Mdraws/s %9.3f Mtriangles/s %9.1f MiB/s\n",
+                         benchCase.name.c_str(), result.cpu.p50, result.cpu.p95,
+                         result.gpu.p50, result.draws / result.seconds * 1e-6,
+                         result.triangles / result.seconds * 1e-6,
+                         result.bytesUploaded / result.seconds / ( 1024.0 * 1024.0 ) );
+        }
+    }
+    catch( const std::logic_error& except )
+    {
+        std::printf( "%s", except.what() );
+        return EXIT_FAILURE;
+    }
+    if ( !writeBenchResults( options.output, options, results ) )
+    {
+        std::printf( "Writing %s failed\n", options.output.c_str() );
+        return EXIT_FAILURE;
+    }
+    std::printf( "Results written to %s\n", options.output.c_str() );
+    if ( options.baseline.empty() )
+    {
+        return 0;
+    }
+    const std::size_t regressions = compareBenchResults( baseline, results,
+                                                         options.threshold );
+    std::printf( "%zu regressions beyond %.1f%% against %s\n", regressions,
+                 options.threshold, options.baseline.c_str() );
+    return regressions > 0 ? EXIT_FAILURE : 0;
+}
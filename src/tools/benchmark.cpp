@@ -0,0 +1,422 @@
+#include "benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+
+/**
+* @section Suite
+*/
+
+std::vector<BenchCase> getBenchSuite()
+{
+    std::vector<BenchCase> suite;
+    // Vertex and fill work of one draw
+    for ( std::size_t triangles : { 1000, 100000, 1000000 } )
+    {
+        SyntheticParams params;
+        params.triangles = triangles;
+        suite.push_back( { "triangles_" + std::to_string( triangles ), params } );
+    }
+    // Cost per draw call, one triangle each
+    for ( std::size_t draws : { 100, 1000, 10000 } )
+    {
+        SyntheticParams params;
+        params.triangles = draws;
+        params.draws = draws;
+        suite.push_back( { "draws_" + std::to_string( draws ), params } );
+    }
+    // Program switches and the cache pressure of many programs
+    for ( std::size_t programs : { 1, 16, 64 } )
+    {
+        SyntheticParams params;
+        params.triangles = 1024;
+        params.draws = 1024;
+        params.programs = programs;
+        suite.push_back( { "programs_" + std::to_string( programs ), params } );
+    }
+    // Texture binds between draws that are otherwise the same
+    for ( std::size_t changes : { 0, 256, 1023 } )
+    {
+        SyntheticParams params;
+        params.triangles = 1024;
+        params.draws = 1024;
+        params.stateChanges = changes;
+        suite.push_back( { "state_changes_" + std::to_string( changes ), params } );
+    }
+    // Bytes written and copied to device memory every frame
+    for ( std::size_t bytes : { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 } )
+    {
+        SyntheticParams params;
+        params.uploadBytes = bytes;
+        suite.push_back( { "upload_" + std::to_string( bytes ), params } );
+    }
+    return suite;
+}
+
+/**
+* @section Running
+*/
+
+BenchResult runBenchCase(const BenchCase& benchCase, const BenchOptions& options)
+{
+    using Clock = std::chrono::steady_clock;
+    BenchResult result;
+    result.benchCase = benchCase;
+
+    // Measure drawing, not building
+    ShaderPipeline pipeline( nullptr );
+    SyntheticScene scene( benchCase.params, pipeline );
+    pipeline.finish();
+    pipeline.poll();
+    result.benchCase.params = scene.getParams();
+    glFinish();
+
+    RenderQueue queue;
+    GLStateCache state;
+    const std::size_t frames = options.warmupFrames + options.measuredFrames;
+    FrameProfiler profiler( frames, true );
+    glEnable( GL_DEPTH_TEST );
+    glDepthFunc( GL_LEQUAL );
+    Clock::time_point start = Clock::now();
+    for ( std::size_t frame = 0; frame < frames; ++frame )
+    {
+        // Warm-up frames fill caches and queues, the clock starts after them
+        if ( frame == options.warmupFrames )
+        {
+            glFinish();
+            start = Clock::now();
+        }
+        profiler.beginFrame();
+        {
+            ProfileScope scope( profiler, FramePhase::Clear );
+            glClearColor( 0.2f, 0.3f, 0.3f, 1.0f );
+            glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        }
+        {
+            ProfileScope scope( profiler, FramePhase::Draw );
+            scene.update( frame );
+            scene.draw( queue, profiler );
+            // Not sorted, the scene submits in the order it wants to measure
+            state.invalidate();
+            state.resetCounters();
+            profiler.addCounter( FrameCounter::DrawCalls, queue.flush( state ) );
+            scene.endFrame();
+            profiler.addCounter( FrameCounter::BindsIssued, state.getBindsIssued() );
+        }
+        {
+            ProfileScope scope( profiler, FramePhase::Swap );
+            glFlush();
+        }
+        profiler.endFrame();
+    }
+    glFinish();
+    result.seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+    profiler.collect();
+
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    for ( const FrameSample& sample : profiler.getSamples() )
+    {
+        if ( sample.frame < options.warmupFrames )
+        {
+            continue;
+        }
+        cpuTimes.push_back( sample.cpuFrame );
+        if ( sample.gpuValid )
+        {
+            gpuTimes.push_back( sample.gpuFrame );
+        }
+        const auto counter = [&]( FrameCounter name )
+        {
+            return sample.counters[static_cast<std::size_t>( name )];
+        };
+        result.draws += counter( FrameCounter::DrawCalls );
+        result.triangles += counter( FrameCounter::Triangles );
+        result.bytesUploaded += counter( FrameCounter::BytesStreamed );
+        result.bindsIssued += counter( FrameCounter::BindsIssued );
+    }
+    result.cpu = summarizeTimes( cpuTimes );
+    result.gpu = summarizeTimes( gpuTimes );
+    return result;
+}
+
+/**
+* @section Results files
+*/
+
+/**
+ * @brief Quotes a string for JSON, escaping quotes, backslashes and control
+ * characters.
+ */
+static std::string quoteJson(const std::string& text)
+{
+    std::string quoted{ "\"" };
+    for ( const char c : text )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ( static_cast<unsigned char>( c ) < 0x20 )
+        {
+            char escape[8];
+            std::snprintf( escape, sizeof( escape ), "\\u%04x", 
+                           static_cast<unsigned int>( c ) );
+            quoted += escape;
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+    return quoted + '"';
+}
+
+/**
+ * @brief Writes a metric so that it reads back as the same double: counts 
+ * as integers, everything else with all significant digits.
+ */
+static void writeNumber(std::ostream& file, double value)
+{
+    if ( !std::isfinite( value ) )
+    {
+        // JSON has no infinities
+        file << 0;
+    }
+    else if ( value == std::floor( value ) && std::fabs( value ) < 9007199254740992.0 )
+    {
+        file << static_cast<long long>( value );
+    }
+    else
+    {
+        file << std::setprecision( std::numeric_limits<double>::max_digits10 ) 
+             << value;
+    }
+}
+
+BenchMetrics getBenchMetrics(const BenchResult& result)
+{
+    const SyntheticParams& params = result.benchCase.params;
+    const double frames = static_cast<double>( std::max<std::size_t>(
+                                                    result.cpu.samples, 1 ) );
+    const double seconds = result.seconds > 0.0 ? result.seconds : 1.0;
+    BenchMetrics metrics = {
+        { "triangles", static_cast<double>( params.triangles ) },
+        { "draws", static_cast<double>( params.draws ) },
+        { "programs", static_cast<double>( params.programs ) },
+        { "state_changes", static_cast<double>( params.stateChanges ) },
+        { "upload_bytes", static_cast<double>( params.uploadBytes ) },
+        { "frames", static_cast<double>( result.cpu.samples ) },
+        { "cpu_p50_ms", result.cpu.p50 },
+        { "cpu_p95_ms", result.cpu.p95 },
+        { "cpu_p99_ms", result.cpu.p99 },
+        { "cpu_max_ms", result.cpu.max },
+        { "gpu_p50_ms", result.gpu.p50 },
+        { "gpu_p95_ms", result.gpu.p95 },
+        { "gpu_p99_ms", result.gpu.p99 },
+        { "gpu_max_ms", result.gpu.max },
+        { "frames_per_second", result.cpu.samples / seconds },
+        { "draws_per_second", result.draws / seconds },
+        { "triangles_per_second", result.triangles / seconds },
+        { "bytes_uploaded", static_cast<double>( result.bytesUploaded ) },
+        { "binds_per_frame", result.bindsIssued / frames } };
+    return metrics;
+}
+
+bool writeBenchResults(const std::string& path, const BenchOptions& options,
+                       const std::vector<BenchResult>& results)
+{
+    std::ofstream file( path );
+    if ( !file )
+    {
+        return false;
+    }
+    const char* renderer = reinterpret_cast<const char*>(
+                                    glGetString( GL_RENDERER ) );
+    file << "{\n  \"renderer\": " << quoteJson( renderer ? renderer : "unknown" )
+         << ",\n  \"width\": " << options.width << ",\n  \"height\": "
+         << options.height << ",\n  \"warmup_frames\": " << options.warmupFrames
+         << ",\n  \"measured_frames\": " << options.measuredFrames
+         << ",\n  \"cases\": [";
+    for ( std::size_t i = 0; i < results.size(); ++i )
+    {
+        file << ( i ? ",\n" : "\n" ) << "    { \"name\": "
+             << quoteJson( results[i].benchCase.name );
+        for ( const std::pair<std::string, double>& metric :
+                                            getBenchMetrics( results[i] ) )
+        {
+            file << ", " << quoteJson( metric.first ) << ": ";
+            writeNumber( file, metric.second );
+        }
+        file << " }";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>( file );
+}
+
+bool readBenchResults(const std::string& path, BenchFile& file)
+{
+    std::ifstream input( path );
+    if ( !input )
+    {
+        return false;
+    }
+    const std::string text{ std::istreambuf_iterator<char>( input ),
+                            std::istreambuf_iterator<char>() };
+    std::string key;
+    std::size_t i{ 0 };
+    while ( i < text.size() )
+    {
+        if ( text[i] == '"' )
+        {
+            // Unquote up to the first quote that is not escaped
+            std::string value;
+            std::size_t end = i + 1;
+            for ( ; end < text.size() && text[end] != '"'; ++end )
+            {
+                if ( text[end] != '\\' || end + 1 >= text.size() )
+                {
+                    value += text[end];
+                }
+                else if ( text[++end] == 'u' && end + 4 < text.size() )
+                {
+                    // Only control characters are written as \u escapes
+                    value += static_cast<char>( std::strtol( 
+                                    text.substr( end + 1, 4 ).c_str(), nullptr, 16 ) );
+                    end += 4;
+                }
+                else
+                {
+                    const char escaped = text[end];
+                    value += escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped;
+                }
+            }
+            if ( end >= text.size() )
+            {
+                return false;
+            }
+            i = text.find_first_not_of( " \t\r\n", end + 1 );
+            if ( i != std::string::npos && text[i] == ':' )
+            {
+                key = value;
+            }
+            else if ( key == "name" )
+            {
+                file.cases.push_back( { value, {} } );
+            }
+            else if ( key == "renderer" )
+            {
+                file.renderer = value;
+            }
+            continue;
+        }
+        if ( text[i] == '-' || ( text[i] >= '0' && text[i] <= '9' ) )
+        {
+            char* end{ nullptr };
+            const double value = std::strtod( text.c_str() + i, &end );
+            i = static_cast<std::size_t>( end - text.c_str() );
+            if ( !file.cases.empty() )
+            {
+                file.cases.back().second.push_back( { key, value } );
+            }
+            continue;
+        }
+        ++i;
+    }
+    return !file.cases.empty();
+}
+
+/**
+* @section Comparison
+*/
+
+/**
+ * @struct BenchCheck
+ * @brief A metric compared against the baseline.
+ */
+struct BenchCheck
+{
+    const char* metric;
+    bool higherIsBetter;
+};
+
+static const BenchCheck BENCH_CHECKS[] = {
+    { "cpu_p50_ms", false },
+    { "cpu_p95_ms", false },
+    { "gpu_p50_ms", false },
+    { "draws_per_second", true },
+    { "triangles_per_second", true } };
+
+static bool findMetric(const BenchMetrics& metrics, const std::string& name,
+                       double& value)
+{
+    for ( const std::pair<std::string, double>& metric : metrics )
+    {
+        if ( metric.first == name )
+        {
+            value = metric.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t compareBenchResults(const BenchFile& baseline,
+                                const std::vector<BenchResult>& results,
+                                double threshold)
+{
+    const char* renderer = reinterpret_cast<const char*>(
+                                    glGetString( GL_RENDERER ) );
+    if ( renderer && !baseline.renderer.empty() && baseline.renderer != renderer )
+    {
+        std::printf( "Warning: the baseline was measured on %s, this run on %s\n",
+                     baseline.renderer.c_str(), renderer );
+    }
+    std::size_t regressions{ 0 };
+    for ( const BenchResult& result : results )
+    {
+        const BenchMetrics* old{ nullptr };
+        for ( const std::pair<std::string, BenchMetrics>& entry : baseline.cases )
+        {
+            if ( entry.first == result.benchCase.name )
+            {
+                old = &entry.second;
+            }
+        }
+        if ( !old )
+        {
+            std::printf( "%-24s not in the baseline\n",
+                         result.benchCase.name.c_str() );
+            continue;
+        }
+        const BenchMetrics current = getBenchMetrics( result );
+        std::printf( "%-24s", result.benchCase.name.c_str() );
+        for ( const BenchCheck& check : BENCH_CHECKS )
+        {
+            double before{ 0.0 };
+            double after{ 0.0 };
+            // Zero is what a missing measurement looks like, e.g. GPU times
+            if ( !findMetric( *old, check.metric, before ) ||
+                 !findMetric( current, check.metric, after ) ||
+                 before <= 0.0 || after <= 0.0 )
+            {
+                continue;
+            }
+            const double change = 100.0 * ( after - before ) / before;
+            const bool regressed = check.higherIsBetter ? change < -threshold
+                                                        : change > threshold;
+            std::printf( " %s %+.1f%%%s", check.metric, change,
+                         regressed ? " REGRESSION" : "" );
+            regressions += regressed ? 1 : 0;
+        }
+        std::printf( "\n" );
+    }
+    return regressions;
+}
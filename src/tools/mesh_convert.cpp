@@ -0,0 +1,410 @@
+/**
+ * @file mesh_convert.cpp
+ * @brief Offline converter from Wavefront OBJ to the binary mesh file format.
+ *
+ * The converter reads positions, normals and texture coordinates, splits
+ * polygons into triangle fans and merges corners that use the same
+ * position, normal and texture coordinate. Meshes without normals get smooth
+ * normals averaged from their faces. The triangles are reordered for the
+ * vertex cache and the vertices for fetch locality, like processMesh does,
+ * then packed and written with writeMeshFile.
+ *
+ * Usage:
+ * @code
+ * mesh_convert input.obj output.htmesh [--format float|packed] [--no-optimize]
+ * @endcode
+ */
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mesh.hpp"
+#include "mesh_file.hpp"
+#include "vertex_layout.hpp"
+
+/**
+* @section Helper functions
+*/
+
+/**
+ * @struct ObjData
+ * @brief Attribute lists of an OBJ file and the corners of its triangles.
+ */
+struct ObjData
+{
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+
+    /**
+     * @brief Position, texture coordinate and normal index of every corner,
+     * zero based, -1 where the corner has none.
+     */
+    std::vector<long> corners;
+};
+
+static std::string readFile(const std::string& path)
+{
+    std::FILE* file = std::fopen( path.c_str(), "rb" );
+    if ( !file )
+    {
+        throw std::logic_error( "ERROR::MESH_CONVERT::OPEN_FAILED\n " + path );
+    }
+    std::string contents;
+    char buffer[1 << 16];
+    std::size_t read;
+    while ( ( read = std::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+    {
+        contents.append( buffer, read );
+    }
+    std::fclose( file );
+    return contents;
+}
+
+static const char* skipSpaces(const char* cursor)
+{
+    while ( *cursor == ' ' || *cursor == '\t' )
+    {
+        ++cursor;
+    }
+    return cursor;
+}
+
+static const char* nextLine(const char* cursor)
+{
+    while ( *cursor != '\0' && *cursor != '\n' )
+    {
+        ++cursor;
+    }
+    return *cursor == '\n' ? cursor + 1 : cursor;
+}
+
+static const char* readFloats(const char* cursor, std::size_t count,
+                              std::vector<float>& out)
+{
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        char* end = nullptr;
+        const float value = std::strtof( cursor, &end );
+        out.push_back( end != cursor ? value : 0.0f );
+        cursor = end;
+    }
+    return cursor;
+}
+
+static long resolveIndex(long index, std::size_t count)
+{
+    // OBJ indices are one based; negative ones count back from the end
+    if ( index > 0 && static_cast<std::size_t>( index ) <= count )
+    {
+        return index - 1;
+    }
+    if ( index < 0 && static_cast<std::size_t>( -index ) <= count )
+    {
+        return static_cast<long>( count ) + index;
+    }
+    return -1;
+}
+
+static ObjData parseObj(const std::string& contents)
+{
+    ObjData obj;
+    std::vector<long> polygon;
+    const char* cursor = contents.c_str();
+    while ( *cursor != '\0' )
+    {
+        cursor = skipSpaces( cursor );
+        if ( cursor[0] == 'v' && ( cursor[1] == ' ' || cursor[1] == '\t' ) )
+        {
+            readFloats( cursor + 1, 3, obj.positions );
+        }
+        else if ( cursor[0] == 'v' && cursor[1] == 'n' )
+        {
+            readFloats( cursor + 2, 3, obj.normals );
+        }
+        else if ( cursor[0] == 'v' && cursor[1] == 't' )
+        {
+            readFloats( cursor + 2, 2, obj.texCoords );
+        }
+        else if ( cursor[0] == 'f' && ( cursor[1] == ' ' || cursor[1] == '\t' ) )
+        {
+            // Corners are v, v/vt, v//vn or v/vt/vn
+            polygon.clear();
+            const char* corner = skipSpaces( cursor + 1 );
+            while ( *corner != '\0' && *corner != '\n' && *corner != '\r' )
+            {
+                char* end = nullptr;
+                long indices[3] = { 0, 0, 0 };
+                indices[0] = std::strtol( corner, &end, 10 );
+                if ( end == corner )
+                {
+                    break;
+                }
+                corner = end;
+                for ( int slot = 1; slot < 3 && *corner == '/'; ++slot )
+                {
+                    ++corner;
+                    indices[slot] = std::strtol( corner, &end, 10 );
+                    corner = end;
+                }
+                polygon.push_back( resolveIndex( indices[0], obj.positions.size() / 3 ) );
+                polygon.push_back( resolveIndex( indices[1], obj.texCoords.size() / 2 ) );
+                polygon.push_back( resolveIndex( indices[2], obj.normals.size() / 3 ) );
+                corner = skipSpaces( corner );
+            }
+            // Split the polygon into a fan of triangles
+            for ( std::size_t i = 2; i < polygon.size() / 3; ++i )
+            {
+                for ( std::size_t c : { std::size_t{ 0 }, i - 1, i } )
+                {
+                    obj.corners.insert( obj.corners.end(), polygon.begin() + c * 3,
+                                        polygon.begin() + c * 3 + 3 );
+                }
+            }
+        }
+        cursor = nextLine( cursor );
+    }
+    return obj;
+}
+
+/**
+ * @struct CornerHash
+ * @brief Hash of the three attribute indices of a corner.
+ */
+struct CornerHash
+{
+    std::size_t operator()(const std::array<long, 3>& corner) const
+    {
+        std::size_t hash = static_cast<std::size_t>( corner[0] ) * 73856093u;
+        hash ^= static_cast<std::size_t>( corner[1] ) * 19349663u;
+        hash ^= static_cast<std::size_t>( corner[2] ) * 83492791u;
+        return hash;
+    }
+};
+
+static void printUsage(const char* program)
+{
+    std::printf(
+        "Usage: %s <input.obj> <output.htmesh> [options]\n"
+        "  --format <f>   vertex format: float (32 bytes) or packed (20 bytes:\n"
+        "                 float position, 2_10_10_10 normal, half texcoord)\n"
+        "  --no-optimize  keep the triangle and vertex order of the file\n",
+        program );
+}
+
+/**
+* @section main
+*/
+int main(int argc, char** argv)
+{
+    if ( argc < 3 )
+    {
+        printUsage( argv[0] );
+        return EXIT_FAILURE;
+    }
+    const std::string input{ argv[1] };
+    const std::string output{ argv[2] };
+    std::string format{ "packed" };
+    bool optimize{ true };
+    for ( int i = 3; i < argc; ++i )
+    {
+        const std::string option{ argv[i] };
+        if ( option == "--format" && i + 1 < argc )
+        {
+            format = argv[++i];
+        }
+        else if ( option == "--no-optimize" )
+        {
+            optimize = false;
+        }
+        else
+        {
+            printUsage( argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+    if ( format != "float" && format != "packed" )
+    {
+        std::printf( "Unknown format %s\n", format.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        const ObjData obj = parseObj( readFile( input ) );
+        const Clock::time_point parsed = Clock::now();
+
+        // Merge corners with the same attributes into one vertex
+        const bool hasNormals = !obj.normals.empty();
+        const bool hasTexCoords = !obj.texCoords.empty();
+        Mesh mesh;
+        std::vector<float> normals;
+        std::vector<float> texCoords;
+        std::unordered_map<std::array<long, 3>, GLuint, CornerHash> vertexOf;
+        std::vector<long> positionOf;
+        for ( std::size_t c = 0; c < obj.corners.size(); c += 3 )
+        {
+            const std::array<long, 3> corner = { obj.corners[c],
+                                                 hasTexCoords ? obj.corners[c + 1] : -1,
+                                                 hasNormals ? obj.corners[c + 2] : -1 };
+            if ( corner[0] < 0 )
+            {
+                throw std::logic_error( "ERROR::MESH_CONVERT::INVALID_INDEX\n " + input );
+            }
+            auto found = vertexOf.find( corner );
+            if ( found == vertexOf.end() )
+            {
+                const GLuint vertex = static_cast<GLuint>( positionOf.size() );
+                found = vertexOf.emplace( corner, vertex ).first;
+                positionOf.push_back( corner[0] );
+                mesh.vertices.insert( mesh.vertices.end(),
+                                      obj.positions.begin() + corner[0] * 3,
+                                      obj.positions.begin() + corner[0] * 3 + 3 );
+                for ( std::size_t k = 0; k < 3; ++k )
+                {
+                    normals.push_back( corner[2] >= 0 ? obj.normals[corner[2] * 3 + k]
+                                                      : 0.0f );
+                }
+                for ( std::size_t k = 0; k < 2; ++k )
+                {
+                    texCoords.push_back( corner[1] >= 0 ? obj.texCoords[corner[1] * 2 + k]
+                                                        : 0.0f );
+                }
+            }
+            mesh.indices.push_back( found->second );
+        }
+        const std::size_t vertexCount = positionOf.size();
+
+        // Smooth normals: sum the face normals at every position
+        if ( !hasNormals )
+        {
+            std::vector<float> sums( obj.positions.size(), 0.0f );
+            for ( std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3 )
+            {
+                const float* p[3];
+                for ( int k = 0; k < 3; ++k )
+                {
+                    p[k] = &mesh.vertices[mesh.indices[t + k] * 3];
+                }
+                const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+                const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+                const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                     e1[2] * e2[0] - e1[0] * e2[2],
+                                     e1[0] * e2[1] - e1[1] * e2[0] };
+                for ( int k = 0; k < 3; ++k )
+                {
+                    float* sum = &sums[positionOf[mesh.indices[t + k]] * 3];
+                    sum[0] += n[0];
+                    sum[1] += n[1];
+                    sum[2] += n[2];
+                }
+            }
+            for ( std::size_t v = 0; v < vertexCount; ++v )
+            {
+                std::memcpy( &normals[v * 3], &sums[positionOf[v] * 3], 3 * sizeof( float ) );
+            }
+        }
+        for ( std::size_t v = 0; v < vertexCount; ++v )
+        {
+            float* n = &normals[v * 3];
+            const float length = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+            for ( int k = 0; k < 3 && length > 0.0f; ++k )
+            {
+                n[k] /= length;
+            }
+        }
+
+        // Reorder triangles for the vertex cache, then vertices by first use
+        double acmrBefore = computeACMR( mesh.indices, vertexCount );
+        double acmrAfter = acmrBefore;
+        if ( optimize )
+        {
+            optimizeVertexCache( mesh );
+            acmrAfter = computeACMR( mesh.indices, vertexCount );
+            std::vector<GLuint> remap( vertexCount, ~GLuint{ 0 } );
+            GLuint next{ 0 };
+            for ( GLuint& index : mesh.indices )
+            {
+                if ( remap[index] == ~GLuint{ 0 } )
+                {
+                    remap[index] = next++;
+                }
+                index = remap[index];
+            }
+            std::vector<float> positions( next * 3 ), moved( next * 3 ), uvs( next * 2 );
+            for ( std::size_t v = 0; v < vertexCount; ++v )
+            {
+                if ( remap[v] == ~GLuint{ 0 } )
+                {
+                    continue;
+                }
+                std::memcpy( &positions[remap[v] * 3], &mesh.vertices[v * 3], 3 * sizeof( float ) );
+                std::memcpy( &moved[remap[v] * 3], &normals[v * 3], 3 * sizeof( float ) );
+                std::memcpy( &uvs[remap[v] * 2], &texCoords[v * 2], 2 * sizeof( float ) );
+            }
+            mesh.vertices.swap( positions );
+            normals.swap( moved );
+            texCoords.swap( uvs );
+        }
+        const std::size_t finalCount = mesh.vertices.size() / 3;
+
+        VertexLayout layout;
+        std::vector<std::vector<float>> sources{ mesh.vertices };
+        layout.add( 0, 3, AttributeFormat::Float32 );
+        if ( format == "float" )
+        {
+            layout.add( 1, 3, AttributeFormat::Float32 );
+            sources.push_back( normals );
+            if ( hasTexCoords )
+            {
+                layout.add( 2, 2, AttributeFormat::Float32 );
+                sources.push_back( texCoords );
+            }
+        }
+        else
+        {
+            // 2_10_10_10 always has four components
+            std::vector<float> normals4;
+            normals4.reserve( finalCount * 4 );
+            for ( std::size_t v = 0; v < finalCount; ++v )
+            {
+                normals4.insert( normals4.end(), { normals[v * 3], normals[v * 3 + 1],
+                                                   normals[v * 3 + 2], 0.0f } );
+            }
+            layout.add( 1, 4, AttributeFormat::Snorm2_10_10_10 );
+            sources.push_back( normals4 );
+            if ( hasTexCoords )
+            {
+                layout.add( 2, 2, AttributeFormat::Half );
+                sources.push_back( texCoords );
+            }
+        }
+        writeMeshFile( output, layout, packVertices( layout, sources, finalCount ),
+                       mesh.indices, computeBounds( mesh.vertices ) );
+        const Clock::time_point written = Clock::now();
+
+        std::printf( "Parsed %s in %.3f ms: %zu positions, %zu normals, "
+                     "%zu texture coordinates, %zu triangles\n", input.c_str(),
+                     std::chrono::duration<double, std::milli>( parsed - start ).count(),
+                     obj.positions.size() / 3, obj.normals.size() / 3,
+                     obj.texCoords.size() / 2, mesh.indices.size() / 3 );
+        std::printf( "Wrote %s: %zu vertices of %zu bytes (%s), ACMR %.3f -> %.3f, "
+                     "%.3f ms in total\n", output.c_str(), finalCount,
+                     layout.getVertexSize(), format.c_str(), acmrBefore, acmrAfter,
+                     std::chrono::duration<double, std::milli>( written - start ).count() );
+    }
+    catch( const std::logic_error& except )
+    {
+        std::printf( "%s", except.what() );
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file buffer_arena_test.cpp
+ * @brief Checks that the OffsetAllocator and the BufferArena fill their
+ * capacity completely.
+ *
+ * A range that is exactly as large as a request has to be found, and an
+ * arena whose meshes fill it exactly has to keep every mesh intact when it
+ * defragments or grows. The arena is tested on a windowless EGL context.
+ * The program prints every failed check and exits with a failure status if
+ * there was one.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include "buffer_arena.hpp"
+#include "headless.hpp"
+#include "offset_allocator.hpp"
+
+/**
+* @section Helper functions
+*/
+
+static int failures{ 0 };
+
+static void check(bool condition, const char* what)
+{
+    if ( !condition )
+    {
+        std::printf( "FAILED: %s\n", what );
+        ++failures;
+    }
+}
+
+/**
+ * @brief Allocates a mesh of count vertices whose values all equal value.
+ */
+static BufferArena::Handle addMesh(BufferArena& arena, std::size_t count,
+                                   float value)
+{
+    const std::vector<float> vertices( count, value );
+    return arena.allocate( count, { vertices.data() }, nullptr, 0 );
+}
+
+/**
+ * @brief Tells whether the vertices of a mesh still hold its value.
+ */
+static bool holds(const BufferArena& arena, BufferArena::Handle handle,
+                  std::size_t count, float value)
+{
+    std::vector<float> vertices( count, 0.0f );
+    glBindBuffer( GL_COPY_READ_BUFFER, arena.getVBOId() );
+    glGetBufferSubData( GL_COPY_READ_BUFFER,
+                        static_cast<GLintptr>( arena.getFirstVertex( handle ) * sizeof( float ) ),
+                        static_cast<GLsizeiptr>( count * sizeof( float ) ),
+                        vertices.data() );
+    glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+    for ( float vertex : vertices )
+    {
+        if ( vertex != value )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+* @section Tests
+*/
+
+static void testAllocatorExactFit()
+{
+    OffsetAllocator whole( 100 );
+    const OffsetAllocator::Allocation all = whole.allocate( 100 );
+    check( all.node != OffsetAllocator::NO_SPACE && all.offset == 0,
+           "allocating the whole capacity" );
+    check( whole.getFreeSize() == 0, "no free space after the whole capacity" );
+
+    OffsetAllocator tail( 1000 );
+    tail.allocate( 900 );
+    const OffsetAllocator::Allocation rest = tail.allocate( 100 );
+    check( rest.node != OffsetAllocator::NO_SPACE && rest.offset == 900,
+           "allocating a tail of exactly the requested size" );
+    check( tail.allocate( 1 ).node == OffsetAllocator::NO_SPACE,
+           "allocating from a full allocator fails" );
+}
+
+static void testArenaFull()
+{
+    VertexLayout layout;
+    layout.add( 0, 1, AttributeFormat::Float32 );
+    BufferArena arena( layout, 1000, 0 );
+
+    // Two meshes fill the arena, so defragmenting replays a full layout
+    const BufferArena::Handle a = addMesh( arena, 500, 1.0f );
+    const BufferArena::Handle b = addMesh( arena, 500, 2.0f );
+    arena.defragment();
+    check( arena.getStats().usedVertices == 1000, "a full arena defragments" );
+    check( holds( arena, a, 500, 1.0f ) && holds( arena, b, 500, 2.0f ),
+           "meshes of a full arena survive defragmenting" );
+
+    // Four quarters with the first and third freed leave two holes that 
+    // only fit 500 vertices once defragmented, into a tail of exactly 500
+    arena.free( a );
+    arena.free( b );
+    const BufferArena::Handle c = addMesh( arena, 250, 3.0f );
+    const BufferArena::Handle d = addMesh( arena, 250, 4.0f );
+    const BufferArena::Handle e = addMesh( arena, 250, 5.0f );
+    const BufferArena::Handle f = addMesh( arena, 250, 6.0f );
+    arena.free( c );
+    arena.free( e );
+    const BufferArena::Handle g = addMesh( arena, 500, 7.0f );
+    const BufferArenaStats packed = arena.getStats();
+    check( packed.vertexCapacity == 1000 && packed.usedVertices == 1000,
+           "a tail of exactly the requested size is used without growing" );
+    check( holds( arena, d, 250, 4.0f ) && holds( arena, f, 250, 6.0f ) &&
+           holds( arena, g, 500, 7.0f ),
+           "meshes survive defragmenting into an exact tail" );
+
+    // A full arena grows and keeps its meshes
+    const BufferArena::Handle h = addMesh( arena, 100, 8.0f );
+    const BufferArenaStats grown = arena.getStats();
+    check( grown.vertexCapacity >= 1100 && grown.usedVertices == 1100,
+           "a full arena grows" );
+    check( holds( arena, d, 250, 4.0f ) && holds( arena, f, 250, 6.0f ) &&
+           holds( arena, g, 500, 7.0f ) && holds( arena, h, 100, 8.0f ),
+           "meshes survive growing a full arena" );
+}
+
+/**
+* @section main
+*/
+int main()
+{
+    testAllocatorExactFit();
+
+    HeadlessContext context;
+    if ( !context.createContext() ||
+         !gladLoadGLLoader( ( GLADloadproc ) HeadlessContext::getProcAddress ) )
+    {
+        std::printf( "Creating the headless OpenGL context failed\n" );
+        return EXIT_FAILURE;
+    }
+    try
+    {
+        testArenaFull();
+    }
+    catch( const std::logic_error& except )
+    {
+        std::printf( "%s\n", except.what() );
+        ++failures;
+    }
+    check( glGetError() == GL_NO_ERROR, "no OpenGL errors" );
+    std::printf( "%d failed checks\n", failures );
+    return failures > 0 ? EXIT_FAILURE : 0;
+}